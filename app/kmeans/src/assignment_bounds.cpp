@@ -0,0 +1,128 @@
+/*
+ * assignment_bounds.cpp
+ */
+
+#include "assignment_bounds.h"
+#include <assert.h>
+#include <algorithm>
+#include <cmath>
+#include "cluster_centers.h"
+#include "dataset.h"
+
+assignment_bounds::assignment_bounds() :
+		max_drift_(0) {
+}
+
+assignment_bounds::assignment_bounds(int num_points, int num_centers) :
+		center_drift_(num_centers, 0), center_drift_at_round_(num_centers, 0),
+		max_drift_(0) {
+	PointBounds unset;
+	unset.center_id = -1;
+	unset.upper = 0;
+	unset.lower = 0;
+	unset.center_drift_at_set = 0;
+	unset.max_drift_at_set = 0;
+	points_.resize(num_points, unset);
+}
+
+void assignment_bounds::AddCenterDrift(int center_id, float drift) {
+	center_drift_[center_id] += drift;
+}
+
+void assignment_bounds::EndRound() {
+	double round_max_drift = 0;
+	for (int i = 0; i < center_drift_.size(); ++i) {
+		round_max_drift = std::max(round_max_drift,
+				center_drift_[i] - center_drift_at_round_[i]);
+	}
+	max_drift_ += round_max_drift;
+	center_drift_at_round_ = center_drift_;
+}
+
+bool assignment_bounds::GetBounds(int point, int* center_id, float* upper,
+		float* lower) const {
+	assert(point >= 0 && point < points_.size());
+	const PointBounds& bounds = points_[point];
+	if (bounds.center_id < 0) {
+		return false;
+	}
+	*center_id = bounds.center_id;
+	*upper = bounds.upper
+			+ (center_drift_[bounds.center_id] - bounds.center_drift_at_set);
+	*lower = bounds.lower - (max_drift_ - bounds.max_drift_at_set);
+	return true;
+}
+
+void assignment_bounds::SetBounds(int point, int center_id, float upper,
+		float lower) {
+	assert(point >= 0 && point < points_.size());
+	PointBounds& bounds = points_[point];
+	bounds.center_id = center_id;
+	bounds.upper = upper;
+	bounds.lower = lower;
+	bounds.center_drift_at_set = center_drift_[center_id];
+	bounds.max_drift_at_set = max_drift_;
+}
+
+void assignment_bounds::SetUpperBound(int point, float upper) {
+	PointBounds& bounds = points_[point];
+	bounds.upper = upper;
+	bounds.center_drift_at_set = center_drift_[bounds.center_id];
+}
+
+int assignment_bounds::AssignPoints(const dataset& data,
+		const vector<int>& x_ids, int first_point, bool exact,
+		cluster_centers* centers, vector<int>* closest,
+		vector<float>* sq_distance) {
+	EndRound();
+	closest->resize(x_ids.size());
+	sq_distance->resize(x_ids.size());
+
+	// Points the bounds cannot settle, searched against all the centers at
+	// once.
+	vector<int> unresolved;
+	for (unsigned int p = 0; p < x_ids.size(); ++p) {
+		int point = x_ids[p] - first_point;
+		int center_id;
+		float upper, lower;
+		if (GetBounds(point, &center_id, &upper, &lower)) {
+			if (!exact && upper <= lower) {
+				(*closest)[p] = center_id;
+				(*sq_distance)[p] = upper * upper;
+				continue;
+			}
+			float sq = centers->SqDistanceToCenterI(center_id,
+					data.getDataPointAt(x_ids[p]));
+			upper = std::sqrt(std::max(sq, 0.0f));
+			SetUpperBound(point, upper);
+			if (upper <= lower) {
+				(*closest)[p] = center_id;
+				(*sq_distance)[p] = sq;
+				continue;
+			}
+		}
+		unresolved.push_back(p);
+	}
+	if (unresolved.empty()) {
+		return 0;
+	}
+
+	vector<const sparse_vector*> points(unresolved.size());
+	for (unsigned int u = 0; u < unresolved.size(); ++u) {
+		points[u] = &data.getDataPointAt(x_ids[unresolved[u]]);
+	}
+	vector<int> closest_centers;
+	vector<float> closest_sq_distance, second_sq_distance;
+	centers->PackCenters();
+	centers->FindTwoClosestCenters(points, &closest_centers,
+			&closest_sq_distance, &second_sq_distance);
+	for (unsigned int u = 0; u < unresolved.size(); ++u) {
+		int p = unresolved[u];
+		(*closest)[p] = closest_centers[u];
+		(*sq_distance)[p] = closest_sq_distance[u];
+		SetBounds(x_ids[p] - first_point, closest_centers[u],
+				std::sqrt(std::max(closest_sq_distance[u], 0.0f)),
+				std::sqrt(std::max(second_sq_distance[u], 0.0f)));
+	}
+	return unresolved.size();
+}
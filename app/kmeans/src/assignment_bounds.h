@@ -0,0 +1,72 @@
+/*
+ * assignment_bounds.h
+ *
+ * Hamerly-style bounds on the distance from each point to the centers,
+ * kept across mini-batches so that points whose closest center cannot have
+ * changed skip the distance computations.
+ */
+
+#ifndef ASSIGNMENT_BOUNDS_H_
+#define ASSIGNMENT_BOUNDS_H_
+
+#include <vector>
+
+using std::vector;
+
+class cluster_centers;
+class dataset;
+
+// For each point: an upper bound on the distance to its assigned center and
+// a lower bound on the distance to every other center. While upper <= lower
+// the assigned center is still the closest one.
+//
+// Centers report how far they move with AddCenterDrift(). The upper bound of
+// a point grows by the drift of its center since the bound was set; the
+// lower bound shrinks by the sum, over the rounds since, of the largest
+// drift of any center in the round. Rounds are delimited by EndRound(),
+// which is O(number of centers), so a point costs O(1) to check however
+// many centers there are. Distances are Euclidean, not squared.
+class assignment_bounds {
+public:
+	assignment_bounds();
+	assignment_bounds(int num_points, int num_centers);
+	void AddCenterDrift(int center_id, float drift);
+	void EndRound();
+	// Returns false if the point has no bounds yet. Otherwise center_id is
+	// the assigned center and upper / lower the bounds as of now.
+	bool GetBounds(int point, int* center_id, float* upper,
+			float* lower) const;
+	void SetBounds(int point, int center_id, float upper, float lower);
+	// Replaces the upper bound by the exact distance to the assigned center.
+	void SetUpperBound(int point, float upper);
+	// Ends the round, then finds the closest center and squared distance to
+	// it for each of the points x_ids of data; point x_ids[p] has the bounds
+	// of x_ids[p] - first_point. Points whose bounds prove their center
+	// unchanged skip the search; with exact, their distance is still
+	// recomputed, otherwise it may be an overestimate. The rest are searched
+	// together with centers->FindTwoClosestCenters(), and their bounds set.
+	// Returns the number of points searched.
+	int AssignPoints(const dataset& data, const vector<int>& x_ids,
+			int first_point, bool exact, cluster_centers* centers,
+			vector<int>* closest, vector<float>* sq_distance);
+
+private:
+	struct PointBounds {
+		int center_id;
+		float upper;
+		float lower;
+		// center_drift_[center_id] and max_drift_ when the bounds were set.
+		double center_drift_at_set;
+		double max_drift_at_set;
+	};
+
+	vector<PointBounds> points_;
+	// Total drift of each center so far.
+	vector<double> center_drift_;
+	// center_drift_ at the last EndRound().
+	vector<double> center_drift_at_round_;
+	// Sum over the rounds so far of the largest drift in the round.
+	double max_drift_;
+};
+
+#endif /* ASSIGNMENT_BOUNDS_H_ */
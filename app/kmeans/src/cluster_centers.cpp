@@ -5,6 +5,7 @@
  *      Author: manu
  */
 #include <assert.h>
+#include <algorithm>
 #include <cmath>
 #include <cstdlib>
 #include <float.h>
@@ -19,8 +20,17 @@
 
 using std::vector;
 
+namespace {
+
+// Bytes of packed centers FindTwoClosestCenters() keeps hot per tile; about
+// half of a typical L2.
+const int kCenterTileBytes = 128 * 1024;
+
+}  // anonymous namespace
+
 cluster_centers::cluster_centers(int dimensionality, int number_of_clusters) :
-		number_of_clusters_(number_of_clusters), dimensionality_(dimensionality) {
+		number_of_clusters_(number_of_clusters), dimensionality_(dimensionality),
+		center_tile_(0) {
 	assert(dimensionality_ > 0);
 	assert(number_of_clusters > 0);
 
@@ -76,16 +86,103 @@ float cluster_centers::SqDistanceToClosestCenter(const sparse_vector& x,
 
 }
 
+void cluster_centers::PackCenters() {
+	packed_centers_.resize(dimensionality_ * number_of_clusters_);
+	packed_square_norms_.resize(number_of_clusters_);
+	for (int c = 0; c < number_of_clusters_; ++c) {
+		const sparse_vector& center = cluster_centers_[c];
+		for (int j = 0; j < dimensionality_; ++j) {
+			packed_centers_[j * number_of_clusters_ + c] = center.ValueAt(j);
+		}
+		packed_square_norms_[c] = center.getSquareNorm();
+	}
+	// A multiple of 16 so the inner loop vectorizes evenly.
+	center_tile_ = kCenterTileBytes / (sizeof(float) * dimensionality_);
+	center_tile_ = std::max(16, center_tile_ / 16 * 16);
+	center_tile_ = std::min(center_tile_, number_of_clusters_);
+}
+
+void cluster_centers::FindTwoClosestCenters(
+		const vector<const sparse_vector*>& points, vector<int>* closest,
+		vector<float>* closest_sq_distance,
+		vector<float>* second_sq_distance) const {
+	assert(center_tile_ > 0);
+	int num_points = points.size();
+	closest->assign(num_points, 0);
+	closest_sq_distance->assign(num_points, FLT_MAX);
+	second_sq_distance->assign(num_points, FLT_MAX);
+	for (int p = 0; p < num_points; ++p) {
+		const sparse_vector& x = *points[p];
+		int first_feature_id = x.FirstFeatureId();
+		for (int i = 0; i < x.size(); ++i) {
+			int j = x.FeatureAt(i) - first_feature_id;
+			CHECK(j >= 0 && j < dimensionality_) << "feature id "
+					<< x.FeatureAt(i) << " out of range for dimensionality "
+					<< dimensionality_;
+		}
+	}
+
+	// One tile of centers is streamed against every point before moving on,
+	// so each packed row is loaded from memory once per tile rather than
+	// once per point. The inner products of a point with the tile are
+	// accumulated one feature at a time (x_j * row j of the tile), which
+	// vectorizes over the centers.
+	vector<float> inner_products(center_tile_);
+	for (int tile_begin = 0; tile_begin < number_of_clusters_;
+			tile_begin += center_tile_) {
+		int tile_size = std::min(center_tile_, number_of_clusters_ - tile_begin);
+		const float* tile_norms = &packed_square_norms_[tile_begin];
+		for (int p = 0; p < num_points; ++p) {
+			const sparse_vector& x = *points[p];
+			float* prod = &inner_products[0];
+			std::fill(prod, prod + tile_size, 0);
+			int first_feature_id = x.FirstFeatureId();
+			for (int i = 0; i < x.size(); ++i) {
+				float value = x.ValueAt(i);
+				int j = x.FeatureAt(i) - first_feature_id;
+				const float* row = &packed_centers_[j * number_of_clusters_
+						+ tile_begin];
+				for (int c = 0; c < tile_size; ++c) {
+					prod[c] += value * row[c];
+				}
+			}
+
+			float best = (*closest_sq_distance)[p];
+			float second = (*second_sq_distance)[p];
+			int best_center = (*closest)[p];
+			float x_norm = x.getSquareNorm();
+			for (int c = 0; c < tile_size; ++c) {
+				float distance = x_norm + tile_norms[c] - 2 * prod[c];
+				if (distance < best) {
+					second = best;
+					best = distance;
+					best_center = tile_begin + c;
+				} else if (distance < second) {
+					second = distance;
+				}
+			}
+			(*closest_sq_distance)[p] = best;
+			(*second_sq_distance)[p] = second;
+			(*closest)[p] = best_center;
+		}
+	}
+}
+
 cluster_centers::cluster_centers() {
 	dimensionality_ = 0;
 	number_of_clusters_ = 0;
+	center_tile_ = 0;
 }
 
 void cluster_centers::clear() {
 	for (int i = 0; i < number_of_clusters_; i++) {
-		for (int j = 0; j < dimensionality_; j++) {
-			cluster_centers_[i].set(j, 0);
-		}
+		clearCenterAt(i);
+	}
+}
+
+void cluster_centers::clearCenterAt(int position) {
+	for (int j = 0; j < dimensionality_; j++) {
+		cluster_centers_[position].set(j, 0);
 	}
 }
 
@@ -24,23 +24,40 @@ public:
 	void random_initiliaze();
 	const sparse_vector& getCenterAt(int position) const;
 	float SqDistanceToClosestCenter(const sparse_vector& x, int& center_id);
+	float SqDistanceToCenterI(int center_id, const sparse_vector& x);
+	// Copies the centers into the feature-major layout used by
+	// FindTwoClosestCenters(). Must be called again once the centers change.
+	void PackCenters();
+	// Squared distances from each point to its closest and second closest
+	// center as of the last PackCenters(), computed as
+	// ||x||^2 + ||c||^2 - 2 x.c over tiles of centers that stay in cache
+	// across all the points. second_sq_distance is FLT_MAX with one center.
+	void FindTwoClosestCenters(const vector<const sparse_vector*>& points,
+			vector<int>* closest, vector<float>* closest_sq_distance,
+			vector<float>* second_sq_distance) const;
 	int NumOfCenters() const {
 		return cluster_centers_.size();
 	}
 	;
 	sparse_vector* getPointerToCenterAt(int position);
 	void clear();
+	void clearCenterAt(int position);
 	void setValueToFeature(int center, int featureId, float featureValue);
 	void saveClusterCentersToDisk(string location);
 	void LoadClusterCentersFromDisk(string location);
 
 protected:
-	float SqDistanceToCenterI(int center_id, const sparse_vector& x);
-
 	// The set of cluster centers.
 	vector<sparse_vector> cluster_centers_;
 	int number_of_clusters_;
 	int dimensionality_;
+
+	// Written by PackCenters(): value j of center c is at
+	// packed_centers_[j * number_of_clusters_ + c].
+	vector<float> packed_centers_;
+	vector<float> packed_square_norms_;
+	// Number of centers per tile in FindTwoClosestCenters().
+	int center_tile_;
 	
 
 private:
@@ -46,7 +46,7 @@ int dataset::Size() const{
   return dataset_.size();
 }
 
-const sparse_vector dataset::getDataPointAt(long x) const {
+const sparse_vector& dataset::getDataPointAt(long x) const {
   assert(x<dataset_.size());
   return dataset_[x];
 }
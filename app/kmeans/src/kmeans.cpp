@@ -78,13 +78,9 @@ void KMeans::Start() {
   string cluster_centers_input_location = context.get_string("cluster_centers_input_location");
   int center_table_id = context.get_int32("centres_table_id");
 
-  int delta_center_table_id=context.get_int32("update_centres_table_id");
   int objective_value_table_id = context.get_int32("objective_function_value_tableId");
   centres_ = petuum::PSTableGroup::GetTableOrDie<float>(center_table_id);
   objective_values_ = petuum::PSTableGroup::GetTableOrDie<float>(objective_value_table_id);
-  int center_count_table_id = context.get_int32("center_count_tableId");
-  count_of_centers_ = petuum::PSTableGroup::GetTableOrDie<int>(center_count_table_id);
-  delta_centers_ = petuum::PSTableGroup::GetTableOrDie<int>(delta_center_table_id);
 
   petuum::HighResolutionTimer center_initialization_timer;
   cluster_centers initial_centres(dimensionality, num_centers);
@@ -124,13 +120,12 @@ void KMeans::Start() {
   KMeansWorkerConfig config;
   config.machine_id_ = client_id;
   config.num_threads_=context.get_int32("num_app_threads");
+  config.num_clients_ = context.get_int32("num_clients");
   config.examples_per_batch_=examples_per_batch_;
-  config.delta_centers_=delta_centers_;
   config.num_centers = num_centers;
   config.centers_=centres_;
   config.objective_values_ = objective_values_;
   config.dimensionality=dimensionality;
-  config.center_counts = count_of_centers_;
   config.size_of_mini_batch = mini_batch_size;
   config.assignment_output_location_ =
     context.get_string("output_file_prefix") + ".assignment";
@@ -140,9 +135,8 @@ void KMeans::Start() {
   config.start_example = (thread_id * examples_per_thread_);
   config.end_example = config.start_example + examples_per_thread_;
   config.learning_rate_= context.get_double("learning_rate");
-  config.process_barrier_ = process_barrier_.get();
   KMeansWorker workerThread(config);
-  workerThread.RefreshParams();
+  workerThread.RefreshParams(true);
   workerThread.PushObjective(0,num_epochs+1,false);
   petuum::HighResolutionTimer checkpoint_timer;
   if(client_id==0 && thread_id ==0){
@@ -150,9 +144,7 @@ void KMeans::Start() {
   }
   for (int epoch = 0; epoch < num_epochs; epoch++) {
     workerThread.SolveOneMiniBatchIteration();
-    petuum::PSTableGroup::Clock();
-
-    workerThread.RefreshParams();
+    workerThread.RefreshParams(false);
   }
   LOG(INFO) << "Completed miniBatch iterations. Optimization took " << checkpoint_timer.elapsed() << " seconds in client:" << client_id  << " thread: "<< thread_id;
   if(client_id==0 && thread_id ==0){
@@ -163,7 +155,7 @@ void KMeans::Start() {
 
   // Computing Objectives
   workerThread.ClearLocalCenters();
-  workerThread.RefreshParams();
+  workerThread.RefreshParams(true);
   petuum::PSTableGroup::Clock();
   workerThread.PushObjective(num_epochs, num_epochs+1, true);
   process_barrier_->wait();
@@ -54,8 +54,6 @@ private:
 
 	  // ============ PS Tables ============
 	  petuum::Table<float> centres_;
-	  petuum::Table<int> count_of_centers_;
-	  petuum::Table<int> delta_centers_;
 	  petuum::Table<float> objective_values_;
 
 	  int examples_per_batch_;
@@ -58,14 +58,10 @@ DEFINE_string(output_file_prefix, "", "Results go here.");
 
 //petuum tables.
 DEFINE_int32(centres_table_id, 0, "Weight table's ID in PS.");
-DEFINE_int32(update_centres_table_id, 3, "Delta Weight table's ID in PS. This is used to accumulate changes and then apply them.");
-DEFINE_int32(center_count_tableId, 1, "center count's ID in PS.");
 DEFINE_int32(objective_function_value_tableId, 4, "objective function value table id");
 
 DEFINE_int32(staleness, 0, "staleness for centers tables.");
-DEFINE_int32(count_table_staleness, 0, "staleness for center count table.");
 DEFINE_int32(objective_table_stalesness,0,"staleness for objective function table");
-DEFINE_int32(update_centres_table_stalenss,0,"staleness for the table which hold the ith epochs number of centers");
 
 
 DEFINE_int32(row_oplog_type, petuum::RowOpLogType::kSparseRowOpLog,
@@ -96,7 +92,7 @@ int main(int argc, char *argv[]) {
 			FLAGS_num_comm_channels_per_client;
 	table_group_config.num_total_clients = FLAGS_num_clients;
 
-	table_group_config.num_tables = 4;
+	table_group_config.num_tables = 2;
 	//  // + 1 for main() thread.
 	table_group_config.num_local_app_threads = FLAGS_num_app_threads + 1;
 	table_group_config.client_id = FLAGS_client_id;
@@ -126,11 +122,13 @@ int main(int argc, char *argv[]) {
 	table_config.table_info.row_type = kDenseRowFloatTypeID;
 	table_config.table_info.table_staleness = FLAGS_staleness;
 	//  //table_config.table_info.row_capacity = feature_dim * num_labels;
-	table_config.table_info.row_capacity = FLAGS_dimensionality;
+	// + 1 for the number of points applied to the center.
+	table_config.table_info.row_capacity = FLAGS_dimensionality + 1;
 	table_config.table_info.row_oplog_type = FLAGS_row_oplog_type;
 	table_config.table_info.oplog_dense_serialized =
 			FLAGS_oplog_dense_serialized;
-	table_config.table_info.dense_row_oplog_capacity = FLAGS_dimensionality;
+	table_config.table_info.dense_row_oplog_capacity =
+			FLAGS_dimensionality + 1;
 	//  //table_config.process_cache_capacity = 1;
 	table_config.process_cache_capacity = FLAGS_num_centers;
 	table_config.oplog_capacity = table_config.process_cache_capacity;
@@ -146,19 +144,6 @@ int main(int argc, char *argv[]) {
 	LOG(INFO) << "created objective values table";
 
 
-	// Centers table
-	table_config.table_info.row_type = kDenseRowIntTypeID;
-	table_config.table_info.table_staleness = FLAGS_count_table_staleness;
-	table_config.table_info.row_capacity = FLAGS_num_centers;
-	table_config.process_cache_capacity = 1000;
-	table_config.oplog_capacity = table_config.process_cache_capacity;
-	petuum::PSTableGroup::CreateTable(FLAGS_center_count_tableId, table_config);
-
-
-	// Table to hold the local deltas.
-	petuum::PSTableGroup::CreateTable(FLAGS_update_centres_table_id, table_config);
-
-
 	LOG(INFO) << "Completed creating tables" ;
 
 	petuum::PSTableGroup::CreateTableDone();
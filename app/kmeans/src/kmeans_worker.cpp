@@ -10,6 +10,7 @@
 #include <petuum_ps_common/include/petuum_ps.hpp>
 #include "dataset.h"
 #include <assert.h>
+#include <algorithm>
 #include <cmath>
 #include <cstdlib>
 #include <cstdio>
@@ -52,23 +53,22 @@ float KMeansWorker::ComputeObjective() {
 KMeansWorker::KMeansWorker(KMeansWorkerConfig config) :
 
 		dimensions_(config.dimensionality), num_centers_(config.num_centers), size_of_miniBatch_(
-				config.size_of_mini_batch),machine_id_(config.machine_id_),num_threads_(config.num_threads_), thread_id_(config.threadid), start_range_(
+				config.size_of_mini_batch),machine_id_(config.machine_id_),num_threads_(config.num_threads_), num_clients_(config.num_clients_), thread_id_(config.threadid), start_range_(
 				config.start_example), end_range_(config.end_example),examples_per_batch_(config.examples_per_batch_), learning_rate_(config.learning_rate_)
 				{
 
 	assignment_output_location_ = config.assignment_output_location_;
 	centers_ = config.centers_;
-	delta_centers_ = config.delta_centers_;
-	center_count_ = config.center_counts;
 	objective_values_ = config.objective_values_;
 
 	centers_local_ = cluster_centers(dimensions_, num_centers_);
 	delta_local_ = cluster_centers(dimensions_, num_centers_);
+	bounds_ = assignment_bounds(end_range_ - start_range_, num_centers_);
 	center_count_local_.resize(num_centers_);
 	center_count_delta_.resize(num_centers_);
-	center_count_delta_accross_machines.resize(num_centers_);
+	global_count_seen_.resize(num_centers_);
+	others_count_.resize(num_centers_, -1);
 	training_data_ = config.dataset_;
-	process_barrier_ = config.process_barrier_;
 	std::random_device rd;
 	generator_ = std::mt19937(rd());
 	distribution_ = std::uniform_int_distribution<>(start_range_,
@@ -91,71 +91,74 @@ void KMeansWorker::PushObjective(int epoch, int totalEpochs, bool writeAssignmen
 	
 	objective_values_.BatchInc(0, objective_update_batch);
 }
-void KMeansWorker::RefreshParams() {
-
-	//updating the centers counts and the number of centers processes per count.
-	petuum::UpdateBatch<int> center_count_update_batch(num_centers_);
-	petuum::UpdateBatch<int> center_count_update_batch_delta(num_centers_);
-
+void KMeansWorker::RefreshParams(bool pull_all_centers) {
+	// Push the deltas of the centers that received points since the last
+	// refresh, with the number of points in the count column.
+	//
+	// The delta of a center is weighted by this worker's share of the points
+	// all workers applied to it in the round. That share is not known
+	// without a barrier, so it is a heuristic: the other workers are assumed
+	// to apply as many points as they did between the last two refreshes,
+	// or before that is known, every worker is given an equal 1/N share.
+	int num_workers = num_clients_ * num_threads_;
+	petuum::DenseUpdateBatch<float> center_update_batch(0, dimensions_ + 1);
 	for (int i = 0; i < num_centers_; i++) {
-		center_count_update_batch.Update(i, center_count_delta_[i]);
-		center_count_update_batch_delta.Update(i, center_count_delta_[i]);
+		if (center_count_delta_[i] == 0) {
+			continue;
+		}
+		float weight = 1.0 / num_workers;
+		if (others_count_[i] >= 0) {
+			weight = ((float) center_count_delta_[i])
+					/ (center_count_delta_[i] + others_count_[i]);
+		}
+		const sparse_vector& delta = delta_local_.getCenterAt(i);
+		for (int j = 0; j < dimensions_; j++) {
+			center_update_batch[j] = delta.ValueAt(j) * weight;
+		}
+		center_update_batch[dimensions_] = center_count_delta_[i];
+		centers_.ThreadDenseBatchInc(i, center_update_batch);
+		delta_local_.clearCenterAt(i);
 	}
-	center_count_.BatchInc(0, center_count_update_batch);
-	delta_centers_.BatchInc(0,center_count_update_batch_delta);
 
-	
-	process_barrier_->wait();
+	// No barrier: how far this worker may run ahead of the others is bounded
+	// by the tables' staleness.
 	petuum::PSTableGroup::Clock();
-	petuum::PSTableGroup::GlobalBarrier();
-
-
 
-	std::vector<int> tmp_row1(num_centers_);
-	petuum::RowAccessor row_acc;	
-	
-	const auto& r = delta_centers_.Get<petuum::DenseRow<int> >(0,&row_acc);
-
-	r.CopyToVector(&tmp_row1);
-	for (int j = 0; j < num_centers_; j++) {
-		center_count_delta_accross_machines[j] = tmp_row1[j];
-	}
+	// Pull the centers whose count moved, i.e. that someone applied points
+	// to since the last pull. The count is read from the same row as the
+	// values, so a center is never skipped while its values are newer than
+	// the count says. Counts are floats, exact up to 2^24 points per center;
+	// past that, increments are lost and a center may stop being pulled.
+	std::vector<float> tmp_row(dimensions_ + 1);
 	for (int i = 0; i < num_centers_; i++) {
-		petuum::UpdateBatch<float> center_update_batch(dimensions_);
-		for (int j = 0; j < dimensions_; j++) {
-			if (center_count_delta_accross_machines[i] == 0) {
-				center_update_batch.Update(j, 0);
-			} else {
-				center_update_batch.Update(j,
-						delta_local_.getCenterAt(i).ValueAt(j)
-								* (((double) center_count_delta_[i])
-										/ center_count_delta_accross_machines[i]));
+		petuum::ThreadRowAccessor row_acc;
+		centers_.ThreadGet(i, &row_acc);
+		const petuum::DenseRow<float>& row =
+				row_acc.Get<petuum::DenseRow<float> >();
+		float global_count = row[dimensions_];
+		CHECK_LT(global_count, 16777216.0f) << "center " << i
+				<< " has more points than its float count can hold exactly";
+		if (!pull_all_centers) {
+			others_count_[i] = (int) std::max(0.0f, global_count
+					- global_count_seen_[i] - center_count_delta_[i]);
+			if (global_count == global_count_seen_[i]) {
+				continue;
 			}
 		}
-		centers_.BatchInc(i, center_update_batch);
-	}
-	delta_local_.clear();
-	petuum::UpdateBatch<int> center_count_update_batch_delta1(num_centers_);
-	for (int i = 0; i < num_centers_; i++) {
-		center_count_update_batch_delta1.Update(i, -1 * (center_count_delta_[i]));
-	}
-	delta_centers_.BatchInc(0, center_count_update_batch_delta1);
+		row.CopyToVector(&tmp_row);
+		global_count_seen_[i] = tmp_row[dimensions_];
 
-	std::fill(center_count_delta_.begin(), center_count_delta_.end(), 0);
-	std::fill(center_count_delta_accross_machines.begin(), center_count_delta_accross_machines.end(), 0);
-
-
-	process_barrier_->wait();
-	std::vector<float> tmp_row(dimensions_);
-	for (int i = 0; i < num_centers_; i++) {
-		petuum::RowAccessor row_acc;
-		const auto&  r1 = centers_.Get<petuum::DenseRow<float> >(i,&row_acc);
-		r1.CopyToVector(&tmp_row);
+		const sparse_vector& center = centers_local_.getCenterAt(i);
+		float sq_drift = 0;
 		for (int j = 0; j < dimensions_; j++) {
+			float diff = tmp_row[j] - center.ValueAt(j);
+			sq_drift += diff * diff;
 			centers_local_.setValueToFeature(i, j, tmp_row[j]);
 		}
 		centers_local_.getPointerToCenterAt(i)->reComputeSquaredNorm();
+		bounds_.AddCenterDrift(i, std::sqrt(sq_drift));
 	}
+	std::fill(center_count_delta_.begin(), center_count_delta_.end(), 0);
 }
 
 
@@ -165,14 +168,17 @@ void KMeansWorker::ClearLocalCenters(){
 
 void KMeansWorker::SolveOneMiniBatchIteration() {
 	vector<vector<int> > mini_batch_centers(centers_local_.NumOfCenters());
+	// Find the closest center for each training point in the mini-batch.
+	vector<int> x_ids(size_of_miniBatch_);
 	for (int i = 0; i < size_of_miniBatch_; ++i) {
-		// Find the closest center for a training point.
-
-		int x_id = GetRandInteger();
-		int closest_center;
-		centers_local_.SqDistanceToClosestCenter(
-				training_data_->getDataPointAt(x_id), closest_center);
-		mini_batch_centers[closest_center].push_back(x_id);
+		x_ids[i] = GetRandInteger();
+	}
+	vector<int> closest;
+	vector<float> sq_distance;
+	bounds_.AssignPoints(*training_data_, x_ids, start_range_, false,
+			&centers_local_, &closest, &sq_distance);
+	for (int i = 0; i < size_of_miniBatch_; ++i) {
+		mini_batch_centers[closest[i]].push_back(x_ids[i]);
 	}
 
 	// Apply the mini-batch.
@@ -180,17 +186,19 @@ void KMeansWorker::SolveOneMiniBatchIteration() {
 		for (unsigned int j = 0; j < mini_batch_centers[i].size(); ++j) {
 			float eta = learning_rate_
 					/ (++(center_count_local_[i]) + learning_rate_);
+			const sparse_vector& x =
+					training_data_->getDataPointAt(mini_batch_centers[i][j]);
+
+			// The center moves by eta * ||x - c||.
+			float sq = centers_local_.SqDistanceToCenterI(i, x);
+			bounds_.AddCenterDrift(i, eta * std::sqrt(std::max(sq, 0.0f)));
 
 			center_count_delta_[i]++;
-			delta_local_.getPointerToCenterAt(i)->Add(
-					training_data_->getDataPointAt(mini_batch_centers[i][j]),
-					eta);
+			delta_local_.getPointerToCenterAt(i)->Add(x, eta);
 			delta_local_.getPointerToCenterAt(i)->Add(
 					centers_local_.getCenterAt(i), -1.0 * eta);
 			centers_local_.getPointerToCenterAt(i)->scaleBy(1.0 - eta);
-			centers_local_.getPointerToCenterAt(i)->Add(
-					training_data_->getDataPointAt(mini_batch_centers[i][j]),
-					eta);
+			centers_local_.getPointerToCenterAt(i)->Add(x, eta);
 		}
 	}
 	mini_batch_centers.clear();
@@ -215,7 +223,15 @@ int KMeansWorker::ComputeNumberOfPointsObserved() {
 }
 
 float KMeansWorker::ComputeObjective(int startPoint, int endPoint, bool write_assignments){
-	int center_id;
+	vector<int> x_ids;
+	for (int i = startPoint; (i<endPoint && i < training_data_->Size()); ++i) {
+		x_ids.push_back(i);
+	}
+	vector<int> closest;
+	vector<float> sq_distance;
+	bounds_.AssignPoints(*training_data_, x_ids, start_range_, true,
+			&centers_local_, &closest, &sq_distance);
+
 	float total_sq_distance = 0.0;
 	int base = machine_id_*examples_per_batch_;
 
@@ -223,10 +239,9 @@ float KMeansWorker::ComputeObjective(int startPoint, int endPoint, bool write_as
   std::string output_assignments_file = assignment_output_location_ +
     std::to_string(fileId) + ".txt";
   petuum::io::ofstream output(output_assignments_file);
-	for (int i = startPoint; (i<endPoint && i < training_data_->Size()); ++i) {
-		total_sq_distance += centers_local_.SqDistanceToClosestCenter(
-				training_data_->getDataPointAt(i), center_id);
-    output << (i + base) << " " << center_id << std::endl; 
+	for (unsigned int p = 0; p < x_ids.size(); ++p) {
+		total_sq_distance += sq_distance[p];
+    output << (x_ids[p] + base) << " " << closest[p] << std::endl; 
 	}
 	return total_sq_distance;
 }
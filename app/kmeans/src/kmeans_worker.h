@@ -15,6 +15,7 @@
 #include <cstdint>
 #include <vector>
 #include <functional>
+#include "assignment_bounds.h"
 #include "cluster_centers.h"
 #include "dataset.h"
 #include "random"
@@ -26,8 +27,6 @@ struct KMeansWorkerConfig {
 	int32_t size_of_mini_batch;
 	string assignment_output_location_;
 	petuum::Table<float> centers_;
-	petuum::Table<int> delta_centers_;
-	petuum::Table<int> center_counts;
 	petuum::Table<float> objective_values_;
 	const dataset* dataset_;
 	int examples_per_batch_;
@@ -36,7 +35,7 @@ struct KMeansWorkerConfig {
 	float learning_rate_;
 	int machine_id_;
 	int num_threads_;
-	boost::barrier* process_barrier_;
+	int num_clients_;
 
 };
 
@@ -44,7 +43,9 @@ class KMeansWorker {
 public:
 	KMeansWorker(KMeansWorkerConfig config);
 	virtual ~KMeansWorker();
-	void RefreshParams();
+	// Pushes the local center updates and pulls the centers others updated,
+	// or all of them with pull_all_centers. Clocks the table group once.
+	void RefreshParams(bool pull_all_centers);
 	void SolveOneMiniBatchIteration();
 	int GetRandInteger();
 	float ComputeObjective();
@@ -56,15 +57,13 @@ public:
 	void PushObjective(int epoch, int num_epochs,bool writeAssignments);
 
 private:
-
-
-	
 	int32_t dimensions_; // feature dimension
 	int32_t num_centers_; // number of classes/labels
 	
 	int32_t size_of_miniBatch_;
 	int machine_id_;
 	int num_threads_;
+	int num_clients_;
 	int thread_id_;
 	int start_range_;
 	int end_range_;
@@ -72,24 +71,28 @@ private:
 	float learning_rate_;
 	string assignment_output_location_;
 	// ======== PS Tables ==========
-	// The weight of each class (stored as single feature-major row).
+	// One row per center: its dimensions_ values, then the number of points
+	// applied to it so far in column dimensions_.
 	petuum::Table<float> centers_;
-	petuum::Table<int> center_count_;
-	petuum::Table<int> delta_centers_;
 	petuum::Table<float> objective_values_;
 
 
 
 	cluster_centers centers_local_;
 	cluster_centers delta_local_;
+	// Bounds of the points in [start_range_, end_range_) w.r.t.
+	// centers_local_.
+	assignment_bounds bounds_;
 	std::vector<int> center_count_local_;
-	std::vector<int> center_count_delta_accross_machines;
-
+	// Points applied to each center since the last refresh.
 	std::vector<int> center_count_delta_;
+	// The count column of each center's row as of the last pull.
+	std::vector<float> global_count_seen_;
+	// Points the other workers applied to each center between the last two
+	// refreshes; -1 until the first refresh after a mini-batch.
+	std::vector<int> others_count_;
 	const dataset* training_data_;
 
-
-	boost::barrier * process_barrier_;
 	std::mt19937 generator_;
 	std::uniform_int_distribution<> distribution_;
 
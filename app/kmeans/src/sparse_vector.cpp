@@ -10,22 +10,30 @@
 #include <cstring>
 #include <cstdio>
 #include <cstdlib>
+#include <cmath>
 #include <iostream>
 #include <sstream>
 #include <assert.h>
 #include <glog/logging.h>
 
+namespace {
 
+// scaleBy() folds the lazy scale into the values once it gets this small,
+// before the stored values lose precision.
+const float kMinScale = 1e-6;
 
+}  // anonymous namespace
 
 sparse_vector::sparse_vector() {
 	isSparse_=true;
 	square_norm = 0;
+	scale_ = 1;
 
 }
 
 sparse_vector::sparse_vector(const char* input) {
 	square_norm = 0;
+	scale_ = 1;
 	const char* pos;
 	pos = strchr(input,':');
 	int i=0;
@@ -69,13 +77,14 @@ sparse_vector::sparse_vector(int size, bool isSparse) {
 	isSparse_=isSparse;
 	vectors_.resize(size);
 	square_norm = 0;
+	scale_ = 1;
 
 }
 
 void sparse_vector::push_back(int id, float value) {
 	FeatureValuePair pair;
 	pair.id_=id;
-	pair.value_=value;
+	pair.value_=value / scale_;
 	vectors_.push_back(pair);
 	square_norm+=(value*value);
 }
@@ -92,7 +101,7 @@ int sparse_vector::FeatureAt(int i) const {
 
 
 float sparse_vector::ValueAt(int i) const {
-	return vectors_[i].value_;
+	return vectors_[i].value_ * scale_;
 }
 
 
@@ -109,11 +118,13 @@ sparse_vector::sparse_vector(const sparse_vector& s) {
 	isSparse_ = s.isSparse_;
 	vectors_ = s.vectors_;
 	square_norm = s.square_norm;
+	scale_ = s.scale_;
 }
 sparse_vector::sparse_vector(const sparse_vector& s, bool setParse) {
 	isSparse_ = setParse;
 	vectors_ = s.vectors_;
 	square_norm = s.square_norm;
+	scale_ = s.scale_;
 }
 
 float sparse_vector::getInnerProduct(const sparse_vector& x) {
@@ -125,33 +136,42 @@ float sparse_vector::getInnerProduct(const sparse_vector& x) {
 			prod+= vectors_[id-1].value_ * x.ValueAt(i);
 		}
 	}
-	return prod;
+	return prod * scale_;
 }
 
 void sparse_vector::scaleBy(float eta){
+	scale_ *= eta;
+	square_norm = square_norm * eta *eta;
+	if (std::fabs(scale_) < kMinScale) {
+		FoldScale();
+	}
+}
+
+void sparse_vector::FoldScale() {
 	for(int i=0;i<vectors_.size();i++){
-		vectors_[i].value_ *=eta;
+		vectors_[i].value_ *= scale_;
 	}
-  square_norm = square_norm * eta *eta;
+	scale_ = 1;
 }
 
 void sparse_vector::Add(const sparse_vector& x, float eta){
 	assert(this->isSparse_ == false);
 	float inner_product = 0.0;
+	float inv_scale = 1 / scale_;
 	for (int i = 0; i < x.size(); i++) {
 		int id = x.FeatureAt(i);
 		float value = (x.ValueAt(i))*eta;
 		inner_product += (vectors_[id-1].value_) * value;
 		// indexing begins at 0 for the center.
-		vectors_[id-1].value_+= value;
+		vectors_[id-1].value_+= value * inv_scale;
 	}
-	square_norm += x.getSquareNorm()* eta * eta + 2*inner_product;
+	square_norm += x.getSquareNorm()* eta * eta + 2*inner_product*scale_;
 }
 
 void sparse_vector::set(int featureId, float featureValue) {
 	if(!isSparse_){
 		vectors_[featureId].id_=featureId+1;
-		vectors_[featureId].value_=featureValue;
+		vectors_[featureId].value_=featureValue / scale_;
 	}
 }
 
@@ -160,4 +180,5 @@ void sparse_vector::reComputeSquaredNorm() {
 	for(int i=0;i<vectors_.size();i++){
 		square_norm+=(vectors_[i].value_* vectors_[i].value_);
 	}
+	square_norm *= scale_ * scale_;
 }
@@ -32,6 +32,9 @@ public:
 	virtual ~sparse_vector();
 	void push_back(int id, float value);
 	int FeatureAt (int i) const;
+	// Id of the first feature: 1 when read from svm-light ("id:value")
+	// input, 0 when read from a plain list of values.
+	int FirstFeatureId() const { return isSparse_ ? 0 : 1; }
 	float ValueAt (int i) const;
 	int size() const;
 	string AsString() const;
@@ -43,9 +46,14 @@ public:
 	void set(int featureId, float featureValue);
 
 private:
+	// Multiplies the stored values by scale_ and resets it to 1.
+	void FoldScale();
+
 	vector<FeatureValuePair> vectors_;
 	bool isSparse_;
 	float square_norm;
+	// Values are stored divided by scale_ so that scaleBy() is O(1).
+	float scale_;
 };
 
 #endif /* SPARSE_VECTOR_H_ */
@@ -0,0 +1,165 @@
+// Description: Times the mini-batch assignment step of kmeans with and
+// without the distance bounds and the blocked FindTwoClosestCenters()
+// kernel, for each number of centers in --num_centers. Points are drawn
+// around --num_means Gaussian means so that, as on real data, most points
+// stay with their center from one mini-batch to the next. The pruned
+// variant assigns with assignment_bounds::AssignPoints(), as KMeansWorker
+// does; both apply the same mini-batch center updates as KMeansWorker.
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "assignment_bounds.h"
+#include "cluster_centers.h"
+#include "dataset.h"
+
+DEFINE_int32(num_points, 20000, "# of synthetic points.");
+DEFINE_int32(dimensionality, 50, "dimensionality of the points.");
+DEFINE_int32(num_means, 20, "# of Gaussian means the points are drawn "
+		"around.");
+DEFINE_string(num_centers, "10,100,1000", "Comma separated numbers of "
+		"centers to time.");
+DEFINE_int32(mini_batch_size, 1000, "# of points per mini-batch.");
+DEFINE_int32(num_batches, 200, "# of mini-batches.");
+DEFINE_double(learning_rate, 0.1, "learning rate of the center updates.");
+DEFINE_bool(verify, false, "Check every pruned assignment against an "
+		"exhaustive search (not timed separately, so it slows the pruned "
+		"run down).");
+
+namespace {
+
+struct RunResult {
+	double sec;
+	// Sum of squared distances of all the points to their closest center
+	// after the last mini-batch.
+	double objective;
+	// Points assigned by FindTwoClosestCenters() rather than the bounds.
+	long num_searched;
+	// Pruned assignments that were not the closest center.
+	long num_wrong;
+};
+
+RunResult Run(const dataset& data, int num_centers, bool pruned) {
+	RunResult result = {0, 0, 0, 0};
+	// Same seed for both variants, so they start from the same centers and
+	// draw the same mini-batches.
+	std::mt19937 gen(7);
+	std::uniform_int_distribution<int> pick(0, data.Size() - 1);
+	cluster_centers centers(FLAGS_dimensionality, num_centers);
+	for (int c = 0; c < num_centers; ++c) {
+		centers.insertAtPosition(data.getDataPointAt(pick(gen)), c);
+	}
+	assignment_bounds bounds(data.Size(), num_centers);
+	vector<int> center_count(num_centers, 0);
+	vector<int> x_ids(FLAGS_mini_batch_size);
+	vector<int> closest(FLAGS_mini_batch_size);
+	vector<float> sq_distance;
+
+	std::chrono::steady_clock::time_point start =
+			std::chrono::steady_clock::now();
+	for (int batch = 0; batch < FLAGS_num_batches; ++batch) {
+		for (int p = 0; p < FLAGS_mini_batch_size; ++p) {
+			x_ids[p] = pick(gen);
+		}
+		if (pruned) {
+			result.num_searched += bounds.AssignPoints(data, x_ids, 0, false,
+					&centers, &closest, &sq_distance);
+		} else {
+			for (int p = 0; p < FLAGS_mini_batch_size; ++p) {
+				centers.SqDistanceToClosestCenter(data.getDataPointAt(x_ids[p]),
+						closest[p]);
+			}
+		}
+		if (FLAGS_verify && pruned) {
+			for (int p = 0; p < FLAGS_mini_batch_size; ++p) {
+				const sparse_vector& x = data.getDataPointAt(x_ids[p]);
+				int best_center;
+				float best = centers.SqDistanceToClosestCenter(x, best_center);
+				float assigned = centers.SqDistanceToCenterI(closest[p], x);
+				if (assigned > best + 1e-2 * (1 + best)) {
+					++result.num_wrong;
+				}
+			}
+		}
+
+		for (int p = 0; p < FLAGS_mini_batch_size; ++p) {
+			int i = closest[p];
+			float eta = FLAGS_learning_rate
+					/ (++center_count[i] + FLAGS_learning_rate);
+			const sparse_vector& x = data.getDataPointAt(x_ids[p]);
+			if (pruned) {
+				float sq = centers.SqDistanceToCenterI(i, x);
+				bounds.AddCenterDrift(i, eta * std::sqrt(std::max(sq, 0.0f)));
+			}
+			centers.getPointerToCenterAt(i)->scaleBy(1.0 - eta);
+			centers.getPointerToCenterAt(i)->Add(x, eta);
+		}
+	}
+	result.sec = std::chrono::duration<double>(
+			std::chrono::steady_clock::now() - start).count();
+
+	for (int i = 0; i < data.Size(); ++i) {
+		int center_id;
+		result.objective += centers.SqDistanceToClosestCenter(
+				data.getDataPointAt(i), center_id);
+	}
+	return result;
+}
+
+}  // anonymous namespace
+
+int main(int argc, char *argv[]) {
+	google::ParseCommandLineFlags(&argc, &argv, true);
+	google::InitGoogleLogging(argv[0]);
+	CHECK_LT(0, FLAGS_num_points);
+	CHECK_LT(0, FLAGS_dimensionality);
+	CHECK_LT(0, FLAGS_num_means);
+
+	// svm-light lines, feature ids from 1, as kmeans_main reads them.
+	std::mt19937 gen(1);
+	std::normal_distribution<float> normal;
+	vector<vector<float> > means(FLAGS_num_means,
+			vector<float>(FLAGS_dimensionality));
+	for (int m = 0; m < FLAGS_num_means; ++m) {
+		for (int j = 0; j < FLAGS_dimensionality; ++j) {
+			means[m][j] = 5 * normal(gen);
+		}
+	}
+	dataset data;
+	for (int i = 0; i < FLAGS_num_points; ++i) {
+		const vector<float>& mean = means[i % FLAGS_num_means];
+		std::stringstream line;
+		line << 0;
+		for (int j = 0; j < FLAGS_dimensionality; ++j) {
+			line << " " << (j + 1) << ":" << mean[j] + normal(gen);
+		}
+		data.AddDataPoint(line.str());
+	}
+
+	std::stringstream num_centers_list(FLAGS_num_centers);
+	std::string num_centers_str;
+	while (std::getline(num_centers_list, num_centers_str, ',')) {
+		int num_centers = std::stoi(num_centers_str);
+		CHECK_LT(0, num_centers);
+		RunResult exhaustive = Run(data, num_centers, false);
+		RunResult pruned = Run(data, num_centers, true);
+		printf("k = %d: exhaustive %.3fs (objective %.6g), pruned %.3fs "
+				"(objective %.6g, %.1f%% of points searched), speedup %.2fx",
+				num_centers, exhaustive.sec, exhaustive.objective, pruned.sec,
+				pruned.objective, 100.0 * pruned.num_searched
+				/ (FLAGS_num_batches * FLAGS_mini_batch_size),
+				exhaustive.sec / pruned.sec);
+		if (FLAGS_verify) {
+			printf(", %ld wrong assignments", pruned.num_wrong);
+		}
+		printf("\n");
+	}
+	return 0;
+}
@@ -0,0 +1,80 @@
+// Description: Convert a LibSVM file (as read by ReadDataLabelLibSVM) to a
+// CSR block file (see ml/util/csr_block_file.hpp), which apps load with
+// ParallelReadDataLabelCSRBlocks without parsing any text. The input is
+// read one line at a time, so it can be larger than memory.
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <ml/include/ml.hpp>
+#include <io/general_fstream.hpp>
+#include <snappy.h>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+DEFINE_string(input_file, "", "LibSVM input file (local or hdfs://).");
+DEFINE_string(output_file, "", "CSR block output file (local).");
+DEFINE_int32(feature_dim, 0, "feature dimension.");
+DEFINE_int32(num_data, 0, "Convert only the first num_data examples; 0 "
+    "converts all.");
+DEFINE_bool(feature_one_based, false, "feature index starts at 1.");
+DEFINE_bool(label_one_based, false, "label starts at 1.");
+DEFINE_bool(int_label, true, "Store labels as int (classification) "
+    "rather than float (regression).");
+DEFINE_bool(input_snappy_compressed, false, "input_file is snappy "
+    "compressed (as written by gen_data_sparse --snappy_compressed).");
+DEFINE_int32(block_size, 4096, "# of examples per block.");
+DEFINE_bool(snappy_compressed, false, "snappy compress each output block.");
+
+int main(int argc, char *argv[]) {
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  CHECK(!FLAGS_input_file.empty()) << "--input_file is required";
+  CHECK(!FLAGS_output_file.empty()) << "--output_file is required";
+  CHECK_LT(0, FLAGS_feature_dim) << "--feature_dim is required";
+
+  std::unique_ptr<std::istream> input;
+  petuum::io::ifstream file(FLAGS_input_file, std::ifstream::binary);
+  CHECK(file) << "Can't open " << FLAGS_input_file;
+  if (FLAGS_input_snappy_compressed) {
+    std::string buffer((std::istreambuf_iterator<char>(file)),
+        std::istreambuf_iterator<char>());
+    std::string uncompressed;
+    CHECK(snappy::Uncompress(buffer.data(), buffer.size(), &uncompressed))
+      << "Cannot snappy decompress " << FLAGS_input_file;
+    input.reset(new std::istringstream(uncompressed));
+  }
+  std::istream& is = input ? *input : file;
+
+  petuum::ml::CSRBlockFileWriter writer(FLAGS_output_file, FLAGS_feature_dim,
+      FLAGS_int_label ? petuum::ml::kIntLabel : petuum::ml::kFloatLabel,
+      FLAGS_block_size, FLAGS_snappy_compressed ?
+      petuum::ml::kSnappyCompression : petuum::ml::kNoCompression);
+  std::string line;
+  std::vector<int32_t> feature_ids;
+  std::vector<float> feature_vals;
+  while ((FLAGS_num_data == 0 || writer.GetNumData() < FLAGS_num_data)
+      && std::getline(is, line)) {
+    float label;
+    int32_t num_entries;
+    feature_ids.clear();
+    feature_vals.clear();
+    if (!petuum::ml::ParseLibSVMLineFast(line.data(),
+          line.data() + line.size(), FLAGS_feature_dim,
+          FLAGS_feature_one_based, FLAGS_label_one_based, &label,
+          &num_entries, &feature_ids, &feature_vals)) {
+      continue;
+    }
+    writer.Append(label, feature_ids, feature_vals);
+  }
+  CHECK(FLAGS_num_data == 0 || writer.GetNumData() == FLAGS_num_data)
+    << "Only " << writer.GetNumData() << " data instances found in "
+    << FLAGS_input_file;
+  writer.Close();
+  LOG(INFO) << "Wrote " << writer.GetNumData() << " instances to "
+    << FLAGS_output_file;
+  return 0;
+}
@@ -0,0 +1,315 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glog/logging.h>
+
+namespace petuum {
+namespace ml {
+
+// Datasets hold all examples of a loader in a few contiguous arrays instead
+// of one AbstractFeature per example, so that iterating them is plain loads
+// with no virtual call or pointer chase:
+//
+//  SparseDataset data(feature_dim);
+//  ReadDataLabelLibSVM(filename, feature_dim, num_data, &data, &labels);
+//  for (int i = 0; i < data.GetNumData(); ++i) {
+//    SparseDatumView x = data.GetDatum(i);
+//    for (int j = 0; j < x.GetNumEntries(); ++j) {
+//      // ... use (x.GetFeatureId(j), x.GetFeatureVal(j)).
+//    }
+//  }
+//
+// Views point into the dataset and are invalidated by Append().
+
+// One example of a SparseDataset.
+struct SparseDatumView {
+  int32_t num_entries;
+  // Sorted in ascending order.
+  const int32_t *feature_ids;
+  const float *feature_vals;
+
+  inline int32_t GetNumEntries() const {
+    return num_entries;
+  }
+
+  inline int32_t GetFeatureId(int32_t idx) const {
+    return feature_ids[idx];
+  }
+
+  inline float GetFeatureVal(int32_t idx) const {
+    return feature_vals[idx];
+  }
+};
+
+// One example of a DenseDataset.
+struct DenseDatumView {
+  int32_t feature_dim;
+  const float *feature_vals;
+
+  inline float operator[](int32_t feature_id) const {
+    return feature_vals[feature_id];
+  }
+};
+
+// A batch of examples [begin, begin + num_data) of a dataset. Indices past
+// wrap_end wrap around to wrap_begin, like WorkloadManager's partitions; a
+// batch that does not wrap is contiguous in memory.
+template<typename Dataset, typename DatumView>
+class BatchView {
+public:
+  BatchView(const Dataset *dataset, int32_t begin, int32_t num_data,
+      int32_t wrap_begin, int32_t wrap_end) :
+    dataset_(dataset), begin_(begin), num_data_(num_data),
+    wrap_begin_(wrap_begin), wrap_end_(wrap_end) {
+      CHECK_LE(wrap_begin, begin);
+      CHECK_LT(begin, wrap_end);
+    }
+
+  inline int32_t GetNumData() const {
+    return num_data_;
+  }
+
+  // Index in the dataset of the idx-th example of the batch.
+  inline int32_t GetDataIdx(int32_t idx) const {
+    int32_t data_idx = begin_ + idx;
+    return (data_idx >= wrap_end_) ?
+      (data_idx - wrap_end_) % (wrap_end_ - wrap_begin_) + wrap_begin_ :
+      data_idx;
+  }
+
+  inline DatumView GetDatum(int32_t idx) const {
+    return dataset_->GetDatum(GetDataIdx(idx));
+  }
+
+  // True if the batch does not wrap around; its examples are then
+  // consecutive in the dataset starting at GetDataIdx(0).
+  inline bool IsContiguous() const {
+    return begin_ + num_data_ <= wrap_end_;
+  }
+
+  const Dataset& GetDataset() const {
+    return *dataset_;
+  }
+
+private:
+  const Dataset *dataset_;
+  int32_t begin_;
+  int32_t num_data_;
+  int32_t wrap_begin_;
+  int32_t wrap_end_;
+};
+
+class SparseDataset;
+class DenseDataset;
+
+typedef BatchView<SparseDataset, SparseDatumView> SparseBatchView;
+typedef BatchView<DenseDataset, DenseDatumView> DenseBatchView;
+
+// Sparse examples in CSR: example i's entries are
+// [offsets_[i], offsets_[i + 1]) of feature_ids_ and feature_vals_.
+class SparseDataset {
+public:
+  typedef SparseDatumView DatumView;
+  typedef SparseBatchView BatchViewType;
+
+  explicit SparseDataset(int32_t feature_dim = 0) :
+    feature_dim_(feature_dim), offsets_(1, 0) { }
+
+  void Init(int32_t feature_dim) {
+    feature_dim_ = feature_dim;
+    Clear();
+  }
+
+  void Clear() {
+    offsets_.assign(1, 0);
+    feature_ids_.clear();
+    feature_vals_.clear();
+  }
+
+  void Reserve(int32_t num_data, int64_t num_entries) {
+    offsets_.reserve(num_data + 1);
+    feature_ids_.reserve(num_entries);
+    feature_vals_.reserve(num_entries);
+  }
+
+  // Appends an example. feature_ids needs to be sorted, and
+  // max(feature_ids[i]) < feature_dim. These are checked.
+  void Append(const int32_t *feature_ids, const float *feature_vals,
+      int32_t num_entries) {
+    int32_t prev_id = -1;
+    for (int i = 0; i < num_entries; ++i) {
+      CHECK_LT(prev_id, feature_ids[i]);
+      prev_id = feature_ids[i];
+    }
+    CHECK_LT(prev_id, feature_dim_);
+    feature_ids_.insert(feature_ids_.end(), feature_ids,
+        feature_ids + num_entries);
+    feature_vals_.insert(feature_vals_.end(), feature_vals,
+        feature_vals + num_entries);
+    offsets_.push_back(feature_ids_.size());
+  }
+
+  void Append(const std::vector<int32_t>& feature_ids,
+      const std::vector<float>& feature_vals) {
+    CHECK_EQ(feature_ids.size(), feature_vals.size());
+    Append(feature_ids.data(), feature_vals.data(), feature_ids.size());
+  }
+
+  inline int32_t GetNumData() const {
+    return offsets_.size() - 1;
+  }
+
+  inline int32_t GetFeatureDim() const {
+    return feature_dim_;
+  }
+
+  // Total number of entries over all examples.
+  inline int64_t GetNumEntries() const {
+    return feature_ids_.size();
+  }
+
+  inline SparseDatumView GetDatum(int32_t idx) const {
+    SparseDatumView datum;
+    int64_t offset = offsets_[idx];
+    datum.num_entries = offsets_[idx + 1] - offset;
+    datum.feature_ids = feature_ids_.data() + offset;
+    datum.feature_vals = feature_vals_.data() + offset;
+    return datum;
+  }
+
+  SparseBatchView GetBatch(int32_t begin, int32_t num_data) const {
+    return SparseBatchView(this, begin, num_data, 0, GetNumData());
+  }
+
+  SparseBatchView GetBatch(int32_t begin, int32_t num_data,
+      int32_t wrap_begin, int32_t wrap_end) const {
+    return SparseBatchView(this, begin, num_data, wrap_begin, wrap_end);
+  }
+
+  // Sizes the dataset for filling the arrays below in place (e.g. by
+  // several loader threads). All offsets must be set before use.
+  void Resize(int32_t num_data, int64_t num_entries) {
+    offsets_.assign(num_data + 1, 0);
+    feature_ids_.resize(num_entries);
+    feature_vals_.resize(num_entries);
+  }
+
+  inline const std::vector<int64_t>& GetOffsets() const {
+    return offsets_;
+  }
+
+  inline std::vector<int64_t>& GetOffsets() {
+    return offsets_;
+  }
+
+  inline const std::vector<int32_t>& GetFeatureIds() const {
+    return feature_ids_;
+  }
+
+  inline std::vector<int32_t>& GetFeatureIds() {
+    return feature_ids_;
+  }
+
+  inline const std::vector<float>& GetFeatureVals() const {
+    return feature_vals_;
+  }
+
+  inline std::vector<float>& GetFeatureVals() {
+    return feature_vals_;
+  }
+
+private:
+  int32_t feature_dim_;
+  // GetNumData() + 1 entries.
+  std::vector<int64_t> offsets_;
+  std::vector<int32_t> feature_ids_;
+  std::vector<float> feature_vals_;
+};
+
+// Dense examples stored row-major: example i is
+// [i * feature_dim_, (i + 1) * feature_dim_) of feature_vals_.
+class DenseDataset {
+public:
+  typedef DenseDatumView DatumView;
+  typedef DenseBatchView BatchViewType;
+
+  explicit DenseDataset(int32_t feature_dim = 0) :
+    feature_dim_(feature_dim) { }
+
+  void Init(int32_t feature_dim) {
+    feature_dim_ = feature_dim;
+    Clear();
+  }
+
+  void Clear() {
+    feature_vals_.clear();
+  }
+
+  void Reserve(int32_t num_data) {
+    feature_vals_.reserve(static_cast<int64_t>(num_data) * feature_dim_);
+  }
+
+  // Appends an example of feature_dim values.
+  void Append(const float *feature_vals) {
+    feature_vals_.insert(feature_vals_.end(), feature_vals,
+        feature_vals + feature_dim_);
+  }
+
+  void Append(const std::vector<float>& feature_vals) {
+    CHECK_EQ(feature_dim_, feature_vals.size());
+    Append(feature_vals.data());
+  }
+
+  // Appends an all-zero example and returns its values to fill in.
+  float *AppendZeros() {
+    feature_vals_.resize(feature_vals_.size() + feature_dim_, 0.);
+    return feature_vals_.data() + feature_vals_.size() - feature_dim_;
+  }
+
+  inline int32_t GetNumData() const {
+    return (feature_dim_ == 0) ? 0 : feature_vals_.size() / feature_dim_;
+  }
+
+  inline int32_t GetFeatureDim() const {
+    return feature_dim_;
+  }
+
+  inline DenseDatumView GetDatum(int32_t idx) const {
+    DenseDatumView datum;
+    datum.feature_dim = feature_dim_;
+    datum.feature_vals = feature_vals_.data()
+      + static_cast<int64_t>(idx) * feature_dim_;
+    return datum;
+  }
+
+  DenseBatchView GetBatch(int32_t begin, int32_t num_data) const {
+    return DenseBatchView(this, begin, num_data, 0, GetNumData());
+  }
+
+  DenseBatchView GetBatch(int32_t begin, int32_t num_data,
+      int32_t wrap_begin, int32_t wrap_end) const {
+    return DenseBatchView(this, begin, num_data, wrap_begin, wrap_end);
+  }
+
+  // Sizes the dataset to num_data all-zero examples, for filling
+  // GetFeatureVals() in place.
+  void Resize(int32_t num_data) {
+    feature_vals_.assign(static_cast<int64_t>(num_data) * feature_dim_, 0.);
+  }
+
+  inline const std::vector<float>& GetFeatureVals() const {
+    return feature_vals_;
+  }
+
+  inline std::vector<float>& GetFeatureVals() {
+    return feature_vals_;
+  }
+
+private:
+  int32_t feature_dim_;
+  std::vector<float> feature_vals_;
+};
+
+}  // namespace ml
+}  // namespace petuum
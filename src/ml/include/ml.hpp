@@ -2,6 +2,9 @@
 
 #include <ml/util/workload_manager.hpp>
 #include <ml/util/data_loading.hpp>
+#include <ml/util/parallel_data_loading.hpp>
+#include <ml/util/csr_block_file.hpp>
+#include <ml/util/streaming_data_source.hpp>
 #include <ml/util/metafile_reader.hpp>
 #include <ml/util/math_util.hpp>
 #include <ml/util/fastapprox/fastapprox.hpp>
@@ -9,3 +12,4 @@
 #include <ml/feature/sparse_feature.hpp>
 #include <ml/feature/dense_feature.hpp>
 #include <ml/feature/abstract_feature.hpp>
+#include <ml/feature/dataset.hpp>
@@ -0,0 +1,227 @@
+#include <ml/util/csr_block_file.hpp>
+#include <glog/logging.h>
+#include <snappy.h>
+#include <cmath>
+#include <cstring>
+
+namespace petuum {
+namespace ml {
+
+namespace {
+
+inline int64_t AlignTo8(int64_t size) {
+  return (size + 7) & ~static_cast<int64_t>(7);
+}
+
+// Byte offsets of the arrays of an uncompressed block.
+struct BlockLayout {
+  BlockLayout(int32_t num_data, int64_t num_entries) {
+    labels = 0;
+    offsets = AlignTo8(sizeof(int32_t) * num_data);
+    feature_ids = offsets + sizeof(int64_t) * (num_data + 1);
+    feature_vals = feature_ids + sizeof(int32_t) * num_entries;
+    size = feature_vals + sizeof(float) * num_entries;
+  }
+
+  int64_t labels;
+  int64_t offsets;
+  int64_t feature_ids;
+  int64_t feature_vals;
+  int64_t size;
+};
+
+}  // anonymous namespace
+
+// ==================== CSRBlockFileWriter ======================
+
+CSRBlockFileWriter::CSRBlockFileWriter(const std::string& filename,
+    int32_t feature_dim, CSRBlockLabelType label_type, int32_t block_size,
+    CSRBlockCompression compression) :
+  file_(filename.c_str(), std::ofstream::binary | std::ofstream::trunc),
+  block_size_(block_size), file_offset_(sizeof(CSRBlockFileHeader)),
+  offsets_(1, 0), closed_(false) {
+  CHECK(file_) << "Failed to open " << filename;
+  CHECK_LT(0, block_size_);
+  memset(&header_, 0, sizeof(header_));
+  memcpy(header_.magic, kCSRBlockFileMagic, sizeof(header_.magic));
+  header_.version = kCSRBlockFileVersion;
+  header_.label_type = label_type;
+  header_.compression = compression;
+  header_.feature_dim = feature_dim;
+  // Written for real by Close().
+  file_.write(reinterpret_cast<const char*>(&header_), sizeof(header_));
+}
+
+CSRBlockFileWriter::~CSRBlockFileWriter() {
+  Close();
+}
+
+void CSRBlockFileWriter::Append(float label,
+    const std::vector<int32_t>& feature_ids,
+    const std::vector<float>& feature_vals) {
+  CHECK(!closed_);
+  CHECK_EQ(feature_ids.size(), feature_vals.size());
+  for (int i = 0; i < feature_ids.size(); ++i) {
+    CHECK(i == 0 || feature_ids[i - 1] < feature_ids[i])
+      << "Feature ids must be sorted";
+  }
+  CHECK(feature_ids.empty() || (feature_ids.front() >= 0
+        && feature_ids.back() < header_.feature_dim))
+    << "Feature id out of range [0, " << header_.feature_dim << ")";
+  if (header_.label_type == kIntLabel) {
+    CHECK_EQ(label, round(label)) << "Int label expected";
+    int_labels_.push_back(static_cast<int32_t>(label));
+  } else {
+    float_labels_.push_back(label);
+  }
+  feature_ids_.insert(feature_ids_.end(), feature_ids.begin(),
+      feature_ids.end());
+  feature_vals_.insert(feature_vals_.end(), feature_vals.begin(),
+      feature_vals.end());
+  offsets_.push_back(feature_ids_.size());
+  ++header_.num_data;
+  header_.num_entries += feature_ids.size();
+  if (offsets_.size() - 1 == block_size_) {
+    FlushBlock();
+  }
+}
+
+void CSRBlockFileWriter::Close() {
+  if (closed_)
+    return;
+  FlushBlock();
+  header_.num_blocks = index_.size();
+  header_.index_offset = file_offset_;
+  file_.write(reinterpret_cast<const char*>(index_.data()),
+      sizeof(CSRBlockIndexEntry) * index_.size());
+  file_.seekp(0);
+  file_.write(reinterpret_cast<const char*>(&header_), sizeof(header_));
+  file_.close();
+  CHECK(file_) << "Failed to write CSR block file";
+  closed_ = true;
+}
+
+void CSRBlockFileWriter::FlushBlock() {
+  int32_t num_data = offsets_.size() - 1;
+  if (num_data == 0)
+    return;
+  int64_t num_entries = feature_ids_.size();
+  BlockLayout layout(num_data, num_entries);
+  block_buff_.assign(layout.size, 0);
+  const void *labels = (header_.label_type == kIntLabel) ?
+    static_cast<const void*>(int_labels_.data()) :
+    static_cast<const void*>(float_labels_.data());
+  memcpy(&block_buff_[layout.labels], labels, sizeof(int32_t) * num_data);
+  memcpy(&block_buff_[layout.offsets], offsets_.data(),
+      sizeof(int64_t) * (num_data + 1));
+  if (num_entries > 0) {
+    memcpy(&block_buff_[layout.feature_ids], feature_ids_.data(),
+        sizeof(int32_t) * num_entries);
+    memcpy(&block_buff_[layout.feature_vals], feature_vals_.data(),
+        sizeof(float) * num_entries);
+  }
+
+  const std::string *stored = &block_buff_;
+  if (header_.compression == kSnappyCompression) {
+    snappy::Compress(block_buff_.data(), block_buff_.size(),
+        &compressed_buff_);
+    stored = &compressed_buff_;
+  }
+  CSRBlockIndexEntry entry;
+  memset(&entry, 0, sizeof(entry));
+  entry.offset = file_offset_;
+  entry.stored_size = stored->size();
+  entry.num_entries = num_entries;
+  entry.num_data = num_data;
+  index_.push_back(entry);
+
+  // Keep the next block 8-byte aligned.
+  int64_t padded_size = AlignTo8(stored->size());
+  file_.write(stored->data(), stored->size());
+  file_.write("\0\0\0\0\0\0\0", padded_size - stored->size());
+  file_offset_ += padded_size;
+
+  int_labels_.clear();
+  float_labels_.clear();
+  offsets_.resize(1);
+  feature_ids_.clear();
+  feature_vals_.clear();
+}
+
+// ==================== CSRBlockReader ======================
+
+bool CSRBlockReader::IsCSRBlockFile(const char *data, size_t size) {
+  return size >= sizeof(CSRBlockFileHeader)
+    && memcmp(data, kCSRBlockFileMagic, sizeof(kCSRBlockFileMagic)) == 0;
+}
+
+CSRBlockReader::CSRBlockReader(const char *data, size_t size) :
+  data_(data), size_(size),
+  header_(reinterpret_cast<const CSRBlockFileHeader*>(data)) {
+  CHECK(IsCSRBlockFile(data, size)) << "Not a CSR block file";
+  CHECK_EQ(0, reinterpret_cast<uintptr_t>(data) % 8)
+    << "CSR block file must be 8-byte aligned in memory";
+  CHECK_EQ(kCSRBlockFileVersion, header_->version)
+    << "Unsupported CSR block file version";
+  CHECK(header_->label_type == kIntLabel
+      || header_->label_type == kFloatLabel) << "Unknown label type "
+    << header_->label_type;
+  CHECK(header_->compression == kNoCompression
+      || header_->compression == kSnappyCompression) << "Unknown compression "
+    << header_->compression;
+  CHECK_EQ(0, header_->index_offset % 8);
+  CHECK_LE(header_->index_offset
+      + sizeof(CSRBlockIndexEntry) * header_->num_blocks, size)
+    << "Truncated CSR block file";
+  index_ = reinterpret_cast<const CSRBlockIndexEntry*>(
+      data + header_->index_offset);
+
+  int64_t num_data = 0;
+  int64_t num_entries = 0;
+  for (int32_t b = 0; b < header_->num_blocks; ++b) {
+    const CSRBlockIndexEntry& entry = index_[b];
+    CHECK(entry.offset % 8 == 0 && entry.offset >= sizeof(CSRBlockFileHeader)
+        && entry.offset + entry.stored_size <= header_->index_offset)
+      << "Corrupted index entry of block " << b;
+    num_data += entry.num_data;
+    num_entries += entry.num_entries;
+  }
+  CHECK_EQ(header_->num_data, num_data) << "Corrupted CSR block file";
+  CHECK_EQ(header_->num_entries, num_entries) << "Corrupted CSR block file";
+}
+
+CSRBlockView CSRBlockReader::GetBlock(int32_t block_idx,
+    std::string *buff) const {
+  const CSRBlockIndexEntry& entry = index_[block_idx];
+  BlockLayout layout(entry.num_data, entry.num_entries);
+  const char *block = data_ + entry.offset;
+  if (header_->compression == kSnappyCompression) {
+    CHECK(snappy::Uncompress(block, entry.stored_size, buff))
+      << "Cannot snappy decompress block " << block_idx;
+    block = buff->data();
+    CHECK_EQ(layout.size, buff->size()) << "Corrupted block " << block_idx;
+  } else {
+    CHECK_EQ(layout.size, entry.stored_size) << "Corrupted block "
+      << block_idx;
+  }
+
+  CSRBlockView view;
+  view.num_data = entry.num_data;
+  view.num_entries = entry.num_entries;
+  view.int_labels = 0;
+  view.float_labels = 0;
+  if (header_->label_type == kIntLabel) {
+    view.int_labels = reinterpret_cast<const int32_t*>(block + layout.labels);
+  } else {
+    view.float_labels = reinterpret_cast<const float*>(block + layout.labels);
+  }
+  view.offsets = reinterpret_cast<const int64_t*>(block + layout.offsets);
+  view.feature_ids =
+    reinterpret_cast<const int32_t*>(block + layout.feature_ids);
+  view.feature_vals =
+    reinterpret_cast<const float*>(block + layout.feature_vals);
+  return view;
+}
+
+}  // namespace ml
+}  // namespace petuum
@@ -0,0 +1,183 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <boost/noncopyable.hpp>
+#include <ml/feature/dataset.hpp>
+
+namespace petuum {
+namespace ml {
+
+// CSR block files: a binary container for sparse training data that is
+// loaded without any text parsing. Layout (little-endian):
+//
+//  CSRBlockFileHeader (64 bytes)
+//  block 0, block 1, ... (each at an 8-byte aligned offset)
+//  CSRBlockIndexEntry[num_blocks] (at header.index_offset)
+//
+// A block holds up to block_size consecutive examples, stored as
+//
+//  labels[num_data]          (int32_t or float, see label_type)
+//  padding to 8 bytes
+//  offsets[num_data + 1]     (int64_t, offsets[0] = 0)
+//  feature_ids[num_entries]  (int32_t, zero-based, sorted per example)
+//  feature_vals[num_entries] (float)
+//
+// and optionally snappy compressed as a whole. Uncompressed blocks are
+// read in place from the mmap'ed file. Use libsvm_to_csr_blocks (app/mlr)
+// to convert LibSVM files, and ParallelReadDataLabelCSRBlocks to load them.
+
+const char kCSRBlockFileMagic[8] = {'P', 'M', 'L', 'C', 'S', 'R', 0, 0};
+const uint32_t kCSRBlockFileVersion = 1;
+
+enum CSRBlockLabelType {
+  kIntLabel = 0,
+  kFloatLabel = 1
+};
+
+enum CSRBlockCompression {
+  kNoCompression = 0,
+  kSnappyCompression = 1
+};
+
+struct CSRBlockFileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t label_type;
+  uint32_t compression;
+  int32_t feature_dim;
+  int32_t num_data;
+  int32_t num_blocks;
+  int64_t num_entries;
+  int64_t index_offset;
+  char reserved[16];
+};
+
+struct CSRBlockIndexEntry {
+  int64_t offset;
+  // Bytes in the file (compressed size if compressed).
+  int64_t stored_size;
+  int64_t num_entries;
+  int32_t num_data;
+  uint32_t reserved;
+};
+
+static_assert(sizeof(CSRBlockFileHeader) == 64, "CSRBlockFileHeader");
+static_assert(sizeof(CSRBlockIndexEntry) == 32, "CSRBlockIndexEntry");
+
+// A block of a CSR block file. Points into the file or the caller's
+// decompression buffer.
+struct CSRBlockView {
+  int32_t num_data;
+  int64_t num_entries;
+  // One of them is set, by the file's label type.
+  const int32_t *int_labels;
+  const float *float_labels;
+  const int64_t *offsets;
+  const int32_t *feature_ids;
+  const float *feature_vals;
+
+  inline float GetLabel(int32_t idx) const {
+    return (int_labels != 0) ? int_labels[idx] : float_labels[idx];
+  }
+
+  inline SparseDatumView GetDatum(int32_t idx) const {
+    SparseDatumView datum;
+    datum.num_entries = offsets[idx + 1] - offsets[idx];
+    datum.feature_ids = feature_ids + offsets[idx];
+    datum.feature_vals = feature_vals + offsets[idx];
+    return datum;
+  }
+};
+
+// Writes a CSR block file, a block at a time. The file is valid once
+// Close() returns.
+class CSRBlockFileWriter : boost::noncopyable {
+public:
+  // filename is local.
+  CSRBlockFileWriter(const std::string& filename, int32_t feature_dim,
+      CSRBlockLabelType label_type, int32_t block_size,
+      CSRBlockCompression compression);
+  ~CSRBlockFileWriter();
+
+  // feature_ids are zero-based and sorted. An int label must be integral.
+  void Append(float label, const std::vector<int32_t>& feature_ids,
+      const std::vector<float>& feature_vals);
+
+  // Writes the last block, the index and the header.
+  void Close();
+
+  int32_t GetNumData() const {
+    return header_.num_data;
+  }
+
+private:
+  void FlushBlock();
+
+  std::ofstream file_;
+  const int32_t block_size_;
+  CSRBlockFileHeader header_;
+  std::vector<CSRBlockIndexEntry> index_;
+  int64_t file_offset_;
+
+  // The block being filled.
+  std::vector<int32_t> int_labels_;
+  std::vector<float> float_labels_;
+  std::vector<int64_t> offsets_;
+  std::vector<int32_t> feature_ids_;
+  std::vector<float> feature_vals_;
+  std::string block_buff_;
+  std::string compressed_buff_;
+  bool closed_;
+};
+
+// Reads a CSR block file from memory (e.g. a MappedFile). The header and
+// index are checked at construction; blocks are read on demand.
+class CSRBlockReader {
+public:
+  // data must outlive the reader.
+  CSRBlockReader(const char *data, size_t size);
+
+  static bool IsCSRBlockFile(const char *data, size_t size);
+
+  int32_t GetNumData() const {
+    return header_->num_data;
+  }
+
+  int32_t GetFeatureDim() const {
+    return header_->feature_dim;
+  }
+
+  int64_t GetNumEntries() const {
+    return header_->num_entries;
+  }
+
+  CSRBlockLabelType GetLabelType() const {
+    return static_cast<CSRBlockLabelType>(header_->label_type);
+  }
+
+  int32_t GetNumBlocks() const {
+    return header_->num_blocks;
+  }
+
+  const CSRBlockIndexEntry& GetBlockIndex(int32_t block_idx) const {
+    return index_[block_idx];
+  }
+
+  // Returns block block_idx. Compressed blocks are decompressed into buff,
+  // which must outlive the view; uncompressed ones point into the file.
+  // Thread-safe.
+  CSRBlockView GetBlock(int32_t block_idx, std::string *buff) const;
+
+private:
+  const char *data_;
+  size_t size_;
+  const CSRBlockFileHeader *header_;
+  const CSRBlockIndexEntry *index_;
+};
+
+}  // namespace ml
+}  // namespace petuum
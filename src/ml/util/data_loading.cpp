@@ -84,6 +84,35 @@ void ReadDataLabelBinary(const std::string& filename,
     << read_timer.elapsed() << " seconds.";
 }
 
+void ReadDataLabelBinary(const std::string& filename,
+    int32_t feature_dim, int32_t num_data,
+    DenseDataset* features, std::vector<int32_t>* labels,
+    bool feature_one_based, bool label_one_based) {
+  petuum::HighResolutionTimer read_timer;
+  features->Init(feature_dim);
+  features->Reserve(num_data);
+  labels->resize(num_data);
+  petuum::io::ifstream is(filename, std::ifstream::binary);
+  CHECK(is) << "Failed to open " << filename;
+  for (int i = 0; i < num_data; ++i) {
+    // Read the label
+    is.read(reinterpret_cast<char*>(&(*labels)[i]), sizeof(int32_t));
+    if (label_one_based) {
+      CHECK_LE(0, --(*labels)[i]) << "label is not one-based";
+    }
+    // Read the feature straight into the dataset.
+    float *feature_vals = features->AppendZeros();
+    is.read(reinterpret_cast<char*>(feature_vals), sizeof(float) * feature_dim);
+    if (feature_one_based) {
+      for (int j = 0; j < feature_dim; ++j) {
+        CHECK_LE(0, --feature_vals[j]) << "feature is not one-based";
+      }
+    }
+  }
+  LOG(INFO) << "Read " << num_data << " instances from " << filename << " in "
+    << read_timer.elapsed() << " seconds.";
+}
+
 namespace {
 
 // Return the label. feature_one_based = true assumes
@@ -156,6 +185,19 @@ void ReadDataLabelLibSVM(const std::string& filename,
   }
 }
 
+void ReadDataLabelLibSVM(const std::string& filename,
+    int32_t feature_dim, int32_t num_data,
+    SparseDataset* features, std::vector<int32_t>* labels,
+    bool feature_one_based, bool label_one_based, bool snappy_compressed) {
+  std::vector<float> float_labels;
+  ReadDataLabelLibSVM(filename, feature_dim, num_data, features, &float_labels,
+    feature_one_based, label_one_based, snappy_compressed);
+  labels->resize(float_labels.size());
+  for (int i = 0; i < float_labels.size(); ++i) {
+    (*labels)[i] = round(float_labels[i]);
+  }
+}
+
 void ReadDataLabelLibSVM(const std::string& filename,
     int32_t feature_dim, int32_t num_data,
     std::vector<std::vector<float> >* features, std::vector<int32_t>* labels,
@@ -196,6 +238,33 @@ void ReadDataLabelLibSVM(const std::string& filename,
     << read_timer.elapsed() << " seconds.";
 }
 
+void ReadDataLabelLibSVM(const std::string& filename,
+    int32_t feature_dim, int32_t num_data,
+    SparseDataset* features, std::vector<float>* labels,
+    bool feature_one_based, bool label_one_based, bool snappy_compressed) {
+  petuum::HighResolutionTimer read_timer;
+  features->Init(feature_dim);
+  labels->resize(num_data);
+  std::string file_str = snappy_compressed ?
+    SnappyOpenFileToString(filename) : OpenFileToString(filename);
+  std::istringstream data_stream(file_str);
+  int32_t i = 0;
+  std::vector<int32_t> feature_ids(feature_dim);
+  std::vector<float> feature_vals(feature_dim);
+  for (std::string line; std::getline(data_stream, line) && i < num_data;
+      ++i) {
+    float label = ParseLibSVMLine(line, &feature_ids,
+        &feature_vals, feature_one_based, label_one_based);
+    (*labels)[i] = label;
+    features->Append(feature_ids, feature_vals);
+  }
+  CHECK_EQ(num_data, i) << "Request to read " << num_data
+    << " data instances but only " << i << " found in " << filename;
+  LOG(INFO) << "Read " << i << " instances (" << features->GetNumEntries()
+    << " entries) from " << filename << " in "
+    << read_timer.elapsed() << " seconds.";
+}
+
 void ReadDataLabelLibSVM(const std::string& filename,
     int32_t feature_dim, int32_t num_data,
     std::vector<std::vector<float> >* features, std::vector<float>* labels,
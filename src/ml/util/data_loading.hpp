@@ -8,6 +8,7 @@
 #include <cstdint>
 #include <ml/feature/sparse_feature.hpp>
 #include <ml/feature/dense_feature.hpp>
+#include <ml/feature/dataset.hpp>
 
 namespace petuum {
 namespace ml {
@@ -26,6 +27,13 @@ void ReadDataLabelBinary(const std::string& filename,
     std::vector<std::vector<float> >* features, std::vector<int32_t>* labels,
     bool feature_one_based = false, bool label_one_based = false);
 
+// Same as ReadDataLabelBinary, but store all features contiguously in
+// 'features', which is Init() to feature_dim.
+void ReadDataLabelBinary(const std::string& filename,
+    int32_t feature_dim, int32_t num_data,
+    DenseDataset* features, std::vector<int32_t>* labels,
+    bool feature_one_based = false, bool label_one_based = false);
+
 // Similar to ReadDataLabelBinary, but read LibSVM format: label
 // [feature_id:feature_value] as SparseFeature.
 //
@@ -44,6 +52,21 @@ void ReadDataLabelLibSVM(const std::string& filename,
     bool feature_one_based = false, bool label_one_based = false,
     bool snappy_compressed = false);
 
+// Read LibSVM into a SparseDataset (CSR), which is Init() to feature_dim.
+// Categorical (int) labels.
+void ReadDataLabelLibSVM(const std::string& filename,
+    int32_t feature_dim, int32_t num_data,
+    SparseDataset* features, std::vector<int32_t>* labels,
+    bool feature_one_based = false, bool label_one_based = false,
+    bool snappy_compressed = false);
+
+// Read LibSVM into a SparseDataset. Real value (float) labels.
+void ReadDataLabelLibSVM(const std::string& filename,
+    int32_t feature_dim, int32_t num_data,
+    SparseDataset* features, std::vector<float>* labels,
+    bool feature_one_based = false, bool label_one_based = false,
+    bool snappy_compressed = false);
+
 // Read LibSVM into std::vector<float>. Categorical (int) labels.
 void ReadDataLabelLibSVM(const std::string& filename,
     int32_t feature_dim, int32_t num_data,
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <glog/logging.h>
+#include <boost/noncopyable.hpp>
+#include <string>
+#include <cstring>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace petuum {
+namespace ml {
+
+// Read-only mapping of a whole local file.
+class MappedFile : boost::noncopyable {
+public:
+  explicit MappedFile(const std::string& filename) :
+    data_(0), size_(0) {
+    fd_ = open(filename.c_str(), O_RDONLY);
+    CHECK_GE(fd_, 0) << "Failed to open " << filename << ": "
+      << strerror(errno);
+    struct stat file_stat;
+    CHECK_EQ(0, fstat(fd_, &file_stat)) << "Failed to stat " << filename;
+    size_ = file_stat.st_size;
+    if (size_ == 0)
+      return;
+    void *addr = mmap(0, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+    CHECK(addr != MAP_FAILED) << "Failed to mmap " << filename << ": "
+      << strerror(errno);
+    data_ = static_cast<const char*>(addr);
+    // Files are mostly read front to back (per thread).
+    madvise(addr, size_, MADV_SEQUENTIAL);
+  }
+
+  ~MappedFile() {
+    if (data_ != 0)
+      munmap(const_cast<char*>(data_), size_);
+    close(fd_);
+  }
+
+  const char *data() const {
+    return data_;
+  }
+
+  size_t size() const {
+    return size_;
+  }
+
+private:
+  int fd_;
+  const char *data_;
+  size_t size_;
+};
+
+}  // namespace ml
+}  // namespace petuum
@@ -124,5 +124,73 @@ void FeatureScaleAndAdd(float alpha, const AbstractFeature<float>& f1,
   }
 }
 
+float SparseDenseFeatureDotProduct(const SparseDatumView& f1,
+    const DenseFeature<float>& f2) {
+  const float *w = f2.GetVector().data();
+  float sum = 0.;
+  for (int i = 0; i < f1.num_entries; ++i) {
+    sum += f1.feature_vals[i] * w[f1.feature_ids[i]];
+  }
+  return sum;
+}
+
+float DenseDenseFeatureDotProduct(const DenseDatumView& f1,
+    const DenseFeature<float>& f2) {
+  CHECK_EQ(f1.feature_dim, f2.GetFeatureDim());
+  Eigen::Map<const Eigen::VectorXf> e1(f1.feature_vals, f1.feature_dim);
+  Eigen::Map<const Eigen::VectorXf> e2(f2.GetVector().data(),
+      f2.GetFeatureDim());
+  return e1.dot(e2);
+}
+
+void SparseDenseFeatureDotProduct(const SparseBatchView& batch,
+    const DenseFeature<float>& f2, std::vector<float>* dot_products) {
+  CHECK_EQ(batch.GetDataset().GetFeatureDim(), f2.GetFeatureDim());
+  dot_products->resize(batch.GetNumData());
+  for (int i = 0; i < batch.GetNumData(); ++i) {
+    (*dot_products)[i] = SparseDenseFeatureDotProduct(batch.GetDatum(i), f2);
+  }
+}
+
+void DenseDenseFeatureDotProduct(const DenseBatchView& batch,
+    const DenseFeature<float>& f2, std::vector<float>* dot_products) {
+  int32_t feature_dim = batch.GetDataset().GetFeatureDim();
+  CHECK_EQ(feature_dim, f2.GetFeatureDim());
+  int32_t num_data = batch.GetNumData();
+  dot_products->resize(num_data);
+  Eigen::Map<const Eigen::VectorXf> w(f2.GetVector().data(), feature_dim);
+  Eigen::Map<Eigen::VectorXf> out(dot_products->data(), num_data);
+  if (num_data > 0 && batch.IsContiguous()) {
+    typedef Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic,
+            Eigen::RowMajor> RowMajorMatrixXf;
+    Eigen::Map<const RowMajorMatrixXf> x(batch.GetDatum(0).feature_vals,
+        num_data, feature_dim);
+    out.noalias() = x * w;
+    return;
+  }
+  for (int i = 0; i < num_data; ++i) {
+    Eigen::Map<const Eigen::VectorXf> x(batch.GetDatum(i).feature_vals,
+        feature_dim);
+    out[i] = x.dot(w);
+  }
+}
+
+void FeatureScaleAndAdd(float alpha, const SparseDatumView& f1,
+    DenseFeature<float>* f2) {
+  std::vector<float>& f2_vec = f2->GetVector();
+  for (int i = 0; i < f1.num_entries; ++i) {
+    f2_vec[f1.feature_ids[i]] += alpha * f1.feature_vals[i];
+  }
+}
+
+void FeatureScaleAndAdd(float alpha, const DenseDatumView& f1,
+    DenseFeature<float>* f2) {
+  CHECK_EQ(f1.feature_dim, f2->GetFeatureDim());
+  std::vector<float>& f2_vec = f2->GetVector();
+  for (int i = 0; i < f1.feature_dim; ++i) {
+    f2_vec[i] += alpha * f1.feature_vals[i];
+  }
+}
+
 }  // namespace ml
 }  // namespace petuum
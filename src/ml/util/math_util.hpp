@@ -9,6 +9,7 @@
 #include <ml/feature/abstract_feature.hpp>
 #include <ml/feature/dense_feature.hpp>
 #include <ml/feature/sparse_feature.hpp>
+#include <ml/feature/dataset.hpp>
 #include <sstream>
 
 namespace petuum {
@@ -67,5 +68,31 @@ void FeatureScaleAndAdd(float alpha, const DenseFeature<float>& f1,
 void FeatureScaleAndAdd(float alpha, const AbstractFeature<float>& f1,
     AbstractFeature<float>* f2);
 
+// ============ Overloads for SparseDataset / DenseDataset views ============
+// f1 is an example and f2 the (dense) weights. Entries are read straight
+// from the dataset's arrays with no virtual call.
+
+float SparseDenseFeatureDotProduct(const SparseDatumView& f1,
+    const DenseFeature<float>& f2);
+
+float DenseDenseFeatureDotProduct(const DenseDatumView& f1,
+    const DenseFeature<float>& f2);
+
+// (*dot_products)[i] is the dot product of the i-th example in the batch
+// and f2. dot_products is resized to the batch size.
+void SparseDenseFeatureDotProduct(const SparseBatchView& batch,
+    const DenseFeature<float>& f2, std::vector<float>* dot_products);
+
+// A contiguous batch is one matrix-vector product.
+void DenseDenseFeatureDotProduct(const DenseBatchView& batch,
+    const DenseFeature<float>& f2, std::vector<float>* dot_products);
+
+// f2 += alpha * f1.
+void FeatureScaleAndAdd(float alpha, const SparseDatumView& f1,
+    DenseFeature<float>* f2);
+
+void FeatureScaleAndAdd(float alpha, const DenseDatumView& f1,
+    DenseFeature<float>* f2);
+
 }  // namespace ml
 }  // namespace petuum
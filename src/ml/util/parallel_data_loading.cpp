@@ -0,0 +1,564 @@
+#include <ml/util/parallel_data_loading.hpp>
+#include <ml/util/data_loading.hpp>
+#include <ml/util/snappy_framed_reader.hpp>
+#include <ml/util/mapped_file.hpp>
+#include <ml/util/csr_block_file.hpp>
+#include <io/general_fstream.hpp>
+#include <petuum_ps_common/util/high_resolution_timer.hpp>
+#include <glog/logging.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <thread>
+
+namespace petuum {
+namespace ml {
+
+namespace {
+
+bool IsHdfsPath(const std::string& filename) {
+  return filename.compare(0, 7, "hdfs://") == 0;
+}
+
+int32_t GetNumThreads(int32_t num_threads) {
+  if (num_threads > 0)
+    return num_threads;
+  return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// Runs fn(0) ... fn(num_threads - 1) on num_threads threads.
+template<typename Fn>
+void RunThreads(int32_t num_threads, Fn fn) {
+  std::vector<std::thread> threads;
+  for (int32_t t = 1; t < num_threads; ++t) {
+    threads.emplace_back(fn, t);
+  }
+  fn(0);
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+// =================== Number parsing ======================
+
+inline bool IsBlank(char c) {
+  return c == ' ' || c == '\t' || c == '\r';
+}
+
+inline int32_t ParseInt(const char **ptr, const char *end) {
+  const char *p = *ptr;
+  bool negative = false;
+  if (p < end && (*p == '-' || *p == '+')) {
+    negative = (*p == '-');
+    ++p;
+  }
+  CHECK(p < end && *p >= '0' && *p <= '9') << "Expect an integer: "
+    << std::string(*ptr, std::min<size_t>(end - *ptr, 32));
+  int64_t val = 0;
+  while (p < end && *p >= '0' && *p <= '9') {
+    val = val * 10 + (*p - '0');
+    ++p;
+  }
+  *ptr = p;
+  return negative ? -val : val;
+}
+
+// Powers of 10 that are exact in double.
+const double kPow10[] = {
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// Decimal float ([+-]digits[.digits][(e|E)[+-]digits]). Anything else
+// (nan, inf, hex floats) goes through strtod.
+inline float ParseFloat(const char **ptr, const char *end) {
+  const char *p = *ptr;
+  bool negative = false;
+  if (p < end && (*p == '-' || *p == '+')) {
+    negative = (*p == '-');
+    ++p;
+  }
+  uint64_t mantissa = 0;
+  int32_t num_digits = 0;
+  int32_t exponent = 0;
+  bool has_digits = false;
+  for (; p < end && *p >= '0' && *p <= '9'; ++p) {
+    has_digits = true;
+    // 19 significant digits is more than a float (or double) holds.
+    if (num_digits < 19) {
+      mantissa = mantissa * 10 + (*p - '0');
+      if (mantissa != 0) ++num_digits;
+    } else {
+      ++exponent;
+    }
+  }
+  if (p < end && *p == '.') {
+    ++p;
+    for (; p < end && *p >= '0' && *p <= '9'; ++p) {
+      has_digits = true;
+      if (num_digits < 19) {
+        mantissa = mantissa * 10 + (*p - '0');
+        if (mantissa != 0) ++num_digits;
+        --exponent;
+      }
+    }
+  }
+  if (!has_digits) {
+    char buff[64];
+    size_t len = std::min<size_t>(end - *ptr, sizeof(buff) - 1);
+    memcpy(buff, *ptr, len);
+    buff[len] = '\0';
+    char *endptr;
+    float val = strtod(buff, &endptr);
+    CHECK(endptr != buff) << "Expect a number: " << buff;
+    *ptr += endptr - buff;
+    return val;
+  }
+  if (p < end && (*p == 'e' || *p == 'E')) {
+    const char *exp_ptr = p + 1;
+    if (exp_ptr < end && (*exp_ptr == '-' || *exp_ptr == '+'
+          || (*exp_ptr >= '0' && *exp_ptr <= '9'))) {
+      exponent += ParseInt(&exp_ptr, end);
+      p = exp_ptr;
+    }
+  }
+  *ptr = p;
+
+  double val = mantissa;
+  if (exponent < 0) {
+    val = (exponent >= -22) ? val / kPow10[-exponent]
+      : val * std::pow(10., exponent);
+  } else if (exponent > 0) {
+    val = (exponent <= 22) ? val * kPow10[exponent]
+      : val * std::pow(10., exponent);
+  }
+  return negative ? -val : val;
+}
+
+// =================== LibSVM parsing ======================
+
+struct ParseConfig {
+  int32_t feature_dim;
+  bool feature_one_based;
+  bool label_one_based;
+};
+
+// The examples one thread parsed, in file order.
+struct LibSVMPart {
+  std::vector<float> labels;
+  std::vector<int32_t> num_entries;
+  std::vector<int32_t> feature_ids;
+  std::vector<float> feature_vals;
+};
+
+void ParseLibSVMLine(const char *p, const char *end, const ParseConfig& config,
+    LibSVMPart *part) {
+  float label;
+  int32_t num_entries;
+  if (ParseLibSVMLineFast(p, end, config.feature_dim, config.feature_one_based,
+        config.label_one_based, &label, &num_entries, &part->feature_ids,
+        &part->feature_vals)) {
+    part->labels.push_back(label);
+    part->num_entries.push_back(num_entries);
+  }
+}
+
+// The text from the beginning of a thread's part to the end of the file,
+// as blocks.
+class MappedTextStream {
+public:
+  MappedTextStream(const char *begin, const char *end) :
+    begin_(begin), end_(end), done_(false) { }
+
+  bool NextBlock(const char **begin, const char **end) {
+    if (done_)
+      return false;
+    done_ = true;
+    *begin = begin_;
+    *end = end_;
+    return true;
+  }
+
+private:
+  const char *begin_;
+  const char *end_;
+  bool done_;
+};
+
+class SnappyFramedTextStream {
+public:
+  SnappyFramedTextStream(const SnappyFramedReader *reader, int32_t chunk_idx) :
+    reader_(reader), chunk_idx_(chunk_idx) { }
+
+  bool NextBlock(const char **begin, const char **end) {
+    if (chunk_idx_ == reader_->GetNumChunks())
+      return false;
+    reader_->ReadChunk(chunk_idx_++, &buff_);
+    *begin = buff_.data();
+    *end = buff_.data() + buff_.size();
+    return true;
+  }
+
+private:
+  const SnappyFramedReader *reader_;
+  int32_t chunk_idx_;
+  std::string buff_;
+};
+
+// Parses the lines of a part, reading stream as far past the part as
+// needed to finish its last line. part_size is the length of the part in
+// stream. A line belongs to the part its first character is in, except
+// that a line starting right at the end of a part belongs to that part
+// (the next part cannot tell a line boundary at its start from one inside
+// a line, so it skips past its first newline).
+template<typename TextStream>
+void ParseLibSVMPart(TextStream *stream, int64_t part_size, bool first_part,
+    const ParseConfig& config, LibSVMPart *part) {
+  bool skipping = !first_part;
+  bool in_carry = false;
+  std::string carry;
+  int64_t block_pos = 0;
+  const char *begin, *end;
+  while (stream->NextBlock(&begin, &end)) {
+    const char *p = begin;
+    if (skipping) {
+      const char *newline = static_cast<const char*>(
+          memchr(p, '\n', end - p));
+      if (newline == 0) {
+        block_pos += end - begin;
+        continue;
+      }
+      p = newline + 1;
+      skipping = false;
+    } else if (in_carry) {
+      const char *newline = static_cast<const char*>(
+          memchr(p, '\n', end - p));
+      if (newline == 0) {
+        carry.append(p, end);
+        block_pos += end - begin;
+        continue;
+      }
+      carry.append(p, newline);
+      ParseLibSVMLine(carry.data(), carry.data() + carry.size(), config, part);
+      in_carry = false;
+      p = newline + 1;
+    }
+
+    while (p < end) {
+      if (block_pos + (p - begin) > part_size)
+        return;
+      const char *newline = static_cast<const char*>(
+          memchr(p, '\n', end - p));
+      if (newline == 0) {
+        carry.assign(p, end);
+        in_carry = true;
+        break;
+      }
+      ParseLibSVMLine(p, newline, config, part);
+      p = newline + 1;
+    }
+    block_pos += end - begin;
+  }
+  // The file does not end with a newline.
+  if (in_carry) {
+    ParseLibSVMLine(carry.data(), carry.data() + carry.size(), config, part);
+  }
+}
+
+}  // anonymous namespace
+
+bool ParseLibSVMLineFast(const char *p, const char *end,
+    int32_t feature_dim, bool feature_one_based, bool label_one_based,
+    float *label, int32_t *num_entries, std::vector<int32_t>* feature_ids,
+    std::vector<float>* feature_vals) {
+  while (p < end && IsBlank(*p)) ++p;
+  if (p == end)
+    return false;
+
+  *label = ParseFloat(&p, end);
+  if (label_one_based) {
+    *label -= 1;
+  }
+  *num_entries = 0;
+  int32_t prev_id = -1;
+  while (true) {
+    while (p < end && IsBlank(*p)) ++p;
+    if (p == end)
+      break;
+    int32_t feature_id = ParseInt(&p, end);
+    if (feature_one_based) {
+      --feature_id;
+    }
+    CHECK(p < end && *p == ':') << "Expect ':' after feature id "
+      << feature_id;
+    ++p;
+    float feature_val = ParseFloat(&p, end);
+    CHECK_LT(prev_id, feature_id) << "Feature ids must be sorted";
+    prev_id = feature_id;
+    feature_ids->push_back(feature_id);
+    feature_vals->push_back(feature_val);
+    ++(*num_entries);
+  }
+  CHECK_LT(prev_id, feature_dim);
+  return true;
+}
+
+void ParallelReadDataLabelLibSVM(const std::string& filename,
+    int32_t feature_dim, int32_t num_data, int32_t num_threads,
+    SparseDataset* features, std::vector<float>* labels,
+    bool feature_one_based, bool label_one_based, bool snappy_framed) {
+  if (IsHdfsPath(filename)) {
+    CHECK(!snappy_framed) << "Snappy framed files on HDFS are not supported";
+    ReadDataLabelLibSVM(filename, feature_dim, num_data, features, labels,
+        feature_one_based, label_one_based);
+    return;
+  }
+  petuum::HighResolutionTimer read_timer;
+  num_threads = GetNumThreads(num_threads);
+  ParseConfig config;
+  config.feature_dim = feature_dim;
+  config.feature_one_based = feature_one_based;
+  config.label_one_based = label_one_based;
+
+  MappedFile file(filename);
+  std::vector<LibSVMPart> parts(num_threads);
+  if (snappy_framed) {
+    SnappyFramedReader reader(file.data(), file.size());
+    // Split the chunks so that each part has about the same amount of text.
+    std::vector<int32_t> part_begin(num_threads + 1, reader.GetNumChunks());
+    std::vector<int64_t> part_size(num_threads, 0);
+    int64_t total_size = reader.GetTotalUncompressedSize();
+    int64_t pos = 0;
+    int32_t part_idx = 0;
+    part_begin[0] = 0;
+    for (int32_t i = 0; i < reader.GetNumChunks(); ++i) {
+      while (part_idx + 1 < num_threads
+          && pos >= total_size * (part_idx + 1) / num_threads) {
+        part_begin[++part_idx] = i;
+      }
+      part_size[part_idx] += reader.GetUncompressedSize(i);
+      pos += reader.GetUncompressedSize(i);
+    }
+    RunThreads(num_threads, [&](int32_t t) {
+        if (part_begin[t] == reader.GetNumChunks())
+          return;
+        SnappyFramedTextStream stream(&reader, part_begin[t]);
+        ParseLibSVMPart(&stream, part_size[t], t == 0, config, &parts[t]);
+      });
+  } else {
+    RunThreads(num_threads, [&](int32_t t) {
+        int64_t begin = file.size() * t / num_threads;
+        int64_t end = file.size() * (t + 1) / num_threads;
+        if (begin == end)
+          return;
+        MappedTextStream stream(file.data() + begin,
+            file.data() + file.size());
+        ParseLibSVMPart(&stream, end - begin, t == 0, config, &parts[t]);
+      });
+  }
+
+  // Copy the first num_data examples into the dataset, each part by its
+  // own thread.
+  std::vector<int32_t> data_begin(num_threads + 1, 0);
+  std::vector<int64_t> entry_begin(num_threads + 1, 0);
+  for (int32_t t = 0; t < num_threads; ++t) {
+    int32_t num_part_data = std::min<int32_t>(parts[t].labels.size(),
+        num_data - data_begin[t]);
+    int64_t num_part_entries = 0;
+    for (int32_t i = 0; i < num_part_data; ++i) {
+      num_part_entries += parts[t].num_entries[i];
+    }
+    data_begin[t + 1] = data_begin[t] + num_part_data;
+    entry_begin[t + 1] = entry_begin[t] + num_part_entries;
+  }
+  CHECK_EQ(num_data, data_begin[num_threads]) << "Request to read "
+    << num_data << " data instances but only " << data_begin[num_threads]
+    << " found in " << filename;
+
+  features->Init(feature_dim);
+  features->Resize(num_data, entry_begin[num_threads]);
+  labels->resize(num_data);
+  std::vector<int64_t>& offsets = features->GetOffsets();
+  RunThreads(num_threads, [&](int32_t t) {
+      const LibSVMPart& part = parts[t];
+      int32_t num_part_data = data_begin[t + 1] - data_begin[t];
+      int64_t num_part_entries = entry_begin[t + 1] - entry_begin[t];
+      std::copy(part.labels.begin(), part.labels.begin() + num_part_data,
+          labels->begin() + data_begin[t]);
+      std::copy(part.feature_ids.begin(),
+          part.feature_ids.begin() + num_part_entries,
+          features->GetFeatureIds().begin() + entry_begin[t]);
+      std::copy(part.feature_vals.begin(),
+          part.feature_vals.begin() + num_part_entries,
+          features->GetFeatureVals().begin() + entry_begin[t]);
+      int64_t offset = entry_begin[t];
+      for (int32_t i = 0; i < num_part_data; ++i) {
+        offset += part.num_entries[i];
+        offsets[data_begin[t] + i + 1] = offset;
+      }
+    });
+  LOG(INFO) << "Read " << num_data << " instances ("
+    << features->GetNumEntries() << " entries) from " << filename
+    << " with " << num_threads << " threads in " << read_timer.elapsed()
+    << " seconds.";
+}
+
+void ParallelReadDataLabelLibSVM(const std::string& filename,
+    int32_t feature_dim, int32_t num_data, int32_t num_threads,
+    SparseDataset* features, std::vector<int32_t>* labels,
+    bool feature_one_based, bool label_one_based, bool snappy_framed) {
+  std::vector<float> float_labels;
+  ParallelReadDataLabelLibSVM(filename, feature_dim, num_data, num_threads,
+      features, &float_labels, feature_one_based, label_one_based,
+      snappy_framed);
+  labels->resize(float_labels.size());
+  for (int i = 0; i < float_labels.size(); ++i) {
+    (*labels)[i] = round(float_labels[i]);
+  }
+}
+
+void ParallelReadDataLabelCSRBlocks(const std::string& filename,
+    int32_t num_data, int32_t num_threads, SparseDataset* features,
+    std::vector<float>* labels) {
+  petuum::HighResolutionTimer read_timer;
+  num_threads = GetNumThreads(num_threads);
+  std::unique_ptr<MappedFile> file;
+  std::string file_str;
+  const char *data;
+  size_t size;
+  if (IsHdfsPath(filename)) {
+    petuum::io::ifstream is(filename, std::ifstream::binary);
+    CHECK(is) << "Failed to open " << filename;
+    file_str.assign(std::istreambuf_iterator<char>(is),
+        std::istreambuf_iterator<char>());
+    data = file_str.data();
+    size = file_str.size();
+  } else {
+    file.reset(new MappedFile(filename));
+    data = file->data();
+    size = file->size();
+  }
+  CSRBlockReader reader(data, size);
+  CHECK_LE(num_data, reader.GetNumData()) << "Request to read " << num_data
+    << " data instances but only " << reader.GetNumData() << " found in "
+    << filename;
+
+  // First example and entry of each block that holds any of the first
+  // num_data examples. The last one may be used only in part.
+  std::vector<int32_t> data_begin(1, 0);
+  std::vector<int64_t> entry_begin(1, 0);
+  for (int32_t b = 0; data_begin.back() < num_data; ++b) {
+    const CSRBlockIndexEntry& entry = reader.GetBlockIndex(b);
+    data_begin.push_back(data_begin.back() + entry.num_data);
+    entry_begin.push_back(entry_begin.back() + entry.num_entries);
+  }
+  int32_t num_blocks = data_begin.size() - 1;
+
+  int32_t feature_dim = reader.GetFeatureDim();
+  features->Init(feature_dim);
+  features->Resize(num_data, entry_begin.back());
+  labels->resize(num_data);
+  int64_t *offsets = features->GetOffsets().data();
+  int32_t *feature_ids = features->GetFeatureIds().data();
+  float *feature_vals = features->GetFeatureVals().data();
+  RunThreads(num_threads, [&](int32_t t) {
+      std::string buff;
+      for (int32_t b = t; b < num_blocks; b += num_threads) {
+        CSRBlockView block = reader.GetBlock(b, &buff);
+        int32_t block_num_data = std::min(block.num_data,
+            num_data - data_begin[b]);
+        CHECK_EQ(0, block.offsets[0]) << "Corrupted block " << b;
+        for (int32_t i = 0; i < block_num_data; ++i) {
+          CHECK_LE(block.offsets[i], block.offsets[i + 1])
+            << "Corrupted block " << b;
+          (*labels)[data_begin[b] + i] = block.GetLabel(i);
+          offsets[data_begin[b] + i + 1] = entry_begin[b]
+            + block.offsets[i + 1];
+        }
+        int64_t block_num_entries = block.offsets[block_num_data];
+        CHECK_LE(block_num_entries, block.num_entries)
+          << "Corrupted block " << b;
+        for (int64_t j = 0; j < block_num_entries; ++j) {
+          CHECK_LT(static_cast<uint32_t>(block.feature_ids[j]), feature_dim)
+            << "Feature id out of range in block " << b;
+        }
+        if (block_num_entries > 0) {
+          memcpy(feature_ids + entry_begin[b], block.feature_ids,
+              sizeof(int32_t) * block_num_entries);
+          memcpy(feature_vals + entry_begin[b], block.feature_vals,
+              sizeof(float) * block_num_entries);
+        }
+      }
+    });
+  // Drop the unused tail of the last block.
+  features->GetFeatureIds().resize(offsets[num_data]);
+  features->GetFeatureVals().resize(offsets[num_data]);
+  LOG(INFO) << "Read " << num_data << " instances ("
+    << features->GetNumEntries() << " entries) from " << filename
+    << " with " << num_threads << " threads in " << read_timer.elapsed()
+    << " seconds.";
+}
+
+void ParallelReadDataLabelCSRBlocks(const std::string& filename,
+    int32_t num_data, int32_t num_threads, SparseDataset* features,
+    std::vector<int32_t>* labels) {
+  std::vector<float> float_labels;
+  ParallelReadDataLabelCSRBlocks(filename, num_data, num_threads, features,
+      &float_labels);
+  labels->resize(float_labels.size());
+  for (int i = 0; i < float_labels.size(); ++i) {
+    (*labels)[i] = round(float_labels[i]);
+  }
+}
+
+void ParallelReadDataLabelBinary(const std::string& filename,
+    int32_t feature_dim, int32_t num_data, int32_t num_threads,
+    DenseDataset* features, std::vector<int32_t>* labels,
+    bool feature_one_based, bool label_one_based) {
+  if (IsHdfsPath(filename)) {
+    ReadDataLabelBinary(filename, feature_dim, num_data, features, labels,
+        feature_one_based, label_one_based);
+    return;
+  }
+  petuum::HighResolutionTimer read_timer;
+  num_threads = GetNumThreads(num_threads);
+  MappedFile file(filename);
+  size_t record_size = sizeof(int32_t) + sizeof(float) * feature_dim;
+  CHECK_LE(record_size * num_data, file.size()) << "Request to read "
+    << num_data << " data instances but only "
+    << file.size() / record_size << " found in " << filename;
+
+  features->Init(feature_dim);
+  features->Resize(num_data);
+  labels->resize(num_data);
+  float *feature_vals = features->GetFeatureVals().data();
+  RunThreads(num_threads, [&](int32_t t) {
+      int32_t begin = static_cast<int64_t>(num_data) * t / num_threads;
+      int32_t end = static_cast<int64_t>(num_data) * (t + 1) / num_threads;
+      for (int32_t i = begin; i < end; ++i) {
+        const char *record = file.data() + record_size * i;
+        int32_t label;
+        memcpy(&label, record, sizeof(int32_t));
+        if (label_one_based) {
+          CHECK_LE(0, --label) << "label is not one-based";
+        }
+        (*labels)[i] = label;
+        float *datum = feature_vals + static_cast<int64_t>(i) * feature_dim;
+        memcpy(datum, record + sizeof(int32_t), sizeof(float) * feature_dim);
+        if (feature_one_based) {
+          for (int j = 0; j < feature_dim; ++j) {
+            CHECK_LE(0, --datum[j]) << "feature is not one-based";
+          }
+        }
+      }
+    });
+  LOG(INFO) << "Read " << num_data << " instances from " << filename
+    << " with " << num_threads << " threads in " << read_timer.elapsed()
+    << " seconds.";
+}
+
+}  // namespace ml
+}  // namespace petuum
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <ml/feature/dataset.hpp>
+
+namespace petuum {
+namespace ml {
+
+// Loaders for large local training files. The file is mmap'ed, split into
+// num_threads parts at line (record) boundaries, and the parts are parsed
+// concurrently with a hand-written number parser. Files on HDFS (hdfs://)
+// fall back to the sequential loaders in data_loading.hpp. num_threads <= 0
+// uses one thread per core.
+
+// Same as ReadDataLabelLibSVM: only the first num_data examples are kept, and
+// the file must have at least that many. Blank lines are skipped.
+//
+// If snappy_framed is true the file is in the snappy framing format (see
+// SnappyFramedReader) rather than one snappy buffer, and is decompressed
+// a block (<= 64KB) at a time as it is parsed, never as a whole.
+void ParallelReadDataLabelLibSVM(const std::string& filename,
+    int32_t feature_dim, int32_t num_data, int32_t num_threads,
+    SparseDataset* features, std::vector<float>* labels,
+    bool feature_one_based = false, bool label_one_based = false,
+    bool snappy_framed = false);
+
+// Categorical (int) labels.
+void ParallelReadDataLabelLibSVM(const std::string& filename,
+    int32_t feature_dim, int32_t num_data, int32_t num_threads,
+    SparseDataset* features, std::vector<int32_t>* labels,
+    bool feature_one_based = false, bool label_one_based = false,
+    bool snappy_framed = false);
+
+// Parses one LibSVM line [begin, end) (without the newline) with the same
+// parser, and appends its entries to feature_ids and feature_vals. Returns
+// false, appending nothing, if the line is blank.
+bool ParseLibSVMLineFast(const char *begin, const char *end,
+    int32_t feature_dim, bool feature_one_based, bool label_one_based,
+    float *label, int32_t *num_entries, std::vector<int32_t>* feature_ids,
+    std::vector<float>* feature_vals);
+
+// Reads the first num_data examples of a CSR block file (see
+// csr_block_file.hpp), one block per thread at a time. There is nothing to
+// parse: examples are copied from the file (or the decompressed block)
+// straight into the dataset. hdfs:// files are read into memory first.
+// Labels are converted to the requested type.
+void ParallelReadDataLabelCSRBlocks(const std::string& filename,
+    int32_t num_data, int32_t num_threads, SparseDataset* features,
+    std::vector<float>* labels);
+
+void ParallelReadDataLabelCSRBlocks(const std::string& filename,
+    int32_t num_data, int32_t num_threads, SparseDataset* features,
+    std::vector<int32_t>* labels);
+
+// Same format as ReadDataLabelBinary. Records are fixed size, so each
+// thread copies its share straight into the dataset.
+void ParallelReadDataLabelBinary(const std::string& filename,
+    int32_t feature_dim, int32_t num_data, int32_t num_threads,
+    DenseDataset* features, std::vector<int32_t>* labels,
+    bool feature_one_based = false, bool label_one_based = false);
+
+}  // namespace ml
+}  // namespace petuum
@@ -0,0 +1,132 @@
+#include <ml/util/snappy_framed_reader.hpp>
+#include <glog/logging.h>
+#include <snappy.h>
+#include <cstring>
+
+namespace petuum {
+namespace ml {
+
+namespace {
+
+const char kStreamIdentifier[] = "sNaPpY";
+const size_t kStreamIdentifierSize = 6;
+const size_t kChunkHeaderSize = 4;
+const size_t kChecksumSize = 4;
+const size_t kMaxUncompressedChunkSize = 65536;
+
+const uint8_t kCompressedChunk = 0x00;
+const uint8_t kUncompressedChunk = 0x01;
+const uint8_t kPaddingChunk = 0xfe;
+const uint8_t kStreamIdentifierChunk = 0xff;
+// 0x02 - 0x7f are reserved unskippable chunks, 0x80 - 0xfd skippable ones.
+const uint8_t kMinSkippableChunk = 0x80;
+
+// CRC-32C (Castagnoli), reflected, as used by the framing format.
+class Crc32c {
+public:
+  Crc32c() {
+    for (uint32_t i = 0; i < 256; ++i) {
+      uint32_t crc = i;
+      for (int j = 0; j < 8; ++j) {
+        crc = (crc & 1) ? (crc >> 1) ^ 0x82f63b78 : (crc >> 1);
+      }
+      table_[i] = crc;
+    }
+  }
+
+  uint32_t Compute(const char *data, size_t size) const {
+    uint32_t crc = 0xffffffff;
+    const uint8_t *p = reinterpret_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; ++i) {
+      crc = table_[(crc ^ p[i]) & 0xff] ^ (crc >> 8);
+    }
+    return crc ^ 0xffffffff;
+  }
+
+  uint32_t ComputeMasked(const char *data, size_t size) const {
+    uint32_t crc = Compute(data, size);
+    return ((crc >> 15) | (crc << 17)) + 0xa282ead8;
+  }
+
+private:
+  uint32_t table_[256];
+};
+
+const Crc32c kCrc32c;
+
+uint32_t ReadLE(const char *data, int num_bytes) {
+  const uint8_t *p = reinterpret_cast<const uint8_t*>(data);
+  uint32_t val = 0;
+  for (int i = num_bytes - 1; i >= 0; --i) {
+    val = (val << 8) | p[i];
+  }
+  return val;
+}
+
+}  // anonymous namespace
+
+bool SnappyFramedReader::IsSnappyFramed(const char *data, size_t size) {
+  return size >= kChunkHeaderSize + kStreamIdentifierSize
+    && static_cast<uint8_t>(data[0]) == kStreamIdentifierChunk
+    && ReadLE(data + 1, 3) == kStreamIdentifierSize
+    && memcmp(data + kChunkHeaderSize, kStreamIdentifier,
+        kStreamIdentifierSize) == 0;
+}
+
+SnappyFramedReader::SnappyFramedReader(const char *data, size_t size) :
+  total_uncompressed_size_(0) {
+  CHECK(IsSnappyFramed(data, size))
+    << "Not in the snappy framing format (missing stream identifier)";
+  size_t pos = 0;
+  while (pos < size) {
+    CHECK_LE(pos + kChunkHeaderSize, size) << "Truncated chunk header at "
+      << pos;
+    uint8_t type = static_cast<uint8_t>(data[pos]);
+    size_t length = ReadLE(data + pos + 1, 3);
+    pos += kChunkHeaderSize;
+    CHECK_LE(pos + length, size) << "Truncated chunk at " << pos;
+
+    if (type == kCompressedChunk || type == kUncompressedChunk) {
+      CHECK_LE(kChecksumSize, length) << "Chunk too short at " << pos;
+      Chunk chunk;
+      chunk.masked_crc = ReadLE(data + pos, 4);
+      chunk.data = data + pos + kChecksumSize;
+      chunk.size = length - kChecksumSize;
+      chunk.compressed = (type == kCompressedChunk);
+      if (chunk.compressed) {
+        CHECK(snappy::GetUncompressedLength(chunk.data, chunk.size,
+              &chunk.uncompressed_size)) << "Corrupted chunk at " << pos;
+      } else {
+        chunk.uncompressed_size = chunk.size;
+      }
+      CHECK_LE(chunk.uncompressed_size, kMaxUncompressedChunkSize)
+        << "Chunk too large at " << pos;
+      total_uncompressed_size_ += chunk.uncompressed_size;
+      chunks_.push_back(chunk);
+    } else if (type == kStreamIdentifierChunk) {
+      CHECK_EQ(kStreamIdentifierSize, length);
+    } else {
+      CHECK(type == kPaddingChunk || type >= kMinSkippableChunk)
+        << "Reserved unskippable chunk type " << static_cast<int>(type)
+        << " at " << pos;
+    }
+    pos += length;
+  }
+}
+
+void SnappyFramedReader::ReadChunk(int32_t chunk_idx,
+    std::string *buff) const {
+  const Chunk& chunk = chunks_[chunk_idx];
+  buff->resize(chunk.uncompressed_size);
+  if (chunk.compressed) {
+    CHECK(snappy::RawUncompress(chunk.data, chunk.size, &(*buff)[0]))
+      << "Cannot snappy decompress chunk " << chunk_idx;
+  } else {
+    memcpy(&(*buff)[0], chunk.data, chunk.size);
+  }
+  CHECK_EQ(chunk.masked_crc, kCrc32c.ComputeMasked(buff->data(),
+        buff->size())) << "Checksum mismatch in chunk " << chunk_idx;
+}
+
+}  // namespace ml
+}  // namespace petuum
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace petuum {
+namespace ml {
+
+// Reads a buffer in the snappy framing format (framing_format.txt in the
+// snappy sources; what snzip and python-snappy's stream tools write): a
+// stream identifier followed by chunks of at most 64KB of uncompressed
+// data, each compressed on its own and checksummed with masked CRC-32C.
+// The chunks are indexed at construction (headers only), so that they can
+// be decompressed one at a time, in any order and from several threads.
+class SnappyFramedReader {
+public:
+  // data must outlive the reader.
+  SnappyFramedReader(const char *data, size_t size);
+
+  static bool IsSnappyFramed(const char *data, size_t size);
+
+  int32_t GetNumChunks() const {
+    return chunks_.size();
+  }
+
+  size_t GetUncompressedSize(int32_t chunk_idx) const {
+    return chunks_[chunk_idx].uncompressed_size;
+  }
+
+  // Sum of GetUncompressedSize() over all chunks.
+  int64_t GetTotalUncompressedSize() const {
+    return total_uncompressed_size_;
+  }
+
+  // Decompresses chunk chunk_idx into buff (resized to fit), checking its
+  // checksum. Thread-safe.
+  void ReadChunk(int32_t chunk_idx, std::string *buff) const;
+
+private:
+  struct Chunk {
+    const char *data;
+    size_t size;
+    bool compressed;
+    size_t uncompressed_size;
+    uint32_t masked_crc;
+  };
+
+  std::vector<Chunk> chunks_;
+  int64_t total_uncompressed_size_;
+};
+
+}  // namespace ml
+}  // namespace petuum
@@ -0,0 +1,173 @@
+#include <ml/util/streaming_data_source.hpp>
+#include <ml/util/parallel_data_loading.hpp>
+#include <glog/logging.h>
+#include <algorithm>
+
+namespace petuum {
+namespace ml {
+
+void InitStreamingDataSourceConfig(const WorkloadManager& workload_mgr,
+    StreamingDataSourceConfig* config) {
+  config->block_size = workload_mgr.GetBatchSize();
+  config->data_idx_begin = workload_mgr.GetDataIdxBegin();
+  config->data_idx_end = workload_mgr.GetDataIdxEnd();
+  config->num_data_per_epoch = workload_mgr.GetNumDataPerEpoch();
+}
+
+StreamingDataSource::StreamingDataSource(
+    const StreamingDataSourceConfig& config) :
+  config_(config), shard_offset_(-1), shard_idx_(0),
+  num_read_this_epoch_(0), fill_idx_(0), fill_pending_(true),
+  restart_pending_(true), epoch_started_(false), stop_(false) {
+  CHECK_LT(0, config_.block_size);
+  CHECK_LT(config_.data_idx_begin, config_.data_idx_end)
+    << "Empty shard of " << config_.filename;
+  // The first block is prefetched right away.
+  prefetch_thread_ = std::thread(&StreamingDataSource::PrefetchLoop, this);
+}
+
+StreamingDataSource::~StreamingDataSource() {
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    stop_ = true;
+  }
+  cv_.notify_all();
+  prefetch_thread_.join();
+}
+
+const DataBlock *StreamingDataSource::NextBlock() {
+  std::unique_lock<std::mutex> lock(mtx_);
+  epoch_started_ = true;
+  cv_.wait(lock, [this] { return !fill_pending_; });
+  DataBlock *block = &blocks_[fill_idx_];
+  if (block->GetNumData() == 0)
+    return 0;
+  // Prefetch the next block into the other buffer.
+  fill_idx_ ^= 1;
+  fill_pending_ = true;
+  cv_.notify_all();
+  return block;
+}
+
+void StreamingDataSource::Restart() {
+  std::unique_lock<std::mutex> lock(mtx_);
+  // The first block of this epoch is already there (or on its way).
+  if (!epoch_started_)
+    return;
+  cv_.wait(lock, [this] { return !fill_pending_; });
+  epoch_started_ = false;
+  restart_pending_ = true;
+  fill_pending_ = true;
+  cv_.notify_all();
+}
+
+// ==================== Private Methods ======================
+
+void StreamingDataSource::PrefetchLoop() {
+  std::unique_lock<std::mutex> lock(mtx_);
+  while (true) {
+    cv_.wait(lock, [this] { return fill_pending_ || stop_; });
+    if (stop_)
+      return;
+    bool restart = restart_pending_;
+    restart_pending_ = false;
+    DataBlock *block = &blocks_[fill_idx_];
+    lock.unlock();
+
+    if (restart) {
+      SeekToShardBegin();
+      num_read_this_epoch_ = 0;
+    }
+    ReadBlock(block);
+
+    lock.lock();
+    fill_pending_ = false;
+    cv_.notify_all();
+  }
+}
+
+void StreamingDataSource::ReadBlock(DataBlock *block) {
+  block->sparse_features.Init(config_.feature_dim);
+  block->dense_features.Init(config_.feature_dim);
+  block->labels.clear();
+  int32_t num_data_per_epoch = (config_.num_data_per_epoch > 0) ?
+    config_.num_data_per_epoch : config_.data_idx_end - config_.data_idx_begin;
+  int32_t num_data = std::min(config_.block_size,
+      num_data_per_epoch - num_read_this_epoch_);
+  for (int32_t i = 0; i < num_data; ++i) {
+    ReadExample(block);
+  }
+  num_read_this_epoch_ += num_data;
+}
+
+void StreamingDataSource::ReadExample(DataBlock *block) {
+  if (config_.data_idx_begin + shard_idx_ == config_.data_idx_end) {
+    SeekToShardBegin();
+  }
+
+  if (config_.format == kBinaryFormat) {
+    int32_t label;
+    file_->read(reinterpret_cast<char*>(&label), sizeof(int32_t));
+    float *feature_vals = block->dense_features.AppendZeros();
+    file_->read(reinterpret_cast<char*>(feature_vals),
+        sizeof(float) * config_.feature_dim);
+    CHECK(*file_) << "Only " << config_.data_idx_begin + shard_idx_
+      << " data instances found in " << config_.filename;
+    if (config_.label_one_based) {
+      CHECK_LE(0, --label) << "label is not one-based";
+    }
+    if (config_.feature_one_based) {
+      for (int j = 0; j < config_.feature_dim; ++j) {
+        CHECK_LE(0, --feature_vals[j]) << "feature is not one-based";
+      }
+    }
+    block->labels.push_back(label);
+  } else {
+    float label;
+    int32_t num_entries;
+    do {
+      CHECK(std::getline(*file_, line_)) << "Only "
+        << config_.data_idx_begin + shard_idx_ << " data instances found in "
+        << config_.filename;
+      feature_ids_.clear();
+      feature_vals_.clear();
+    } while (!ParseLibSVMLineFast(line_.data(), line_.data() + line_.size(),
+          config_.feature_dim, config_.feature_one_based,
+          config_.label_one_based, &label, &num_entries, &feature_ids_,
+          &feature_vals_));
+    block->sparse_features.Append(feature_ids_, feature_vals_);
+    block->labels.push_back(label);
+  }
+  ++shard_idx_;
+}
+
+void StreamingDataSource::SeekToShardBegin() {
+  shard_idx_ = 0;
+  if (shard_offset_ >= 0) {
+    file_->clear();
+    file_->seekg(shard_offset_);
+    return;
+  }
+
+  file_.reset(new petuum::io::ifstream(config_.filename,
+        std::ifstream::binary));
+  CHECK(*file_) << "Failed to open " << config_.filename;
+  if (config_.format == kBinaryFormat) {
+    shard_offset_ = static_cast<int64_t>(config_.data_idx_begin)
+      * (sizeof(int32_t) + sizeof(float) * config_.feature_dim);
+    file_->seekg(shard_offset_);
+    return;
+  }
+  // Skip the examples before the shard once, and remember where it starts.
+  int32_t num_skipped = 0;
+  while (num_skipped < config_.data_idx_begin) {
+    CHECK(std::getline(*file_, line_)) << "Only " << num_skipped
+      << " data instances found in " << config_.filename;
+    if (line_.find_first_not_of(" \t\r") != std::string::npos)
+      ++num_skipped;
+  }
+  shard_offset_ = file_->tellg();
+}
+
+}  // namespace ml
+}  // namespace petuum
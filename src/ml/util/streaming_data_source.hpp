@@ -0,0 +1,148 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <boost/noncopyable.hpp>
+#include <ml/feature/dataset.hpp>
+#include <ml/util/workload_manager.hpp>
+#include <io/general_fstream.hpp>
+
+namespace petuum {
+namespace ml {
+
+enum StreamingDataFormat {
+  // label [feature_id:feature_value] ... per line, as ReadDataLabelLibSVM.
+  // Blank lines are skipped.
+  kLibSVMFormat = 0,
+  // int32_t label followed by feature_dim floats per example, as
+  // ReadDataLabelBinary.
+  kBinaryFormat = 1
+};
+
+struct StreamingDataSourceConfig {
+  StreamingDataSourceConfig() :
+    format(kLibSVMFormat), feature_dim(0), block_size(1),
+    data_idx_begin(0), data_idx_end(0), num_data_per_epoch(0),
+    feature_one_based(false), label_one_based(false) { }
+
+  // Local path or hdfs:// url, read through petuum::io::ifstream.
+  std::string filename;
+  StreamingDataFormat format;
+  int32_t feature_dim;
+
+  // Number of examples per block.
+  int32_t block_size;
+
+  // This thread's shard is the examples [data_idx_begin, data_idx_end) of
+  // the file.
+  int32_t data_idx_begin;
+  int32_t data_idx_end;
+
+  // Examples an epoch goes through; it wraps around to the beginning of the
+  // shard if this is more than the shard size. 0 means the shard size.
+  int32_t num_data_per_epoch;
+
+  bool feature_one_based;
+  bool label_one_based;
+};
+
+// Takes the shard, block size and epoch length from workload_mgr, so that
+// block k of an epoch holds the examples of batch k of WorkloadManager's
+// epoch (the indices of GetBatchDataIdx()).
+void InitStreamingDataSourceConfig(const WorkloadManager& workload_mgr,
+    StreamingDataSourceConfig* config);
+
+// A block of consecutive examples of the shard. Features are in
+// sparse_features for kLibSVMFormat and dense_features for kBinaryFormat.
+struct DataBlock {
+  SparseDataset sparse_features;
+  DenseDataset dense_features;
+  std::vector<float> labels;
+
+  int32_t GetNumData() const {
+    return labels.size();
+  }
+};
+
+// Streams a thread's shard of a training file from disk in blocks, so that
+// datasets larger than memory can be trained on. While the app works on
+// block k, a background thread reads and parses block k+1, so at most two
+// blocks are in memory at any time. Usage:
+//
+//  StreamingDataSource source(config);
+//  for (int epoch = 0; epoch < num_epochs; ++epoch) {
+//    source.Restart();
+//    while (const DataBlock *block = source.NextBlock()) {
+//      // ... train on block.
+//    }
+//  }
+//
+// Not thread-safe; meant to be used by one app thread.
+class StreamingDataSource : boost::noncopyable {
+public:
+  explicit StreamingDataSource(const StreamingDataSourceConfig& config);
+  ~StreamingDataSource();
+
+  // Returns the next block of the epoch, waiting for it to be read if
+  // needed, or NULL at the end of the epoch. The block returned by the
+  // previous call is invalidated.
+  const DataBlock *NextBlock();
+
+  // Starts the next epoch from the beginning of the shard. The block
+  // returned by the last NextBlock() is invalidated.
+  void Restart();
+
+private:
+  // Prefetch thread.
+  void PrefetchLoop();
+
+  // Reads the next block of the epoch into block; empty at the end of the
+  // epoch. Only called on the prefetch thread.
+  void ReadBlock(DataBlock *block);
+
+  // Reads the next example of the shard into block, wrapping around at the
+  // end of the shard.
+  void ReadExample(DataBlock *block);
+
+  // Positions the file at the beginning of the shard.
+  void SeekToShardBegin();
+
+  const StreamingDataSourceConfig config_;
+
+  // ======== Accessed by the prefetch thread only while it fills =========
+  std::unique_ptr<petuum::io::ifstream> file_;
+  // File offset of the beginning of the shard; -1 until found.
+  int64_t shard_offset_;
+  // Next example of the shard to read, relative to data_idx_begin.
+  int32_t shard_idx_;
+  // Examples of this epoch read so far.
+  int32_t num_read_this_epoch_;
+  std::string line_;
+  std::vector<int32_t> feature_ids_;
+  std::vector<float> feature_vals_;
+
+  // ======== Hand-off between NextBlock() and the prefetch thread ========
+  DataBlock blocks_[2];
+  // The block being filled or to be returned next.
+  int32_t fill_idx_;
+  // Set when the prefetch thread should fill (or is filling)
+  // blocks_[fill_idx_]; cleared when it is done.
+  bool fill_pending_;
+  // Set by Restart() for the prefetch thread to start a new epoch first.
+  bool restart_pending_;
+  // Set once NextBlock() is called after the last (re)start, so that
+  // Restart() before the first NextBlock() keeps the prefetched block.
+  bool epoch_started_;
+  bool stop_;
+  std::mutex mtx_;
+  std::condition_variable cv_;
+  std::thread prefetch_thread_;
+};
+
+}  // namespace ml
+}  // namespace petuum
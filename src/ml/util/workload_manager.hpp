@@ -74,6 +74,21 @@ public:
     return num_data_per_epoch_ / batch_size_;
   }
 
+  // This thread's partition is [GetDataIdxBegin(), GetDataIdxEnd()).
+  int32_t GetDataIdxBegin() const {
+    return data_idx_begin_;
+  }
+
+  int32_t GetDataIdxEnd() const {
+    return data_idx_end_;
+  }
+
+  // Number of data indices an epoch goes through, wrapping around the
+  // partition if it is not divisible into batches.
+  int32_t GetNumDataPerEpoch() const {
+    return num_data_per_epoch_;
+  }
+
   void Restart() {
     num_data_this_epoch_ = 0;
   }
@@ -96,6 +111,16 @@ public:
     return result;
   }
 
+  // The next num_data examples of dataset (a SparseDataset or DenseDataset)
+  // as a batch view, without advancing. Same examples as
+  // GetBatchDataIdx(num_data).
+  template<typename Dataset>
+  typename Dataset::BatchViewType GetBatchView(const Dataset& dataset,
+      int32_t num_data) const {
+    return dataset.GetBatch(WrapAround(num_data_this_epoch_ + data_idx_begin_),
+        num_data, data_idx_begin_, data_idx_end_);
+  }
+
   // Is end of the data set (of this partition).
   bool IsEnd() const {
     return num_data_this_epoch_ == num_data_per_epoch_;
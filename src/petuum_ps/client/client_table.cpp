@@ -5,6 +5,9 @@
 #include <petuum_ps_common/client/client_row.hpp>
 #include <petuum_ps_common/storage/bounded_dense_process_storage.hpp>
 #include <petuum_ps_common/storage/bounded_sparse_process_storage.hpp>
+#include <petuum_ps_common/storage/evicted_row_store.hpp>
+#include <petuum_ps_common/storage/ooc_row_store.hpp>
+#include <petuum_ps_common/client/ooc_client_row.hpp>
 #include <petuum_ps_common/util/class_register.hpp>
 
 #include <petuum_ps/client/ssp_client_row.hpp>
@@ -13,6 +16,7 @@
 #include <petuum_ps/consistency/ssp_push_append_only_consistency_controller.hpp>
 #include <petuum_ps/consistency/ssp_aggr_consistency_controller.hpp>
 #include <petuum_ps/consistency/ssp_aggr_value_consistency_controller.hpp>
+#include <petuum_ps/consistency/local_ooc_consistency_controller.hpp>
 #include <petuum_ps/thread/context.hpp>
 
 #include <petuum_ps/oplog/sparse_oplog.hpp>
@@ -20,6 +24,7 @@
 #include <petuum_ps/oplog/append_only_oplog.hpp>
 
 #include <cmath>
+#include <string>
 
 namespace petuum {
 
@@ -40,6 +45,7 @@ ClientTable::ClientTable(int32_t table_id, const ClientTableConfig &config):
     append_only_oplog_type_(config.append_only_oplog_type),
     row_capacity_(config.table_info.row_capacity),
     no_oplog_replay_(config.no_oplog_replay) {
+  OOCRowStore *ooc_row_store = 0;
   switch (config.process_storage_type) {
     case BoundedDense:
       {
@@ -51,6 +57,8 @@ ClientTable::ClientTable(int32_t table_id, const ClientTableConfig &config):
                    || GlobalContext::get_consistency_model() == SSPAggr) {
           StorageCreateClientRow = std::bind(&ClientTable::CreateClientRow, this,
                                              std::placeholders::_1);
+        } else if (GlobalContext::get_consistency_model() == LocalOOC) {
+          LOG(FATAL) << "LocalOOC requires BoundedSparse process storage";
         } else {
           LOG(FATAL) << "Unknown consistency model " << GlobalContext::get_consistency_model();
         }
@@ -62,38 +70,74 @@ ClientTable::ClientTable(int32_t table_id, const ClientTableConfig &config):
       break;
     case BoundedSparse:
       {
-        process_storage_ = static_cast<AbstractProcessStorage*>(
-            new BoundedSparseProcessStorage(
-            config.process_cache_capacity,
-            GlobalContext::GetLockPoolSize(config.process_cache_capacity)));
+        size_t lock_pool_size
+            = GlobalContext::GetLockPoolSize(config.process_cache_capacity);
+        if (GlobalContext::get_consistency_model() == LocalOOC) {
+          CHECK_GT(config.process_cache_capacity, 0)
+              << "LocalOOC keeps process_cache_capacity rows in memory";
+          ooc_row_store = new OOCRowStore(
+              GlobalContext::get_ooc_path_prefix() + ".table"
+              + std::to_string(table_id));
+          process_storage_ = static_cast<AbstractProcessStorage*>(
+              new BoundedSparseProcessStorage(
+                  config.process_cache_capacity, lock_pool_size,
+                  ooc_row_store,
+                  std::bind(&ClientTable::RestoreOOCClientRow, this,
+                            std::placeholders::_2, std::placeholders::_3)));
+        } else if (GlobalContext::get_consistency_model() == SSP
+            && (config.evicted_row_mem_capacity > 0
+                || config.evicted_row_spill_capacity > 0)) {
+          EvictedRowStore *evicted_rows = new EvictedRowStore(
+              config.evicted_row_mem_capacity,
+              GlobalContext::get_evicted_row_spill_dir(),
+              config.evicted_row_spill_capacity);
+          process_storage_ = static_cast<AbstractProcessStorage*>(
+              new BoundedSparseProcessStorage(
+                  config.process_cache_capacity, lock_pool_size,
+                  evicted_rows,
+                  std::bind(&ClientTable::RestoreSSPClientRow, this,
+                            std::placeholders::_1, std::placeholders::_2,
+                            std::placeholders::_3)));
+        } else {
+          process_storage_ = static_cast<AbstractProcessStorage*>(
+              new BoundedSparseProcessStorage(
+                  config.process_cache_capacity, lock_pool_size));
+        }
       }
       break;
     default:
       LOG(FATAL) << "Unknown process storage type " << config.process_storage_type;
   }
 
-  switch (config.oplog_type) {
-    case Sparse:
-      oplog_ = new SparseOpLog(config.oplog_capacity, sample_row_,
-                               dense_row_oplog_capacity_, row_oplog_type_);
-      break;
-    case AppendOnly:
-      oplog_ = new AppendOnlyOpLog(
-          config.append_only_buff_capacity,
-          sample_row_,
-          config.append_only_oplog_type,
-          dense_row_oplog_capacity_,
-          config.per_thread_append_only_buff_pool_size);
-      break;
-    case Dense:
-      oplog_ = new DenseOpLog(
-          config.oplog_capacity,
-          sample_row_,
-          dense_row_oplog_capacity_,
-          row_oplog_type_);
-      break;
-    default:
-      LOG(FATAL) << "Unknown oplog type = " << config.oplog_type;
+  // LocalOOC applies updates to the rows right away; there is nothing to
+  // send.
+  if (GlobalContext::get_consistency_model() == LocalOOC) {
+    oplog_ = 0;
+  } else {
+    switch (config.oplog_type) {
+      case Sparse:
+        oplog_ = new SparseOpLog(config.oplog_capacity, sample_row_,
+                                 dense_row_oplog_capacity_, row_oplog_type_);
+        break;
+      case AppendOnly:
+        oplog_ = new AppendOnlyOpLog(
+            table_id_,
+            config.append_only_buff_capacity,
+            sample_row_,
+            config.append_only_oplog_type,
+            dense_row_oplog_capacity_,
+            config.per_thread_append_only_buff_pool_size);
+        break;
+      case Dense:
+        oplog_ = new DenseOpLog(
+            config.oplog_capacity,
+            sample_row_,
+            dense_row_oplog_capacity_,
+            row_oplog_type_);
+        break;
+      default:
+        LOG(FATAL) << "Unknown oplog type = " << config.oplog_type;
+    }
   }
 
   switch (GlobalContext::get_consistency_model()) {
@@ -144,6 +188,15 @@ ClientTable::ClientTable(int32_t table_id, const ClientTableConfig &config):
         }
       }
       break;
+    case LocalOOC:
+      {
+        consistency_controller_
+            = new LocalOOCConsistencyController(
+                config.table_info, table_id, *process_storage_,
+                *ooc_row_store, sample_row_, thread_cache_,
+                std::bind(&ClientTable::CreateOOCClientRow, this));
+      }
+      break;
     default:
       LOG(FATAL) << "Not yet support consistency model "
                  << GlobalContext::get_consistency_model();
@@ -160,15 +213,18 @@ ClientTable::~ClientTable() {
 void ClientTable::RegisterThread() {
   if (thread_cache_.get() == 0)
     thread_cache_.reset(new ThreadTable(
-        sample_row_, client_table_config_.table_info.row_oplog_type,
+        table_id_, sample_row_,
+        client_table_config_.table_info.row_oplog_type,
         client_table_config_.table_info.row_capacity));
 
-  oplog_->RegisterThread();
+  if (oplog_ != 0)
+    oplog_->RegisterThread();
 }
 
 void ClientTable::DeregisterThread() {
   thread_cache_.reset(0);
-  oplog_->DeregisterThread();
+  if (oplog_ != 0)
+    oplog_->DeregisterThread();
 }
 
 void ClientTable::GetAsyncForced(int32_t row_id) {
@@ -206,6 +262,11 @@ ClientRow *ClientTable::Get(int32_t row_id, RowAccessor *row_accessor) {
   return consistency_controller_->Get(row_id, row_accessor);
 }
 
+void ClientTable::GetBatch(const std::vector<int32_t> &row_ids,
+                           RowAccessor *row_accessors) {
+  consistency_controller_->GetBatch(row_ids, row_accessors);
+}
+
 void ClientTable::Inc(int32_t row_id, int32_t column_id, const void *update) {
   STATS_APP_SAMPLE_INC_BEGIN(table_id_);
   consistency_controller_->Inc(row_id, column_id, update);
@@ -264,4 +325,23 @@ ClientRow *ClientTable::CreateSSPClientRow(int32_t clock) {
   return static_cast<ClientRow*>(new SSPClientRow(clock, row_data, false));
 }
 
+ClientRow *ClientTable::CreateOOCClientRow() {
+  AbstractRow *row_data = ClassRegistry<AbstractRow>::GetRegistry().CreateObject(row_type_);
+  row_data->Init(row_capacity_);
+  return static_cast<ClientRow*>(new OOCClientRow(row_data));
+}
+
+ClientRow *ClientTable::RestoreOOCClientRow(const void *data, size_t size) {
+  AbstractRow *row_data = ClassRegistry<AbstractRow>::GetRegistry().CreateObject(row_type_);
+  row_data->Deserialize(data, size);
+  return static_cast<ClientRow*>(new OOCClientRow(row_data));
+}
+
+ClientRow *ClientTable::RestoreSSPClientRow(int32_t clock, const void *data,
+                                            size_t size) {
+  AbstractRow *row_data = ClassRegistry<AbstractRow>::GetRegistry().CreateObject(row_type_);
+  row_data->Deserialize(data, size);
+  return static_cast<ClientRow*>(new SSPClientRow(clock, row_data, true));
+}
+
 }  // namespace petuum
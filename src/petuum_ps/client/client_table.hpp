@@ -39,6 +39,8 @@ public:
   void FlushThreadCache();
 
   ClientRow *Get(int32_t row_id, RowAccessor *row_accessor);
+  void GetBatch(const std::vector<int32_t> &row_ids,
+                RowAccessor *row_accessors);
   void Inc(int32_t row_id, int32_t column_id, const void *update);
   void BatchInc(int32_t row_id, const int32_t* column_ids, const void* updates,
     int32_t num_updates);
@@ -57,6 +59,10 @@ public:
     return *oplog_;
   }
 
+  int32_t get_table_id() const {
+    return table_id_;
+  }
+
   const AbstractRow* get_sample_row () const {
     return sample_row_;
   }
@@ -97,6 +103,14 @@ public:
     return no_oplog_replay_;
   }
 
+  OpLogCodec get_oplog_codec() const {
+    return client_table_config_.table_info.oplog_codec;
+  }
+
+  double get_oplog_topk_ratio() const {
+    return client_table_config_.table_info.oplog_topk_ratio;
+  }
+
 private:
   const int32_t table_id_;
   const int32_t row_type_;
@@ -122,6 +136,12 @@ private:
 
   ClientRow *CreateClientRow(int32_t clock);
   ClientRow *CreateSSPClientRow(int32_t clock);
+  // For rows coming back from the EvictedRowStore.
+  ClientRow *RestoreSSPClientRow(int32_t clock, const void *data,
+                                 size_t size);
+  // For LocalOOC rows, new or read back from the OOCRowStore.
+  ClientRow *CreateOOCClientRow();
+  ClientRow *RestoreOOCClientRow(const void *data, size_t size);
 
   const bool no_oplog_replay_;
 };
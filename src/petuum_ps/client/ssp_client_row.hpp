@@ -30,19 +30,18 @@ public:
       ClientRow(clock, row_data, use_ref_count),
       clock_(clock){ }
 
+  // The clock is read by every SSP Get() to check freshness while the bg
+  // thread advances it, so it is kept lock-free.
   void SetClock(int32_t clock) {
-    std::unique_lock<std::mutex> ulock(clock_mtx_);
-    clock_ = clock;
+    clock_.store(clock, std::memory_order_release);
   }
 
   int32_t GetClock() const {
-    std::unique_lock<std::mutex> ulock(clock_mtx_);
-    return clock_;
+    return clock_.load(std::memory_order_acquire);
   }
 
 private:  // private members
-  mutable std::mutex clock_mtx_;
-  int32_t clock_;
+  std::atomic<int32_t> clock_;
 };
 
 }  // namespace petuum
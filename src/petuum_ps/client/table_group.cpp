@@ -4,6 +4,7 @@
 #include <petuum_ps/server/server_threads.hpp>
 #include <petuum_ps/server/name_node.hpp>
 #include <petuum_ps/thread/bg_workers.hpp>
+#include <petuum_ps_common/oplog/oplog_codec.hpp>
 #include <sstream>
 #include <iostream>
 #include <algorithm>
@@ -50,6 +51,7 @@ TableGroup::TableGroup(const TableGroupConfig &table_group_config,
       table_group_config.snapshot_dir,
       table_group_config.resume_clock,
       table_group_config.resume_dir,
+      table_group_config.snapshot_incremental,
       table_group_config.update_sort_policy,
       table_group_config.bg_idle_milli,
       table_group_config.bandwidth_mbps,
@@ -58,15 +60,34 @@ TableGroup::TableGroup(const TableGroupConfig &table_group_config,
       table_group_config.thread_oplog_batch_size,
       table_group_config.server_push_row_threshold,
       table_group_config.server_idle_milli,
-      table_group_config.server_row_candidate_factor);
+      table_group_config.server_row_candidate_factor,
+      table_group_config.num_server_apply_threads,
+      table_group_config.oplog_aggr_group_size,
+      table_group_config.evicted_row_spill_dir,
+      table_group_config.ooc_path_prefix,
+      table_group_config.inproc_ring_transport,
+      table_group_config.adaptive_bg_send,
+      table_group_config.bg_bandwidth_share);
+
+  *init_thread_id = local_id_min
+                    + GlobalContext::kInitThreadIDOffset;
+
+  if (consistency_model == LocalOOC) {
+    // Tables live in this process only; there are no servers, bg threads or
+    // messages.
+    ThreadContext::RegisterThread(*init_thread_id);
+    if (table_access) {
+      vector_clock_.AddClock(*init_thread_id, 0);
+    }
+    ClockInternal = &TableGroup::ClockLocal;
+    return;
+  }
 
   CommBus *comm_bus = new CommBus(local_id_min, local_id_max,
                                   num_total_clients, 1);
   GlobalContext::comm_bus = comm_bus;
-
-  *init_thread_id = local_id_min
-                    + GlobalContext::kInitThreadIDOffset;
   CommBus::Config comm_config(*init_thread_id, CommBus::kNone, "");
+  comm_config.inproc_transport_ = GlobalContext::get_app_bg_inproc_transport();
 
   GlobalContext::comm_bus->ThreadRegister(comm_config);
   ThreadContext::RegisterThread(*init_thread_id);
@@ -93,6 +114,16 @@ TableGroup::TableGroup(const TableGroupConfig &table_group_config,
 
 TableGroup::~TableGroup() {
   pthread_barrier_destroy(&register_barrier_);
+  if (GlobalContext::get_consistency_model() == LocalOOC) {
+    pthread_barrier_destroy(&global_barrier_);
+    for (auto iter = tables_.begin(); iter != tables_.end(); iter++) {
+      delete iter->second;
+    }
+    STATS_DEREGISTER_THREAD();
+    STATS_PRINT();
+    return;
+  }
+
   BgWorkers::AppThreadDeregister();
   ServerThreads::ShutDown();
 
@@ -112,9 +143,33 @@ TableGroup::~TableGroup() {
 
 bool TableGroup::CreateTable(int32_t table_id,
   const ClientTableConfig& table_config) {
+  if (!OpLogCodecSupported(table_config.table_info)) {
+    LOG(ERROR) << "Table " << table_id << ": oplog codec "
+               << table_config.table_info.oplog_codec << " and top-k ratio "
+               << table_config.table_info.oplog_topk_ratio
+               << " require float updates, but row type "
+               << table_config.table_info.row_type << " does not have them";
+    return false;
+  }
+
   max_table_staleness_ = std::max(max_table_staleness_,
       table_config.table_info.table_staleness);
 
+  if (GlobalContext::get_consistency_model() == LocalOOC) {
+    CHECK(tables_.find(table_id) == tables_.end())
+        << "Table " << table_id << " already exists";
+    ClientTable *client_table = new ClientTable(table_id, table_config);
+    tables_[table_id] = client_table;
+    if (GlobalContext::get_num_app_threads()
+        == GlobalContext::get_num_table_threads()) {
+      client_table->RegisterThread();
+    }
+    return true;
+  }
+
+  // Bg threads route the table's rows as soon as it is created.
+  GlobalContext::RegisterRowPartitioner(table_id, table_config.table_info);
+
   bool suc = BgWorkers::CreateTable(table_id, table_config);
   if (suc
       && (GlobalContext::get_num_app_threads()
@@ -126,7 +181,12 @@ bool TableGroup::CreateTable(int32_t table_id,
 }
 
 void TableGroup::CreateTableDone() {
-  BgWorkers::WaitCreateTable();
+  if (GlobalContext::get_consistency_model() == LocalOOC) {
+    pthread_barrier_init(&global_barrier_, 0,
+                         GlobalContext::get_num_table_threads());
+  } else {
+    BgWorkers::WaitCreateTable();
+  }
   pthread_barrier_init(&register_barrier_, 0,
     GlobalContext::get_num_table_threads());
 }
@@ -146,12 +206,14 @@ int32_t TableGroup::RegisterThread() {
     + GlobalContext::kInitThreadIDOffset + app_thread_id_offset;
 
   petuum::CommBus::Config comm_config(thread_id, petuum::CommBus::kNone, "");
+  comm_config.inproc_transport_ = GlobalContext::get_app_bg_inproc_transport();
 
   ThreadContext::RegisterThread(thread_id);
 
-  GlobalContext::comm_bus->ThreadRegister(comm_config);
-
-  BgWorkers::AppThreadRegister();
+  if (GlobalContext::get_consistency_model() != LocalOOC) {
+    GlobalContext::comm_bus->ThreadRegister(comm_config);
+    BgWorkers::AppThreadRegister();
+  }
 
   vector_clock_.AddClock(thread_id, 0);
 
@@ -170,8 +232,10 @@ void TableGroup::DeregisterThread(){
     table_iter->second->DeregisterThread();
   }
 
-  BgWorkers::AppThreadDeregister();
-  GlobalContext::comm_bus->ThreadDeregister();
+  if (GlobalContext::get_consistency_model() != LocalOOC) {
+    BgWorkers::AppThreadDeregister();
+    GlobalContext::comm_bus->ThreadDeregister();
+  }
   STATS_DEREGISTER_THREAD();
 }
 
@@ -183,6 +247,14 @@ void TableGroup::Clock() {
 }
 
 void TableGroup::GlobalBarrier() {
+  if (GlobalContext::get_consistency_model() == LocalOOC) {
+    // Clock() flushes the thread caches into the tables, which every thread
+    // reads directly.
+    Clock();
+    pthread_barrier_wait(&global_barrier_);
+    return;
+  }
+
   for (int i = 0; i < max_table_staleness_ + 1; ++i) {
     Clock();
   }
@@ -201,6 +273,14 @@ void TableGroup::ClockAggressive() {
   }
 }
 
+void TableGroup::ClockLocal() {
+  for (auto table_iter = tables_.cbegin(); table_iter != tables_.cend();
+    table_iter++) {
+    table_iter->second->Clock();
+  }
+  vector_clock_.Tick(ThreadContext::get_id());
+}
+
 void TableGroup::ClockConservative() {
   for (auto table_iter = tables_.cbegin(); table_iter != tables_.cend();
     table_iter++) {
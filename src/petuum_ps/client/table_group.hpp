@@ -52,9 +52,13 @@ private:
 
   void ClockAggressive();
   void ClockConservative();
+  // LocalOOC, no bg threads to tell.
+  void ClockLocal();
 
   std::map<int32_t, ClientTable* > tables_;
   pthread_barrier_t register_barrier_;
+  // LocalOOC's GlobalBarrier() among table threads.
+  pthread_barrier_t global_barrier_;
   std::atomic<int> num_app_threads_registered_;
 
   // Max staleness among all tables.
@@ -11,8 +11,9 @@
 namespace petuum {
 
 ThreadTable::ThreadTable(
-    const AbstractRow *sample_row, int32_t row_oplog_type,
+    int32_t table_id, const AbstractRow *sample_row, int32_t row_oplog_type,
     size_t dense_row_oplog_capacity) :
+    table_id_(table_id),
     oplog_index_(GlobalContext::get_num_comm_channels_per_client()),
     sample_row_(sample_row),
     update_count_(0),
@@ -65,12 +66,14 @@ void ThreadTable::UpdateOpLogClockSSPAggr(AbstractRowOpLog *row_oplog) {
 }
 
 void ThreadTable::IndexUpdate(int32_t row_id) {
-  int32_t partition_num = GlobalContext::GetPartitionCommChannelIndex(row_id);
+  int32_t partition_num
+      = GlobalContext::GetPartitionCommChannelIndex(table_id_, row_id);
   oplog_index_[partition_num].insert(row_id);
 }
 
 size_t ThreadTable::IndexUpdateAndGetCount(int32_t row_id, size_t num_updates) {
-  int32_t partition_num = GlobalContext::GetPartitionCommChannelIndex(row_id);
+  int32_t partition_num
+      = GlobalContext::GetPartitionCommChannelIndex(table_id_, row_id);
   oplog_index_[partition_num].insert(row_id);
   update_count_ += num_updates;
   return update_count_;
@@ -217,6 +220,22 @@ void ThreadTable::FlushCache(AbstractProcessStorage &process_storage,
   row_storage_.clear();
 }
 
+void ThreadTable::FlushCache(const ApplyRowOpLogFunc &ApplyRowOpLog) {
+  for (auto oplog_iter = oplog_map_.begin(); oplog_iter != oplog_map_.end();
+       oplog_iter++) {
+    ApplyRowOpLog(oplog_iter->first, oplog_iter->second);
+    delete oplog_iter->second;
+  }
+  oplog_map_.clear();
+
+  for (auto iter = row_storage_.begin(); iter != row_storage_.end(); iter++) {
+    if (iter->second != 0) {
+      delete iter->second;
+    }
+  }
+  row_storage_.clear();
+}
+
 void ThreadTable::FlushCacheOpLog(AbstractProcessStorage &process_storage,
                                   AbstractOpLog &table_oplog,
                                   const AbstractRow *sample_row) {
@@ -228,8 +247,10 @@ void ThreadTable::FlushCacheOpLog(AbstractProcessStorage &process_storage,
     table_oplog.FindInsertOpLog(row_id, &oplog_accessor);
     UpdateOpLogClock_(oplog_accessor.get_row_oplog());
 
+    // As in SSPConsistencyController::Inc(), a row in the evicted row
+    // store is not brought back just to apply the updates.
     RowAccessor row_accessor;
-    bool found = process_storage.Find(row_id, &row_accessor);
+    bool found = process_storage.FindResident(row_id, &row_accessor);
 
     (this->*ApplyThreadOpLog_)(&oplog_accessor, &row_accessor, found,
                                oplog_iter->second, row_id);
@@ -242,7 +263,8 @@ void ThreadTable::ApplyThreadOpLogSSP(
     OpLogAccessor *oplog_accessor, RowAccessor *row_accessor, bool row_found,
     AbstractRowOpLog *row_oplog, int32_t row_id) {
 
-  int32_t partition_num = GlobalContext::GetPartitionCommChannelIndex(row_id);
+  int32_t partition_num
+      = GlobalContext::GetPartitionCommChannelIndex(table_id_, row_id);
 
   int32_t column_id;
   void *delta = row_oplog->BeginIterate(&column_id);
@@ -263,7 +285,8 @@ void ThreadTable::ApplyThreadOpLogGetImportance(
     OpLogAccessor *oplog_accessor, RowAccessor *row_accessor, bool row_found,
     AbstractRowOpLog *row_oplog, int32_t row_id) {
 
-  int32_t partition_num = GlobalContext::GetPartitionCommChannelIndex(row_id);
+  int32_t partition_num
+      = GlobalContext::GetPartitionCommChannelIndex(table_id_, row_id);
 
   int32_t column_id;
   void *delta = row_oplog->BeginIterate(&column_id);
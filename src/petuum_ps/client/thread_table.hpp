@@ -2,6 +2,7 @@
 
 #include <unordered_set>
 #include <vector>
+#include <functional>
 #include <boost/noncopyable.hpp>
 
 #include <petuum_ps_common/include/abstract_row.hpp>
@@ -16,8 +17,8 @@ namespace petuum {
 
 class ThreadTable : boost::noncopyable {
 public:
-  explicit ThreadTable(const AbstractRow *sample_row, int32_t row_oplog_type,
-                       size_t dense_row_oplog_capacity);
+  ThreadTable(int32_t table_id, const AbstractRow *sample_row,
+              int32_t row_oplog_type, size_t dense_row_oplog_capacity);
   ~ThreadTable();
   void IndexUpdate(int32_t row_id);
   void FlushOpLogIndex(TableOpLogIndex &oplog_index);
@@ -36,6 +37,12 @@ public:
   void FlushCacheOpLog(AbstractProcessStorage &process_storage, AbstractOpLog &table_oplog,
                        const AbstractRow *sample_row);
 
+  // For tables without a table oplog (LocalOOC): hands each row's updates
+  // to ApplyRowOpLog, then drops the cached rows.
+  typedef std::function<void(int32_t row_id, AbstractRowOpLog *row_oplog)>
+  ApplyRowOpLogFunc;
+  void FlushCache(const ApplyRowOpLogFunc &ApplyRowOpLog);
+
   size_t IndexUpdateAndGetCount(int32_t row_id, size_t num_updates = 1);
   void ResetUpdateCount();
 
@@ -46,6 +53,7 @@ public:
   }
 
 private:
+  const int32_t table_id_;
   std::vector<std::unordered_set<int32_t> > oplog_index_;
   boost::unordered_map<int32_t, AbstractRow* > row_storage_;
   boost::unordered_map<int32_t, AbstractRowOpLog* > oplog_map_;
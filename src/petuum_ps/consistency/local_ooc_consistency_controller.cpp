@@ -0,0 +1,161 @@
+#include <petuum_ps/consistency/local_ooc_consistency_controller.hpp>
+#include <petuum_ps_common/client/ooc_client_row.hpp>
+#include <petuum_ps_common/util/stats.hpp>
+#include <glog/logging.h>
+
+namespace petuum {
+
+LocalOOCConsistencyController::LocalOOCConsistencyController(
+    const TableInfo& info,
+    int32_t table_id,
+    AbstractProcessStorage& process_storage,
+    OOCRowStore& row_store,
+    const AbstractRow* sample_row,
+    boost::thread_specific_ptr<ThreadTable> &thread_cache,
+    CreateClientRowFunc CreateClientRow) :
+  AbstractConsistencyController(table_id, process_storage, sample_row),
+  row_store_(row_store),
+  thread_cache_(thread_cache),
+  CreateClientRow_(CreateClientRow) { }
+
+void LocalOOCConsistencyController::GetAsyncForced(int32_t row_id) {
+  GetAsync(row_id);
+}
+
+void LocalOOCConsistencyController::GetAsync(int32_t row_id) {
+  if (!process_storage_.Find(row_id))
+    row_store_.Prefetch(std::vector<int32_t>(1, row_id));
+}
+
+ClientRow *LocalOOCConsistencyController::Get(int32_t row_id,
+                                              RowAccessor* row_accessor) {
+  STATS_APP_SAMPLE_SSP_GET_BEGIN(table_id_);
+  RowTier tier;
+  ClientRow *client_row = process_storage_.Find(row_id, row_accessor, &tier);
+  STATS_APP_ACCUM_SSP_GET_TIER(table_id_, tier, true);
+
+  // A row that is neither cached nor on disk was never written to.
+  while (client_row == 0) {
+    ClientRow *new_row = CreateClientRow_();
+    // Another thread may have inserted the row meanwhile.
+    if (!process_storage_.Insert(row_id, new_row))
+      delete new_row;
+    // Gone again if it was evicted right away, as an empty row is not
+    // written back.
+    client_row = process_storage_.Find(row_id, row_accessor, &tier);
+  }
+  STATS_APP_SAMPLE_SSP_GET_END(table_id_, tier == kRowTierCache);
+  return client_row;
+}
+
+void LocalOOCConsistencyController::GetBatch(
+    const std::vector<int32_t> &row_ids, RowAccessor *row_accessors) {
+  std::vector<int32_t> rows_to_load;
+  for (int32_t row_id : row_ids) {
+    if (!process_storage_.Find(row_id))
+      rows_to_load.push_back(row_id);
+  }
+  row_store_.Prefetch(rows_to_load);
+
+  if (row_accessors != 0) {
+    for (size_t i = 0; i < row_ids.size(); ++i) {
+      Get(row_ids[i], &row_accessors[i]);
+    }
+    return;
+  }
+
+  for (int32_t row_id : rows_to_load) {
+    RowAccessor row_accessor;
+    Get(row_id, &row_accessor);
+  }
+}
+
+void LocalOOCConsistencyController::Inc(int32_t row_id, int32_t column_id,
+                                        const void* delta) {
+  RowAccessor row_accessor;
+  ClientRow *client_row = GetForUpdate(row_id, &row_accessor);
+  client_row->GetRowDataPtr()->ApplyInc(column_id, delta);
+}
+
+void LocalOOCConsistencyController::BatchInc(int32_t row_id,
+  const int32_t* column_ids, const void* updates, int32_t num_updates) {
+  RowAccessor row_accessor;
+  ClientRow *client_row = GetForUpdate(row_id, &row_accessor);
+  client_row->GetRowDataPtr()->ApplyBatchInc(column_ids, updates,
+                                             num_updates);
+}
+
+void LocalOOCConsistencyController::DenseBatchInc(
+    int32_t row_id, const void *updates, int32_t index_st,
+    int32_t num_updates) {
+  RowAccessor row_accessor;
+  ClientRow *client_row = GetForUpdate(row_id, &row_accessor);
+  client_row->GetRowDataPtr()->ApplyDenseBatchInc(updates, index_st,
+                                                  num_updates);
+}
+
+void LocalOOCConsistencyController::ThreadGet(
+    int32_t row_id, ThreadRowAccessor* row_accessor) {
+  STATS_APP_SAMPLE_THREAD_GET_BEGIN(table_id_);
+  AbstractRow *row_data = thread_cache_->GetRow(row_id);
+  if (row_data == 0) {
+    RowAccessor process_row_accessor;
+    Get(row_id, &process_row_accessor);
+    thread_cache_->InsertRow(row_id, process_row_accessor.GetRowData());
+    row_data = thread_cache_->GetRow(row_id);
+    CHECK(row_data != 0);
+  }
+  row_accessor->row_data_ptr_ = row_data;
+  STATS_APP_SAMPLE_THREAD_GET_END(table_id_);
+}
+
+void LocalOOCConsistencyController::ThreadInc(int32_t row_id,
+                                              int32_t column_id,
+                                              const void* delta) {
+  thread_cache_->Inc(row_id, column_id, delta);
+}
+
+void LocalOOCConsistencyController::ThreadBatchInc(int32_t row_id,
+  const int32_t* column_ids, const void* updates, int32_t num_updates) {
+  thread_cache_->BatchInc(row_id, column_ids, updates, num_updates);
+}
+
+void LocalOOCConsistencyController::ThreadDenseBatchInc(
+    int32_t row_id, const void *updates, int32_t index_st,
+    int32_t num_updates) {
+  thread_cache_->DenseBatchInc(row_id, updates, index_st, num_updates);
+}
+
+void LocalOOCConsistencyController::FlushThreadCache() {
+  thread_cache_->FlushCache(std::bind(
+      &LocalOOCConsistencyController::ApplyRowOpLog, this,
+      std::placeholders::_1, std::placeholders::_2));
+}
+
+void LocalOOCConsistencyController::Clock() {
+  FlushThreadCache();
+}
+
+// ==================== Private Methods ======================
+
+ClientRow *LocalOOCConsistencyController::GetForUpdate(
+    int32_t row_id, RowAccessor* row_accessor) {
+  ClientRow *client_row = Get(row_id, row_accessor);
+  static_cast<OOCClientRow*>(client_row)->MarkDirty();
+  return client_row;
+}
+
+void LocalOOCConsistencyController::ApplyRowOpLog(
+    int32_t row_id, AbstractRowOpLog *row_oplog) {
+  RowAccessor row_accessor;
+  AbstractRow *row_data
+      = GetForUpdate(row_id, &row_accessor)->GetRowDataPtr();
+  int32_t column_id;
+  const void *delta = row_oplog->BeginIterate(&column_id);
+  while (delta != 0) {
+    row_data->ApplyInc(column_id, delta);
+    delta = row_oplog->Next(&column_id);
+  }
+}
+
+}  // namespace petuum
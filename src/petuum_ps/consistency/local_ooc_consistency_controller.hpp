@@ -0,0 +1,80 @@
+#pragma once
+
+#include <petuum_ps_common/consistency/abstract_consistency_controller.hpp>
+#include <petuum_ps_common/storage/ooc_row_store.hpp>
+#include <petuum_ps/client/thread_table.hpp>
+#include <boost/thread/tss.hpp>
+#include <vector>
+#include <cstdint>
+#include <functional>
+
+namespace petuum {
+
+// LocalOOC: the table lives in this process only, with no servers. The
+// process storage is the hot row cache, over an OOCRowStore holding the rest
+// of the table on disk. Updates are applied to the rows directly, so every
+// read sees all updates that were applied (or flushed from thread caches)
+// before it; there is no staleness to wait for.
+class LocalOOCConsistencyController : public AbstractConsistencyController {
+public:
+  // Creates an empty OOCClientRow.
+  typedef std::function<ClientRow*()> CreateClientRowFunc;
+
+  // row_store is the one under process_storage.
+  LocalOOCConsistencyController(
+      const TableInfo& info,
+      int32_t table_id,
+      AbstractProcessStorage& process_storage,
+      OOCRowStore& row_store,
+      const AbstractRow* sample_row,
+      boost::thread_specific_ptr<ThreadTable> &thread_cache,
+      CreateClientRowFunc CreateClientRow);
+
+  // Read ahead row_id if it is on disk.
+  virtual void GetAsyncForced(int32_t row_id);
+  virtual void GetAsync(int32_t row_id);
+  virtual void WaitPendingAsnycGet() { }
+
+  // Load row_id from disk if it is not cached; create it if it is new.
+  virtual ClientRow *Get(int32_t row_id, RowAccessor* row_accessor);
+
+  // Reads ahead the rows that are not cached, all at once, before loading
+  // them.
+  virtual void GetBatch(const std::vector<int32_t> &row_ids,
+                        RowAccessor *row_accessors);
+
+  virtual void Inc(int32_t row_id, int32_t column_id, const void* delta);
+
+  virtual void BatchInc(int32_t row_id, const int32_t* column_ids,
+                        const void* updates, int32_t num_updates);
+
+  virtual void DenseBatchInc(int32_t row_id, const void *updates,
+                             int32_t index_st, int32_t num_updates);
+
+  virtual void ThreadGet(int32_t row_id, ThreadRowAccessor* row_accessor);
+
+  virtual void ThreadInc(int32_t row_id, int32_t column_id, const void* delta);
+
+  virtual void ThreadBatchInc(int32_t row_id, const int32_t* column_ids,
+                              const void* updates, int32_t num_updates);
+
+  virtual void ThreadDenseBatchInc(
+      int32_t row_id, const void *updates, int32_t index_st,
+      int32_t num_updates);
+
+  virtual void FlushThreadCache();
+  virtual void Clock();
+
+private:
+  // Same as Get(), and marks the row dirty as the caller is about to update
+  // it.
+  ClientRow *GetForUpdate(int32_t row_id, RowAccessor* row_accessor);
+
+  void ApplyRowOpLog(int32_t row_id, AbstractRowOpLog *row_oplog);
+
+  OOCRowStore &row_store_;
+  boost::thread_specific_ptr<ThreadTable> &thread_cache_;
+  CreateClientRowFunc CreateClientRow_;
+};
+
+}  // namespace petuum
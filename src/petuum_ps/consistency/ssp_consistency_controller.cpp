@@ -23,9 +23,6 @@ SSPConsistencyController::SSPConsistencyController(
   thread_cache_(thread_cache),
   oplog_index_(oplog_index),
   oplog_(oplog) {
-  AddUpdates_ = std::bind(&AbstractRow::AddUpdates,
-                          sample_row_, std::placeholders::_1,
-                          std::placeholders::_2, std::placeholders::_3);
   if (row_oplog_type == RowOpLogType::kDenseRowOpLog) {
     DenseBatchIncOpLog_ = &SSPConsistencyController::DenseBatchIncDenseOpLog;
   } else {
@@ -39,16 +36,19 @@ ClientRow *SSPConsistencyController::Get(int32_t row_id, RowAccessor* row_access
   // Look for row_id in process_storage_.
   int32_t stalest_clock = std::max(0, ThreadContext::get_clock() - staleness_);
 
-  ClientRow *client_row = process_storage_.Find(row_id, row_accessor);
+  RowTier tier;
+  ClientRow *client_row = process_storage_.Find(row_id, row_accessor, &tier);
 
   if (client_row != 0) {
     // Found it! Check staleness.
     int32_t clock = client_row->GetClock();
     if (clock >= stalest_clock) {
+      STATS_APP_ACCUM_SSP_GET_TIER(table_id_, tier, true);
       STATS_APP_SAMPLE_SSP_GET_END(table_id_, true);
       return client_row;
     }
   }
+  STATS_APP_ACCUM_SSP_GET_TIER(table_id_, tier, false);
 
   // Didn't find row_id that's fresh enough in process_storage_.
   // Fetch from server.
@@ -74,6 +74,45 @@ ClientRow *SSPConsistencyController::Get(int32_t row_id, RowAccessor* row_access
   return client_row;
 }
 
+void SSPConsistencyController::GetBatch(const std::vector<int32_t> &row_ids,
+                                        RowAccessor *row_accessors) {
+  int32_t stalest_clock = std::max(0, ThreadContext::get_clock() - staleness_);
+  FetchGetBatch(row_ids, row_accessors, stalest_clock, true);
+}
+
+void SSPConsistencyController::FetchGetBatch(
+    const std::vector<int32_t> &row_ids, RowAccessor *row_accessors,
+    int32_t stalest_clock, bool check_clock) {
+  std::vector<int32_t> rows_to_fetch;
+  for (int32_t row_id : row_ids) {
+    RowAccessor row_accessor;
+    RowTier tier;
+    ClientRow *client_row = process_storage_.Find(row_id, &row_accessor,
+                                                  &tier);
+    if (client_row == 0
+        || (check_clock && client_row->GetClock() < stalest_clock))
+      rows_to_fetch.push_back(row_id);
+  }
+
+  if (!rows_to_fetch.empty()) {
+    std::sort(rows_to_fetch.begin(), rows_to_fetch.end());
+    rows_to_fetch.erase(std::unique(rows_to_fetch.begin(),
+                                    rows_to_fetch.end()),
+                        rows_to_fetch.end());
+    STATS_APP_ACCUM_SSP_GET_SERVER_FETCH_BEGIN(table_id_);
+    BgWorkers::RequestRowBatch(table_id_, rows_to_fetch, stalest_clock);
+    STATS_APP_ACCUM_SSP_GET_SERVER_FETCH_END(table_id_);
+  }
+
+  if (row_accessors == 0)
+    return;
+
+  // Rows evicted since are fetched again one by one.
+  for (size_t i = 0; i < row_ids.size(); ++i) {
+    Get(row_ids[i], &row_accessors[i]);
+  }
+}
+
 void SSPConsistencyController::Inc(int32_t row_id, int32_t column_id,
     const void* delta) {
   thread_cache_->IndexUpdate(row_id);
@@ -84,8 +123,11 @@ void SSPConsistencyController::Inc(int32_t row_id, int32_t column_id,
   void *oplog_delta = oplog_accessor.get_row_oplog()->FindCreate(column_id);
   sample_row_->AddUpdates(column_id, oplog_delta, delta);
 
+  // A row in the evicted row store is not brought back for an update, which
+  // stays in the oplog only. The copy misses it like a row fetched before
+  // the oplog is sent, and its clock still bounds its staleness.
   RowAccessor row_accessor;
-  ClientRow *client_row = process_storage_.Find(row_id, &row_accessor);
+  ClientRow *client_row = process_storage_.FindResident(row_id, &row_accessor);
   if (client_row != 0) {
     client_row->GetRowDataPtr()->ApplyInc(column_id, delta);
   }
@@ -112,7 +154,7 @@ void SSPConsistencyController::BatchInc(int32_t row_id,
 
   STATS_APP_SAMPLE_BATCH_INC_PROCESS_STORAGE_BEGIN();
   RowAccessor row_accessor;
-  ClientRow *client_row = process_storage_.Find(row_id, &row_accessor);
+  ClientRow *client_row = process_storage_.FindResident(row_id, &row_accessor);
   if (client_row != 0) {
     client_row->GetRowDataPtr()->ApplyBatchInc(column_ids, updates,
                                                num_updates);
@@ -141,7 +183,7 @@ void SSPConsistencyController::DenseBatchInc(
 
   STATS_APP_SAMPLE_BATCH_INC_PROCESS_STORAGE_BEGIN();
   RowAccessor row_accessor;
-  ClientRow *client_row = process_storage_.Find(row_id, &row_accessor);
+  ClientRow *client_row = process_storage_.FindResident(row_id, &row_accessor);
   if (client_row != 0) {
     client_row->GetRowDataPtr()->ApplyDenseBatchInc(
         updates, index_st, num_updates);
@@ -152,14 +194,8 @@ void SSPConsistencyController::DenseBatchInc(
 void SSPConsistencyController::DenseBatchIncDenseOpLog(
     OpLogAccessor *oplog_accessor, const uint8_t *updates,
     int32_t index_st, int32_t num_updates) {
-  size_t update_size = sample_row_->get_update_size();
-  uint8_t *oplog_delta = reinterpret_cast<uint8_t*>(
-      oplog_accessor->get_row_oplog()->FindCreate(index_st));
-  for (int i = 0; i < num_updates; ++i) {
-    int32_t col_id = i + index_st;
-    AddUpdates_(col_id, oplog_delta, updates + update_size*i);
-    oplog_delta += update_size;
-  }
+  void *oplog_delta = oplog_accessor->get_row_oplog()->FindCreate(index_st);
+  sample_row_->AddDenseUpdates(index_st, oplog_delta, updates, num_updates);
 }
 
 void SSPConsistencyController::DenseBatchIncNonDenseOpLog(
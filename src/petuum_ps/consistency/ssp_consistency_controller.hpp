@@ -37,6 +37,10 @@ public:
   // in storage.
   virtual ClientRow *Get(int32_t row_id, RowAccessor* row_accessor);
 
+  // One request for all rows that are missing or too stale.
+  virtual void GetBatch(const std::vector<int32_t> &row_ids,
+                        RowAccessor *row_accessors);
+
   // Return immediately.
   virtual void Inc(int32_t row_id, int32_t column_id, const void* delta);
 
@@ -62,6 +66,13 @@ public:
   virtual void Clock();
 
 protected:
+  // Fetches the rows of row_ids that are not in the process storage, or
+  // (with check_clock) older than stalest_clock, in one batch, then Get()s
+  // them into row_accessors if given.
+  void FetchGetBatch(const std::vector<int32_t> &row_ids,
+                     RowAccessor *row_accessors, int32_t stalest_clock,
+                     bool check_clock);
+
   void DenseBatchIncDenseOpLog(OpLogAccessor *oplog_accessor, const uint8_t *updates,
                                int32_t index_st, int32_t num_updates);
   void DenseBatchIncNonDenseOpLog(OpLogAccessor *oplog_accessor, const uint8_t *updates,
@@ -80,8 +91,6 @@ protected:
   // all local updates are reflected in the row values.
   AbstractOpLog& oplog_;
 
-  typedef std::function<void(int32_t, void*, const void*)> AddUpdatesFunc;
-  AddUpdatesFunc AddUpdates_;
   DenseBatchIncOpLogFunc DenseBatchIncOpLog_;
 };
 
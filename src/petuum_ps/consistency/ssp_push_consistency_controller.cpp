@@ -114,6 +114,27 @@ ClientRow *SSPPushConsistencyController::Get(int32_t row_id,
   return client_row;
 }
 
+void SSPPushConsistencyController::GetBatch(
+    const std::vector<int32_t> &row_ids, RowAccessor *row_accessors) {
+  int32_t stalest_clock = std::max(0, ThreadContext::get_clock() - staleness_);
+
+  if (ThreadContext::GetCachedSystemClock() < stalest_clock) {
+    int32_t system_clock = BgWorkers::GetSystemClock();
+    if(system_clock < stalest_clock) {
+      STATS_APP_ACCUM_SSPPUSH_GET_COMM_BLOCK_BEGIN(table_id_);
+      BgWorkers::WaitSystemClock(stalest_clock);
+      STATS_APP_ACCUM_SSPPUSH_GET_COMM_BLOCK_END(table_id_);
+      system_clock = BgWorkers::GetSystemClock();
+    }
+    ThreadContext::SetCachedSystemClock(system_clock);
+  }
+
+  // The bg thread answers a bulk request once, so no single row request may
+  // be outstanding.
+  WaitPendingAsnycGet();
+  FetchGetBatch(row_ids, row_accessors, stalest_clock, false);
+}
+
 void SSPPushConsistencyController::ThreadGet(int32_t row_id,
   ThreadRowAccessor* row_accessor) {
   STATS_APP_SAMPLE_THREAD_GET_BEGIN(table_id_);
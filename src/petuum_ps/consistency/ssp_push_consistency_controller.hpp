@@ -30,6 +30,10 @@ public:
   // in storage.
   ClientRow *Get(int32_t row_id, RowAccessor* row_accessor);
 
+  // Rows found in storage are fresh as of the system clock.
+  void GetBatch(const std::vector<int32_t> &row_ids,
+                RowAccessor *row_accessors);
+
   void ThreadGet(int32_t row_id, ThreadRowAccessor* row_accessor);
 
 private:
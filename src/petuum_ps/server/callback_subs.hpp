@@ -2,7 +2,6 @@
 #include <stdint.h>
 #include <bitset>
 
-#include <petuum_ps_common/util/record_buff.hpp>
 #include <petuum_ps/thread/context.hpp>
 #include <glog/logging.h>
 
@@ -14,6 +13,8 @@ namespace petuum {
 
 class CallBackSubs {
 public:
+  typedef std::bitset<PETUUM_MAX_NUM_CLIENTS> ClientSet;
+
   CallBackSubs() { }
   ~CallBackSubs() { }
 
@@ -35,59 +36,13 @@ public:
     return bit_changed;
   }
 
-  bool AppendRowToBuffs(
-      int32_t client_id_st,
-      boost::unordered_map<int32_t, RecordBuff> *buffs,
-      const void *row_data, size_t row_size, int32_t row_id,
-      int32_t *failed_client_id) {
-    // Some simple tests show that iterating bitset isn't too bad.
-    // For bitset size below 512, it takes 200~300 ns on an Intel i5 CPU.
-    int32_t client_id;
-    for (client_id = client_id_st;
-         client_id < GlobalContext::get_num_clients(); ++client_id) {
-      if (subscriptions_.test(client_id)) {
-        bool suc = (*buffs)[client_id].Append(row_id, row_data, row_size);
-        if (!suc) {
-          *failed_client_id = client_id;
-          return false;
-        }
-      }
-    }
-    //VLOG(0) << "Return true";
-    return true;
-  }
-
-  void AccumSerializedSizePerClient(
-      boost::unordered_map<int32_t, size_t> *client_size_map,
-      size_t serialized_size) {
-    int32_t client_id;
-    for (client_id = 0;
-         client_id < GlobalContext::get_num_clients(); ++client_id) {
-      if (subscriptions_.test(client_id)) {
-        (*client_size_map)[client_id] += serialized_size + sizeof(int32_t)
-                                         + sizeof(size_t);
-      }
-    }
-  }
-
-  void AppendRowToBuffs(
-      boost::unordered_map<int32_t, RecordBuff> *buffs,
-      const void *row_data, size_t row_size, int32_t row_id) {
-    // Some simple tests show that iterating bitset isn't too bad.
-    // For bitset size below 512, it takes 200~300 ns on an Intel i5 CPU.
-    int32_t client_id;
-    for (client_id = 0;
-         client_id < GlobalContext::get_num_clients(); ++client_id) {
-      if (subscriptions_.test(client_id)) {
-        bool suc = (*buffs)[client_id].Append(row_id, row_data, row_size);
-        if (!suc)
-          (*buffs)[client_id].PrintInfo();
-      }
-    }
+  // Clients subscribed, indexed by client id.
+  const ClientSet &get_subscriptions() const {
+    return subscriptions_;
   }
 
 private:
-  std::bitset<PETUUM_MAX_NUM_CLIENTS> subscriptions_;
+  ClientSet subscriptions_;
 };
 
 }  //namespace petuum
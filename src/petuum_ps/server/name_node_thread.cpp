@@ -137,6 +137,12 @@ void NameNodeThread::HandleCreateTable (int32_t sender_id,
     table_info.oplog_dense_serialized = create_table_msg.get_oplog_dense_serialized();
     table_info.row_oplog_type = create_table_msg.get_row_oplog_type();
     table_info.dense_row_oplog_capacity = create_table_msg.get_dense_row_oplog_capacity();
+    table_info.server_dense_storage = create_table_msg.get_server_dense_storage();
+    table_info.oplog_codec = create_table_msg.get_oplog_codec();
+    table_info.oplog_topk_ratio = create_table_msg.get_oplog_topk_ratio();
+    table_info.row_partitioner = create_table_msg.get_row_partitioner();
+    table_info.row_partitioner_num_rows
+        = create_table_msg.get_row_partitioner_num_rows();
     server_obj_.CreateTable(table_id, table_info);
 
     create_table_map_.insert(std::make_pair(table_id, CreateTableInfo())); // access it to call default constructor
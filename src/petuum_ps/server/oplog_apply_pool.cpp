@@ -0,0 +1,83 @@
+#include <petuum_ps/server/oplog_apply_pool.hpp>
+#include <petuum_ps_common/util/high_resolution_timer.hpp>
+#include <glog/logging.h>
+
+namespace petuum {
+
+OpLogApplyPool::OpLogApplyPool(int32_t num_shards):
+    num_shards_(num_shards),
+    shards_(num_shards),
+    shard_apply_sec_(num_shards, 0.0),
+    round_(0),
+    num_workers_busy_(0),
+    stop_(false) {
+  CHECK_GT(num_shards_, 0);
+  for (int32_t shard = 1; shard < num_shards_; ++shard) {
+    workers_.push_back(std::thread(&OpLogApplyPool::WorkerMain, this, shard));
+  }
+}
+
+OpLogApplyPool::~OpLogApplyPool() {
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    stop_ = true;
+  }
+  work_cv_.notify_all();
+  for (auto &worker : workers_) {
+    worker.join();
+  }
+}
+
+void OpLogApplyPool::ApplyAll() {
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    ++round_;
+    num_workers_busy_ = num_shards_ - 1;
+  }
+  work_cv_.notify_all();
+
+  ApplyShard(0);
+
+  std::unique_lock<std::mutex> lock(mtx_);
+  done_cv_.wait(lock, [this] { return num_workers_busy_ == 0; });
+}
+
+void OpLogApplyPool::ApplyShard(int32_t shard) {
+  HighResolutionTimer apply_timer;
+  std::vector<RowUpdate> &row_updates = shards_[shard];
+  for (const auto &row_update : row_updates) {
+    bool found = row_update.server_table->ApplyRowOpLog(
+        row_update.row_id, row_update.column_ids, row_update.updates,
+        row_update.num_updates);
+    CHECK(found) << "row " << row_update.row_id
+                 << " was not created before apply";
+  }
+  row_updates.clear();
+  shard_apply_sec_[shard] = apply_timer.elapsed();
+}
+
+void OpLogApplyPool::WorkerMain(int32_t shard) {
+  uint64_t my_round = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mtx_);
+      work_cv_.wait(lock, [this, my_round] {
+          return stop_ || round_ != my_round; });
+      if (stop_)
+        return;
+      my_round = round_;
+    }
+
+    ApplyShard(shard);
+
+    bool last_done;
+    {
+      std::lock_guard<std::mutex> lock(mtx_);
+      last_done = (--num_workers_busy_ == 0);
+    }
+    if (last_done)
+      done_cv_.notify_one();
+  }
+}
+
+}  // namespace petuum
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <boost/noncopyable.hpp>
+
+#include <petuum_ps/server/server_table.hpp>
+
+namespace petuum {
+
+// Applies the row updates of one oplog message on several threads.
+//
+// Server::ApplyOpLogUpdateVersion() reads the message on the server thread,
+// makes sure every row exists and Add()s each row update to the shard its
+// row id maps to. ApplyAll() then applies all shards in parallel (shard 0 on
+// the calling thread, the others on the pool's worker threads) and returns
+// once every shard is done.
+//
+// A row always maps to the same shard and a shard applies its updates in the
+// order they were added, so updates to a row are applied in the same order
+// as in the serial path. Since ApplyAll() does not return before the whole
+// message has been applied, everything that happens after it on the server
+// thread (ClockUntil(), replying row requests, pushing rows) sees the same
+// state as before.
+class OpLogApplyPool : boost::noncopyable {
+public:
+  explicit OpLogApplyPool(int32_t num_shards);
+  ~OpLogApplyPool();
+
+  int32_t get_num_shards() const {
+    return num_shards_;
+  }
+
+  // The row must exist in server_table. column_ids and updates must stay
+  // valid until ApplyAll() returns.
+  void Add(ServerTable *server_table, int32_t row_id,
+           const int32_t *column_ids, const void *updates,
+           int32_t num_updates) {
+    shards_[GetShard(row_id)].push_back(
+        RowUpdate(server_table, row_id, column_ids, updates, num_updates));
+  }
+
+  // Apply and clear everything that was Add()ed since the last call.
+  void ApplyAll();
+
+  // Time spent by each shard in the last ApplyAll(), in seconds.
+  const std::vector<double> &get_shard_apply_sec() const {
+    return shard_apply_sec_;
+  }
+
+private:
+  struct RowUpdate {
+    ServerTable *server_table;
+    int32_t row_id;
+    const int32_t *column_ids;
+    const void *updates;
+    int32_t num_updates;
+
+    RowUpdate(ServerTable *_server_table, int32_t _row_id,
+              const int32_t *_column_ids, const void *_updates,
+              int32_t _num_updates):
+        server_table(_server_table),
+        row_id(_row_id),
+        column_ids(_column_ids),
+        updates(_updates),
+        num_updates(_num_updates) { }
+  };
+
+  // Rows of a server thread are strided (row_id % num_comm_channels selects
+  // the server thread), so row ids are hashed rather than taken modulo
+  // num_shards_ to spread them evenly.
+  int32_t GetShard(int32_t row_id) const {
+    return (static_cast<uint32_t>(row_id) * 2654435761U) % num_shards_;
+  }
+
+  void ApplyShard(int32_t shard);
+  void WorkerMain(int32_t shard);
+
+  const int32_t num_shards_;
+  std::vector<std::vector<RowUpdate> > shards_;
+  std::vector<double> shard_apply_sec_;
+
+  std::vector<std::thread> workers_;
+  std::mutex mtx_;
+  std::condition_variable work_cv_;
+  std::condition_variable done_cv_;
+  // Bumped by ApplyAll() to start a round.
+  uint64_t round_;
+  int32_t num_workers_busy_;
+  bool stop_;
+};
+
+}  // namespace petuum
@@ -2,6 +2,7 @@
 
 #include <boost/noncopyable.hpp>
 #include <petuum_ps/server/server_table.hpp>
+#include <petuum_ps_common/oplog/oplog_codec.hpp>
 
 namespace petuum {
 
@@ -14,6 +15,9 @@ namespace petuum {
 // 2. int32_t : table id
 // 3. size_t : update_size for this table
 // 4. serialized table, details in oplog_partition
+//
+// Row oplogs of tables with an oplog codec are decoded into memory owned by
+// the reader, so updates returned by Next() stay valid as long as the reader.
 
 class SerializedOpLogReader : boost::noncopyable {
 public:
@@ -50,10 +54,18 @@ public:
             serialized_oplog_ptr_ + offset_));
         offset_ += sizeof(int32_t);
         size_t serialized_size;
-        const void *update
-            = GetNextUpdate_(curr_sample_row_oplog_,
-                             serialized_oplog_ptr_ + offset_,
-                             column_ids, num_updates, &serialized_size);
+        const void *update;
+        if (curr_oplog_codec_ == NoCodec) {
+          update = GetNextUpdate_(curr_sample_row_oplog_,
+                                  serialized_oplog_ptr_ + offset_,
+                                  column_ids, num_updates, &serialized_size);
+        } else {
+          update = DecodeRowOpLog(curr_oplog_codec_, curr_dense_serialized_,
+                                  update_size_,
+                                  serialized_oplog_ptr_ + offset_,
+                                  &decode_arena_, column_ids, num_updates,
+                                  &serialized_size);
+        }
         offset_ += serialized_size;
         --num_rows_left_in_current_table_;
         return update;
@@ -107,6 +119,8 @@ private:
 
     auto table_iter = server_tables_.find(current_table_id_);
     curr_sample_row_oplog_ = table_iter->second.get_sample_row_oplog();
+    curr_oplog_codec_ = table_iter->second.oplog_codec();
+    curr_dense_serialized_ = table_iter->second.oplog_dense_serialized();
     if (table_iter->second.oplog_dense_serialized())
       GetNextUpdate_ = GetNextUpdateDense;
     else
@@ -124,6 +138,9 @@ private:
   const boost::unordered_map<int32_t, ServerTable> &server_tables_;
   const AbstractRowOpLog *curr_sample_row_oplog_;
   GetNextUpdateFunc GetNextUpdate_;
+  OpLogCodec curr_oplog_codec_;
+  bool curr_dense_serialized_;
+  OpLogDecodeArena decode_arena_;
 };
 
 }  // namespace petuum
@@ -3,10 +3,12 @@
 #include <petuum_ps/server/server.hpp>
 #include <petuum_ps/server/serialized_oplog_reader.hpp>
 #include <petuum_ps_common/util/class_register.hpp>
+#include <petuum_ps_common/util/stats.hpp>
 
 #include <utility>
 #include <fstream>
 #include <map>
+#include <string.h>
 
 namespace petuum {
 
@@ -25,12 +27,38 @@ void Server::Init(int32_t server_id,
    server_id_ = server_id;
 
    accum_oplog_count_ = 0;
+
+   if (GlobalContext::get_num_server_apply_threads() > 1
+       && server_id_ != GlobalContext::get_name_node_id()) {
+     apply_pool_.reset(
+         new OpLogApplyPool(GlobalContext::get_num_server_apply_threads()));
+   }
+
+   if (GlobalContext::get_snapshot_clock() > 0
+       && server_id_ != GlobalContext::get_name_node_id()) {
+     snapshot_writer_.reset(new SnapShotWriter);
+   }
  }
 
  void Server::CreateTable(int32_t table_id, TableInfo &table_info){
    auto ret = tables_.emplace(table_id, ServerTable(table_info));
    CHECK(ret.second);
 
+   // Rows held by this server thread, see RowPartitioner. Hashed rows are
+   // not contiguous in any stride and keep the hashed layout.
+   int32_t partition = GlobalContext::GetServerPartition(server_id_);
+   if (table_info.server_dense_storage
+       && table_info.row_partitioner == ModuloPartitioner) {
+     ret.first->second.UseDenseStorage(
+         GlobalContext::get_num_total_comm_channels(), partition);
+   } else if (table_info.server_dense_storage
+              && table_info.row_partitioner == RangePartitioner) {
+     ret.first->second.UseDenseStorage(
+         1, RowPartitioner::GetRangeBegin(
+             partition, GlobalContext::get_num_total_comm_channels(),
+             table_info.row_partitioner_num_rows));
+   }
+
    if (GlobalContext::get_resume_clock() > 0) {
      boost::unordered_map<int32_t, ServerTable>::iterator table_iter
          = tables_.find(table_id);
@@ -66,7 +94,9 @@ void Server::Init(int32_t server_id,
           table_iter++) {
        table_iter->second.TakeSnapShot(GlobalContext::get_snapshot_dir(),
                                        server_id_,
-                                       table_iter->first, new_clock);
+                                       table_iter->first, new_clock,
+                                       GlobalContext::get_snapshot_incremental(),
+                                       snapshot_writer_.get());
      }
      return true;
    }
@@ -119,6 +149,18 @@ void Server::Init(int32_t server_id,
    CHECK_EQ(bg_version_map_[bg_thread_id] + 1, version);
    bg_version_map_[bg_thread_id] = version;
 
+   ApplyOpLog(oplog, oplog_size);
+ }
+
+ void Server::UpdateBgVersion(int32_t bg_thread_id, uint32_t version) {
+   // versions wrap around; the first one follows the initial -1
+   CHECK_GT(static_cast<int32_t>(version - bg_version_map_[bg_thread_id]), 0)
+       << "bg " << bg_thread_id << " version " << version
+       << " not newer than " << bg_version_map_[bg_thread_id];
+   bg_version_map_[bg_thread_id] = version;
+ }
+
+ void Server::ApplyOpLog(const void *oplog, size_t oplog_size) {
    if (oplog_size == 0)
      return;
 
@@ -144,6 +186,12 @@ void Server::Init(int32_t server_id,
      server_table = &(table_iter->second);
    }
 
+   if (apply_pool_) {
+     ApplyOpLogSharded(&oplog_reader, updates, server_table, table_id, row_id,
+                       column_ids, num_updates);
+     return;
+   }
+
    while (updates != 0) {
      ++accum_oplog_count_;
      bool found
@@ -168,6 +216,41 @@ void Server::Init(int32_t server_id,
    }
  }
 
+ void Server::ApplyOpLogSharded(
+     SerializedOpLogReader *oplog_reader, const void *updates,
+     ServerTable *server_table, int32_t table_id, int32_t row_id,
+     const int32_t *column_ids, int32_t num_updates) {
+   bool started_new_table;
+   // Rows are created here, on the server thread, so that the shards only
+   // look rows up and never modify a table's storage.
+   while (updates != 0) {
+     ++accum_oplog_count_;
+     if (server_table->FindRow(row_id) == 0)
+       server_table->CreateRow(row_id);
+
+     apply_pool_->Add(server_table, row_id, column_ids, updates, num_updates);
+
+     updates = oplog_reader->Next(&table_id, &row_id, &column_ids,
+       &num_updates, &started_new_table);
+
+     if (updates == 0)
+       break;
+     if (started_new_table) {
+       auto table_iter = tables_.find(table_id);
+       CHECK(table_iter != tables_.end())
+         << "Not found table_id = " << table_id;
+       server_table = &(table_iter->second);
+     }
+   }
+
+   apply_pool_->ApplyAll();
+
+   for (int32_t shard = 0; shard < apply_pool_->get_num_shards(); ++shard) {
+     STATS_SERVER_ACCUM_APPLY_OPLOG_SHARD_SEC(
+         shard, apply_pool_->get_shard_apply_sec()[shard]);
+   }
+ }
+
  int32_t Server::GetMinClock() {
    return bg_clock_.get_min_clock();
  }
@@ -176,240 +259,186 @@ void Server::Init(int32_t server_id,
    return bg_version_map_[bg_thread_id];
  }
 
- size_t Server::CreateSendServerPushRowMsgs(PushMsgSendFunc PushMsgSend,
-                                            bool clock_changed) {
-   boost::unordered_map<int32_t, RecordBuff> buffs;
-   boost::unordered_map<int32_t, ServerPushRowMsg*> msg_map;
-
-   accum_oplog_count_ = 0;
-
-   size_t accum_send_bytes = 0;
-
-   int32_t comm_channel_idx
-       = GlobalContext::GetCommChannelIndexServer(server_id_);
-
-   // Create a message for each bg thread
-   int32_t client_id = 0;
-   for (client_id = 0;
-        client_id < GlobalContext::get_num_clients(); ++client_id) {
-    ServerPushRowMsg *msg = new ServerPushRowMsg(push_row_msg_data_size_);
-    msg_map[client_id] = msg;
-    buffs.insert(
-        std::make_pair(client_id,
-                       RecordBuff(msg->get_data(), push_row_msg_data_size_)));
-  }
+size_t Server::CreateSendServerPushRowMsgs(PushMsgSendFunc PushMsgSend,
+                                           bool clock_changed) {
+  accum_oplog_count_ = 0;
 
-  int32_t num_tables_left = GlobalContext::get_num_tables();
   for (auto table_iter = tables_.begin(); table_iter != tables_.end();
        table_iter++) {
-    int32_t table_id = table_iter->first;
-    ServerTable &server_table = table_iter->second;
-    for (client_id = 0;
-         client_id < GlobalContext::get_num_clients(); ++client_id) {
-      RecordBuff &record_buff = buffs[client_id];
-      int32_t *table_id_ptr = record_buff.GetMemPtrInt32();
-      if (table_id_ptr == 0) {
-        int32_t bg_id = GlobalContext::get_bg_thread_id(client_id,
-                                                        comm_channel_idx);
-        PushMsgSend(bg_id, msg_map[client_id], false && clock_changed,
-                    GetBgVersion(bg_id), GetMinClock());
-        memset((msg_map[client_id])->get_data(), 0, push_row_msg_data_size_);
-        record_buff.ResetOffset();
-        table_id_ptr = record_buff.GetMemPtrInt32();
-      }
-      *table_id_ptr = table_id;
-    }
-
-    //ServerTable packs the data.
-    server_table.InitAppendTableToBuffs();
-    int32_t failed_client_id;
-    bool pack_suc = server_table.AppendTableToBuffs(0, &buffs,
-                                                    &failed_client_id, false);
-    while (!pack_suc) {
-      RecordBuff &record_buff = buffs[failed_client_id];
-      int32_t *buff_end_ptr = record_buff.GetMemPtrInt32();
-      if (buff_end_ptr != 0)
-        *buff_end_ptr = GlobalContext::get_serialized_table_end();
-
-      int32_t bg_id = GlobalContext::get_bg_thread_id(failed_client_id,
-                                                      comm_channel_idx);
-      PushMsgSend(bg_id, msg_map[failed_client_id], false && clock_changed,
-                  GetBgVersion(bg_id), GetMinClock());
-      memset((msg_map[failed_client_id])->get_data(), 0,
-             push_row_msg_data_size_);
-      record_buff.ResetOffset();
-      int32_t *table_id_ptr = record_buff.GetMemPtrInt32();
-      *table_id_ptr = table_id;
-      pack_suc = server_table.AppendTableToBuffs(failed_client_id, &buffs,
-                                                 &failed_client_id, true);
+    table_rows_to_push_.clear();
+    table_iter->second.GetRowsToPush(&table_rows_to_push_);
+    for (const auto &row : table_rows_to_push_) {
+      AddRowToPush(table_iter->first, row);
     }
-
-    --num_tables_left;
-    if (num_tables_left > 0) {
-      for (client_id = 0;
-           client_id < GlobalContext::get_num_clients(); ++client_id) {
-
-        RecordBuff &record_buff = buffs[client_id];
-        int32_t *table_sep_ptr = record_buff.GetMemPtrInt32();
-        if (table_sep_ptr == 0) {
-          int32_t bg_id = GlobalContext::get_bg_thread_id(client_id,
-                                                          comm_channel_idx);
-
-          PushMsgSend(bg_id, msg_map[client_id], false && clock_changed,
-                      GetBgVersion(bg_id), GetMinClock());
-          memset((msg_map[client_id])->get_data(), 0, push_row_msg_data_size_);
-          record_buff.ResetOffset();
-        } else {
-          *table_sep_ptr = GlobalContext::get_serialized_table_separator();
-        }
-      }
-    } else
-      break;
   }
 
-  for (client_id = 0;
-       client_id < GlobalContext::get_num_clients(); ++client_id) {
-    RecordBuff &record_buff = buffs[client_id];
-    int32_t *table_end_ptr = record_buff.GetMemPtrInt32();
-    if (table_end_ptr == 0) {
-      int32_t bg_id = GlobalContext::get_bg_thread_id(client_id,
-                                                      comm_channel_idx);
-      PushMsgSend(bg_id, msg_map[client_id], true && clock_changed,
-                  GetBgVersion(bg_id), GetMinClock());
-      continue;
-    }
-    *table_end_ptr = GlobalContext::get_serialized_table_end();
-    msg_map[client_id]->get_avai_size() = buffs[client_id].GetMemUsedSize();
-    accum_send_bytes += msg_map[client_id]->get_size();
-
-    int32_t bg_id = GlobalContext::get_bg_thread_id(client_id,
-                                                    comm_channel_idx);
-    PushMsgSend(bg_id, msg_map[client_id], true && clock_changed,
-                GetBgVersion(bg_id), GetMinClock());
-    delete msg_map[client_id];
-  }
-  return accum_send_bytes;
+  return SendPushGroups(PushMsgSend, clock_changed);
 }
 
 size_t Server::CreateSendServerPushRowMsgsPartial(
     PushMsgSendFunc PushMsgSend) {
-  boost::unordered_map<int32_t, RecordBuff> buffs;
-  boost::unordered_map<int32_t, ServerPushRowMsg*> msg_map;
-  boost::unordered_map<int32_t, size_t> client_buff_size;
-  boost::unordered_map<int32_t,
-                       boost::unordered_map<int32_t, ServerRow*> >
-      table_rows_to_send;
-
   accum_oplog_count_ = 0;
 
-  size_t accum_send_bytes = 0;
-
-  int32_t comm_channel_idx
-      = GlobalContext::GetCommChannelIndexServer(server_id_);
-
-  // Create a message for each bg thread
-  int32_t client_id = 0;
-  for (client_id = 0;
-       client_id < GlobalContext::get_num_clients(); ++client_id) {
-    client_buff_size[client_id] = 0;
-  }
-
   for (auto table_iter = tables_.begin(); table_iter != tables_.end();
        table_iter++) {
-    int32_t table_id = table_iter->first;
-
-    table_rows_to_send.insert(std::make_pair(
-        table_id,
-        boost::unordered_map<int32_t, ServerRow*>()));
-
+    table_rows_to_push_.clear();
     table_iter->second.GetPartialTableToSend(
-        &(table_rows_to_send[table_id]),
-        &client_buff_size,
+        &table_rows_to_push_,
         GlobalContext::get_server_push_row_threshold());
+    for (const auto &row : table_rows_to_push_) {
+      AddRowToPush(table_iter->first, row);
+    }
   }
 
-  size_t num_tables = tables_.size();
-
-  for (auto buff_size_iter = client_buff_size.begin();
-       buff_size_iter != client_buff_size.end(); ++buff_size_iter) {
+  return SendPushGroups(PushMsgSend, false);
+}
 
-    if (buff_size_iter->second > 0)
-      buff_size_iter->second += (sizeof(int32_t) + sizeof(int32_t))*num_tables;
+void Server::AddRowToPush(int32_t table_id, const CandidateServerRow &row) {
+  PushGroup &group = push_groups_[row.server_row_ptr->get_subscriptions()];
+  if (group.bg_ids.empty()) {
+    const CallBackSubs::ClientSet &subscriptions
+        = row.server_row_ptr->get_subscriptions();
+    int32_t comm_channel_idx
+        = GlobalContext::GetCommChannelIndexServer(server_id_);
+    for (int32_t client_id = 0;
+         client_id < GlobalContext::get_num_clients(); ++client_id) {
+      if (subscriptions.test(client_id)) {
+        group.bg_ids.push_back(
+            GlobalContext::get_bg_thread_id(client_id, comm_channel_idx));
+      }
+    }
   }
 
-  for (auto buff_size_iter = client_buff_size.begin();
-       buff_size_iter != client_buff_size.end(); buff_size_iter++) {
-    size_t buff_size = buff_size_iter->second;
-    int32_t client_id = buff_size_iter->first;
-
-    if (buff_size == 0) {
-      msg_map[client_id] = 0;
-      continue;
-    }
+  // Tables are visited one after another, so a group's rows of a table are
+  // contiguous.
+  group.table_ids.push_back(table_id);
+  group.rows.push_back(row);
+  group.row_sizes.push_back(row.server_row_ptr->SerializedSize());
+}
 
-    ServerPushRowMsg *msg = new ServerPushRowMsg(buff_size);
-    msg_map[client_id] = msg;
-    buffs.insert(
-        std::make_pair(client_id,
-                       RecordBuff(msg->get_data(), buff_size)));
+size_t Server::SendPushGroups(PushMsgSendFunc PushMsgSend,
+                              bool clock_changed) {
+  int32_t num_clients = GlobalContext::get_num_clients();
+  int32_t comm_channel_idx
+      = GlobalContext::GetCommChannelIndexServer(server_id_);
+  push_versions_.resize(num_clients);
+  for (int32_t client_id = 0; client_id < num_clients; ++client_id) {
+    push_versions_[client_id] = GetBgVersion(
+        GlobalContext::get_bg_thread_id(client_id, comm_channel_idx));
   }
 
-  size_t num_tables_left = tables_.size();
+  int32_t server_min_clock = GetMinClock();
+  size_t accum_send_bytes = 0;
 
-  for (auto table_iter = tables_.begin(); table_iter != tables_.end();
-       table_iter++) {
-    int32_t table_id = table_iter->first;
-    ServerTable &server_table = table_iter->second;
-
-    for (auto buff_iter = buffs.begin(); buff_iter != buffs.end();
-         ++buff_iter) {
-      RecordBuff &record_buff = buff_iter->second;
-      int32_t *table_id_ptr = record_buff.GetMemPtrInt32();
-      CHECK_NOTNULL(table_id_ptr);
-      *table_id_ptr = table_id;
+  // The rows every client subscribes to go last, so that their last message
+  // can also carry the clock.
+  const PushGroup *all_clients_group = 0;
+  for (auto &group_pair : push_groups_) {
+    const PushGroup &group = group_pair.second;
+    if (group.rows.empty())
+      continue;
+    if ((int32_t) group.bg_ids.size() == num_clients) {
+      all_clients_group = &group;
+      continue;
     }
+    accum_send_bytes += SendPushGroup(PushMsgSend, group, false,
+                                      server_min_clock);
+  }
 
-    server_table.AppendRowsToBuffsPartial(
-        &buffs, table_rows_to_send[table_id]);
-
-    --num_tables_left;
-
-    for (auto buff_iter = buffs.begin(); buff_iter != buffs.end();
-         ++buff_iter) {
-      RecordBuff &record_buff = buff_iter->second;
-      int32_t *table_end_ptr = record_buff.GetMemPtrInt32();
-      CHECK_NOTNULL(table_end_ptr);
-
-      if (num_tables_left == 0)
-        *table_end_ptr = GlobalContext::get_serialized_table_end();
-      else
-        *table_end_ptr = GlobalContext::get_serialized_table_separator();
+  if (all_clients_group != 0) {
+    accum_send_bytes += SendPushGroup(PushMsgSend, *all_clients_group,
+                                      clock_changed, server_min_clock);
+  } else if (clock_changed) {
+    // no rows for some client; the clock goes in a message of its own
+    ServerPushRowMsg msg(sizeof(int32_t));
+    *(reinterpret_cast<int32_t*>(msg.get_data()))
+        = GlobalContext::get_serialized_table_end();
+    SetPushRowMsgVersions(&msg);
+
+    std::vector<int32_t> bg_ids;
+    for (int32_t client_id = 0; client_id < num_clients; ++client_id) {
+      bg_ids.push_back(
+          GlobalContext::get_bg_thread_id(client_id, comm_channel_idx));
     }
+    accum_send_bytes += msg.get_size()*bg_ids.size();
+    PushMsgSend(bg_ids, &msg, true, server_min_clock);
   }
 
-  for (auto msg_iter = msg_map.begin(); msg_iter != msg_map.end();
-       msg_iter++) {
-    int32_t client_id = msg_iter->first;
-    ServerPushRowMsg *msg = msg_iter->second;
-    if (msg == 0)
-      continue;
+  for (auto &group_pair : push_groups_) {
+    PushGroup &group = group_pair.second;
+    group.table_ids.clear();
+    group.rows.clear();
+    group.row_sizes.clear();
+  }
 
-    accum_send_bytes += msg->get_size();
+  return accum_send_bytes;
+}
 
-    int32_t bg_id = GlobalContext::get_bg_thread_id(client_id,
-                                                    comm_channel_idx);
-    PushMsgSend(bg_id, msg, false, GetBgVersion(bg_id), GetMinClock());
+size_t Server::SendPushGroup(PushMsgSendFunc PushMsgSend,
+                             const PushGroup &group, bool clock_changed,
+                             int32_t server_min_clock) {
+  size_t accum_send_bytes = 0;
+  size_t num_rows = group.rows.size();
+  size_t row_st = 0;
+  while (row_st < num_rows) {
+    // Rows [row_st, row_end) go into one message: for each table, its id and
+    // rows, then a separator, or the end after the last table.
+    size_t data_size = 0;
+    size_t row_end = row_st;
+    for (; row_end < num_rows; ++row_end) {
+      size_t record_size = sizeof(int32_t) + sizeof(size_t)
+                           + group.row_sizes[row_end];
+      if (row_end == row_st
+          || group.table_ids[row_end] != group.table_ids[row_end - 1])
+        record_size += sizeof(int32_t) + sizeof(int32_t);
+
+      if (row_end > row_st
+          && data_size + record_size > push_row_msg_data_size_)
+        break;
+      data_size += record_size;
+    }
 
-    VLOG(0) << "Send server push row size = " << msg->get_avai_size()
-            << " to bg id = " << bg_id
-            << " server id = " << ThreadContext::get_id();
+    ServerPushRowMsg msg(data_size);
+    uint8_t *mem = reinterpret_cast<uint8_t*>(msg.get_data());
+    for (size_t i = row_st; i < row_end; ++i) {
+      if (i == row_st || group.table_ids[i] != group.table_ids[i - 1]) {
+        if (i != row_st) {
+          *(reinterpret_cast<int32_t*>(mem))
+              = GlobalContext::get_serialized_table_separator();
+          mem += sizeof(int32_t);
+        }
+        *(reinterpret_cast<int32_t*>(mem)) = group.table_ids[i];
+        mem += sizeof(int32_t);
+      }
 
-    delete msg;
+      *(reinterpret_cast<int32_t*>(mem)) = group.rows[i].row_id;
+      mem += sizeof(int32_t);
+      size_t *row_size = reinterpret_cast<size_t*>(mem);
+      mem += sizeof(size_t);
+      *row_size = group.rows[i].server_row_ptr->Serialize(mem);
+      mem += *row_size;
+    }
+    *(reinterpret_cast<int32_t*>(mem))
+        = GlobalContext::get_serialized_table_end();
+    mem += sizeof(int32_t);
+
+    msg.get_avai_size()
+        = mem - reinterpret_cast<uint8_t*>(msg.get_data());
+    SetPushRowMsgVersions(&msg);
+    accum_send_bytes += msg.get_size()*group.bg_ids.size();
+
+    PushMsgSend(group.bg_ids, &msg, clock_changed && (row_end == num_rows),
+                server_min_clock);
+    row_st = row_end;
   }
-
   return accum_send_bytes;
 }
 
+void Server::SetPushRowMsgVersions(ServerPushRowMsg *msg) {
+  memcpy(msg->get_versions(), push_versions_.data(),
+         push_versions_.size()*sizeof(uint32_t));
+}
+
 bool Server::AccumedOpLogSinceLastPush() {
   return accum_oplog_count_ > 0;
 }
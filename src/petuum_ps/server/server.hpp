@@ -3,17 +3,22 @@
 #pragma once
 
 #include <vector>
+#include <unordered_map>
 #include <pthread.h>
 #include <boost/unordered_map.hpp>
+#include <boost/scoped_ptr.hpp>
 #include <petuum_ps_common/include/table.hpp>
 #include <petuum_ps_common/include/configs.hpp>
 #include <petuum_ps_common/include/abstract_row.hpp>
 #include <petuum_ps_common/include/constants.hpp>
 #include <petuum_ps_common/util/vector_clock.hpp>
 #include <petuum_ps/server/server_table.hpp>
+#include <petuum_ps/server/oplog_apply_pool.hpp>
 #include <petuum_ps/thread/ps_msgs.hpp>
 
 namespace petuum {
+class SerializedOpLogReader;
+
 struct ServerRowRequest {
 public:
   int32_t bg_id; // requesting bg thread id
@@ -44,21 +49,42 @@ public:
   void ApplyOpLogUpdateVersion(
       const void *oplog, size_t oplog_size, int32_t bg_thread_id,
       uint32_t version);
+  // For oplogs several bg threads sent through an oplog aggregator (see
+  // AggrSendOpLogMsg): the combined oplogs are applied once and each bg
+  // thread's version may skip the ones that were combined.
+  void ApplyOpLog(const void *oplog, size_t oplog_size);
+  void UpdateBgVersion(int32_t bg_thread_id, uint32_t version);
   int32_t GetMinClock();
   int32_t GetBgVersion(int32_t bg_thread_id);
 
-  typedef void (*PushMsgSendFunc)(int32_t bg_id, ServerPushRowMsg *msg,
-                                  bool is_last, int32_t version,
+  // Sends msg, whose versions are set, to each of bg_ids; is_last marks
+  // the message that ends a push with the server clock.
+  typedef void (*PushMsgSendFunc)(const std::vector<int32_t> &bg_ids,
+                                  ServerPushRowMsg *msg, bool is_last,
                                   int32_t server_min_clock);
+
+  // Pushes all dirty rows to the clients subscribed to them. Each row is
+  // serialized once: rows with the same subscribers go into the same
+  // messages, which are shared by those clients' bg threads. Returns the
+  // number of bytes sent, counting each receiver.
   size_t CreateSendServerPushRowMsgs(PushMsgSendFunc PushMsgSender,
                                      bool clock_changed = true);
 
+  // Pushes up to get_server_push_row_threshold() dirty rows of each table,
+  // without the clock.
   size_t CreateSendServerPushRowMsgsPartial(
       PushMsgSendFunc PushMsgSend);
 
   bool AccumedOpLogSinceLastPush();
 
 private:
+  // Apply the rest of an oplog message on apply_pool_; updates etc. are the
+  // first row update, already read from oplog_reader.
+  void ApplyOpLogSharded(
+      SerializedOpLogReader *oplog_reader, const void *updates,
+      ServerTable *server_table, int32_t table_id, int32_t row_id,
+      const int32_t *column_ids, int32_t num_updates);
+
   VectorClock bg_clock_;
 
   boost::unordered_map<int32_t, ServerTable> tables_;
@@ -67,15 +93,43 @@ private:
     boost::unordered_map<int32_t,
       std::vector<ServerRowRequest> > > clock_bg_row_requests_;
 
+  // Rows with the same subscribers, pushed together.
+  struct PushGroup {
+    // bg threads of the subscribed clients on my comm channel
+    std::vector<int32_t> bg_ids;
+    // grouped by table; see AddRowToPush()
+    std::vector<int32_t> table_ids;
+    std::vector<CandidateServerRow> rows;
+    std::vector<size_t> row_sizes;
+  };
+
+  void AddRowToPush(int32_t table_id, const CandidateServerRow &row);
+  size_t SendPushGroups(PushMsgSendFunc PushMsgSend, bool clock_changed);
+  size_t SendPushGroup(PushMsgSendFunc PushMsgSend, const PushGroup &group,
+                       bool clock_changed, int32_t server_min_clock);
+  // Sets the version of each client's bg thread in msg.
+  void SetPushRowMsgVersions(ServerPushRowMsg *msg);
+
   // latest oplog version that I have received from a bg thread
   std::map<int32_t, uint32_t> bg_version_map_;
-  // Assume a single row does not exceed this size!
+  // Push messages are cut at this size, unless a single row is larger.
   static const size_t kPushRowMsgSizeInit = 4*k1_Mi;
   size_t push_row_msg_data_size_;
 
+  // Kept across pushes so their buffers are reused.
+  std::unordered_map<CallBackSubs::ClientSet, PushGroup> push_groups_;
+  std::vector<CandidateServerRow> table_rows_to_push_;
+  std::vector<uint32_t> push_versions_;
+
   int32_t server_id_;
 
   size_t accum_oplog_count_;
+
+  // Only created if num_server_apply_threads > 1.
+  boost::scoped_ptr<OpLogApplyPool> apply_pool_;
+
+  // Only created if snapshots are taken (snapshot_clock > 0).
+  boost::scoped_ptr<SnapShotWriter> snapshot_writer_;
 };
 
 }  // namespace petuum
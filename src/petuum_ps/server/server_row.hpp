@@ -9,15 +9,22 @@
 namespace petuum {
 
 // Disallow copy to avoid shared ownership of row_data.
-// Allow move sematic for it to be stored in STL containers.
+// Allow move sematic for it to be stored in STL containers and ServerRowMap,
+// which moves rows when it grows.
 class ServerRow : boost::noncopyable {
 public:
   ServerRow():
-    dirty_(false) { }
+      row_data_(0),
+      num_clients_subscribed_(0),
+      dirty_(false),
+      snapshot_dirty_(true),
+      importance_(0) { }
   ServerRow(AbstractRow *row_data):
       row_data_(row_data),
       num_clients_subscribed_(0),
-      dirty_(false) { }
+      dirty_(false),
+      snapshot_dirty_(true),
+      importance_(0) { }
 
   ~ServerRow() {
     if(row_data_ != 0)
@@ -25,10 +32,28 @@ public:
   }
 
   ServerRow(ServerRow && other):
+      callback_subs_(other.callback_subs_),
       row_data_(other.row_data_),
       num_clients_subscribed_(other.num_clients_subscribed_),
-      dirty_(other.dirty_) {
+      dirty_(other.dirty_),
+      snapshot_dirty_(other.snapshot_dirty_),
+      importance_(other.importance_) {
+    other.row_data_ = 0;
+  }
+
+  ServerRow & operator = (ServerRow && other) {
+    if (this == &other)
+      return *this;
+    if (row_data_ != 0)
+      delete row_data_;
+    callback_subs_ = other.callback_subs_;
+    row_data_ = other.row_data_;
+    num_clients_subscribed_ = other.num_clients_subscribed_;
+    dirty_ = other.dirty_;
+    snapshot_dirty_ = other.snapshot_dirty_;
+    importance_ = other.importance_;
     other.row_data_ = 0;
+    return *this;
   }
 
   ServerRow & operator = (ServerRow & other) = delete;
@@ -38,6 +63,7 @@ public:
       const void *update_batch, int32_t num_updates) {
     row_data_->ApplyBatchIncUnsafe(column_ids, update_batch, num_updates);
     dirty_ = true;
+    snapshot_dirty_ = true;
   }
 
   void ApplyBatchIncAccumImportance(
@@ -47,11 +73,13 @@ public:
         column_ids, update_batch, num_updates);
     AccumImportance(importance);
     dirty_ = true;
+    snapshot_dirty_ = true;
   }
 
   void ApplyDenseBatchInc(const void *update_batch, int32_t num_updates) {
     row_data_->ApplyDenseBatchIncUnsafe(update_batch, 0, num_updates);
     dirty_ = true;
+    snapshot_dirty_ = true;
   }
 
   void ApplyDenseBatchIncAccumImportance(const void *update_batch,
@@ -61,6 +89,7 @@ public:
             update_batch, 0, num_updates);
     AccumImportance(importance);
     dirty_ = true;
+    snapshot_dirty_ = true;
   }
 
   size_t SerializedSize() const {
@@ -85,12 +114,8 @@ public:
       --num_clients_subscribed_;
   }
 
-  bool AppendRowToBuffs(int32_t client_id_st,
-    boost::unordered_map<int32_t, RecordBuff> *buffs,
-    const void *row_data, size_t row_size, int32_t row_id,
-    int32_t *failed_client_id) {
-    return callback_subs_.AppendRowToBuffs(client_id_st, buffs, row_data,
-      row_size, row_id, failed_client_id);
+  const CallBackSubs::ClientSet &get_subscriptions() const {
+    return callback_subs_.get_subscriptions();
   }
 
   bool IsDirty() {
@@ -101,17 +126,14 @@ public:
     dirty_ = false;
   }
 
-  void AccumSerializedSizePerClient(
-      boost::unordered_map<int32_t, size_t> *client_size_map) {
-    callback_subs_.AccumSerializedSizePerClient(
-        client_size_map, SerializedSize());
+  // Like dirty_, but tracks changes since the last snapshot rather than the
+  // last push; see ServerTable::TakeSnapShot().
+  bool IsSnapShotDirty() const {
+    return snapshot_dirty_;
   }
 
-  void AppendRowToBuffs(
-      boost::unordered_map<int32_t, RecordBuff> *buffs,
-      const void *row_data, size_t row_size, int32_t row_id) {
-    callback_subs_.AppendRowToBuffs(buffs, row_data,
-      row_size, row_id);
+  void ResetSnapShotDirty() {
+    snapshot_dirty_ = false;
   }
 
   double get_importance() {
@@ -133,6 +155,7 @@ private:
   size_t num_clients_subscribed_;
 
   bool dirty_;
+  bool snapshot_dirty_;
 
   double importance_;
 };
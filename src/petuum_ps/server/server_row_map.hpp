@@ -0,0 +1,269 @@
+#pragma once
+
+#include <stdint.h>
+#include <limits>
+#include <utility>
+#include <vector>
+#include <boost/noncopyable.hpp>
+#include <glog/logging.h>
+
+#include <petuum_ps/server/server_row.hpp>
+
+namespace petuum {
+
+// Row storage of a ServerTable, replacing boost::unordered_map<int32_t,
+// ServerRow>. (row id, ServerRow) pairs are stored inline in one flat array,
+// so finding a row does not chase a bucket pointer and a node pointer before
+// reaching the ServerRow, and iterating the table walks memory sequentially.
+//
+// There are two layouts:
+// 1) Hashed (default): open addressing with linear probing. The capacity is
+// a power of two and the array is doubled once it is kMaxLoadPercent full.
+// 2) Dense: slot i holds the row whose id is i * row_id_stride +
+// row_id_offset, for tables whose row ids are contiguous. row_id_stride is the
+// number of server threads the rows are partitioned among, so that a server
+// thread's rows occupy consecutive slots. The array grows to the largest row
+// id seen and iteration is in row id order.
+//
+// Rows are never erased. Inserting may move rows, so ServerRow pointers and
+// iterators are only valid until the next Insert().
+class ServerRowMap : boost::noncopyable {
+private:
+  typedef std::pair<int32_t, ServerRow> Slot;
+
+public:
+  static const int32_t kEmptyRowId = std::numeric_limits<int32_t>::min();
+
+  class iterator {
+  public:
+    iterator():
+        slot_(0),
+        end_(0) { }
+
+    Slot &operator * () const {
+      return *slot_;
+    }
+
+    Slot *operator -> () const {
+      return slot_;
+    }
+
+    iterator &operator ++ () {
+      ++slot_;
+      SkipEmpty();
+      return *this;
+    }
+
+    iterator operator ++ (int) {
+      iterator old = *this;
+      ++(*this);
+      return old;
+    }
+
+    bool operator == (const iterator &other) const {
+      return slot_ == other.slot_;
+    }
+
+    bool operator != (const iterator &other) const {
+      return slot_ != other.slot_;
+    }
+
+  private:
+    friend class ServerRowMap;
+
+    iterator(Slot *slot, Slot *end):
+        slot_(slot),
+        end_(end) {
+      SkipEmpty();
+    }
+
+    void SkipEmpty() {
+      while (slot_ != end_ && slot_->first == kEmptyRowId)
+        ++slot_;
+    }
+
+    Slot *slot_;
+    Slot *end_;
+  };
+
+  typedef iterator const_iterator;
+
+  ServerRowMap():
+      dense_(false),
+      row_id_stride_(1),
+      row_id_offset_(0),
+      mask_(0),
+      hash_shift_(63),
+      num_rows_(0) { }
+
+  ServerRowMap(ServerRowMap &&other):
+      slots_(std::move(other.slots_)),
+      dense_(other.dense_),
+      row_id_stride_(other.row_id_stride_),
+      row_id_offset_(other.row_id_offset_),
+      mask_(other.mask_),
+      hash_shift_(other.hash_shift_),
+      num_rows_(other.num_rows_) {
+    other.mask_ = 0;
+    other.num_rows_ = 0;
+  }
+
+  // Must be called before any row is inserted.
+  void SetDense(int32_t row_id_stride, int32_t row_id_offset) {
+    CHECK_EQ(num_rows_, 0);
+    CHECK_GT(row_id_stride, 0);
+    dense_ = true;
+    row_id_stride_ = row_id_stride;
+    row_id_offset_ = row_id_offset;
+  }
+
+  ServerRow *Find(int32_t row_id) {
+    if (dense_) {
+      int64_t idx = DenseIndex(row_id);
+      if (idx < 0 || idx >= static_cast<int64_t>(slots_.size())
+          || slots_[idx].first != row_id)
+        return 0;
+      return &(slots_[idx].second);
+    }
+
+    if (slots_.empty())
+      return 0;
+
+    size_t idx = Hash(row_id) & mask_;
+    while (true) {
+      int32_t slot_row_id = slots_[idx].first;
+      if (slot_row_id == row_id)
+        return &(slots_[idx].second);
+      if (slot_row_id == kEmptyRowId)
+        return 0;
+      idx = (idx + 1) & mask_;
+    }
+  }
+
+  // Takes over server_row. If row_id already exists, server_row is
+  // discarded and the existing row is returned.
+  ServerRow *Insert(int32_t row_id, ServerRow &&server_row) {
+    CHECK(row_id != kEmptyRowId) << "row id " << row_id << " is reserved";
+    if (dense_)
+      return InsertDense(row_id, std::move(server_row));
+
+    if ((num_rows_ + 1) * 100 > slots_.size() * kMaxLoadPercent)
+      Rehash(slots_.empty() ? kInitCapacity : slots_.size() * 2);
+
+    size_t idx = Hash(row_id) & mask_;
+    while (slots_[idx].first != kEmptyRowId) {
+      if (slots_[idx].first == row_id)
+        return &(slots_[idx].second);
+      idx = (idx + 1) & mask_;
+    }
+    slots_[idx].first = row_id;
+    slots_[idx].second = std::move(server_row);
+    ++num_rows_;
+    return &(slots_[idx].second);
+  }
+
+  size_t size() const {
+    return num_rows_;
+  }
+
+  iterator begin() {
+    return iterator(slots_.data(), slots_.data() + slots_.size());
+  }
+
+  iterator end() {
+    return iterator(slots_.data() + slots_.size(),
+                    slots_.data() + slots_.size());
+  }
+
+  const_iterator begin() const {
+    return const_cast<ServerRowMap*>(this)->begin();
+  }
+
+  const_iterator end() const {
+    return const_cast<ServerRowMap*>(this)->end();
+  }
+
+private:
+  static const size_t kInitCapacity = 64;
+  static const size_t kMaxLoadPercent = 70;
+
+  // Row ids of a server thread share their residue modulo the number of
+  // server threads, so the low bits of a row id carry little information;
+  // a multiplicative (Fibonacci) hash mixes them into the top bits of the
+  // product, and the top log2(capacity) bits are the slot index.
+  size_t Hash(int32_t row_id) const {
+    uint64_t h = static_cast<uint32_t>(row_id) * 0x9E3779B97F4A7C15ULL;
+    return static_cast<size_t>(h >> hash_shift_);
+  }
+
+  int64_t DenseIndex(int32_t row_id) const {
+    int64_t shifted = static_cast<int64_t>(row_id) - row_id_offset_;
+    if (shifted < 0 || shifted % row_id_stride_ != 0)
+      return -1;
+    return shifted / row_id_stride_;
+  }
+
+  ServerRow *InsertDense(int32_t row_id, ServerRow &&server_row) {
+    int64_t idx = DenseIndex(row_id);
+    CHECK_GE(idx, 0) << "row " << row_id << " does not belong to this dense "
+                     << "table partition (stride = " << row_id_stride_
+                     << ", offset = " << row_id_offset_ << ")";
+    if (idx >= static_cast<int64_t>(slots_.size())) {
+      size_t new_size = slots_.empty() ? kInitCapacity : slots_.size();
+      while (static_cast<int64_t>(new_size) <= idx)
+        new_size *= 2;
+      Resize(new_size);
+    }
+    Slot &slot = slots_[idx];
+    if (slot.first == kEmptyRowId) {
+      slot.first = row_id;
+      slot.second = std::move(server_row);
+      ++num_rows_;
+    }
+    return &(slot.second);
+  }
+
+  // Grow the dense array in place (slot positions do not depend on size).
+  void Resize(size_t new_size) {
+    std::vector<Slot> new_slots(new_size);
+    for (auto &slot : new_slots)
+      slot.first = kEmptyRowId;
+    for (size_t i = 0; i < slots_.size(); ++i) {
+      new_slots[i].first = slots_[i].first;
+      new_slots[i].second = std::move(slots_[i].second);
+    }
+    slots_.swap(new_slots);
+  }
+
+  void Rehash(size_t new_capacity) {
+    std::vector<Slot> old_slots(new_capacity);
+    old_slots.swap(slots_);
+    for (auto &slot : slots_)
+      slot.first = kEmptyRowId;
+    mask_ = new_capacity - 1;
+    hash_shift_ = 64;
+    for (size_t capacity = new_capacity; capacity > 1; capacity >>= 1)
+      --hash_shift_;
+
+    for (auto &old_slot : old_slots) {
+      if (old_slot.first == kEmptyRowId)
+        continue;
+      size_t idx = Hash(old_slot.first) & mask_;
+      while (slots_[idx].first != kEmptyRowId)
+        idx = (idx + 1) & mask_;
+      slots_[idx].first = old_slot.first;
+      slots_[idx].second = std::move(old_slot.second);
+    }
+  }
+
+  std::vector<Slot> slots_;
+  bool dense_;
+  int32_t row_id_stride_;
+  int32_t row_id_offset_;
+  size_t mask_;
+  // 64 - log2(capacity).
+  int32_t hash_shift_;
+  size_t num_rows_;
+};
+
+}  // namespace petuum
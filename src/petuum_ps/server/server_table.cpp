@@ -2,74 +2,49 @@
 #include <iterator>
 #include <vector>
 #include <sstream>
-#include <leveldb/db.h>
+#include <thread>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
 #include <random>
 #include <algorithm>
 #include <iostream>
 
 namespace petuum {
 
-bool ServerTable::AppendTableToBuffs(
-    int32_t client_id_st,
-    boost::unordered_map<int32_t, RecordBuff> *buffs,
-    int32_t *failed_client_id, bool resume) {
-
-  if (resume) {
-    bool append_row_suc
-        = row_iter_->second.AppendRowToBuffs(
-            client_id_st,
-            buffs, tmp_row_buff_, curr_row_size_, row_iter_->first,
-            failed_client_id);
-    if (!append_row_suc)
-      return false;
-    ++row_iter_;
-    client_id_st = 0;
+void ServerTable::GetRowsToPush(
+    std::vector<CandidateServerRow> *rows_to_push) {
+  size_t num_rows_st = rows_to_push->size();
+  GetDirtyRows(rows_to_push);
+  for (size_t i = num_rows_st; i < rows_to_push->size(); ++i) {
+    ServerRow *server_row = (*rows_to_push)[i].server_row_ptr;
+    server_row->ResetDirty();
+    ResetImportance_(server_row);
   }
-  for (; row_iter_ != storage_.end(); ++row_iter_) {
-    if (row_iter_->second.NoClientSubscribed())
-      continue;
-
-    if (!row_iter_->second.IsDirty())
-      continue;
-
-    row_iter_->second.ResetDirty();
-    ResetImportance_(&(row_iter_->second));
-
-    curr_row_size_ = row_iter_->second.SerializedSize();
-    if (curr_row_size_ > tmp_row_buff_size_) {
-      delete[] tmp_row_buff_;
-      tmp_row_buff_size_ = curr_row_size_;
-      tmp_row_buff_ = new uint8_t[curr_row_size_];
-    }
-    curr_row_size_ = row_iter_->second.Serialize(tmp_row_buff_);
-
-    bool append_row_suc = row_iter_->second.AppendRowToBuffs(
-        client_id_st,
-        buffs, tmp_row_buff_, curr_row_size_, row_iter_->first,
-        failed_client_id);
-
-    if (!append_row_suc) {
-      return false;
-    }
-  }
-  delete[] tmp_row_buff_;
-  return true;
 }
 
-void ServerTable::SortCandidateVectorRandom(
-    std::vector<CandidateServerRow> *candidate_row_vector) {
+void ServerTable::SelectCandidatesRandom(
+    std::vector<CandidateServerRow> *candidate_row_vector, size_t num_rows) {
   std::random_device rd;
   std::mt19937 g(rd());
 
-  std::shuffle((*candidate_row_vector).begin(),
-               (*candidate_row_vector).end(), g);
+  // the first steps of a Fisher-Yates shuffle
+  size_t num_candidates = candidate_row_vector->size();
+  for (size_t i = 0; i < num_rows && i + 1 < num_candidates; ++i) {
+    std::uniform_int_distribution<size_t> dist(i, num_candidates - 1);
+    std::swap((*candidate_row_vector)[i], (*candidate_row_vector)[dist(g)]);
+  }
 }
 
-void ServerTable::SortCandidateVectorImportance(
-    std::vector<CandidateServerRow> *candidate_row_vector) {
+void ServerTable::SelectCandidatesImportance(
+    std::vector<CandidateServerRow> *candidate_row_vector, size_t num_rows) {
 
-  std::sort((*candidate_row_vector).begin(),
-            (*candidate_row_vector).end(),
+  std::partial_sort((*candidate_row_vector).begin(),
+                    (*candidate_row_vector).begin() + num_rows,
+                    (*candidate_row_vector).end(),
             [] (const CandidateServerRow &row1, const CandidateServerRow &row2)
             {
 
@@ -84,79 +59,43 @@ void ServerTable::SortCandidateVectorImportance(
 }
 
 void ServerTable::GetPartialTableToSend(
-    boost::unordered_map<int32_t, ServerRow*> *rows_to_send,
-    boost::unordered_map<int32_t, size_t> *client_size_map,
+    std::vector<CandidateServerRow> *rows_to_send,
     size_t num_rows_threshold) {
 
-  size_t num_candidate_rows
-      = num_rows_threshold * GlobalContext::get_server_row_candidate_factor();
-
   std::vector<CandidateServerRow> candidate_row_vector;
-
-  auto row_iter = storage_.begin();
-  for (; row_iter != storage_.end(); ++row_iter) {
-    if (row_iter->second.NoClientSubscribed())
-      continue;
-
-    if (!row_iter->second.IsDirty())
-      continue;
-
-    candidate_row_vector.push_back(
-        CandidateServerRow(row_iter->first, &(row_iter->second)));
-
-    if (candidate_row_vector.size() >= num_candidate_rows)
-      break;
-  }
+  GetDirtyRows(&candidate_row_vector);
 
   if (candidate_row_vector.empty())
     return;
 
-  SortCandidateVector_(&candidate_row_vector);
-
-  for (auto vec_iter = candidate_row_vector.begin();
-       vec_iter != candidate_row_vector.end(); vec_iter++) {
-
-    (*rows_to_send).insert(
-        std::make_pair(vec_iter->row_id, vec_iter->server_row_ptr));
+  size_t num_rows = std::min(num_rows_threshold, candidate_row_vector.size());
+  SelectCandidates_(&candidate_row_vector, num_rows);
 
-    vec_iter->server_row_ptr->AccumSerializedSizePerClient(client_size_map);
+  for (size_t i = 0; i < num_rows; ++i) {
+    ServerRow *server_row = candidate_row_vector[i].server_row_ptr;
+    server_row->ResetDirty();
+    ResetImportance_(server_row);
+    rows_to_send->push_back(candidate_row_vector[i]);
+  }
 
-    if ((*rows_to_send).size() >= num_rows_threshold)
-      break;
+  // the rest wait for the next push
+  for (size_t i = num_rows; i < candidate_row_vector.size(); ++i) {
+    dirty_row_ids_.push_back(candidate_row_vector[i].row_id);
   }
 }
 
-void ServerTable::AppendRowsToBuffsPartial(
-    boost::unordered_map<int32_t, RecordBuff> *buffs,
-    const boost::unordered_map<int32_t, ServerRow*> &rows_to_send) {
-
-  tmp_row_buff_ = new uint8_t[tmp_row_buff_size_];
-
-  for (auto row_iter = rows_to_send.cbegin(); row_iter != rows_to_send.cend();
-       ++row_iter) {
-    if (row_iter->second->NoClientSubscribed())
-      continue;
-
-    if (!row_iter->second->IsDirty())
+void ServerTable::GetDirtyRows(std::vector<CandidateServerRow> *dirty_rows) {
+  for (int32_t row_id : dirty_row_ids_) {
+    ServerRow *server_row = storage_.Find(row_id);
+    CHECK(server_row != 0 && server_row->IsDirty()) << "row " << row_id;
+    if (server_row->NoClientSubscribed()) {
+      server_row->ResetDirty();
+      ResetImportance_(server_row);
       continue;
-
-    row_iter->second->ResetDirty();
-    ResetImportance_(row_iter->second);
-
-    curr_row_size_ = row_iter->second->SerializedSize();
-    if (curr_row_size_ > tmp_row_buff_size_) {
-      delete[] tmp_row_buff_;
-      tmp_row_buff_size_ = curr_row_size_;
-      tmp_row_buff_ = new uint8_t[curr_row_size_];
     }
-
-    curr_row_size_ = row_iter->second->Serialize(tmp_row_buff_);
-
-    row_iter->second->AppendRowToBuffs(
-        buffs, tmp_row_buff_, curr_row_size_, row_iter->first);
+    dirty_rows->push_back(CandidateServerRow(row_id, server_row));
   }
-
-  delete[] tmp_row_buff_;
+  dirty_row_ids_.clear();
 }
 
 void ServerTable::MakeSnapShotFileName(
@@ -167,70 +106,164 @@ void ServerTable::MakeSnapShotFileName(
   std::stringstream ss;
   ss << snapshot_dir << "/server_table" << ".server-" << server_id
      << ".table-" << table_id << ".clock-" << clock
-     << ".db";
+     << ".snap";
   *filename = ss.str();
 }
 
 void ServerTable::TakeSnapShot(
     const std::string &snapshot_dir,
-    int32_t server_id, int32_t table_id, int32_t clock) const {
+    int32_t server_id, int32_t table_id, int32_t clock, bool incremental,
+    SnapShotWriter *snapshot_writer) {
 
-  std::string db_name;
-  MakeSnapShotFileName(snapshot_dir, server_id, table_id, clock, &db_name);
+  int32_t base_clock = incremental ? last_snapshot_clock_ : -1;
+  bool full = (base_clock < 0);
 
-  leveldb::DB* db;
-  leveldb::Options options;
-  options.create_if_missing = true;
-  leveldb::Status status = leveldb::DB::Open(options, db_name, &db);
+  std::vector<SnapShotIndexEntry> index;
+  size_t data_size = 0;
+  for (auto row_iter = storage_.begin(); row_iter != storage_.end();
+       ++row_iter) {
+    if (!full && !row_iter->second.IsSnapShotDirty())
+      continue;
+    SnapShotIndexEntry entry;
+    entry.row_id = row_iter->first;
+    entry.reserved = 0;
+    entry.offset = sizeof(SnapShotHeader) + data_size;
+    entry.size = row_iter->second.SerializedSize();
+    index.push_back(entry);
+    data_size += entry.size;
+  }
 
-  uint8_t *mem_buff = new uint8_t[512];
-  int32_t buff_size = 512;
+  std::string filename;
+  MakeSnapShotFileName(snapshot_dir, server_id, table_id, clock, &filename);
+  snapshot_writer->Open(filename);
+
+  size_t index_offset = sizeof(SnapShotHeader) + data_size;
+  size_t chunk_capacity = std::max(SnapShotWriter::kChunkSize,
+                                   sizeof(SnapShotHeader));
+  uint8_t *chunk = new uint8_t[chunk_capacity];
+  size_t chunk_size = sizeof(SnapShotHeader);
+
+  SnapShotHeader *header = reinterpret_cast<SnapShotHeader*>(chunk);
+  header->magic = kSnapShotMagic;
+  header->version = kSnapShotVersion;
+  header->table_id = table_id;
+  header->server_id = server_id;
+  header->clock = clock;
+  header->base_clock = base_clock;
+  header->reserved = 0;
+  header->num_rows = index.size();
+  header->index_offset = index_offset;
+
+  // Rows are visited in the same order as above, so they line up with the
+  // index entries. A chunk is handed to snapshot_writer as soon as the next
+  // row does not fit.
+  auto entry_iter = index.begin();
   for (auto row_iter = storage_.begin(); row_iter != storage_.end();
-       row_iter++) {
-    int32_t serialized_size = row_iter->second.SerializedSize();
-    if (buff_size < serialized_size) {
-      delete[] mem_buff;
-      buff_size = serialized_size;
-      mem_buff = new uint8_t[buff_size];
+       ++row_iter) {
+    if (!full && !row_iter->second.IsSnapShotDirty())
+      continue;
+    if (chunk_size + entry_iter->size > chunk_capacity) {
+      snapshot_writer->Append(chunk, chunk_size);
+      chunk_capacity = std::max(SnapShotWriter::kChunkSize,
+                                static_cast<size_t>(entry_iter->size));
+      chunk = new uint8_t[chunk_capacity];
+      chunk_size = 0;
     }
-    row_iter->second.Serialize(mem_buff);
-    leveldb::Slice key(reinterpret_cast<const char*>(&(row_iter->first)),
-                       sizeof(int32_t));
-    leveldb::Slice value(reinterpret_cast<const char*>(mem_buff),
-                         serialized_size);
-    db->Put(leveldb::WriteOptions(), key, value);
+    size_t row_size = row_iter->second.Serialize(chunk + chunk_size);
+    CHECK_EQ(row_size, entry_iter->size);
+    chunk_size += row_size;
+    row_iter->second.ResetSnapShotDirty();
+    ++entry_iter;
+  }
+  snapshot_writer->Append(chunk, chunk_size);
+
+  if (!index.empty()) {
+    size_t index_size = index.size() * sizeof(SnapShotIndexEntry);
+    uint8_t *index_buff = new uint8_t[index_size];
+    memcpy(index_buff, index.data(), index_size);
+    snapshot_writer->Append(index_buff, index_size);
   }
-  delete[] mem_buff;
-  delete db;
+  snapshot_writer->Close();
+
+  last_snapshot_clock_ = clock;
 }
 
 void ServerTable::ReadSnapShot(const std::string &resume_dir,
                                int32_t server_id, int32_t table_id, int32_t clock) {
+  // Newest snapshot first; rows already loaded from a newer snapshot are
+  // skipped in older ones.
+  while (clock >= 0) {
+    std::string filename;
+    MakeSnapShotFileName(resume_dir, server_id, table_id, clock, &filename);
+
+    int fd = open(filename.c_str(), O_RDONLY);
+    CHECK_GE(fd, 0) << "failed to open snapshot " << filename << ": "
+                    << strerror(errno);
+    struct stat file_stat;
+    CHECK_EQ(fstat(fd, &file_stat), 0);
+    size_t file_size = file_stat.st_size;
+    CHECK_GE(file_size, sizeof(SnapShotHeader)) << filename;
+
+    void *mapped = mmap(0, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    CHECK(mapped != MAP_FAILED) << "failed to mmap snapshot " << filename
+                                << ": " << strerror(errno);
+    close(fd);
+    const uint8_t *file_mem = reinterpret_cast<const uint8_t*>(mapped);
+
+    const SnapShotHeader *header
+        = reinterpret_cast<const SnapShotHeader*>(file_mem);
+    CHECK_EQ(header->magic, kSnapShotMagic) << filename;
+    CHECK_EQ(header->version, kSnapShotVersion) << filename;
+    CHECK_EQ(header->table_id, table_id) << filename;
+    CHECK_EQ(header->clock, clock) << filename;
+    CHECK_EQ(header->index_offset
+             + header->num_rows * sizeof(SnapShotIndexEntry), file_size)
+        << filename;
+
+    const SnapShotIndexEntry *index
+        = reinterpret_cast<const SnapShotIndexEntry*>(
+            file_mem + header->index_offset);
+
+    std::vector<const SnapShotIndexEntry*> entries_to_load;
+    for (uint64_t i = 0; i < header->num_rows; ++i) {
+      if (storage_.Find(index[i].row_id) == 0)
+        entries_to_load.push_back(&(index[i]));
+    }
 
-  std::string db_name;
-  MakeSnapShotFileName(resume_dir, server_id, table_id, clock, &db_name);
-
-  leveldb::DB* db;
-  leveldb::Options options;
-  options.create_if_missing = true;
-  leveldb::Status status = leveldb::DB::Open(options, db_name, &db);
+    // Deserialize in parallel; only the inserts below touch storage_.
+    std::vector<AbstractRow*> rows(entries_to_load.size());
+    int32_t row_type = table_info_.row_type;
+    auto DeserializeRange = [&] (size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) {
+        const SnapShotIndexEntry *entry = entries_to_load[i];
+        CHECK_LE(entry->offset + entry->size, header->index_offset);
+        rows[i] = ClassRegistry<AbstractRow>::GetRegistry().CreateObject(
+            row_type);
+        rows[i]->Deserialize(file_mem + entry->offset, entry->size);
+      }
+    };
+
+    size_t num_per_thread = (rows.size() + kNumSnapShotReadThreads - 1)
+                            / kNumSnapShotReadThreads;
+    std::vector<std::thread> readers;
+    for (size_t begin = num_per_thread; begin < rows.size();
+         begin += num_per_thread) {
+      readers.push_back(std::thread(DeserializeRange, begin,
+          std::min(begin + num_per_thread, rows.size())));
+    }
+    DeserializeRange(0, std::min(num_per_thread, rows.size()));
+    for (auto &reader : readers)
+      reader.join();
 
-  leveldb::Iterator* it = db->NewIterator(leveldb::ReadOptions());
-  for (it->SeekToFirst(); it->Valid(); it->Next()) {
-    int32_t row_id = *(reinterpret_cast<const int32_t*>(it->key().data()));
-        const uint8_t *row_data
-            = reinterpret_cast<const uint8_t*>(it->value().data());
-        size_t row_data_size = it->value().size();
+    for (size_t i = 0; i < rows.size(); ++i) {
+      storage_.Insert(entries_to_load[i]->row_id, ServerRow(rows[i]));
+    }
 
-        int32_t row_type = table_info_.row_type;
-            AbstractRow *abstract_row
-                = ClassRegistry<AbstractRow>::GetRegistry().CreateObject(row_type);
-            abstract_row->Deserialize(row_data, row_data_size);
+    VLOG(0) << "ReadSnapShot " << filename << ", loaded " << rows.size()
+            << " of " << header->num_rows << " rows";
 
-            storage_.insert(std::make_pair(row_id, ServerRow(abstract_row)));
-            VLOG(0) << "ReadSnapShot, row_id = " << row_id;
+    clock = header->base_clock;
+    munmap(mapped, file_size);
   }
-  delete it;
-  delete db;
 }
 }
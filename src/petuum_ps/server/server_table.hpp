@@ -2,12 +2,17 @@
 
 #pragma once
 #include <petuum_ps/server/server_row.hpp>
+#include <petuum_ps/server/server_row_map.hpp>
+#include <petuum_ps/server/snapshot_writer.hpp>
 #include <petuum_ps_common/util/class_register.hpp>
 #include <petuum_ps/thread/context.hpp>
 #include <petuum_ps_common/oplog/dense_row_oplog.hpp>
 #include <petuum_ps_common/oplog/sparse_row_oplog.hpp>
 #include <boost/unordered_map.hpp>
 #include <map>
+#include <vector>
+#include <memory>
+#include <mutex>
 #include <utility>
 
 namespace petuum {
@@ -26,7 +31,11 @@ class ServerTable : boost::noncopyable {
 public:
   explicit ServerTable(const TableInfo &table_info):
       table_info_(table_info),
-      tmp_row_buff_size_ (kTmpRowBuffSizeInit),
+      track_dirty_rows_(
+          GlobalContext::get_consistency_model() == SSPPush
+          || GlobalContext::get_consistency_model() == SSPAggr),
+      dirty_row_ids_mtx_(new std::mutex),
+      last_snapshot_clock_(-1),
       sample_row_(
           ClassRegistry<AbstractRow>::GetRegistry().CreateObject(
               table_info.row_type)) {
@@ -41,7 +50,7 @@ public:
         ApplyRowBatchInc_ = ApplyRowDenseBatchInc;
 
       ResetImportance_ = ResetImportance;
-      SortCandidateVector_ = SortCandidateVectorImportance;
+      SelectCandidates_ = SelectCandidatesImportance;
     } else {
       if (table_info.oplog_dense_serialized)
         ApplyRowBatchInc_ = ApplyRowDenseBatchInc;
@@ -49,7 +58,7 @@ public:
         ApplyRowBatchInc_ = ApplyRowBatchInc;
 
       ResetImportance_ = ResetImportanceNoOp;
-      SortCandidateVector_ = SortCandidateVectorRandom;
+      SelectCandidates_ = SelectCandidatesRandom;
     }
 
     if (table_info.row_oplog_type == RowOpLogType::kDenseRowOpLog)
@@ -75,10 +84,13 @@ public:
   ServerTable(ServerTable && other):
     table_info_(other.table_info_),
     storage_(std::move(other.storage_)) ,
-    tmp_row_buff_size_(other.tmp_row_buff_size_) {
+    track_dirty_rows_(other.track_dirty_rows_),
+    dirty_row_ids_(std::move(other.dirty_row_ids_)),
+    dirty_row_ids_mtx_(std::move(other.dirty_row_ids_mtx_)),
+    last_snapshot_clock_(other.last_snapshot_clock_) {
     ApplyRowBatchInc_ = other.ApplyRowBatchInc_;
     ResetImportance_ = other.ResetImportance_;
-    SortCandidateVector_ = other.SortCandidateVector_;
+    SelectCandidates_ = other.SelectCandidates_;
 
     sample_row_ = other.sample_row_;
     other.sample_row_ = 0;
@@ -89,11 +101,15 @@ public:
 
   ServerTable & operator = (ServerTable & other) = delete;
 
+  // Store rows in a dense array (see ServerRowMap), for tables with
+  // TableInfo::server_dense_storage set. Must be called before any row is
+  // created.
+  void UseDenseStorage(int32_t row_id_stride, int32_t row_id_offset) {
+    storage_.SetDense(row_id_stride, row_id_offset);
+  }
+
   ServerRow *FindRow(int32_t row_id) {
-    auto row_iter = storage_.find(row_id);
-    if(row_iter == storage_.end())
-      return 0;
-    return &(row_iter->second);
+    return storage_.Find(row_id);
   }
 
   ServerRow *CreateRow (int32_t row_id) {
@@ -101,26 +117,27 @@ public:
     AbstractRow *row_data
       = ClassRegistry<AbstractRow>::GetRegistry().CreateObject(row_type);
     row_data->Init(table_info_.row_capacity);
-    storage_.insert(std::make_pair(row_id, ServerRow(row_data)));
-    return &(storage_[row_id]);
+    return storage_.Insert(row_id, ServerRow(row_data));
   }
 
   bool ApplyRowOpLog (int32_t row_id, const int32_t *column_ids,
     const void *updates, int32_t num_updates) {
-    auto row_iter = storage_.find(row_id);
-    if (row_iter == storage_.end())
+    ServerRow *server_row = storage_.Find(row_id);
+    if (server_row == 0)
       return false;
 
-    ApplyRowBatchInc_(column_ids, updates, num_updates, &(row_iter->second));
+    bool was_dirty = server_row->IsDirty();
+    ApplyRowBatchInc_(column_ids, updates, num_updates, server_row);
 
+    // May run on several OpLogApplyPool threads at once, but each row on
+    // only one of them.
+    if (track_dirty_rows_ && !was_dirty) {
+      std::lock_guard<std::mutex> lock(*dirty_row_ids_mtx_);
+      dirty_row_ids_.push_back(row_id);
+    }
     return true;
   }
 
-  void InitAppendTableToBuffs() {
-    row_iter_ = storage_.begin();
-    tmp_row_buff_ = new uint8_t[tmp_row_buff_size_];
-  }
-
   const AbstractRowOpLog *get_sample_row_oplog() const {
     return sample_row_oplog_;
   }
@@ -129,33 +146,47 @@ public:
     return table_info_.oplog_dense_serialized;
   }
 
-  bool AppendTableToBuffs(
-      int32_t client_id_st,
-      boost::unordered_map<int32_t, RecordBuff> *buffs,
-      int32_t *failed_client_id, bool resume);
+  OpLogCodec oplog_codec() const {
+    return table_info_.oplog_codec;
+  }
+
+  // Appends the dirty rows some client subscribes to and marks them clean,
+  // as they are about to be pushed.
+  void GetRowsToPush(std::vector<CandidateServerRow> *rows_to_push);
 
-  static void SortCandidateVectorRandom(
-      std::vector<CandidateServerRow> *candidate_row_vector);
+  // Move num_rows rows to the front of candidate_row_vector: a uniform
+  // sample, or those of largest importance.
+  static void SelectCandidatesRandom(
+      std::vector<CandidateServerRow> *candidate_row_vector, size_t num_rows);
 
-  static void SortCandidateVectorImportance(
-      std::vector<CandidateServerRow> *candidate_row_vector);
+  static void SelectCandidatesImportance(
+      std::vector<CandidateServerRow> *candidate_row_vector, size_t num_rows);
 
+  // Like GetRowsToPush(), but only up to num_rows_threshold rows, picked
+  // by SelectCandidates_ among all dirty rows; the others stay dirty.
   void GetPartialTableToSend(
-    boost::unordered_map<int32_t, ServerRow*> *rows_to_send,
-    boost::unordered_map<int32_t, size_t> *client_size_map,
+    std::vector<CandidateServerRow> *rows_to_send,
     size_t num_rows_threshold);
 
-  void AppendRowsToBuffsPartial(
-    boost::unordered_map<int32_t, RecordBuff> *buffs,
-    const boost::unordered_map<int32_t, ServerRow*> &rows_to_send);
-
   void MakeSnapShotFileName(const std::string &snapshot_dir, int32_t server_id,
                             int32_t table_id, int32_t clock,
                             std::string *filename) const;
 
+  // Serializes the table (or, if incremental and there is an earlier
+  // snapshot, the rows changed since then) on the calling thread, which
+  // does not apply updates meanwhile, so this takes time linear in the
+  // rows written. Rows are serialized into SnapShotWriter::kChunkSize
+  // chunks that are queued on snapshot_writer as they fill and written
+  // to the file in the background, so memory beyond the table is bounded
+  // by SnapShotWriter::kMaxQueuedBytes rather than the snapshot size. See
+  // snapshot_writer.hpp for the file layout.
   void TakeSnapShot(const std::string &snapshot_dir, int32_t server_id,
-                    int32_t table_id, int32_t clock) const;
+                    int32_t table_id, int32_t clock, bool incremental,
+                    SnapShotWriter *snapshot_writer);
 
+  // Loads the snapshot taken at clock and, if it is a delta, the snapshots
+  // it is based on. Rows are deserialized in parallel from the mmap()ed
+  // files.
   void ReadSnapShot(const std::string &resume_dir, int32_t server_id,
                     int32_t table_id, int32_t clock);
 private:
@@ -201,22 +232,31 @@ private:
 
   typedef void (*ResetImportanceFunc)(ServerRow *server_row);
 
-  typedef void (*SortCandidateVectorFunc)(
-      std::vector<CandidateServerRow> *candidate_row_vector);
+  typedef void (*SelectCandidatesFunc)(
+      std::vector<CandidateServerRow> *candidate_row_vector, size_t num_rows);
+
+  // Takes the dirty rows out of dirty_row_ids_, dropping (and cleaning)
+  // those no client subscribes to, as a subscriber gets the row's latest
+  // value when it subscribes.
+  void GetDirtyRows(std::vector<CandidateServerRow> *dirty_rows);
 
   TableInfo table_info_;
-  boost::unordered_map<int32_t, ServerRow> storage_;
+  ServerRowMap storage_;
+
+  // Rows are pushed only under SSPPush and SSPAggr.
+  const bool track_dirty_rows_;
+  // Ids of the rows that are dirty, each once: a row is added when an
+  // update makes it dirty, so pushes need not scan storage_.
+  std::vector<int32_t> dirty_row_ids_;
+  std::unique_ptr<std::mutex> dirty_row_ids_mtx_;
 
-  // used for appending rows to buffs
-  boost::unordered_map<int32_t, ServerRow>::iterator row_iter_;
-  uint8_t *tmp_row_buff_;
-  size_t tmp_row_buff_size_;
-  static const size_t kTmpRowBuffSizeInit = 512;
-  size_t curr_row_size_;
+  // Clock of the last snapshot taken of this table, -1 if none.
+  int32_t last_snapshot_clock_;
+  static const int32_t kNumSnapShotReadThreads = 4;
 
   ApplyRowBatchIncFunc ApplyRowBatchInc_;
   ResetImportanceFunc ResetImportance_;
-  SortCandidateVectorFunc SortCandidateVector_;
+  SelectCandidatesFunc SelectCandidates_;
 
   const AbstractRow *sample_row_;
   const AbstractRowOpLog *sample_row_oplog_;
@@ -5,6 +5,9 @@
 #include <petuum_ps_common/util/stats.hpp>
 #include <petuum_ps_common/thread/mem_transfer.hpp>
 
+#include <map>
+#include <utility>
+
 namespace petuum {
 
 bool ServerThread::WaitMsgBusy(int32_t *sender_id, zmq::message_t *zmq_msg,
@@ -159,6 +162,16 @@ void ServerThread::HandleCreateTable(int32_t sender_id,
       = create_table_msg.get_row_oplog_type();
   table_info.dense_row_oplog_capacity
       = create_table_msg.get_dense_row_oplog_capacity();
+  table_info.server_dense_storage
+      = create_table_msg.get_server_dense_storage();
+  table_info.oplog_codec
+      = create_table_msg.get_oplog_codec();
+  table_info.oplog_topk_ratio
+      = create_table_msg.get_oplog_topk_ratio();
+  table_info.row_partitioner
+      = create_table_msg.get_row_partitioner();
+  table_info.row_partitioner_num_rows
+      = create_table_msg.get_row_partitioner_num_rows();
   server_obj_.CreateTable(table_id, table_info);
 }
 
@@ -200,6 +213,60 @@ void ServerThread::ReplyRowRequest(int32_t bg_id, ServerRow *server_row,
   MemTransfer::TransferMem(comm_bus_, bg_id, &server_row_request_reply_msg);
 }
 
+void ServerThread::HandleBulkRowRequest(
+    int32_t sender_id, BulkRowRequestMsg &bulk_row_request_msg) {
+  int32_t table_id = bulk_row_request_msg.get_table_id();
+  int32_t clock = bulk_row_request_msg.get_clock();
+  int32_t num_rows = bulk_row_request_msg.get_num_rows();
+  const int32_t *row_ids = bulk_row_request_msg.get_row_ids();
+  int32_t server_clock = server_obj_.GetMinClock();
+  if (server_clock < clock) {
+    // not fresh enough, wait; ReplyFulfilledRowRequests() batches them again
+    for (int32_t i = 0; i < num_rows; ++i) {
+      server_obj_.AddRowRequest(sender_id, table_id, row_ids[i], clock);
+    }
+    return;
+  }
+
+  uint32_t version = server_obj_.GetBgVersion(sender_id);
+  ReplyBulkRowRequest(sender_id, table_id, row_ids, num_rows, server_clock,
+                      version);
+}
+
+void ServerThread::ReplyBulkRowRequest(int32_t bg_id, int32_t table_id,
+                                       const int32_t *row_ids,
+                                       int32_t num_rows,
+                                       int32_t server_clock,
+                                       uint32_t version) {
+  int32_t client_id = GlobalContext::thread_id_to_client_id(bg_id);
+  std::vector<ServerRow*> server_rows(num_rows);
+  size_t data_size = 0;
+  for (int32_t i = 0; i < num_rows; ++i) {
+    server_rows[i] = server_obj_.FindCreateRow(table_id, row_ids[i]);
+    RowSubscribe(server_rows[i], client_id);
+    data_size += sizeof(int32_t) + sizeof(size_t)
+                 + server_rows[i]->SerializedSize();
+  }
+
+  ServerBulkRowRequestReplyMsg bulk_reply_msg(data_size);
+  bulk_reply_msg.get_table_id() = table_id;
+  bulk_reply_msg.get_clock() = server_clock;
+  bulk_reply_msg.get_version() = version;
+  bulk_reply_msg.get_num_rows() = num_rows;
+
+  uint8_t *mem = reinterpret_cast<uint8_t*>(bulk_reply_msg.get_row_data());
+  for (int32_t i = 0; i < num_rows; ++i) {
+    *(reinterpret_cast<int32_t*>(mem)) = row_ids[i];
+    mem += sizeof(int32_t);
+    size_t *row_size = reinterpret_cast<size_t*>(mem);
+    mem += sizeof(size_t);
+    *row_size = server_rows[i]->Serialize(mem);
+    mem += *row_size;
+  }
+
+  MemTransfer::TransferMem(comm_bus_, bg_id, &bulk_reply_msg);
+}
+
 void ServerThread::HandleOpLogMsg(int32_t sender_id,
                                   ClientSendOpLogMsg &client_send_oplog_msg) {
   bool is_clock = client_send_oplog_msg.get_is_clock();
@@ -217,23 +284,11 @@ void ServerThread::HandleOpLogMsg(int32_t sender_id,
 
   bool clock_changed = false;
   if (is_clock) {
+    STATS_SERVER_CLOCK_UNTIL_BEGIN();
     clock_changed = server_obj_.ClockUntil(sender_id, bg_clock);
+    STATS_SERVER_CLOCK_UNTIL_END(sender_id);
     if (clock_changed) {
-      std::vector<ServerRowRequest> requests;
-      server_obj_.GetFulfilledRowRequests(&requests);
-      for (auto request_iter = requests.begin();
-	   request_iter != requests.end(); request_iter++) {
-	int32_t table_id = request_iter->table_id;
-	int32_t row_id = request_iter->row_id;
-	int32_t bg_id = request_iter->bg_id;
-	uint32_t version = server_obj_.GetBgVersion(bg_id);
-	ServerRow *server_row = server_obj_.FindCreateRow(table_id, row_id);
-        RowSubscribe(server_row,
-                     GlobalContext::thread_id_to_client_id(bg_id));
-	int32_t server_clock = server_obj_.GetMinClock();
-	ReplyRowRequest(bg_id, server_row, table_id, row_id, server_clock,
-                        version);
-      }
+      ReplyFulfilledRowRequests();
       STATS_SERVER_CLOCK();
     }
   }
@@ -245,6 +300,72 @@ void ServerThread::HandleOpLogMsg(int32_t sender_id,
   }
 }
 
+void ServerThread::HandleAggrOpLogMsg(AggrSendOpLogMsg &aggr_send_oplog_msg) {
+  STATS_SERVER_ADD_PER_CLOCK_OPLOG_SIZE(aggr_send_oplog_msg.get_size());
+
+  STATS_SERVER_ACCUM_APPLY_OPLOG_BEGIN();
+  server_obj_.ApplyOpLog(aggr_send_oplog_msg.get_oplog_data(),
+                         aggr_send_oplog_msg.get_oplog_size());
+  STATS_SERVER_ACCUM_APPLY_OPLOG_END();
+
+  int32_t num_bgs = aggr_send_oplog_msg.get_num_bgs();
+  const AggrOpLogBgInfo *bg_infos = aggr_send_oplog_msg.get_bg_infos();
+
+  bool clock_changed = false;
+  for (int32_t i = 0; i < num_bgs; ++i) {
+    server_obj_.UpdateBgVersion(bg_infos[i].bg_id, bg_infos[i].version);
+    if (bg_infos[i].is_clock) {
+      STATS_SERVER_CLOCK_UNTIL_BEGIN();
+      if (server_obj_.ClockUntil(bg_infos[i].bg_id, bg_infos[i].bg_clock))
+        clock_changed = true;
+      STATS_SERVER_CLOCK_UNTIL_END(bg_infos[i].bg_id);
+    }
+  }
+
+  if (clock_changed) {
+    ReplyFulfilledRowRequests();
+    STATS_SERVER_CLOCK();
+    ServerPushRow(clock_changed);
+  } else {
+    for (int32_t i = 0; i < num_bgs; ++i) {
+      SendOpLogAckMsg(bg_infos[i].bg_id,
+                      server_obj_.GetBgVersion(bg_infos[i].bg_id));
+    }
+  }
+}
+
+void ServerThread::ReplyFulfilledRowRequests() {
+  std::vector<ServerRowRequest> requests;
+  server_obj_.GetFulfilledRowRequests(&requests);
+
+  // A bg thread gets all its rows of a table in one message.
+  std::map<std::pair<int32_t, int32_t>, std::vector<int32_t> > bg_table_rows;
+  for (auto request_iter = requests.begin();
+       request_iter != requests.end(); request_iter++) {
+    bg_table_rows[std::make_pair(request_iter->bg_id,
+                                 request_iter->table_id)].push_back(
+                                     request_iter->row_id);
+  }
+
+  int32_t server_clock = server_obj_.GetMinClock();
+  for (const auto &bg_table_pair : bg_table_rows) {
+    int32_t bg_id = bg_table_pair.first.first;
+    int32_t table_id = bg_table_pair.first.second;
+    const std::vector<int32_t> &row_ids = bg_table_pair.second;
+    uint32_t version = server_obj_.GetBgVersion(bg_id);
+    if (row_ids.size() == 1) {
+      ServerRow *server_row = server_obj_.FindCreateRow(table_id, row_ids[0]);
+      RowSubscribe(server_row,
+                   GlobalContext::thread_id_to_client_id(bg_id));
+      ReplyRowRequest(bg_id, server_row, table_id, row_ids[0], server_clock,
+                      version);
+    } else {
+      ReplyBulkRowRequest(bg_id, table_id, row_ids.data(), row_ids.size(),
+                          server_clock, version);
+    }
+  }
+}
+
 long ServerThread::ServerIdleWork() {
   return 0;
 }
@@ -317,6 +438,12 @@ void *ServerThread::operator() () {
 	HandleRowRequest(sender_id, row_request_msg);
       }
       break;
+    case kBulkRowRequest:
+      {
+	BulkRowRequestMsg bulk_row_request_msg(msg_mem);
+	HandleBulkRowRequest(sender_id, bulk_row_request_msg);
+      }
+      break;
     case kClientSendOpLog:
       {
 	ClientSendOpLogMsg client_send_oplog_msg(msg_mem);
@@ -325,6 +452,14 @@ void *ServerThread::operator() () {
         STATS_SERVER_OPLOG_MSG_RECV_INC_ONE();
       }
       break;
+    case kAggrSendOpLog:
+      {
+	AggrSendOpLogMsg aggr_send_oplog_msg(msg_mem);
+
+	HandleAggrOpLogMsg(aggr_send_oplog_msg);
+        STATS_SERVER_OPLOG_MSG_RECV_INC_ONE();
+      }
+      break;
     default:
       LOG(FATAL) << "Unrecognized message type " << msg_type;
     }
@@ -53,8 +53,17 @@ protected:
   void ReplyRowRequest(int32_t bg_id, ServerRow *server_row,
                        int32_t table_id, int32_t row_id, int32_t server_clock,
                        uint32_t version);
+  void HandleBulkRowRequest(int32_t sender_id,
+                            BulkRowRequestMsg &bulk_row_request_msg);
+  // Replies to requests of bg_id for num_rows rows of table_id in one
+  // message.
+  void ReplyBulkRowRequest(int32_t bg_id, int32_t table_id,
+                           const int32_t *row_ids, int32_t num_rows,
+                           int32_t server_clock, uint32_t version);
   void HandleOpLogMsg(int32_t sender_id,
                       ClientSendOpLogMsg &client_send_oplog_msg);
+  void HandleAggrOpLogMsg(AggrSendOpLogMsg &aggr_send_oplog_msg);
+  void ReplyFulfilledRowRequests();
 
   virtual long ServerIdleWork();
   virtual long ResetServerIdleMilli();
@@ -0,0 +1,133 @@
+#include <petuum_ps/server/snapshot_writer.hpp>
+#include <glog/logging.h>
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+namespace petuum {
+
+const size_t SnapShotWriter::kChunkSize;
+const size_t SnapShotWriter::kMaxQueuedBytes;
+
+SnapShotWriter::SnapShotWriter():
+    queued_bytes_(0),
+    stop_(false),
+    file_(NULL) {
+  writer_ = std::thread(&SnapShotWriter::WriterMain, this);
+}
+
+SnapShotWriter::~SnapShotWriter() {
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    stop_ = true;
+  }
+  cv_.notify_one();
+  writer_.join();
+  CHECK(file_ == NULL) << filename_ << " was not closed";
+}
+
+void SnapShotWriter::Open(const std::string &filename) {
+  WriteJob job;
+  job.type = kOpen;
+  job.filename = filename;
+  job.buff = 0;
+  job.size = 0;
+  Enqueue(job);
+}
+
+void SnapShotWriter::Append(uint8_t *buff, size_t size) {
+  WriteJob job;
+  job.type = kAppend;
+  job.buff = buff;
+  job.size = size;
+  {
+    // A chunk larger than kMaxQueuedBytes is let through once the queue
+    // is empty.
+    std::unique_lock<std::mutex> lock(mtx_);
+    space_cv_.wait(lock, [this, size] {
+        return queued_bytes_ == 0
+            || queued_bytes_ + size <= kMaxQueuedBytes; });
+    queued_bytes_ += size;
+    jobs_.push_back(job);
+  }
+  cv_.notify_one();
+}
+
+void SnapShotWriter::Close() {
+  WriteJob job;
+  job.type = kClose;
+  job.buff = 0;
+  job.size = 0;
+  Enqueue(job);
+}
+
+void SnapShotWriter::Enqueue(const WriteJob &job) {
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    jobs_.push_back(job);
+  }
+  cv_.notify_one();
+}
+
+void SnapShotWriter::WriterMain() {
+  while (true) {
+    WriteJob job;
+    {
+      std::unique_lock<std::mutex> lock(mtx_);
+      cv_.wait(lock, [this] { return stop_ || !jobs_.empty(); });
+      if (jobs_.empty())
+        return;
+      job = jobs_.front();
+      jobs_.pop_front();
+    }
+    switch (job.type) {
+      case kOpen:
+        OpenFile(job.filename);
+        break;
+      case kAppend:
+        AppendToFile(job);
+        delete[] job.buff;
+        {
+          std::lock_guard<std::mutex> lock(mtx_);
+          queued_bytes_ -= job.size;
+        }
+        space_cv_.notify_one();
+        break;
+      case kClose:
+        CloseFile();
+        break;
+      default:
+        LOG(FATAL) << "Unknown write job type " << job.type;
+    }
+  }
+}
+
+void SnapShotWriter::OpenFile(const std::string &filename) {
+  CHECK(file_ == NULL) << filename_ << " is still open";
+  filename_ = filename;
+  tmp_filename_ = filename + ".tmp";
+  file_ = fopen(tmp_filename_.c_str(), "wb");
+  CHECK(file_ != NULL) << "failed to open " << tmp_filename_ << ": "
+                       << strerror(errno);
+}
+
+void SnapShotWriter::AppendToFile(const WriteJob &job) {
+  CHECK(file_ != NULL) << "no snapshot file is open";
+  size_t written = fwrite(job.buff, 1, job.size, file_);
+  CHECK_EQ(written, job.size) << "failed to write " << tmp_filename_ << ": "
+                              << strerror(errno);
+}
+
+void SnapShotWriter::CloseFile() {
+  CHECK(file_ != NULL) << "no snapshot file is open";
+  CHECK_EQ(fflush(file_), 0);
+  CHECK_EQ(fsync(fileno(file_)), 0);
+  CHECK_EQ(fclose(file_), 0);
+  file_ = NULL;
+
+  CHECK_EQ(rename(tmp_filename_.c_str(), filename_.c_str()), 0)
+      << "failed to rename " << tmp_filename_ << ": " << strerror(errno);
+}
+
+}  // namespace petuum
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <boost/noncopyable.hpp>
+
+namespace petuum {
+
+// On-disk layout of a server table snapshot. A snapshot file is written in
+// one sequential pass and is meant to be mmap()ed when read:
+//
+// SnapShotHeader
+// serialized rows, back to back, each as produced by AbstractRow::Serialize()
+// SnapShotIndexEntry[num_rows], starting at index_offset
+//
+// A delta snapshot only holds the rows that changed since the snapshot taken
+// at base_clock; a full snapshot has base_clock = -1. Rows in the newest
+// snapshot of a chain take precedence over older ones.
+struct SnapShotHeader {
+  uint64_t magic;
+  int32_t version;
+  int32_t table_id;
+  int32_t server_id;
+  int32_t clock;
+  int32_t base_clock;
+  int32_t reserved;
+  uint64_t num_rows;
+  uint64_t index_offset;
+};
+
+struct SnapShotIndexEntry {
+  int32_t row_id;
+  int32_t reserved;
+  uint64_t offset;
+  uint64_t size;
+};
+
+// "PSSNAP01" when read as bytes on a little-endian host.
+const uint64_t kSnapShotMagic = 0x313050414e535350ULL;
+const int32_t kSnapShotVersion = 1;
+
+// Writes snapshot files on a background thread so that the server thread
+// only pays for serializing rows into memory, not for file I/O. A file is
+// handed over as a sequence of chunks (Open(), Append()..., Close()), so
+// the serialized copy of a table never needs to be in memory at once: at
+// most kMaxQueuedBytes wait to be written, and Append() blocks while the
+// disk is that far behind.
+//
+// A file is first written under a temporary name and renamed once it is
+// complete, so a resume never sees a partially written snapshot.
+class SnapShotWriter : boost::noncopyable {
+public:
+  // Callers serialize into chunks of about this size.
+  static const size_t kChunkSize = 4 * 1024 * 1024;
+  static const size_t kMaxQueuedBytes = 16 * kChunkSize;
+
+  SnapShotWriter();
+  // Writes out everything that has been queued.
+  ~SnapShotWriter();
+
+  // Starts a new file; chunks appended until Close() go to it. Only one
+  // file may be open at a time.
+  void Open(const std::string &filename);
+
+  // Takes ownership of buff, which must be allocated with new[].
+  void Append(uint8_t *buff, size_t size);
+
+  void Close();
+
+private:
+  enum WriteJobType {
+    kOpen,
+    kAppend,
+    kClose
+  };
+
+  struct WriteJob {
+    WriteJobType type;
+    std::string filename;
+    uint8_t *buff;
+    size_t size;
+  };
+
+  void Enqueue(const WriteJob &job);
+  void WriterMain();
+
+  // Accessed by the writer thread only.
+  void OpenFile(const std::string &filename);
+  void AppendToFile(const WriteJob &job);
+  void CloseFile();
+
+  std::thread writer_;
+  std::mutex mtx_;
+  std::condition_variable cv_;
+  // Signaled when queued_bytes_ drops.
+  std::condition_variable space_cv_;
+  std::deque<WriteJob> jobs_;
+  size_t queued_bytes_;
+  bool stop_;
+
+  FILE *file_;
+  std::string filename_;
+  std::string tmp_filename_;
+};
+
+}  // namespace petuum
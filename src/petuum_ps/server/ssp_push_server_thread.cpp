@@ -6,23 +6,17 @@
 namespace petuum {
 
 void SSPPushServerThread::SendServerPushRowMsg(
-    int32_t bg_id, ServerPushRowMsg *msg, bool last_msg,
-    int32_t version, int32_t server_min_clock) {
-  msg->get_version() = version;
-  STATS_SERVER_ADD_PER_CLOCK_PUSH_ROW_SIZE(msg->get_size());
-  STATS_SERVER_PUSH_ROW_MSG_SEND_INC_ONE();
-
-  if (last_msg) {
-    msg->get_is_clock() = true;
-    msg->get_clock() = server_min_clock;
-    MemTransfer::TransferMem(GlobalContext::comm_bus, bg_id, msg);
-  } else {
-    msg->get_is_clock() = false;
-    size_t sent_size = (GlobalContext::comm_bus->*(
-        GlobalContext::comm_bus->SendAny_))(
-        bg_id, msg->get_mem(), msg->get_size());
-    CHECK_EQ(sent_size, msg->get_size());
+    const std::vector<int32_t> &bg_ids, ServerPushRowMsg *msg,
+    bool last_msg, int32_t server_min_clock) {
+  for (size_t i = 0; i < bg_ids.size(); ++i) {
+    STATS_SERVER_ADD_PER_CLOCK_PUSH_ROW_SIZE(msg->get_size());
+    STATS_SERVER_PUSH_ROW_MSG_SEND_INC_ONE();
   }
+
+  msg->get_is_clock() = last_msg;
+  msg->get_clock() = server_min_clock;
+  // All bg threads read the same memory.
+  MemTransfer::TransferMemShared(GlobalContext::comm_bus, bg_ids, msg);
 }
 
 void SSPPushServerThread::ServerPushRow(bool clock_changed) {
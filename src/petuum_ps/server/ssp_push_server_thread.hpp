@@ -12,8 +12,8 @@ public:
   ~SSPPushServerThread() { }
 protected:
   virtual void ServerPushRow(bool clock_changed);
-  static void SendServerPushRowMsg (int32_t bg_id, ServerPushRowMsg *msg,
-                                    bool last_msg, int32_t version,
+  static void SendServerPushRowMsg (const std::vector<int32_t> &bg_ids,
+                                    ServerPushRowMsg *msg, bool last_msg,
                                     int32_t server_min_clock);
 
   virtual void RowSubscribe(ServerRow *server_row, int32_t client_id);
@@ -11,6 +11,7 @@
 #include <glog/logging.h>
 #include <utility>
 #include <limits.h>
+#include <string.h>
 #include <algorithm>
 
 namespace petuum {
@@ -28,8 +29,14 @@ AbstractBgWorker::AbstractBgWorker(int32_t id,
     clock_has_pushed_(-1),
     comm_bus_(GlobalContext::comm_bus),
     init_barrier_(init_barrier),
-    create_table_barrier_(create_table_barrier) {
+    create_table_barrier_(create_table_barrier),
+    oplog_aggr_bg_id_(-1) {
   GlobalContext::GetServerThreadIDs(my_comm_channel_idx_, &(server_ids_));
+  int32_t client_id = GlobalContext::get_client_id();
+  if (GlobalContext::is_oplog_aggr_enabled(client_id))
+    oplog_aggr_bg_id_ = GlobalContext::get_oplog_aggr_bg_id(
+        client_id, my_comm_channel_idx_);
+
   for (const auto &server_id : server_ids_) {
     server_table_oplog_size_map_.insert(
         std::make_pair(server_id, std::map<int32_t, size_t>()));
@@ -66,6 +73,9 @@ bool AbstractBgWorker::CreateTable(int32_t table_id,
                            const ClientTableConfig& table_config) {
   {
     const TableInfo &table_info = table_config.table_info;
+    // Encoded oplogs are only serialized through RowOpLogSerializer.
+    CHECK(table_info.oplog_codec == NoCodec || table_config.no_oplog_replay)
+        << "table " << table_id << ": oplog codecs require no_oplog_replay";
     BgCreateTableMsg bg_create_table_msg;
     bg_create_table_msg.get_table_id() = table_id;
     bg_create_table_msg.get_staleness() = table_info.table_staleness;
@@ -83,6 +93,16 @@ bool AbstractBgWorker::CreateTable(int32_t table_id,
         = table_info.row_oplog_type;
     bg_create_table_msg.get_dense_row_oplog_capacity()
         = table_info.dense_row_oplog_capacity;
+    bg_create_table_msg.get_server_dense_storage()
+        = table_info.server_dense_storage;
+    bg_create_table_msg.get_oplog_codec()
+        = table_info.oplog_codec;
+    bg_create_table_msg.get_oplog_topk_ratio()
+        = table_info.oplog_topk_ratio;
+    bg_create_table_msg.get_row_partitioner()
+        = table_info.row_partitioner;
+    bg_create_table_msg.get_row_partitioner_num_rows()
+        = table_info.row_partitioner_num_rows;
 
     bg_create_table_msg.get_oplog_type()
         = table_config.oplog_type;
@@ -98,6 +118,10 @@ bool AbstractBgWorker::CreateTable(int32_t table_id,
         = table_config.process_storage_type;
     bg_create_table_msg.get_no_oplog_replay()
         = table_config.no_oplog_replay;
+    bg_create_table_msg.get_evicted_row_mem_capacity()
+        = table_config.evicted_row_mem_capacity;
+    bg_create_table_msg.get_evicted_row_spill_capacity()
+        = table_config.evicted_row_spill_capacity;
 
     size_t sent_size = SendMsg(
         reinterpret_cast<MsgBase*>(&bg_create_table_msg));
@@ -149,6 +173,19 @@ void AbstractBgWorker::RequestRowAsync(int32_t table_id, int32_t row_id,
   CHECK_EQ(sent_size, request_row_msg.get_size());
 }
 
+void AbstractBgWorker::RequestRowBatch(int32_t table_id,
+                                       const std::vector<int32_t> &row_ids,
+                                       int32_t clock) {
+  BulkRowRequestMsg bulk_row_request_msg(row_ids.size());
+  bulk_row_request_msg.get_table_id() = table_id;
+  bulk_row_request_msg.get_clock() = clock;
+  memcpy(bulk_row_request_msg.get_row_ids(), row_ids.data(),
+         row_ids.size()*sizeof(int32_t));
+
+  size_t sent_size = SendMsg(reinterpret_cast<MsgBase*>(&bulk_row_request_msg));
+  CHECK_EQ(sent_size, bulk_row_request_msg.get_size());
+}
+
 void AbstractBgWorker::GetAsyncRowRequestReply() {
   zmq::message_t zmq_msg;
   int32_t sender_id;
@@ -231,11 +268,27 @@ void AbstractBgWorker::SetWaitMsg() {
 void AbstractBgWorker::InitCommBus() {
   CommBus::Config comm_config;
   comm_config.entity_id_ = my_id_;
-  comm_config.ltype_ = CommBus::kInProc;
+  if (is_oplog_aggregator()) {
+    // bg threads of other clients connect to me
+    comm_config.ltype_ = CommBus::kInProc | CommBus::kInterProc;
+    HostInfo host_info = GlobalContext::get_oplog_aggr_bg_info(my_id_);
+    comm_config.network_addr_ = "*:" + host_info.port;
+  } else {
+    comm_config.ltype_ = CommBus::kInProc;
+  }
+  comm_config.inproc_transport_ = GlobalContext::get_app_bg_inproc_transport();
   comm_bus_->ThreadRegister(comm_config);
 }
 
 void AbstractBgWorker::BgServerHandshake() {
+  // bg threads whose oplogs I aggregate connect to me in the meantime
+  int32_t num_aggr_bgs_to_connect = 0;
+  if (is_oplog_aggregator()) {
+    num_aggr_bgs_to_connect = GlobalContext::get_num_oplog_aggr_clients(
+        GlobalContext::get_client_id()) - 1;
+  }
+  int32_t num_connected_aggr_bgs = 0;
+
   {
     // connect to name node
     int32_t name_node_id = GlobalContext::get_name_node_id();
@@ -244,12 +297,19 @@ void AbstractBgWorker::BgServerHandshake() {
     // wait for ConnectServerMsg
     zmq::message_t zmq_msg;
     int32_t sender_id;
-    if (comm_bus_->IsLocalEntity(name_node_id)) {
-      comm_bus_->RecvInProc(&sender_id, &zmq_msg);
-    }else{
-      comm_bus_->RecvInterProc(&sender_id, &zmq_msg);
+    MsgType msg_type;
+    while (1) {
+      if (comm_bus_->IsLocalEntity(name_node_id)) {
+        comm_bus_->RecvInProc(&sender_id, &zmq_msg);
+      }else{
+        comm_bus_->RecvInterProc(&sender_id, &zmq_msg);
+      }
+      msg_type = MsgBase::get_msg_type(zmq_msg.data());
+      if (msg_type != kClientConnect)
+        break;
+      CHECK(is_oplog_aggregator()) << "sender_id = " << sender_id;
+      ++num_connected_aggr_bgs;
     }
-    MsgType msg_type = MsgBase::get_msg_type(zmq_msg.data());
     CHECK_EQ(sender_id, name_node_id);
     CHECK_EQ(msg_type, kConnectServer) << "sender_id = " << sender_id;
   }
@@ -261,20 +321,29 @@ void AbstractBgWorker::BgServerHandshake() {
     }
   }
 
+  if (oplog_aggr_bg_id_ >= 0 && !is_oplog_aggregator())
+    ConnectToOpLogAggregator();
+
   // get messages from servers for permission to start
   {
     int32_t num_started_servers = 0;
-    for (num_started_servers = 0;
-         // receive from all servers and name node
-         num_started_servers < GlobalContext::get_num_clients() + 1;
-         ++num_started_servers) {
+    // receive from all servers and name node
+    while (num_started_servers < GlobalContext::get_num_clients() + 1
+           || num_connected_aggr_bgs < num_aggr_bgs_to_connect) {
       zmq::message_t zmq_msg;
       int32_t sender_id;
       (comm_bus_->*(comm_bus_->RecvAny_))(&sender_id, &zmq_msg);
       MsgType msg_type = MsgBase::get_msg_type(zmq_msg.data());
 
+      if (msg_type == kClientConnect) {
+        CHECK(is_oplog_aggregator()) << "sender_id = " << sender_id;
+        ++num_connected_aggr_bgs;
+        continue;
+      }
       CHECK_EQ(msg_type, kClientStart);
+      ++num_started_servers;
     }
+    CHECK_EQ(num_connected_aggr_bgs, num_aggr_bgs_to_connect);
   }
 }
 
@@ -312,6 +381,16 @@ void AbstractBgWorker::HandleCreateTables() {
           = bg_create_table_msg.get_row_oplog_type();
       client_table_config.table_info.dense_row_oplog_capacity
           = bg_create_table_msg.get_dense_row_oplog_capacity();
+      client_table_config.table_info.server_dense_storage
+          = bg_create_table_msg.get_server_dense_storage();
+      client_table_config.table_info.oplog_codec
+          = bg_create_table_msg.get_oplog_codec();
+      client_table_config.table_info.oplog_topk_ratio
+          = bg_create_table_msg.get_oplog_topk_ratio();
+      client_table_config.table_info.row_partitioner
+          = bg_create_table_msg.get_row_partitioner();
+      client_table_config.table_info.row_partitioner_num_rows
+          = bg_create_table_msg.get_row_partitioner_num_rows();
 
       client_table_config.oplog_type
           = bg_create_table_msg.get_oplog_type();
@@ -327,6 +406,10 @@ void AbstractBgWorker::HandleCreateTables() {
           = bg_create_table_msg.get_process_storage_type();
       client_table_config.no_oplog_replay
           = bg_create_table_msg.get_no_oplog_replay();
+      client_table_config.evicted_row_mem_capacity
+          = bg_create_table_msg.get_evicted_row_mem_capacity();
+      client_table_config.evicted_row_spill_capacity
+          = bg_create_table_msg.get_evicted_row_spill_capacity();
 
       CreateTableMsg create_table_msg;
       create_table_msg.get_table_id() = bg_create_table_msg.get_table_id();
@@ -340,6 +423,16 @@ void AbstractBgWorker::HandleCreateTables() {
           = bg_create_table_msg.get_row_oplog_type();
       create_table_msg.get_dense_row_oplog_capacity()
           = bg_create_table_msg.get_dense_row_oplog_capacity();
+      create_table_msg.get_server_dense_storage()
+          = bg_create_table_msg.get_server_dense_storage();
+      create_table_msg.get_oplog_codec()
+          = bg_create_table_msg.get_oplog_codec();
+      create_table_msg.get_oplog_topk_ratio()
+          = bg_create_table_msg.get_oplog_topk_ratio();
+      create_table_msg.get_row_partitioner()
+          = bg_create_table_msg.get_row_partitioner();
+      create_table_msg.get_row_partitioner_num_rows()
+          = bg_create_table_msg.get_row_partitioner_num_rows();
 
       table_id = create_table_msg.get_table_id();
 
@@ -394,7 +487,9 @@ long AbstractBgWorker::HandleClockMsg(bool clock_advanced) {
 
   clock_has_pushed_ = client_clock_;
 
+  STATS_BG_SEND_OPLOG_BEGIN();
   SendOpLogMsgs(clock_advanced);
+  STATS_BG_SEND_OPLOG_END();
   TrackBgOpLog(bg_oplog);
   return 0;
 }
@@ -404,6 +499,11 @@ void AbstractBgWorker::HandleServerPushRow(int32_t sender_id, void *msg_mem) {
              << " does not support HandleServerPushRow";
 }
 
+void AbstractBgWorker::HandleServerOpLogAck(int32_t sender_id,
+                                            uint32_t version) {
+  row_request_oplog_mgr_->ServerAcknowledgeVersion(sender_id, version);
+}
+
 void AbstractBgWorker::PrepareBeforeInfiniteLoop() { }
 
 void AbstractBgWorker::FinalizeTableStats() { }
@@ -486,8 +586,10 @@ void AbstractBgWorker::HandleAppendOpLogAndApply(
     AbstractRowOpLog *row_oplog
         = append_only_row_oplog_buffer->InitReadTmpOpLog(&row_id);
     while (row_oplog != 0) {
+      // Rows not in the process storage get these updates from the server.
       RowAccessor row_accessor;
-      ClientRow *client_row = process_storage.Find(row_id, &row_accessor);
+      ClientRow *client_row = process_storage.FindResident(row_id,
+                                                           &row_accessor);
       if (client_row != 0) {
         AbstractRow *row_data = client_row->GetRowDataPtr();
         row_data->GetWriteLock();
@@ -617,9 +719,16 @@ size_t AbstractBgWorker::SendOpLogMsgs(bool clock_advanced) {
       oplog_msg_iter->second->get_client_id() = GlobalContext::get_client_id();
       oplog_msg_iter->second->get_version() = version_;
       oplog_msg_iter->second->get_bg_clock() = clock_has_pushed_ + 1;
-
-      accum_size += oplog_msg_iter->second->get_size();
-      MemTransfer::TransferMem(comm_bus_, server_id, oplog_msg_iter->second);
+      STATS_BG_ACCUM_SERVER_OPLOG_SENT_BYTES(
+          server_id, oplog_msg_iter->second->get_size());
+
+      if (oplog_aggr_bg_id_ >= 0) {
+        accum_size += SendOpLogMsgToAggregator(server_id,
+                                               oplog_msg_iter->second);
+      } else {
+        accum_size += oplog_msg_iter->second->get_size();
+        MemTransfer::TransferMem(comm_bus_, server_id, oplog_msg_iter->second);
+      }
       // delete message after send
       delete oplog_msg_iter->second;
       oplog_msg_iter->second = 0;
@@ -629,17 +738,108 @@ size_t AbstractBgWorker::SendOpLogMsgs(bool clock_advanced) {
       clock_oplog_msg.get_client_id() = GlobalContext::get_client_id();
       clock_oplog_msg.get_version() = version_;
       clock_oplog_msg.get_bg_clock() = clock_has_pushed_ + 1;
+      STATS_BG_ACCUM_SERVER_OPLOG_SENT_BYTES(server_id, 0);
 
-      accum_size += clock_oplog_msg.get_size();
-      MemTransfer::TransferMem(comm_bus_, server_id, &clock_oplog_msg);
+      if (oplog_aggr_bg_id_ >= 0) {
+        accum_size += SendOpLogMsgToAggregator(server_id, &clock_oplog_msg);
+      } else {
+        accum_size += clock_oplog_msg.get_size();
+        MemTransfer::TransferMem(comm_bus_, server_id, &clock_oplog_msg);
+      }
     }
   }
 
+  if (oplog_aggregator_) {
+    size_t sent_size = oplog_aggregator_->SendOpLogs(comm_bus_, false);
+    STATS_BG_ACCUM_OPLOG_AGGR_BYTES(0, sent_size);
+    accum_size += sent_size;
+  }
+
   STATS_BG_ADD_PER_CLOCK_OPLOG_SIZE(accum_size);
 
   return accum_size;
 }
 
+size_t AbstractBgWorker::SendOpLogMsgToAggregator(
+    int32_t server_id, ClientSendOpLogMsg *oplog_msg) {
+  if (oplog_aggregator_) {
+    oplog_aggregator_->AddOpLog(
+        my_id_, server_id, oplog_msg->get_is_clock(), oplog_msg->get_version(),
+        oplog_msg->get_bg_clock(), oplog_msg->get_data(),
+        oplog_msg->get_avai_size());
+    STATS_BG_ACCUM_OPLOG_AGGR_BYTES(oplog_msg->get_size(), 0);
+    return 0;
+  }
+
+  ClientAggrOpLogMsg aggr_oplog_msg(oplog_msg->get_avai_size());
+  aggr_oplog_msg.get_is_clock() = oplog_msg->get_is_clock();
+  aggr_oplog_msg.get_version() = oplog_msg->get_version();
+  aggr_oplog_msg.get_bg_clock() = oplog_msg->get_bg_clock();
+  aggr_oplog_msg.get_server_id() = server_id;
+  memcpy(aggr_oplog_msg.get_data(), oplog_msg->get_data(),
+         oplog_msg->get_avai_size());
+
+  size_t msg_size = aggr_oplog_msg.get_size();
+  MemTransfer::TransferMem(comm_bus_, oplog_aggr_bg_id_, &aggr_oplog_msg);
+  return msg_size;
+}
+
+void AbstractBgWorker::CreateOpLogAggregator() {
+  int32_t aggr_client_id = GlobalContext::get_client_id();
+  int32_t num_aggr_clients
+      = GlobalContext::get_num_oplog_aggr_clients(aggr_client_id);
+
+  std::vector<int32_t> bg_ids;
+  for (int32_t client_id = aggr_client_id;
+       client_id < aggr_client_id + num_aggr_clients; ++client_id) {
+    bg_ids.push_back(GlobalContext::get_bg_thread_id(
+        client_id, my_comm_channel_idx_));
+  }
+
+  oplog_aggregator_.reset(new OpLogAggregator(
+      my_comm_channel_idx_, bg_ids, server_ids_, tables_));
+}
+
+void AbstractBgWorker::HandleClientAggrOpLogMsg(
+    int32_t sender_id, ClientAggrOpLogMsg &client_aggr_oplog_msg) {
+  oplog_aggregator_->AddOpLog(
+      sender_id, client_aggr_oplog_msg.get_server_id(),
+      client_aggr_oplog_msg.get_is_clock(),
+      client_aggr_oplog_msg.get_version(),
+      client_aggr_oplog_msg.get_bg_clock(),
+      client_aggr_oplog_msg.get_data(),
+      client_aggr_oplog_msg.get_avai_size());
+
+  size_t sent_size = oplog_aggregator_->SendOpLogs(comm_bus_, false);
+  STATS_BG_ACCUM_OPLOG_AGGR_BYTES(client_aggr_oplog_msg.get_size(),
+                                  sent_size);
+  // Only read by the stats macro.
+  (void) sent_size;
+}
+
+void AbstractBgWorker::HandleOpLogAggrBgShutDown(int32_t bg_id) {
+  oplog_aggregator_->RemoveBg(bg_id);
+
+  // The remaining bg threads may be all a server was waiting for.
+  bool all_shut_down = !oplog_aggregator_->HasBgs();
+  size_t sent_size = oplog_aggregator_->SendOpLogs(comm_bus_, all_shut_down);
+  STATS_BG_ACCUM_OPLOG_AGGR_BYTES(0, sent_size);
+  (void) sent_size;
+
+  // Servers may only count me as shut down once they have everything I
+  // aggregated.
+  if (all_shut_down)
+    SendClientShutDownMsgToServers();
+}
+
+void AbstractBgWorker::SendClientShutDownMsgToServers() {
+  ClientShutDownMsg msg;
+  for (const auto &server_id : server_ids_) {
+    (comm_bus_->*(comm_bus_->SendAny_))(server_id, msg.get_mem(),
+                                        msg.get_size());
+  }
+}
+
 size_t AbstractBgWorker::CountRowOpLogToSend(
       int32_t row_id, AbstractRowOpLog *row_oplog,
       std::map<int32_t, size_t> *table_num_bytes_by_server,
@@ -648,7 +848,7 @@ size_t AbstractBgWorker::CountRowOpLogToSend(
 
   // update oplog message size
   int32_t server_id = GlobalContext::GetPartitionServerID(
-      row_id, my_comm_channel_idx_);
+      bg_table_oplog->get_table_id(), row_id, my_comm_channel_idx_);
   // 1) row id
   // 2) serialized row size
   size_t serialized_size = sizeof(int32_t)
@@ -668,6 +868,25 @@ void AbstractBgWorker::RecvAppInitThreadConnection(int32_t *num_connected_app_th
   CHECK(*num_connected_app_threads <= GlobalContext::get_num_app_threads());
 }
 
+bool AbstractBgWorker::ProcessStorageHasFreshRow(int32_t table_id,
+                                                 int32_t row_id,
+                                                 int32_t clock) {
+  auto table_iter = tables_->find(table_id);
+  CHECK(table_iter != tables_->end());
+  AbstractProcessStorage &table_storage
+      = table_iter->second->get_process_storage();
+  // The app thread looked in the evicted row store before asking.
+  RowAccessor row_accessor;
+  ClientRow *client_row = table_storage.FindResident(row_id, &row_accessor);
+  if (client_row == 0)
+    return false;
+
+  return (GlobalContext::get_consistency_model() == SSP
+          && client_row->GetClock() >= clock)
+      || (GlobalContext::get_consistency_model() == SSPPush)
+      || (GlobalContext::get_consistency_model() == SSPAggr);
+}
+
 void AbstractBgWorker::CheckForwardRowRequestToServer(
     int32_t app_thread_id, RowRequestMsg &row_request_msg) {
 
@@ -676,30 +895,13 @@ void AbstractBgWorker::CheckForwardRowRequestToServer(
   int32_t clock = row_request_msg.get_clock();
   bool forced = row_request_msg.get_forced_request();
 
-  if (!forced) {
-    // Check if the row exists in process cache
-    auto table_iter = tables_->find(table_id);
-    CHECK(table_iter != tables_->end());
-    {
-      // check if it is in process storage
-      ClientTable *table = table_iter->second;
-      AbstractProcessStorage &table_storage = table->get_process_storage();
-      RowAccessor row_accessor;
-      ClientRow *client_row = table_storage.Find(row_id, &row_accessor);
-      if (client_row != 0) {
-        if ((GlobalContext::get_consistency_model() == SSP
-             && client_row->GetClock() >= clock)
-            || (GlobalContext::get_consistency_model() == SSPPush)
-            || (GlobalContext::get_consistency_model() == SSPAggr)) {
-          RowRequestReplyMsg row_request_reply_msg;
-          size_t sent_size = comm_bus_->SendInProc(
-              app_thread_id, row_request_reply_msg.get_mem(),
-              row_request_reply_msg.get_size());
-          CHECK_EQ(sent_size, row_request_reply_msg.get_size());
-          return;
-        }
-      }
-    }
+  if (!forced && ProcessStorageHasFreshRow(table_id, row_id, clock)) {
+    RowRequestReplyMsg row_request_reply_msg;
+    size_t sent_size = comm_bus_->SendInProc(
+        app_thread_id, row_request_reply_msg.get_mem(),
+        row_request_reply_msg.get_size());
+    CHECK_EQ(sent_size, row_request_reply_msg.get_size());
+    return;
   }
 
   std::pair<int32_t, int32_t> request_key(table_id, row_id);
@@ -715,8 +917,8 @@ void AbstractBgWorker::CheckForwardRowRequestToServer(
     = row_request_oplog_mgr_->AddRowRequest(row_request, table_id, row_id);
 
   if (should_be_sent) {
-    int32_t server_id
-        = GlobalContext::GetPartitionServerID(row_id, my_comm_channel_idx_);
+    int32_t server_id = GlobalContext::GetPartitionServerID(
+        table_id, row_id, my_comm_channel_idx_);
 
     size_t sent_size = (comm_bus_->*(comm_bus_->SendAny_))(server_id,
       row_request_msg.get_mem(), row_request_msg.get_size());
@@ -724,6 +926,57 @@ void AbstractBgWorker::CheckForwardRowRequestToServer(
   }
 }
 
+void AbstractBgWorker::HandleBulkRowRequest(
+    int32_t app_thread_id, BulkRowRequestMsg &bulk_row_request_msg) {
+  int32_t table_id = bulk_row_request_msg.get_table_id();
+  int32_t clock = bulk_row_request_msg.get_clock();
+  int32_t num_rows = bulk_row_request_msg.get_num_rows();
+  const int32_t *row_ids = bulk_row_request_msg.get_row_ids();
+
+  RowRequestInfo row_request;
+  row_request.app_thread_id = app_thread_id;
+  row_request.clock = clock;
+  row_request.version = version_ - 1;
+
+  // server id -> rows to ask it for
+  std::map<int32_t, std::vector<int32_t> > server_row_ids;
+  int32_t num_pending = 0;
+  for (int32_t i = 0; i < num_rows; ++i) {
+    int32_t row_id = row_ids[i];
+    if (ProcessStorageHasFreshRow(table_id, row_id, clock))
+      continue;
+
+    ++num_pending;
+    bool should_be_sent
+        = row_request_oplog_mgr_->AddRowRequest(row_request, table_id, row_id);
+    if (should_be_sent) {
+      int32_t server_id = GlobalContext::GetPartitionServerID(
+          table_id, row_id, my_comm_channel_idx_);
+      server_row_ids[server_id].push_back(row_id);
+    }
+  }
+
+  for (const auto &server_rows_pair : server_row_ids) {
+    const std::vector<int32_t> &server_rows = server_rows_pair.second;
+    BulkRowRequestMsg server_request_msg(server_rows.size());
+    server_request_msg.get_table_id() = table_id;
+    server_request_msg.get_clock() = clock;
+    memcpy(server_request_msg.get_row_ids(), server_rows.data(),
+           server_rows.size()*sizeof(int32_t));
+
+    size_t sent_size = (comm_bus_->*(comm_bus_->SendAny_))(
+        server_rows_pair.first, server_request_msg.get_mem(),
+        server_request_msg.get_size());
+    CHECK_EQ(sent_size, server_request_msg.get_size());
+  }
+
+  if (num_pending == 0) {
+    ReplyRowRequestToApp(app_thread_id);
+    return;
+  }
+  bulk_row_requests_[app_thread_id] = num_pending;
+}
+
 void AbstractBgWorker::UpdateExistingRow(
     int32_t table_id,
     int32_t row_id, ClientRow *client_row, ClientTable *client_table,
@@ -845,19 +1098,49 @@ void AbstractBgWorker::HandleServerRowRequestReply(
   int32_t clock = server_row_request_reply_msg.get_clock();
   uint32_t version = server_row_request_reply_msg.get_version();
 
+  row_request_oplog_mgr_->ServerAcknowledgeVersion(server_id, version);
+
+  ApplyRowRequestReply(table_id, row_id, clock, version,
+                       server_row_request_reply_msg.get_row_data(),
+                       server_row_request_reply_msg.get_row_size());
+}
+
+void AbstractBgWorker::HandleServerBulkRowRequestReply(
+    int32_t server_id,
+    ServerBulkRowRequestReplyMsg &server_bulk_row_request_reply_msg) {
+
+  int32_t table_id = server_bulk_row_request_reply_msg.get_table_id();
+  int32_t clock = server_bulk_row_request_reply_msg.get_clock();
+  uint32_t version = server_bulk_row_request_reply_msg.get_version();
+  int32_t num_rows = server_bulk_row_request_reply_msg.get_num_rows();
+
+  row_request_oplog_mgr_->ServerAcknowledgeVersion(server_id, version);
+
+  const uint8_t *mem = reinterpret_cast<const uint8_t*>(
+      server_bulk_row_request_reply_msg.get_row_data());
+  for (int32_t i = 0; i < num_rows; ++i) {
+    int32_t row_id = *(reinterpret_cast<const int32_t*>(mem));
+    mem += sizeof(int32_t);
+    size_t row_size = *(reinterpret_cast<const size_t*>(mem));
+    mem += sizeof(size_t);
+    ApplyRowRequestReply(table_id, row_id, clock, version, mem, row_size);
+    mem += row_size;
+  }
+}
+
+void AbstractBgWorker::ApplyRowRequestReply(
+    int32_t table_id, int32_t row_id, int32_t clock, uint32_t version,
+    const void *data, size_t row_size) {
   auto table_iter = tables_->find(table_id);
   CHECK(table_iter != tables_->end()) << "Cannot find table " << table_id;
   ClientTable *client_table = table_iter->second;
 
-  row_request_oplog_mgr_->ServerAcknowledgeVersion(server_id, version);
-
+  // An evicted copy is superseded when the reply is inserted, so it is
+  // not worth restoring.
   RowAccessor row_accessor;
-  ClientRow *client_row = client_table->get_process_storage().Find(
+  ClientRow *client_row = client_table->get_process_storage().FindResident(
       row_id, &row_accessor);
 
-  const void *data = server_row_request_reply_msg.get_row_data();
-  size_t row_size = server_row_request_reply_msg.get_row_size();
-
   if (client_row != 0) {
     UpdateExistingRow(table_id, row_id, client_row, client_table, data,
                       row_size, version);
@@ -878,23 +1161,34 @@ void AbstractBgWorker::HandleServerRowRequestReply(
     row_request_msg.get_clock() = clock_to_request;
 
     int32_t server_id = GlobalContext::GetPartitionServerID(
-        row_id, my_comm_channel_idx_);
+        table_id, row_id, my_comm_channel_idx_);
 
     size_t sent_size = (comm_bus_->*(comm_bus_->SendAny_))(server_id,
       row_request_msg.get_mem(), row_request_msg.get_size());
     CHECK_EQ(sent_size, row_request_msg.get_size());
   }
 
-  std::pair<int32_t, int32_t> request_key(table_id, row_id);
-  RowRequestReplyMsg row_request_reply_msg;
-
   for (int i = 0; i < (int) app_thread_ids.size(); ++i) {
-    size_t sent_size = comm_bus_->SendInProc(app_thread_ids[i],
-      row_request_reply_msg.get_mem(), row_request_reply_msg.get_size());
-    CHECK_EQ(sent_size, row_request_reply_msg.get_size());
+    ReplyRowRequestToApp(app_thread_ids[i]);
   }
 }
 
+void AbstractBgWorker::ReplyRowRequestToApp(int32_t app_thread_id) {
+  // An app thread waiting on a bulk request is answered once, when its
+  // last row arrives.
+  auto bulk_iter = bulk_row_requests_.find(app_thread_id);
+  if (bulk_iter != bulk_row_requests_.end()) {
+    if (--(bulk_iter->second) > 0)
+      return;
+    bulk_row_requests_.erase(bulk_iter);
+  }
+
+  RowRequestReplyMsg row_request_reply_msg;
+  size_t sent_size = comm_bus_->SendInProc(app_thread_id,
+    row_request_reply_msg.get_mem(), row_request_reply_msg.get_size());
+  CHECK_EQ(sent_size, row_request_reply_msg.get_size());
+}
+
 size_t AbstractBgWorker::SendMsg(MsgBase *msg) {
   size_t sent_size = comm_bus_->SendInProc(my_id_, msg->get_mem(),
                                             msg->get_size());
@@ -926,6 +1220,17 @@ void AbstractBgWorker::ConnectToNameNodeOrServer(int32_t server_id) {
   }
 }
 
+void AbstractBgWorker::ConnectToOpLogAggregator() {
+  ClientConnectMsg client_connect_msg;
+  client_connect_msg.get_client_id() = GlobalContext::get_client_id();
+  void *msg = client_connect_msg.get_mem();
+  int32_t msg_size = client_connect_msg.get_size();
+
+  HostInfo aggr_info = GlobalContext::get_oplog_aggr_bg_info(oplog_aggr_bg_id_);
+  std::string aggr_addr = aggr_info.ip + ":" + aggr_info.port;
+  comm_bus_->ConnectTo(oplog_aggr_bg_id_, aggr_addr, msg, msg_size);
+}
+
 void *AbstractBgWorker::operator() () {
   STATS_REGISTER_THREAD(kBgThread);
 
@@ -950,6 +1255,9 @@ void *AbstractBgWorker::operator() () {
 
   FinalizeTableStats();
 
+  if (is_oplog_aggregator())
+    CreateOpLogAggregator();
+
   zmq::message_t zmq_msg;
   int32_t sender_id;
   MsgType msg_type;
@@ -1002,13 +1310,32 @@ void *AbstractBgWorker::operator() () {
             (comm_bus_->*(comm_bus_->SendAny_))(name_node_id, msg.get_mem(),
               msg.get_size());
 
-            for (const auto &server_id : server_ids_) {
-              (comm_bus_->*(comm_bus_->SendAny_))(server_id, msg.get_mem(),
-                                           msg.get_size());
+            if (is_oplog_aggregator()) {
+              HandleOpLogAggrBgShutDown(my_id_);
+            } else {
+              // my last oplogs must reach the aggregator before it lets
+              // servers know it is done
+              if (oplog_aggr_bg_id_ >= 0)
+                (comm_bus_->*(comm_bus_->SendAny_))(
+                    oplog_aggr_bg_id_, msg.get_mem(), msg.get_size());
+              SendClientShutDownMsgToServers();
             }
           }
         }
         break;
+      case kClientShutDown:
+        {
+          // from a bg thread whose oplogs I aggregate
+          CHECK(is_oplog_aggregator()) << "sender_id = " << sender_id;
+          HandleOpLogAggrBgShutDown(sender_id);
+        }
+        break;
+      case kClientAggrOpLog:
+        {
+          ClientAggrOpLogMsg client_aggr_oplog_msg(msg_mem);
+          HandleClientAggrOpLogMsg(sender_id, client_aggr_oplog_msg);
+        }
+        break;
       case kServerShutDownAck:
         {
           ++num_shutdown_acked_servers;
@@ -1026,12 +1353,26 @@ void *AbstractBgWorker::operator() () {
           CheckForwardRowRequestToServer(sender_id, row_request_msg);
         }
         break;
+      case kBulkRowRequest:
+        {
+          BulkRowRequestMsg bulk_row_request_msg(msg_mem);
+          HandleBulkRowRequest(sender_id, bulk_row_request_msg);
+        }
+        break;
       case kServerRowRequestReply:
         {
           ServerRowRequestReplyMsg server_row_request_reply_msg(msg_mem);
           HandleServerRowRequestReply(sender_id, server_row_request_reply_msg);
         }
         break;
+      case kServerBulkRowRequestReply:
+        {
+          ServerBulkRowRequestReplyMsg server_bulk_row_request_reply_msg(
+              msg_mem);
+          HandleServerBulkRowRequestReply(sender_id,
+                                          server_bulk_row_request_reply_msg);
+        }
+        break;
       case kBgClock:
         {
           timeout_milli = HandleClockMsg(true);
@@ -1052,8 +1393,8 @@ void *AbstractBgWorker::operator() () {
       case kServerOpLogAck:
         {
           ServerOpLogAckMsg server_oplog_ack_msg(msg_mem);
-          row_request_oplog_mgr_->ServerAcknowledgeVersion(
-              sender_id, server_oplog_ack_msg.get_ack_version());
+          HandleServerOpLogAck(sender_id,
+                               server_oplog_ack_msg.get_ack_version());
         }
         break;
       case kBgHandleAppendOpLog:
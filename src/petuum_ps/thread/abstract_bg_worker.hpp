@@ -17,6 +17,7 @@
 #include <petuum_ps/client/client_table.hpp>
 #include <petuum_ps/thread/append_only_row_oplog_buffer.hpp>
 #include <petuum_ps/thread/row_oplog_serializer.hpp>
+#include <petuum_ps/thread/oplog_aggregator.hpp>
 
 namespace petuum {
 class AbstractBgWorker : public Thread {
@@ -38,6 +39,11 @@ public:
   bool RequestRow(int32_t table_id, int32_t row_id, int32_t clock);
   void RequestRowAsync(int32_t table_id, int32_t row_id, int32_t clock,
                        bool forced);
+  // Asks for all of row_ids (which belong to my comm channel) at once
+  // without waiting; the reply is a single kRowRequestReply once they are
+  // all fresh as of clock.
+  void RequestRowBatch(int32_t table_id, const std::vector<int32_t> &row_ids,
+                       int32_t clock);
   void GetAsyncRowRequestReply();
   void SignalHandleAppendOnlyBuffer(int32_t table_id);
 
@@ -107,6 +113,9 @@ protected:
 
   virtual void TrackBgOpLog(BgOpLog *bg_oplog) = 0;
 
+  size_t SendOpLogMsgToAggregator(int32_t server_id,
+                                  ClientSendOpLogMsg *oplog_msg);
+
   void FinalizeOpLogMsgStats(
       int32_t table_id,
       std::map<int32_t, size_t> *table_num_bytes_by_server,
@@ -114,12 +123,40 @@ protected:
       *server_table_oplog_size_map);
   /* Handles Sending OpLogs -- END */
 
+  /* Handles OpLog Aggregation -- BEGIN */
+  bool is_oplog_aggregator() const {
+    return oplog_aggr_bg_id_ == my_id_;
+  }
+
+  void ConnectToOpLogAggregator();
+  void CreateOpLogAggregator();
+  void HandleClientAggrOpLogMsg(int32_t sender_id,
+                                ClientAggrOpLogMsg &client_aggr_oplog_msg);
+  // An aggregated bg thread or this one has shut down.
+  void HandleOpLogAggrBgShutDown(int32_t bg_id);
+  /* Handles OpLog Aggregation -- END */
+
+  void SendClientShutDownMsgToServers();
+
   /* Handles Row Requests -- BEGIN */
+  bool ProcessStorageHasFreshRow(int32_t table_id, int32_t row_id,
+                                 int32_t clock);
   void CheckForwardRowRequestToServer(int32_t app_thread_id,
                                       RowRequestMsg &row_request_msg);
+  void HandleBulkRowRequest(int32_t app_thread_id,
+                            BulkRowRequestMsg &bulk_row_request_msg);
   void HandleServerRowRequestReply(
       int32_t server_id,
       ServerRowRequestReplyMsg &server_row_request_reply_msg);
+  void HandleServerBulkRowRequestReply(
+      int32_t server_id,
+      ServerBulkRowRequestReplyMsg &server_bulk_row_request_reply_msg);
+  // Puts a row from the server into the process storage and answers the
+  // requests it fulfills.
+  void ApplyRowRequestReply(int32_t table_id, int32_t row_id, int32_t clock,
+                            uint32_t version, const void *data,
+                            size_t row_size);
+  void ReplyRowRequestToApp(int32_t app_thread_id);
 
   virtual void CheckAndApplyOldOpLogsToRowData(int32_t table_id,
                                                int32_t row_id, uint32_t row_version,
@@ -129,6 +166,9 @@ protected:
   // Handles server pushed rows
   virtual void HandleServerPushRow(int32_t sender_id, void *msg_mem);
 
+  // Server sender_id has applied our oplogs up to version.
+  virtual void HandleServerOpLogAck(int32_t sender_id, uint32_t version);
+
   /* Helper Functions */
   size_t SendMsg(MsgBase *msg);
   void RecvMsg(zmq::message_t &zmq_msg);
@@ -170,6 +210,14 @@ protected:
   std::unordered_map<int32_t, int32_t> append_only_buff_proc_count_;
 
   std::unordered_map<int32_t, RowOpLogSerializer*> row_oplog_serializer_map_;
+
+  // The bg thread my oplogs go through on their way to servers, which may
+  // be myself; -1 if they go straight to servers.
+  int32_t oplog_aggr_bg_id_;
+  // app thread id -> number of rows its bulk row request still waits for
+  std::map<int32_t, int32_t> bulk_row_requests_;
+  // Only on the aggregator bg thread.
+  std::unique_ptr<OpLogAggregator> oplog_aggregator_;
 };
 
 }
@@ -0,0 +1,165 @@
+#include <petuum_ps/thread/adaptive_send_control.hpp>
+#include <petuum_ps/thread/context.hpp>
+#include <petuum_ps_common/include/constants.hpp>
+#include <glog/logging.h>
+#include <algorithm>
+
+namespace petuum {
+
+const double AdaptiveSendControl::kMinRttWindowSec = 10;
+
+namespace {
+const double kBitsPerMegabit = 1000.0 * 1000.0;
+
+// An idle push carries this many round trips' worth of data at the allowed
+// rate; more than 1 so that the estimate can grow past an undersized pipe.
+const double kPushUpperBoundGain = 2.0;
+const size_t kMinPushUpperBoundBytes = 4 * k1_Ki;
+// Times oplog_push_upper_bound_kb.
+const size_t kMaxPushUpperBoundFactor = 64;
+
+// Pushes smaller than this (e.g. clock-only) say little about bandwidth.
+const size_t kMinSampleBytes = 4 * k1_Ki;
+// Below this the timer and scheduling noise dominate; the sample is then a
+// lower bound.
+const double kMinTransferSec = 1e-4;
+
+// Version numbers wrap around.
+bool VersionNotAfter(uint32_t version, uint32_t acked_version) {
+  return static_cast<int32_t>(version - acked_version) <= 0;
+}
+}  // anonymous namespace
+
+AdaptiveSendControl::AdaptiveSendControl(
+    const std::vector<int32_t> &server_ids):
+    num_bandwidth_samples_(0),
+    bandwidth_bytes_per_sec_(GlobalContext::get_bandwidth_mbps()
+                             * kBitsPerMegabit / kNumBitsPerByte),
+    min_rtt_sec_(0),
+    min_rtt_stamp_sec_(0),
+    push_upper_bound_bytes_(
+        GlobalContext::get_oplog_push_upper_bound_kb() * k1_Ki) {
+  for (const auto &server_id : server_ids) {
+    servers_[server_id];
+  }
+}
+
+void AdaptiveSendControl::OpLogSent(int32_t server_id, uint32_t version,
+                                    size_t num_bytes, double now_sec) {
+  if (pushes_.empty() || pushes_.back().version != version) {
+    Push push;
+    push.version = version;
+    push.send_sec = now_sec;
+    push.num_bytes = 0;
+    push.sample = true;
+    pushes_.push_back(push);
+  }
+  pushes_.back().num_bytes += num_bytes;
+}
+
+void AdaptiveSendControl::OpLogAcked(int32_t server_id, uint32_t version,
+                                     double now_sec, bool sample) {
+  auto server_iter = servers_.find(server_id);
+  CHECK(server_iter != servers_.end()) << "Unknown server " << server_id;
+  ServerState &server = server_iter->second;
+  bool new_ack = !server.acked || server.acked_version != version;
+  server.acked = true;
+  server.acked_version = version;
+  if (!new_ack)
+    return;
+
+  // The newest push this ack covers.
+  const Push *acked_push = 0;
+  for (auto &push : pushes_) {
+    if (!VersionNotAfter(push.version, version))
+      break;
+    if (!sample)
+      push.sample = false;
+    acked_push = &push;
+  }
+
+  if (sample && acked_push != 0) {
+    double rtt_sec = now_sec - acked_push->send_sec;
+    server.srtt_sec = (server.srtt_sec == 0) ? rtt_sec
+        : 0.875 * server.srtt_sec + 0.125 * rtt_sec;
+    if (min_rtt_sec_ == 0 || rtt_sec <= min_rtt_sec_
+        || now_sec - min_rtt_stamp_sec_ > kMinRttWindowSec) {
+      min_rtt_sec_ = rtt_sec;
+      min_rtt_stamp_sec_ = now_sec;
+    }
+  }
+
+  // Pushes completed by this ack.
+  bool updated = false;
+  while (!pushes_.empty() && AckedByAll(pushes_.front().version)) {
+    const Push &push = pushes_.front();
+    if (push.sample && push.num_bytes >= kMinSampleBytes) {
+      double transfer_sec = std::max(now_sec - push.send_sec - min_rtt_sec_,
+                                     kMinTransferSec);
+      AddBandwidthSample(push.num_bytes / transfer_sec);
+      updated = true;
+    }
+    pushes_.pop_front();
+  }
+  if (updated || sample)
+    UpdatePushUpperBound();
+}
+
+double AdaptiveSendControl::EstimateTransMillisec(size_t num_bytes) const {
+  return num_bytes / (bandwidth_bytes_per_sec_
+                      * GlobalContext::get_bg_bandwidth_share())
+      * kOneThousand;
+}
+
+size_t AdaptiveSendControl::GetPushUpperBoundBytes() const {
+  return push_upper_bound_bytes_;
+}
+
+double AdaptiveSendControl::GetBandwidthMbps() const {
+  return bandwidth_bytes_per_sec_ * kNumBitsPerByte / kBitsPerMegabit;
+}
+
+double AdaptiveSendControl::GetMinRttMilli() const {
+  return min_rtt_sec_ * kOneThousand;
+}
+
+double AdaptiveSendControl::GetSmoothedRttMilli() const {
+  double srtt_sum = 0;
+  int32_t num_sampled = 0;
+  for (const auto &server_pair : servers_) {
+    if (server_pair.second.srtt_sec > 0) {
+      srtt_sum += server_pair.second.srtt_sec;
+      ++num_sampled;
+    }
+  }
+  return (num_sampled == 0) ? 0 : srtt_sum / num_sampled * kOneThousand;
+}
+
+bool AdaptiveSendControl::AckedByAll(uint32_t version) const {
+  for (const auto &server_pair : servers_) {
+    const ServerState &server = server_pair.second;
+    if (!server.acked || !VersionNotAfter(version, server.acked_version))
+      return false;
+  }
+  return true;
+}
+
+void AdaptiveSendControl::AddBandwidthSample(double bytes_per_sec) {
+  bandwidth_samples_[num_bandwidth_samples_ % kFilterWindow] = bytes_per_sec;
+  ++num_bandwidth_samples_;
+  int32_t num_valid = std::min<int64_t>(num_bandwidth_samples_,
+                                        kFilterWindow);
+  bandwidth_bytes_per_sec_ = *std::max_element(
+      bandwidth_samples_, bandwidth_samples_ + num_valid);
+}
+
+void AdaptiveSendControl::UpdatePushUpperBound() {
+  double bdp = kPushUpperBoundGain * bandwidth_bytes_per_sec_
+      * GlobalContext::get_bg_bandwidth_share() * min_rtt_sec_;
+  size_t max_bytes = kMaxPushUpperBoundFactor
+      * GlobalContext::get_oplog_push_upper_bound_kb() * k1_Ki;
+  push_upper_bound_bytes_ = std::min(max_bytes, std::max(
+      kMinPushUpperBoundBytes, static_cast<size_t>(bdp)));
+}
+
+}  // namespace petuum
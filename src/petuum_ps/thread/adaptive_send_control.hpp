@@ -0,0 +1,96 @@
+#pragma once
+
+#include <boost/noncopyable.hpp>
+#include <cstdint>
+#include <cstddef>
+#include <deque>
+#include <map>
+#include <vector>
+
+namespace petuum {
+
+// Measures, for a bg thread, the bandwidth and round trip time to the
+// servers from oplog acknowledgements, and derives from them how long to
+// wait after a push (pacing at bg_bandwidth_share of the bandwidth) and how
+// large an idle push may be (twice the bandwidth-delay product, so that the
+// pipe stays busy between pushes). Until the first measurement it falls
+// back to bandwidth_mbps and oplog_push_upper_bound_kb.
+//
+// A push is the oplog messages sent to all servers with one version. Its
+// round trip takes the base RTT (min RTT over the last kMinRttWindowSec) plus
+// the time its bytes take on the wire, so each push fully acknowledged gives
+// a bandwidth sample of num_bytes / (completion time - base RTT). Bandwidth
+// is the max of the last kFilterWindow samples, so that queueing behind
+// other traffic lowers it only while it lasts. Not thread-safe; owned by one
+// bg thread.
+class AdaptiveSendControl : boost::noncopyable {
+public:
+  explicit AdaptiveSendControl(const std::vector<int32_t> &server_ids);
+
+  // An oplog message of num_bytes with version was sent to server_id at
+  // now_sec (on a monotonic timer). Every push sends one to every server.
+  void OpLogSent(int32_t server_id, uint32_t version, size_t num_bytes,
+                 double now_sec);
+
+  // server_id acknowledged all oplogs up to version at now_sec. If sample is
+  // false, the acknowledgement could have been held up by something else
+  // than the network (e.g. the server waiting for other clients' clocks),
+  // and is not used for measurement.
+  void OpLogAcked(int32_t server_id, uint32_t version, double now_sec,
+                  bool sample);
+
+  // Time it takes to send num_bytes at the allowed share of the bandwidth.
+  double EstimateTransMillisec(size_t num_bytes) const;
+
+  size_t GetPushUpperBoundBytes() const;
+
+  // Before applying the share.
+  double GetBandwidthMbps() const;
+
+  double GetMinRttMilli() const;
+
+  // Averaged over servers.
+  double GetSmoothedRttMilli() const;
+
+private:
+  static const int32_t kFilterWindow = 16;
+  static const double kMinRttWindowSec;
+
+  struct Push {
+    uint32_t version;
+    double send_sec;
+    size_t num_bytes;
+    // False once an ack not fit for measurement covered it.
+    bool sample;
+  };
+
+  struct ServerState {
+    ServerState():
+        acked(false),
+        acked_version(0),
+        srtt_sec(0) { }
+
+    bool acked;
+    uint32_t acked_version;
+    double srtt_sec;
+  };
+
+  bool AckedByAll(uint32_t version) const;
+  void AddBandwidthSample(double bytes_per_sec);
+  void UpdatePushUpperBound();
+
+  std::map<int32_t, ServerState> servers_;
+  // In flight, oldest first.
+  std::deque<Push> pushes_;
+
+  double bandwidth_samples_[kFilterWindow];
+  int64_t num_bandwidth_samples_;
+  double bandwidth_bytes_per_sec_;
+
+  double min_rtt_sec_;
+  double min_rtt_stamp_sec_;
+
+  size_t push_upper_bound_bytes_;
+};
+
+}  // namespace petuum
@@ -50,7 +50,7 @@ void BgOpLogPartition::SerializeByServer(
   for (auto iter = oplog_map_.cbegin(); iter != oplog_map_.cend(); iter++) {
     int32_t row_id = iter->first;
     int32_t server_id = GlobalContext::GetPartitionServerID(
-        row_id, comm_channel_idx_);
+        table_id_, row_id, comm_channel_idx_);
 
     auto server_iter = (*bytes_by_server).find(server_id);
     CHECK(server_iter != (*bytes_by_server).end());
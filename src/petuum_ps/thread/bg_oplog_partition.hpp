@@ -21,6 +21,11 @@ public:
   void InsertOpLog(int32_t row_id, AbstractRowOpLog *row_oplog);
   void SerializeByServer(std::map<int32_t, void* > *bytes_by_server,
                          bool dense_serialize = false);
+
+  int32_t get_table_id() const {
+    return table_id_;
+  }
+
 private:
   std::unordered_map<int32_t,  AbstractRowOpLog*> oplog_map_;
   const int32_t table_id_;
@@ -71,13 +71,15 @@ void BgWorkerGroup::WaitCreateTable() {
 
 bool BgWorkerGroup::RequestRow(int32_t table_id, int32_t row_id,
                                int32_t clock) {
-  int32_t bg_idx = GlobalContext::GetPartitionCommChannelIndex(row_id);
+  int32_t bg_idx
+      = GlobalContext::GetPartitionCommChannelIndex(table_id, row_id);
   return bg_worker_vec_[bg_idx]->RequestRow(table_id, row_id, clock);
 }
 
 void BgWorkerGroup::RequestRowAsync(int32_t table_id, int32_t row_id,
                                     int32_t clock, bool forced){
-  int32_t bg_idx = GlobalContext::GetPartitionCommChannelIndex(row_id);
+  int32_t bg_idx
+      = GlobalContext::GetPartitionCommChannelIndex(table_id, row_id);
   bg_worker_vec_[bg_idx]->RequestRowAsync(table_id, row_id, clock, forced);
 }
 
@@ -89,6 +91,31 @@ void BgWorkerGroup::GetAsyncRowRequestReply() {
   CHECK_EQ(msg_type, kRowRequestReply);
 }
 
+void BgWorkerGroup::RequestRowBatch(int32_t table_id,
+                                    const std::vector<int32_t> &row_ids,
+                                    int32_t clock) {
+  std::map<int32_t, std::vector<int32_t> > channel_row_ids;
+  for (int32_t row_id : row_ids) {
+    int32_t bg_idx
+        = GlobalContext::GetPartitionCommChannelIndex(table_id, row_id);
+    channel_row_ids[bg_idx].push_back(row_id);
+  }
+
+  for (const auto &channel_rows_pair : channel_row_ids) {
+    bg_worker_vec_[channel_rows_pair.first]->RequestRowBatch(
+        table_id, channel_rows_pair.second, clock);
+  }
+
+  // one reply from each bg thread asked
+  for (size_t i = 0; i < channel_row_ids.size(); ++i) {
+    zmq::message_t zmq_msg;
+    int32_t sender_id;
+    GlobalContext::comm_bus->RecvInProc(&sender_id, &zmq_msg);
+    MsgType msg_type = MsgBase::get_msg_type(zmq_msg.data());
+    CHECK_EQ(msg_type, kRowRequestReply);
+  }
+}
+
 void BgWorkerGroup::SignalHandleAppendOnlyBuffer(
     int32_t table_id, int32_t channel_idx) {
   bg_worker_vec_[channel_idx]->SignalHandleAppendOnlyBuffer(table_id);
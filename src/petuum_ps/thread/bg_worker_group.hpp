@@ -25,6 +25,8 @@ public:
   void RequestRowAsync(int32_t table_id, int32_t row_id, int32_t clock,
                        bool forced);
   void GetAsyncRowRequestReply();
+  void RequestRowBatch(int32_t table_id, const std::vector<int32_t> &row_ids,
+                       int32_t clock);
   void SignalHandleAppendOnlyBuffer(int32_t table_id, int32_t channel_idx);
 
   void ClockAllTables();
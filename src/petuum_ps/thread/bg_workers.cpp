@@ -53,6 +53,12 @@ void BgWorkers::RequestRowAsync(int32_t table_id, int32_t row_id,
   return bg_worker_group_->RequestRowAsync(table_id, row_id, clock, forced);
 }
 
+void BgWorkers::RequestRowBatch(int32_t table_id,
+                                const std::vector<int32_t> &row_ids,
+                                int32_t clock) {
+  bg_worker_group_->RequestRowBatch(table_id, row_ids, clock);
+}
+
 void BgWorkers::GetAsyncRowRequestReply() {
   return bg_worker_group_->GetAsyncRowRequestReply();
 }
@@ -24,6 +24,11 @@ public:
   static void RequestRowAsync(int32_t table_id, int32_t row_id, int32_t clock,
                               bool forced);
   static void GetAsyncRowRequestReply();
+  // Requests row_ids at once (one message per server) and waits until all
+  // of them are fresh as of clock in the process storage.
+  static void RequestRowBatch(int32_t table_id,
+                              const std::vector<int32_t> &row_ids,
+                              int32_t clock);
   static void SignalHandleAppendOnlyBuffer(int32_t table_id, int32_t channel_idx);
   static void ClockAllTables();
   static void SendOpLogsAllTables();
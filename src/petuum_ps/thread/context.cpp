@@ -1,4 +1,6 @@
 #include <petuum_ps/thread/context.hpp>
+#include <petuum_ps_common/util/class_register.hpp>
+#include <memory>
 
 namespace petuum {
 
@@ -43,6 +45,7 @@ std::string GlobalContext::snapshot_dir_;
 int32_t GlobalContext::resume_clock_;
 
 std::string GlobalContext::resume_dir_;
+bool GlobalContext::snapshot_incremental_;
 
 UpdateSortPolicy GlobalContext::update_sort_policy_;
 
@@ -62,4 +65,63 @@ long GlobalContext::server_idle_milli_;
 
 int32_t GlobalContext::server_row_candidate_factor_;
 
+int32_t GlobalContext::num_server_apply_threads_;
+
+int32_t GlobalContext::oplog_aggr_group_size_;
+
+std::map<int32_t, HostInfo> GlobalContext::aggr_bg_map_;
+
+std::string GlobalContext::evicted_row_spill_dir_;
+
+std::string GlobalContext::ooc_path_prefix_;
+
+bool GlobalContext::inproc_ring_transport_;
+
+bool GlobalContext::adaptive_bg_send_;
+
+double GlobalContext::bg_bandwidth_share_;
+
+std::vector<GlobalContext::TablePartitioner>
+GlobalContext::row_partitioners_;
+std::atomic<int32_t> GlobalContext::num_row_partitioners_(0);
+
+void GlobalContext::RegisterRowPartitioner(int32_t table_id,
+                                           const TableInfo &table_info) {
+  // A row lives on one server thread: splitting one across server threads
+  // by column range is not supported, so a table with fewer rows than
+  // server threads cannot be balanced by any partitioner.
+  int32_t num_partitions = num_clients_ * num_comm_channels_per_client_;
+  if (table_info.row_partitioner_num_rows > 0
+      && table_info.row_partitioner_num_rows < num_partitions) {
+    std::unique_ptr<AbstractRow> sample_row(
+        ClassRegistry<AbstractRow>::GetRegistry().CreateObject(
+            table_info.row_type));
+    sample_row->Init(table_info.row_capacity);
+    LOG(WARNING) << "Table " << table_id << " has "
+                 << table_info.row_partitioner_num_rows << " rows of up to "
+                 << sample_row->SerializedSize() << " bytes for "
+                 << num_partitions << " server threads: each row is more "
+                 << "than a server thread's even share of the table and "
+                 << num_partitions - table_info.row_partitioner_num_rows
+                 << " server threads get no rows. Rows are not split "
+                 << "across servers; store wide rows as several row ids.";
+  }
+
+  if (table_info.row_partitioner == ModuloPartitioner)
+    return;
+  CHECK(GetRowPartitioner(table_id) == 0)
+      << "Table " << table_id << " registered twice";
+  // Only the thread creating tables writes, one table at a time.
+  int32_t num_row_partitioners = num_row_partitioners_.load();
+  CHECK_LT(num_row_partitioners,
+           static_cast<int32_t>(row_partitioners_.size()))
+      << "more tables created than num_tables = " << num_tables_;
+  TablePartitioner &entry = row_partitioners_[num_row_partitioners];
+  entry.table_id = table_id;
+  entry.partitioner = new RowPartitioner(
+      table_id, table_info, num_clients_, num_comm_channels_per_client_);
+  num_row_partitioners_.store(num_row_partitioners + 1,
+                              std::memory_order_release);
+}
+
 }   // namespace petuum
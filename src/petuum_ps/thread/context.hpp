@@ -3,7 +3,9 @@
 #pragma once
 
 #include <vector>
+#include <atomic>
 #include <map>
+#include <algorithm>
 #include <glog/logging.h>
 #include <boost/utility.hpp>
 
@@ -12,6 +14,7 @@
 #include <petuum_ps_common/comm_bus/comm_bus.hpp>
 #include <petuum_ps_common/include/configs.hpp>
 #include <petuum_ps_common/util/vector_clock_mt.hpp>
+#include <petuum_ps/thread/row_partitioner.hpp>
 
 namespace petuum {
 
@@ -145,6 +148,7 @@ public:
       const std::string &snapshot_dir,
       int32_t resume_clock,
       const std::string &resume_dir,
+      bool snapshot_incremental,
       UpdateSortPolicy update_sort_policy,
       long bg_idle_milli,
       double bandwidth_mbps,
@@ -153,7 +157,14 @@ public:
       size_t thread_oplog_batch_size,
       size_t server_push_row_threshold,
       long server_idle_milli,
-      int32_t server_row_candidate_factor) {
+      int32_t server_row_candidate_factor,
+      int32_t num_server_apply_threads,
+      int32_t oplog_aggr_group_size,
+      const std::string &evicted_row_spill_dir,
+      const std::string &ooc_path_prefix,
+      bool inproc_ring_transport,
+      bool adaptive_bg_send,
+      double bg_bandwidth_share) {
 
     num_comm_channels_per_client_
         = num_comm_channels_per_client;
@@ -177,6 +188,7 @@ public:
     snapshot_dir_ = snapshot_dir;
     resume_clock_ = resume_clock;
     resume_dir_ = resume_dir;
+    snapshot_incremental_ = snapshot_incremental;
     update_sort_policy_ = update_sort_policy;
     bg_idle_milli_ = bg_idle_milli;
 
@@ -191,6 +203,29 @@ public:
 
     server_row_candidate_factor_ = server_row_candidate_factor;
 
+    num_server_apply_threads_ = num_server_apply_threads;
+
+    CHECK_GE(oplog_aggr_group_size, 1);
+    oplog_aggr_group_size_ = oplog_aggr_group_size;
+
+    evicted_row_spill_dir_ = evicted_row_spill_dir;
+
+    CHECK(consistency_model != LocalOOC || !ooc_path_prefix.empty())
+        << "LocalOOC requires ooc_path_prefix";
+    CHECK(consistency_model != LocalOOC || num_clients == 1)
+        << "LocalOOC runs on a single client";
+    ooc_path_prefix_ = ooc_path_prefix;
+
+    inproc_ring_transport_ = inproc_ring_transport;
+
+    CHECK(bg_bandwidth_share > 0 && bg_bandwidth_share <= 1)
+        << "bg_bandwidth_share must be in (0, 1]";
+    adaptive_bg_send_ = adaptive_bg_send;
+    bg_bandwidth_share_ = bg_bandwidth_share;
+
+    row_partitioners_.assign(num_tables, TablePartitioner());
+    num_row_partitioners_ = 0;
+
     for (auto host_iter = host_map.begin();
          host_iter != host_map.end(); ++host_iter) {
       HostInfo host_info = host_iter->second;
@@ -216,6 +251,20 @@ public:
 
         server_ids_.push_back(server_id);
       }
+
+      // oplog aggregator bg threads listen on the ports following the
+      // servers'
+      if (is_oplog_aggr_client(host_iter->first)) {
+        for (int i = 0; i < num_comm_channels_per_client_; ++i) {
+          int32_t bg_id = get_bg_thread_id(host_iter->first, i);
+          aggr_bg_map_.insert(std::make_pair(bg_id, host_info));
+
+          ++port_num;
+          std::stringstream ss;
+          ss << port_num;
+          host_info.port = ss.str();
+        }
+      }
     }
   }
 
@@ -278,18 +327,31 @@ public:
     return client_id_;
   }
 
-  static int32_t GetPartitionCommChannelIndex(int32_t row_id) {
+  // Sets how table_id's rows are assigned to server threads. Must be called
+  // before any of its rows is routed, i.e. when the table is created; tables
+  // not registered use ModuloPartitioner.
+  static void RegisterRowPartitioner(int32_t table_id,
+                                     const TableInfo &table_info);
+
+  static int32_t GetPartitionCommChannelIndex(int32_t table_id,
+                                              int32_t row_id) {
+    const RowPartitioner *partitioner = GetRowPartitioner(table_id);
+    if (partitioner != 0)
+      return partitioner->GetCommChannelIndex(row_id);
     return row_id % num_comm_channels_per_client_;
   }
 
   // get the id of the server who is responsible for holding that row
-  static int32_t GetPartitionClientID(int32_t row_id) {
+  static int32_t GetPartitionClientID(int32_t table_id, int32_t row_id) {
+    const RowPartitioner *partitioner = GetRowPartitioner(table_id);
+    if (partitioner != 0)
+      return partitioner->GetClientID(row_id);
     return (row_id / num_comm_channels_per_client_) % num_clients_;
   }
 
-  static int32_t GetPartitionServerID(int32_t row_id,
+  static int32_t GetPartitionServerID(int32_t table_id, int32_t row_id,
                                       int32_t comm_channel_idx) {
-    int32_t client_id = GetPartitionClientID(row_id);
+    int32_t client_id = GetPartitionClientID(table_id, row_id);
     return get_server_thread_id(client_id, comm_channel_idx);
   }
 
@@ -299,6 +361,12 @@ public:
     return index;
   }
 
+  // Partition of server_id as numbered by RowPartitioner.
+  static int32_t GetServerPartition(int32_t server_id) {
+    return GetCommChannelIndexServer(server_id)
+        + num_comm_channels_per_client_ * thread_id_to_client_id(server_id);
+  }
+
   static int32_t get_server_ring_size(){
     return server_ring_size_;
   }
@@ -322,11 +390,12 @@ public:
         * kStripedLockExpansionFactor;
   }
 
+  // Lock pool of a table's process storage. Contention comes from the
+  // threads touching the table, not from the number of rows, so the pool
+  // does not grow past GetLockPoolSize().
   static int32_t GetLockPoolSize(size_t table_capacity) {
-    static const int32_t kStripedLockReductionFactor = 1;
-    return (table_capacity <= 2*kStripedLockReductionFactor)
-        ? table_capacity
-        : table_capacity / kStripedLockReductionFactor;
+    return std::min<size_t>(std::max<size_t>(table_capacity, 1),
+                            GetLockPoolSize());
   }
 
   static int32_t get_snapshot_clock() {
@@ -345,6 +414,10 @@ public:
     return resume_dir_;
   }
 
+  static bool get_snapshot_incremental() {
+    return snapshot_incremental_;
+  }
+
   static UpdateSortPolicy get_update_sort_policy() {
     return update_sort_policy_;
   }
@@ -361,6 +434,14 @@ public:
     return oplog_push_upper_bound_kb_;
   }
 
+  static bool get_adaptive_bg_send() {
+    return adaptive_bg_send_;
+  }
+
+  static double get_bg_bandwidth_share() {
+    return bg_bandwidth_share_;
+  }
+
   static int32_t get_oplog_push_staleness_tolerance() {
     return oplog_push_staleness_tolerance_;
   }
@@ -377,6 +458,65 @@ public:
     return server_idle_milli_;
   }
 
+  static int32_t get_num_server_apply_threads() {
+    return num_server_apply_threads_;
+  }
+
+  static int32_t get_oplog_aggr_group_size() {
+    return oplog_aggr_group_size_;
+  }
+
+  static const std::string &get_evicted_row_spill_dir() {
+    return evicted_row_spill_dir_;
+  }
+
+  static const std::string &get_ooc_path_prefix() {
+    return ooc_path_prefix_;
+  }
+
+  // CommBus::Config::inproc_transport_ for app threads and bg threads.
+  static int get_app_bg_inproc_transport() {
+    return inproc_ring_transport_ ? CommBus::kRingTransport
+        : CommBus::kZmqTransport;
+  }
+
+  // The client whose bg threads aggregate oplogs for client_id.
+  static int32_t get_oplog_aggr_client_id(int32_t client_id) {
+    return client_id - client_id % oplog_aggr_group_size_;
+  }
+
+  // Number of clients in client_id's oplog aggregation group, including the
+  // aggregating client. The last group may be smaller than the group size.
+  static int32_t get_num_oplog_aggr_clients(int32_t client_id) {
+    int32_t aggr_client_id = get_oplog_aggr_client_id(client_id);
+    return std::min(oplog_aggr_group_size_, num_clients_ - aggr_client_id);
+  }
+
+  // Whether client_id's oplogs go through an aggregator bg thread rather
+  // than straight to servers.
+  static bool is_oplog_aggr_enabled(int32_t client_id) {
+    return get_num_oplog_aggr_clients(client_id) > 1;
+  }
+
+  static bool is_oplog_aggr_client(int32_t client_id) {
+    return is_oplog_aggr_enabled(client_id)
+        && get_oplog_aggr_client_id(client_id) == client_id;
+  }
+
+  static int32_t get_oplog_aggr_bg_id(int32_t client_id,
+                                      int32_t comm_channel_idx) {
+    return get_bg_thread_id(get_oplog_aggr_client_id(client_id),
+                            comm_channel_idx);
+  }
+
+  static HostInfo get_oplog_aggr_bg_info(int32_t bg_id) {
+    std::map<int32_t, HostInfo>::const_iterator iter
+      = aggr_bg_map_.find(bg_id);
+    CHECK(iter != aggr_bg_map_.end()) << "id not found "
+                                      << bg_id;
+    return iter->second;
+  }
+
   static CommBus* comm_bus;
 
   // name node thread id - 0
@@ -406,6 +546,28 @@ private:
   static HostInfo name_node_host_info_;
   static std::vector<int32_t> server_ids_;
 
+  static const RowPartitioner *GetRowPartitioner(int32_t table_id) {
+    int32_t num_row_partitioners
+        = num_row_partitioners_.load(std::memory_order_acquire);
+    for (int32_t i = 0; i < num_row_partitioners; ++i) {
+      if (row_partitioners_[i].table_id == table_id)
+        return row_partitioners_[i].partitioner;
+    }
+    return 0;
+  }
+
+  struct TablePartitioner {
+    int32_t table_id;
+    RowPartitioner *partitioner;
+  };
+
+  // Tables not using the default partitioner, in the order they were
+  // created. Sized to num_tables in Init() and never resized, so bg threads
+  // may look up one table while another is being registered: the first
+  // num_row_partitioners_ entries are not written again.
+  static std::vector<TablePartitioner> row_partitioners_;
+  static std::atomic<int32_t> num_row_partitioners_;
+
   static int32_t client_id_;
   static int32_t server_ring_size_;
 
@@ -417,6 +579,7 @@ private:
   static std::string snapshot_dir_;
   static int32_t resume_clock_;
   static std::string resume_dir_;
+  static bool snapshot_incremental_;
   static UpdateSortPolicy update_sort_policy_;
   static long bg_idle_milli_;
 
@@ -432,6 +595,20 @@ private:
   static long server_idle_milli_;
 
   static int32_t server_row_candidate_factor_;
+
+  static int32_t num_server_apply_threads_;
+
+  static int32_t oplog_aggr_group_size_;
+  static std::map<int32_t, HostInfo> aggr_bg_map_;
+
+  static std::string evicted_row_spill_dir_;
+
+  static std::string ooc_path_prefix_;
+
+  static bool inproc_ring_transport_;
+
+  static bool adaptive_bg_send_;
+  static double bg_bandwidth_share_;
 };
 
 }   // namespace petuum
@@ -0,0 +1,315 @@
+#include <petuum_ps/thread/oplog_aggregator.hpp>
+#include <petuum_ps/thread/ps_msgs.hpp>
+#include <petuum_ps/client/oplog_serializer.hpp>
+#include <petuum_ps_common/oplog/oplog_codec.hpp>
+#include <petuum_ps_common/thread/mem_transfer.hpp>
+#include <petuum_ps_common/util/stats.hpp>
+#include <glog/logging.h>
+#include <algorithm>
+
+namespace petuum {
+
+OpLogAggregator::TableAggr::TableAggr(int32_t comm_channel_idx,
+                                      ClientTable *table):
+    sample_row(table->get_sample_row()),
+    update_size(table->get_sample_row()->get_update_size()),
+    dense_serialized(table->oplog_dense_serialized()),
+    dense_row_oplog(
+        table->get_row_oplog_type() == RowOpLogType::kDenseRowOpLog),
+    dense_row_oplog_capacity(table->get_dense_row_oplog_capacity()),
+    oplog_codec(table->get_oplog_codec()),
+    serializer(table->oplog_dense_serialized(), table->get_table_id(),
+               comm_channel_idx,
+               table->get_oplog_codec(), table->get_oplog_topk_ratio(),
+               table->get_sample_row()->get_update_size()) {
+  if (table->get_row_oplog_type() == RowOpLogType::kDenseRowOpLog)
+    CreateRowOpLog_ = CreateRowOpLog::CreateDenseRowOpLog;
+  else if (table->get_row_oplog_type() == RowOpLogType::kSparseRowOpLog)
+    CreateRowOpLog_ = CreateRowOpLog::CreateSparseRowOpLog;
+  else
+    CreateRowOpLog_ = CreateRowOpLog::CreateSparseVectorRowOpLog;
+
+  sample_row_oplog = CreateRowOpLog_(update_size, sample_row,
+                                     dense_row_oplog_capacity);
+}
+
+OpLogAggregator::TableAggr::~TableAggr() {
+  for (auto &server_pair : server_row_oplogs) {
+    for (auto &row_pair : server_pair.second.row_oplogs) {
+      delete row_pair.second.row_oplog;
+    }
+  }
+  delete sample_row_oplog;
+}
+
+OpLogAggregator::OpLogAggregator(int32_t comm_channel_idx,
+                                 const std::vector<int32_t> &bg_ids,
+                                 const std::vector<int32_t> &server_ids,
+                                 std::map<int32_t, ClientTable*> *tables):
+    comm_channel_idx_(comm_channel_idx),
+    bg_ids_(bg_ids.begin(), bg_ids.end()),
+    server_ids_(server_ids),
+    tables_(tables) {
+  for (const auto &server_id : server_ids_) {
+    ServerProgress &server_progress = server_progress_[server_id];
+    for (const auto &bg_id : bg_ids) {
+      server_progress.bg_progress[bg_id] = BgProgress();
+    }
+  }
+}
+
+OpLogAggregator::~OpLogAggregator() {
+  for (auto &table_pair : table_aggrs_) {
+    delete table_pair.second;
+  }
+}
+
+OpLogAggregator::TableAggr *OpLogAggregator::GetTableAggr(int32_t table_id) {
+  auto aggr_iter = table_aggrs_.find(table_id);
+  if (aggr_iter != table_aggrs_.end())
+    return aggr_iter->second;
+
+  auto table_iter = tables_->find(table_id);
+  CHECK(table_iter != tables_->end()) << "Not found table_id = " << table_id;
+  TableAggr *table_aggr = new TableAggr(comm_channel_idx_, table_iter->second);
+  table_aggrs_.insert(std::make_pair(table_id, table_aggr));
+  return table_aggr;
+}
+
+void OpLogAggregator::MergeRowOpLog(
+    TableAggr *table_aggr, ServerRowOpLogs *server_oplogs, int32_t row_id,
+    const int32_t *column_ids, const void *updates, int32_t num_updates) {
+  auto row_iter = server_oplogs->row_oplogs.find(row_id);
+  if (row_iter == server_oplogs->row_oplogs.end()) {
+    AggrRowOpLog aggr_row_oplog;
+    aggr_row_oplog.row_oplog = table_aggr->CreateRowOpLog_(
+        table_aggr->update_size, table_aggr->sample_row,
+        table_aggr->dense_row_oplog_capacity);
+    aggr_row_oplog.dirty = false;
+    row_iter = server_oplogs->row_oplogs.insert(
+        std::make_pair(row_id, aggr_row_oplog)).first;
+  }
+
+  AbstractRowOpLog *row_oplog = row_iter->second.row_oplog;
+  const AbstractRow *sample_row = table_aggr->sample_row;
+  const uint8_t *updates_uint8 = reinterpret_cast<const uint8_t*>(updates);
+
+  if (table_aggr->dense_serialized) {
+    // updates are for columns 0 to num_updates - 1
+    if (table_aggr->dense_row_oplog) {
+      sample_row->AddDenseUpdates(0, row_oplog->Find(0), updates,
+                                  num_updates);
+    } else {
+      for (int32_t i = 0; i < num_updates; ++i) {
+        sample_row->AddUpdates(i, row_oplog->FindCreate(i),
+                               updates_uint8 + i*table_aggr->update_size);
+      }
+    }
+  } else {
+    for (int32_t i = 0; i < num_updates; ++i) {
+      sample_row->AddUpdates(column_ids[i],
+                             row_oplog->FindCreate(column_ids[i]),
+                             updates_uint8 + i*table_aggr->update_size);
+    }
+  }
+
+  if (!row_iter->second.dirty) {
+    row_iter->second.dirty = true;
+    server_oplogs->dirty_row_ids.push_back(row_id);
+  }
+}
+
+void OpLogAggregator::AddOpLog(int32_t bg_id, int32_t server_id,
+                               bool is_clock, uint32_t version,
+                               int32_t bg_clock, const void *oplog,
+                               size_t oplog_size) {
+  auto server_iter = server_progress_.find(server_id);
+  CHECK(server_iter != server_progress_.end()) << "server " << server_id;
+  auto bg_iter = server_iter->second.bg_progress.find(bg_id);
+  CHECK(bg_iter != server_iter->second.bg_progress.end()) << "bg " << bg_id;
+
+  BgProgress &progress = bg_iter->second;
+  progress.pending = true;
+  progress.version = version;
+  if (is_clock) {
+    progress.is_clock = true;
+    progress.bg_clock = bg_clock;
+  }
+
+  if (oplog_size == 0)
+    return;
+
+  // See SerializedOpLogReader for the layout.
+  const uint8_t *mem = reinterpret_cast<const uint8_t*>(oplog);
+  int32_t num_tables = *(reinterpret_cast<const int32_t*>(mem));
+  mem += sizeof(int32_t);
+
+  OpLogDecodeArena decode_arena;
+  for (int32_t i = 0; i < num_tables; ++i) {
+    int32_t table_id = *(reinterpret_cast<const int32_t*>(mem));
+    mem += sizeof(int32_t) + sizeof(size_t);
+    int32_t num_rows = *(reinterpret_cast<const int32_t*>(mem));
+    mem += sizeof(int32_t);
+
+    TableAggr *table_aggr = GetTableAggr(table_id);
+    ServerRowOpLogs &server_oplogs
+        = table_aggr->server_row_oplogs[server_id];
+
+    for (int32_t j = 0; j < num_rows; ++j) {
+      int32_t row_id = *(reinterpret_cast<const int32_t*>(mem));
+      mem += sizeof(int32_t);
+
+      const int32_t *column_ids = 0;
+      int32_t num_updates;
+      size_t serialized_size;
+      const void *updates;
+      if (table_aggr->oplog_codec != NoCodec) {
+        updates = DecodeRowOpLog(table_aggr->oplog_codec,
+                                 table_aggr->dense_serialized,
+                                 table_aggr->update_size, mem, &decode_arena,
+                                 &column_ids, &num_updates, &serialized_size);
+      } else if (table_aggr->dense_serialized) {
+        updates = table_aggr->sample_row_oplog->ParseDenseSerializedOpLog(
+            mem, &num_updates, &serialized_size);
+      } else {
+        updates = table_aggr->sample_row_oplog->ParseSparseSerializedOpLog(
+            mem, &column_ids, &num_updates, &serialized_size);
+      }
+      mem += serialized_size;
+
+      MergeRowOpLog(table_aggr, &server_oplogs, row_id, column_ids, updates,
+                    num_updates);
+    }
+  }
+}
+
+void OpLogAggregator::RemoveBg(int32_t bg_id) {
+  size_t num_erased = bg_ids_.erase(bg_id);
+  CHECK_EQ(num_erased, 1) << "bg " << bg_id << " is not aggregated";
+}
+
+bool OpLogAggregator::ServerReady(int32_t server_id, bool force) {
+  const ServerProgress &server_progress = server_progress_[server_id];
+  const std::map<int32_t, BgProgress> &bg_progress
+      = server_progress.bg_progress;
+
+  bool any_pending = false;
+  int32_t min_clock = bg_progress.begin()->second.bg_clock;
+  for (const auto &progress_pair : bg_progress) {
+    any_pending = any_pending || progress_pair.second.pending;
+    min_clock = std::min(min_clock, progress_pair.second.bg_clock);
+  }
+
+  if (!any_pending)
+    return false;
+  if (force || min_clock > server_progress.min_clock_sent)
+    return true;
+
+  for (const auto &bg_id : bg_ids_) {
+    if (!bg_progress.find(bg_id)->second.pending)
+      return false;
+  }
+  return true;
+}
+
+size_t OpLogAggregator::SendServerOpLogs(CommBus *comm_bus,
+                                         int32_t server_id) {
+  std::map<int32_t, size_t> table_size_map;
+  for (auto &table_pair : table_aggrs_) {
+    TableAggr *table_aggr = table_pair.second;
+    auto server_iter = table_aggr->server_row_oplogs.find(server_id);
+    if (server_iter == table_aggr->server_row_oplogs.end())
+      continue;
+
+    ServerRowOpLogs &server_oplogs = server_iter->second;
+    std::vector<int32_t> dirty_row_ids;
+    dirty_row_ids.swap(server_oplogs.dirty_row_ids);
+    for (const auto &row_id : dirty_row_ids) {
+      AggrRowOpLog &aggr_row_oplog = server_oplogs.row_oplogs[row_id];
+      if (aggr_row_oplog.row_oplog->ClearZerosAndGetNoneZeroSize() > 0) {
+        table_aggr->serializer.AppendRowOpLogAndReset(
+            row_id, aggr_row_oplog.row_oplog);
+      }
+      // a lossy codec leaves what it did not send in the row oplog
+      if (table_aggr->oplog_codec != NoCodec
+          && aggr_row_oplog.row_oplog->ClearZerosAndGetNoneZeroSize() > 0) {
+        server_oplogs.dirty_row_ids.push_back(row_id);
+      } else {
+        aggr_row_oplog.dirty = false;
+      }
+    }
+
+    std::map<int32_t, size_t> table_num_bytes_by_server;
+    table_aggr->serializer.GetServerTableSizeMap(&table_num_bytes_by_server);
+    auto size_iter = table_num_bytes_by_server.find(server_id);
+    if (size_iter != table_num_bytes_by_server.end())
+      // plus int32_t: number of rows
+      table_size_map[table_pair.first] = size_iter->second + sizeof(int32_t);
+  }
+
+  ServerProgress &server_progress = server_progress_[server_id];
+  std::map<int32_t, BgProgress> &bg_progress = server_progress.bg_progress;
+  int32_t num_bgs = 0;
+  int32_t min_clock = bg_progress.begin()->second.bg_clock;
+  for (const auto &progress_pair : bg_progress) {
+    if (progress_pair.second.pending)
+      ++num_bgs;
+    min_clock = std::min(min_clock, progress_pair.second.bg_clock);
+  }
+  server_progress.min_clock_sent = min_clock;
+
+  OpLogSerializer oplog_serializer;
+  size_t oplog_size = oplog_serializer.Init(table_size_map);
+
+  AggrSendOpLogMsg aggr_send_oplog_msg(
+      num_bgs*sizeof(AggrOpLogBgInfo) + oplog_size);
+  aggr_send_oplog_msg.get_num_bgs() = num_bgs;
+
+  AggrOpLogBgInfo *bg_info = aggr_send_oplog_msg.get_bg_infos();
+  for (auto &progress_pair : bg_progress) {
+    BgProgress &progress = progress_pair.second;
+    if (!progress.pending)
+      continue;
+    bg_info->bg_id = progress_pair.first;
+    bg_info->version = progress.version;
+    bg_info->bg_clock = progress.bg_clock;
+    bg_info->is_clock = progress.is_clock;
+    ++bg_info;
+
+    progress.pending = false;
+    progress.is_clock = false;
+  }
+
+  if (oplog_size > 0) {
+    oplog_serializer.AssignMem(aggr_send_oplog_msg.get_oplog_data());
+    for (const auto &table_size_pair : table_size_map) {
+      int32_t table_id = table_size_pair.first;
+      TableAggr *table_aggr = table_aggrs_[table_id];
+      uint8_t *table_ptr = reinterpret_cast<uint8_t*>(
+          oplog_serializer.GetTablePtr(table_id));
+
+      *(reinterpret_cast<int32_t*>(table_ptr)) = table_id;
+      *(reinterpret_cast<size_t*>(table_ptr + sizeof(int32_t)))
+          = table_aggr->update_size;
+
+      std::map<int32_t, void*> server_mem_map;
+      server_mem_map[server_id] = table_ptr + sizeof(int32_t) + sizeof(size_t);
+      table_aggr->serializer.SerializeByServer(&server_mem_map);
+    }
+  }
+
+  size_t sent_size = aggr_send_oplog_msg.get_size();
+  MemTransfer::TransferMem(comm_bus, server_id, &aggr_send_oplog_msg);
+  return sent_size;
+}
+
+size_t OpLogAggregator::SendOpLogs(CommBus *comm_bus, bool force) {
+  size_t sent_size = 0;
+  for (const auto &server_id : server_ids_) {
+    if (ServerReady(server_id, force))
+      sent_size += SendServerOpLogs(comm_bus, server_id);
+  }
+  return sent_size;
+}
+
+}  // namespace petuum
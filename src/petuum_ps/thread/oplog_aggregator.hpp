@@ -0,0 +1,130 @@
+#pragma once
+
+#include <stdint.h>
+#include <map>
+#include <set>
+#include <vector>
+#include <unordered_map>
+#include <boost/noncopyable.hpp>
+
+#include <petuum_ps_common/comm_bus/comm_bus.hpp>
+#include <petuum_ps/client/client_table.hpp>
+#include <petuum_ps/oplog/create_row_oplog.hpp>
+#include <petuum_ps/thread/row_oplog_serializer.hpp>
+
+namespace petuum {
+
+// Combines the oplogs that the bg threads of one comm channel on a group of
+// clients (TableGroupConfig::oplog_aggr_group_size) send to servers, so that
+// a server receives one oplog message per group rather than one per client.
+// Runs on the bg thread of the group's first client.
+//
+// Updates to a row from different bg threads are added up into one row
+// oplog. A server's combined oplogs go out, together with each bg thread's
+// latest version and clock (AggrSendOpLogMsg), as soon as the smallest clock
+// among the group's bg threads advances, or once every bg thread of the
+// group has sent that server something since they last went out. The server
+// thus learns of the group's clock as early as without aggregation and
+// never before the updates that precede it, so SSP and SSPAggr bounds hold;
+// a bg thread's versions just skip the messages that were combined.
+// Updates sent without a clock (SSPAggr idle sends) wait for one of the two.
+class OpLogAggregator : boost::noncopyable {
+public:
+  OpLogAggregator(int32_t comm_channel_idx,
+                  const std::vector<int32_t> &bg_ids,
+                  const std::vector<int32_t> &server_ids,
+                  std::map<int32_t, ClientTable*> *tables);
+
+  ~OpLogAggregator();
+
+  // Adds oplogs bg_id sent for server_id, serialized as in the data of a
+  // ClientSendOpLogMsg.
+  void AddOpLog(int32_t bg_id, int32_t server_id, bool is_clock,
+                uint32_t version, int32_t bg_clock,
+                const void *oplog, size_t oplog_size);
+
+  // bg_id has shut down and will not send anymore.
+  void RemoveBg(int32_t bg_id);
+
+  bool HasBgs() const {
+    return !bg_ids_.empty();
+  }
+
+  // Sends the combined oplogs of each server that is due (see above); with
+  // force set, of each server that has anything pending. Returns the number
+  // of bytes sent.
+  size_t SendOpLogs(CommBus *comm_bus, bool force);
+
+private:
+  struct AggrRowOpLog {
+    AbstractRowOpLog *row_oplog;
+    bool dirty;
+  };
+
+  struct ServerRowOpLogs {
+    std::unordered_map<int32_t, AggrRowOpLog> row_oplogs;
+    std::vector<int32_t> dirty_row_ids;
+  };
+
+  struct TableAggr {
+    TableAggr(int32_t comm_channel_idx, ClientTable *table);
+    ~TableAggr();
+
+    const AbstractRow *sample_row;
+    size_t update_size;
+    bool dense_serialized;
+    bool dense_row_oplog;
+    size_t dense_row_oplog_capacity;
+    OpLogCodec oplog_codec;
+    CreateRowOpLog::CreateRowOpLogFunc CreateRowOpLog_;
+    // used to parse row oplogs only
+    AbstractRowOpLog *sample_row_oplog;
+    RowOpLogSerializer serializer;
+    std::map<int32_t, ServerRowOpLogs> server_row_oplogs;
+  };
+
+  // What a bg thread sent to a server since the last send.
+  struct BgProgress {
+    BgProgress():
+        pending(false),
+        is_clock(false),
+        version(0),
+        bg_clock(0) { }
+
+    bool pending;
+    bool is_clock;
+    uint32_t version;
+    // latest clock, sent or not
+    int32_t bg_clock;
+  };
+
+  struct ServerProgress {
+    ServerProgress():
+        min_clock_sent(0) { }
+
+    // bg id -> progress
+    std::map<int32_t, BgProgress> bg_progress;
+    // smallest bg clock as of the last send
+    int32_t min_clock_sent;
+  };
+
+  TableAggr *GetTableAggr(int32_t table_id);
+
+  void MergeRowOpLog(TableAggr *table_aggr, ServerRowOpLogs *server_oplogs,
+                     int32_t row_id, const int32_t *column_ids,
+                     const void *updates, int32_t num_updates);
+
+  bool ServerReady(int32_t server_id, bool force);
+
+  size_t SendServerOpLogs(CommBus *comm_bus, int32_t server_id);
+
+  const int32_t comm_channel_idx_;
+  std::set<int32_t> bg_ids_;
+  const std::vector<int32_t> server_ids_;
+  std::map<int32_t, ClientTable*> *tables_;
+
+  std::map<int32_t, TableAggr*> table_aggrs_;
+  std::map<int32_t, ServerProgress> server_progress_;
+};
+
+}  // namespace petuum
@@ -5,6 +5,7 @@
 
 #include <petuum_ps_common/thread/msg_base.hpp>
 #include <petuum_ps_common/include/configs.hpp>
+#include <petuum_ps/thread/context.hpp>
 
 namespace petuum {
 
@@ -116,7 +117,9 @@ public:
         + sizeof(size_t) + sizeof(bool) + sizeof(int32_t)
         + sizeof(size_t)  + sizeof(OpLogType) +sizeof(AppendOnlyOpLogType)
         + sizeof(size_t) + sizeof(size_t) + sizeof(int32_t)
-        + sizeof(ProcessStorageType) + sizeof(bool);
+        + sizeof(ProcessStorageType) + sizeof(bool) + sizeof(bool)
+        + sizeof(OpLogCodec) + sizeof(double) + sizeof(size_t)
+        + sizeof(size_t) + sizeof(RowPartitionerType) + sizeof(int32_t);
   }
 
   int32_t &get_table_id() {
@@ -250,6 +253,90 @@ public:
         + sizeof(ProcessStorageType) ));
   }
 
+  bool &get_server_dense_storage() {
+    return *(reinterpret_cast<bool*>(
+        mem_.get_mem()
+        + NumberedMsg::get_size() + sizeof(int32_t) + sizeof(int32_t)
+        + sizeof(int32_t) + sizeof(size_t) + sizeof(size_t)
+        + sizeof(size_t) + sizeof(size_t) + sizeof(bool) + sizeof(int32_t)
+        + sizeof(size_t) + sizeof(OpLogType) +sizeof(AppendOnlyOpLogType)
+        + sizeof(size_t) + sizeof(size_t) + sizeof(int32_t)
+        + sizeof(ProcessStorageType) + sizeof(bool) ));
+  }
+
+  OpLogCodec &get_oplog_codec() {
+    return *(reinterpret_cast<OpLogCodec*>(
+        mem_.get_mem()
+        + NumberedMsg::get_size() + sizeof(int32_t) + sizeof(int32_t)
+        + sizeof(int32_t) + sizeof(size_t) + sizeof(size_t)
+        + sizeof(size_t) + sizeof(size_t) + sizeof(bool) + sizeof(int32_t)
+        + sizeof(size_t) + sizeof(OpLogType) +sizeof(AppendOnlyOpLogType)
+        + sizeof(size_t) + sizeof(size_t) + sizeof(int32_t)
+        + sizeof(ProcessStorageType) + sizeof(bool) + sizeof(bool) ));
+  }
+
+  double &get_oplog_topk_ratio() {
+    return *(reinterpret_cast<double*>(
+        mem_.get_mem()
+        + NumberedMsg::get_size() + sizeof(int32_t) + sizeof(int32_t)
+        + sizeof(int32_t) + sizeof(size_t) + sizeof(size_t)
+        + sizeof(size_t) + sizeof(size_t) + sizeof(bool) + sizeof(int32_t)
+        + sizeof(size_t) + sizeof(OpLogType) +sizeof(AppendOnlyOpLogType)
+        + sizeof(size_t) + sizeof(size_t) + sizeof(int32_t)
+        + sizeof(ProcessStorageType) + sizeof(bool) + sizeof(bool)
+        + sizeof(OpLogCodec) ));
+  }
+
+  size_t &get_evicted_row_mem_capacity() {
+    return *(reinterpret_cast<size_t*>(
+        mem_.get_mem()
+        + NumberedMsg::get_size() + sizeof(int32_t) + sizeof(int32_t)
+        + sizeof(int32_t) + sizeof(size_t) + sizeof(size_t)
+        + sizeof(size_t) + sizeof(size_t) + sizeof(bool) + sizeof(int32_t)
+        + sizeof(size_t) + sizeof(OpLogType) +sizeof(AppendOnlyOpLogType)
+        + sizeof(size_t) + sizeof(size_t) + sizeof(int32_t)
+        + sizeof(ProcessStorageType) + sizeof(bool) + sizeof(bool)
+        + sizeof(OpLogCodec) + sizeof(double) ));
+  }
+
+  size_t &get_evicted_row_spill_capacity() {
+    return *(reinterpret_cast<size_t*>(
+        mem_.get_mem()
+        + NumberedMsg::get_size() + sizeof(int32_t) + sizeof(int32_t)
+        + sizeof(int32_t) + sizeof(size_t) + sizeof(size_t)
+        + sizeof(size_t) + sizeof(size_t) + sizeof(bool) + sizeof(int32_t)
+        + sizeof(size_t) + sizeof(OpLogType) +sizeof(AppendOnlyOpLogType)
+        + sizeof(size_t) + sizeof(size_t) + sizeof(int32_t)
+        + sizeof(ProcessStorageType) + sizeof(bool) + sizeof(bool)
+        + sizeof(OpLogCodec) + sizeof(double) + sizeof(size_t) ));
+  }
+
+  RowPartitionerType &get_row_partitioner() {
+    return *(reinterpret_cast<RowPartitionerType*>(
+        mem_.get_mem()
+        + NumberedMsg::get_size() + sizeof(int32_t) + sizeof(int32_t)
+        + sizeof(int32_t) + sizeof(size_t) + sizeof(size_t)
+        + sizeof(size_t) + sizeof(size_t) + sizeof(bool) + sizeof(int32_t)
+        + sizeof(size_t) + sizeof(OpLogType) +sizeof(AppendOnlyOpLogType)
+        + sizeof(size_t) + sizeof(size_t) + sizeof(int32_t)
+        + sizeof(ProcessStorageType) + sizeof(bool) + sizeof(bool)
+        + sizeof(OpLogCodec) + sizeof(double) + sizeof(size_t)
+        + sizeof(size_t) ));
+  }
+
+  int32_t &get_row_partitioner_num_rows() {
+    return *(reinterpret_cast<int32_t*>(
+        mem_.get_mem()
+        + NumberedMsg::get_size() + sizeof(int32_t) + sizeof(int32_t)
+        + sizeof(int32_t) + sizeof(size_t) + sizeof(size_t)
+        + sizeof(size_t) + sizeof(size_t) + sizeof(bool) + sizeof(int32_t)
+        + sizeof(size_t) + sizeof(OpLogType) +sizeof(AppendOnlyOpLogType)
+        + sizeof(size_t) + sizeof(size_t) + sizeof(int32_t)
+        + sizeof(ProcessStorageType) + sizeof(bool) + sizeof(bool)
+        + sizeof(OpLogCodec) + sizeof(double) + sizeof(size_t)
+        + sizeof(size_t) + sizeof(RowPartitionerType) ));
+  }
+
 protected:
   void InitMsg() {
     NumberedMsg::InitMsg();
@@ -278,7 +365,9 @@ public:
   size_t get_size() {
     return NumberedMsg::get_size() + sizeof(int32_t) + sizeof(int32_t)
         + sizeof(int32_t) + sizeof(size_t)
-        + sizeof(bool) + sizeof(int32_t) + sizeof(size_t);
+        + sizeof(bool) + sizeof(int32_t) + sizeof(size_t) + sizeof(bool)
+        + sizeof(OpLogCodec) + sizeof(double) + sizeof(RowPartitionerType)
+        + sizeof(int32_t);
   }
 
   int32_t &get_table_id() {
@@ -322,6 +411,48 @@ public:
         + sizeof(size_t) + sizeof(bool) + sizeof(int32_t)));
   }
 
+  bool &get_server_dense_storage() {
+    return *(reinterpret_cast<bool*>(
+        mem_.get_mem() + NumberedMsg::get_size()
+        + sizeof(int32_t) + sizeof(int32_t) + sizeof(int32_t)
+        + sizeof(size_t) + sizeof(bool) + sizeof(int32_t)
+        + sizeof(size_t)));
+  }
+
+  OpLogCodec &get_oplog_codec() {
+    return *(reinterpret_cast<OpLogCodec*>(
+        mem_.get_mem() + NumberedMsg::get_size()
+        + sizeof(int32_t) + sizeof(int32_t) + sizeof(int32_t)
+        + sizeof(size_t) + sizeof(bool) + sizeof(int32_t)
+        + sizeof(size_t) + sizeof(bool)));
+  }
+
+  double &get_oplog_topk_ratio() {
+    return *(reinterpret_cast<double*>(
+        mem_.get_mem() + NumberedMsg::get_size()
+        + sizeof(int32_t) + sizeof(int32_t) + sizeof(int32_t)
+        + sizeof(size_t) + sizeof(bool) + sizeof(int32_t)
+        + sizeof(size_t) + sizeof(bool) + sizeof(OpLogCodec)));
+  }
+
+  RowPartitionerType &get_row_partitioner() {
+    return *(reinterpret_cast<RowPartitionerType*>(
+        mem_.get_mem() + NumberedMsg::get_size()
+        + sizeof(int32_t) + sizeof(int32_t) + sizeof(int32_t)
+        + sizeof(size_t) + sizeof(bool) + sizeof(int32_t)
+        + sizeof(size_t) + sizeof(bool) + sizeof(OpLogCodec)
+        + sizeof(double)));
+  }
+
+  int32_t &get_row_partitioner_num_rows() {
+    return *(reinterpret_cast<int32_t*>(
+        mem_.get_mem() + NumberedMsg::get_size()
+        + sizeof(int32_t) + sizeof(int32_t) + sizeof(int32_t)
+        + sizeof(size_t) + sizeof(bool) + sizeof(int32_t)
+        + sizeof(size_t) + sizeof(bool) + sizeof(OpLogCodec)
+        + sizeof(double) + sizeof(RowPartitionerType)));
+  }
+
 protected:
   void InitMsg() {
     NumberedMsg::InitMsg();
@@ -770,6 +901,112 @@ protected:
   }
 };
 
+// Requests several rows of a table at once, from app thread to bg thread
+// and from bg thread to server. The row ids follow the header.
+struct BulkRowRequestMsg : public ArbitrarySizedMsg {
+public:
+  explicit BulkRowRequestMsg(int32_t num_rows) {
+    own_mem_ = true;
+    mem_.Alloc(get_header_size() + num_rows*sizeof(int32_t));
+    InitMsg(num_rows*sizeof(int32_t));
+    get_num_rows() = num_rows;
+  }
+
+  explicit BulkRowRequestMsg(void *msg):
+    ArbitrarySizedMsg(msg) {}
+
+  size_t get_header_size() {
+    return ArbitrarySizedMsg::get_header_size() + sizeof(int32_t)
+        + sizeof(int32_t) + sizeof(int32_t);
+  }
+
+  int32_t &get_table_id() {
+    return *(reinterpret_cast<int32_t*>(mem_.get_mem()
+      + ArbitrarySizedMsg::get_header_size()));
+  }
+
+  int32_t &get_clock() {
+    return *(reinterpret_cast<int32_t*>(mem_.get_mem()
+      + ArbitrarySizedMsg::get_header_size() + sizeof(int32_t)));
+  }
+
+  int32_t &get_num_rows() {
+    return *(reinterpret_cast<int32_t*>(mem_.get_mem()
+      + ArbitrarySizedMsg::get_header_size() + sizeof(int32_t)
+      + sizeof(int32_t)));
+  }
+
+  int32_t *get_row_ids() {
+    return reinterpret_cast<int32_t*>(mem_.get_mem() + get_header_size());
+  }
+
+  size_t get_size() {
+    return get_header_size() + get_avai_size();
+  }
+
+protected:
+  virtual void InitMsg(int32_t avai_size) {
+    ArbitrarySizedMsg::InitMsg(avai_size);
+    get_msg_type() = kBulkRowRequest;
+  }
+};
+
+// Server's reply to several row requests of one bg thread on one table.
+// Each row follows the header as its row id (int32_t), its serialized size
+// (size_t) and the serialized row, as in RecordBuff.
+struct ServerBulkRowRequestReplyMsg : public ArbitrarySizedMsg {
+public:
+  explicit ServerBulkRowRequestReplyMsg(int32_t avai_size) {
+    own_mem_ = true;
+    mem_.Alloc(get_header_size() + avai_size);
+    InitMsg(avai_size);
+  }
+
+  explicit ServerBulkRowRequestReplyMsg(void *msg):
+    ArbitrarySizedMsg(msg) {}
+
+  size_t get_header_size() {
+    return ArbitrarySizedMsg::get_header_size() + sizeof(int32_t)
+      + sizeof(int32_t) + sizeof(uint32_t) + sizeof(int32_t);
+  }
+
+  int32_t &get_table_id() {
+    return *(reinterpret_cast<int32_t*>(mem_.get_mem()
+      + ArbitrarySizedMsg::get_header_size()));
+  }
+
+  int32_t &get_clock() {
+    return *(reinterpret_cast<int32_t*>(mem_.get_mem()
+      + ArbitrarySizedMsg::get_header_size() + sizeof(int32_t)));
+  }
+
+  uint32_t &get_version() {
+    return *(reinterpret_cast<uint32_t*>(mem_.get_mem()
+      + ArbitrarySizedMsg::get_header_size() + sizeof(int32_t)
+      + sizeof(int32_t)));
+  }
+
+  int32_t &get_num_rows() {
+    return *(reinterpret_cast<int32_t*>(mem_.get_mem()
+      + ArbitrarySizedMsg::get_header_size() + sizeof(int32_t)
+      + sizeof(int32_t) + sizeof(uint32_t)));
+  }
+
+  void *get_row_data() {
+    return mem_.get_mem() + get_header_size();
+  }
+
+  size_t get_size() {
+    return get_header_size() + get_avai_size();
+  }
+
+protected:
+  virtual void InitMsg(int32_t avai_size) {
+    ArbitrarySizedMsg::InitMsg(avai_size);
+    get_msg_type() = kServerBulkRowRequestReply;
+  }
+};
+
 struct ClientSendOpLogMsg : public ArbitrarySizedMsg {
 public:
   explicit ClientSendOpLogMsg(int32_t avai_size) {
@@ -824,6 +1061,124 @@ protected:
   }
 };
 
+// OpLogs a bg thread sends to its oplog aggregator bg thread instead of
+// server_id. Fields other than server_id are those of ClientSendOpLogMsg
+// and data is in the same format.
+struct ClientAggrOpLogMsg : public ArbitrarySizedMsg {
+public:
+  explicit ClientAggrOpLogMsg(int32_t avai_size) {
+    own_mem_ = true;
+    mem_.Alloc(get_header_size() + avai_size);
+    InitMsg(avai_size);
+  }
+
+  explicit ClientAggrOpLogMsg(void *msg):
+    ArbitrarySizedMsg(msg) {}
+
+  size_t get_header_size() {
+    return ArbitrarySizedMsg::get_header_size() + sizeof(bool)
+        + sizeof(uint32_t) + sizeof(int32_t) + sizeof(int32_t);
+  }
+
+  bool &get_is_clock() {
+    return *(reinterpret_cast<bool*>(mem_.get_mem()
+      + ArbitrarySizedMsg::get_header_size()));
+  }
+
+  uint32_t &get_version() {
+    return *(reinterpret_cast<uint32_t*>(mem_.get_mem()
+      + ArbitrarySizedMsg::get_header_size() + sizeof(bool)));
+  }
+
+  int32_t &get_bg_clock() {
+    return *(reinterpret_cast<int32_t*>(mem_.get_mem()
+      + ArbitrarySizedMsg::get_header_size() + sizeof(bool)
+      + sizeof(uint32_t)));
+  }
+
+  int32_t &get_server_id() {
+    return *(reinterpret_cast<int32_t*>(mem_.get_mem()
+      + ArbitrarySizedMsg::get_header_size() + sizeof(bool)
+      + sizeof(uint32_t) + sizeof(int32_t)));
+  }
+
+  void *get_data() {
+    return mem_.get_mem() + get_header_size();
+  }
+
+  size_t get_size() {
+    return get_header_size() + get_avai_size();
+  }
+
+protected:
+  virtual void InitMsg(int32_t avai_size) {
+    ArbitrarySizedMsg::InitMsg(avai_size);
+    get_msg_type() = kClientAggrOpLog;
+  }
+};
+
+// Progress of one bg thread whose oplogs are combined in an
+// AggrSendOpLogMsg.
+struct AggrOpLogBgInfo {
+  int32_t bg_id;
+  // latest version the bg thread sent
+  uint32_t version;
+  // with is_clock set, the bg thread's clock advanced to bg_clock
+  int32_t bg_clock;
+  int32_t is_clock;
+};
+
+// OpLogs of several bg threads combined by an oplog aggregator bg thread.
+// The data starts with AggrOpLogBgInfo[num_bgs], followed by the oplogs in
+// the format of ClientSendOpLogMsg's data (empty if nothing was combined).
+struct AggrSendOpLogMsg : public ArbitrarySizedMsg {
+public:
+  explicit AggrSendOpLogMsg(int32_t avai_size) {
+    own_mem_ = true;
+    mem_.Alloc(get_header_size() + avai_size);
+    InitMsg(avai_size);
+  }
+
+  explicit AggrSendOpLogMsg(void *msg):
+    ArbitrarySizedMsg(msg) {}
+
+  size_t get_header_size() {
+    return ArbitrarySizedMsg::get_header_size() + sizeof(int32_t);
+  }
+
+  int32_t &get_num_bgs() {
+    return *(reinterpret_cast<int32_t*>(mem_.get_mem()
+      + ArbitrarySizedMsg::get_header_size()));
+  }
+
+  AggrOpLogBgInfo *get_bg_infos() {
+    return reinterpret_cast<AggrOpLogBgInfo*>(
+        mem_.get_mem() + get_header_size());
+  }
+
+  void *get_oplog_data() {
+    return mem_.get_mem() + get_header_size()
+        + get_num_bgs()*sizeof(AggrOpLogBgInfo);
+  }
+
+  size_t get_oplog_size() {
+    return get_avai_size() - get_num_bgs()*sizeof(AggrOpLogBgInfo);
+  }
+
+  size_t get_size() {
+    return get_header_size() + get_avai_size();
+  }
+
+protected:
+  virtual void InitMsg(int32_t avai_size) {
+    ArbitrarySizedMsg::InitMsg(avai_size);
+    get_msg_type() = kAggrSendOpLog;
+  }
+};
+
+// Rows a server pushes. One message (and its memory) is shared by all bg
+// threads subscribed to its rows, so the header carries the oplog version of
+// every client's bg thread; a bg thread reads its own by client id.
 struct ServerPushRowMsg : public ArbitrarySizedMsg {
 public:
   explicit ServerPushRowMsg(int32_t avai_size) {
@@ -837,7 +1192,7 @@ public:
 
   size_t get_header_size() {
     return ArbitrarySizedMsg::get_header_size() + sizeof(int32_t)
-        + sizeof(uint32_t) + sizeof(bool);
+        + sizeof(uint32_t)*GlobalContext::get_num_clients() + sizeof(bool);
   }
 
   int32_t &get_clock() {
@@ -845,15 +1200,19 @@ public:
       + ArbitrarySizedMsg::get_header_size()));
   }
 
-  uint32_t &get_version() {
-    return *(reinterpret_cast<uint32_t*>(mem_.get_mem()
-      + ArbitrarySizedMsg::get_header_size() + sizeof(int32_t)));
+  uint32_t *get_versions() {
+    return reinterpret_cast<uint32_t*>(mem_.get_mem()
+      + ArbitrarySizedMsg::get_header_size() + sizeof(int32_t));
+  }
+
+  uint32_t &get_version(int32_t client_id) {
+    return get_versions()[client_id];
   }
 
   bool &get_is_clock() {
     return *(reinterpret_cast<bool*>(mem_.get_mem()
       + ArbitrarySizedMsg::get_header_size() + sizeof(int32_t)
-      + sizeof(uint32_t) ));
+      + sizeof(uint32_t)*GlobalContext::get_num_clients()));
   }
 
   // data is to be accessed via SerializedRowReader
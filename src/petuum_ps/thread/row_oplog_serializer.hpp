@@ -2,10 +2,13 @@
 
 #include <memory>
 #include <vector>
+#include <unordered_map>
 #include <boost/noncopyable.hpp>
 #include <petuum_ps/thread/context.hpp>
 #include <petuum_ps_common/include/constants.hpp>
 #include <petuum_ps_common/oplog/abstract_row_oplog.hpp>
+#include <petuum_ps_common/oplog/oplog_codec.hpp>
+#include <petuum_ps_common/util/stats.hpp>
 #include <glog/logging.h>
 
 namespace petuum {
@@ -55,6 +58,22 @@ public:
     return sizeof(int32_t) + serialized_size;
   }
 
+  // Appends a row oplog that is already serialized, e.g. by an OpLogEncoder.
+  size_t AppendSerializedRowOpLog(int32_t row_id, const uint8_t *serialized,
+                                  size_t serialized_size) {
+    if (size_ + sizeof(int32_t) + serialized_size > capacity_)
+      return 0;
+
+    *(reinterpret_cast<int32_t*>(mem_ + size_)) = row_id;
+    size_ += sizeof(int32_t);
+
+    memcpy(mem_ + size_, serialized, serialized_size);
+    size_ += serialized_size;
+    ++num_row_oplogs_;
+
+    return sizeof(int32_t) + serialized_size;
+  }
+
   size_t get_size() const {
     return size_;
   }
@@ -78,19 +97,32 @@ private:
 
 class RowOpLogSerializer : boost::noncopyable {
 public:
+  // Row oplogs are encoded with oplog_codec unless it is NoCodec, in which
+  // case oplog_topk_ratio and update_size are not used.
   RowOpLogSerializer(bool dense_serialize,
-                     int32_t my_comm_channel_idx):
+                     int32_t table_id,
+                     int32_t my_comm_channel_idx,
+                     OpLogCodec oplog_codec,
+                     double oplog_topk_ratio,
+                     size_t update_size):
       dense_serialize_(dense_serialize),
-      my_comm_channel_idx_(my_comm_channel_idx) { }
+      table_id_(table_id),
+      my_comm_channel_idx_(my_comm_channel_idx) {
+    if (oplog_codec != NoCodec)
+      encoder_.reset(new OpLogEncoder(oplog_codec, oplog_topk_ratio,
+                                      dense_serialize, update_size));
+  }
 
   ~RowOpLogSerializer() {
     CHECK_EQ(buffer_map_.size(), 0);
   }
 
-  size_t AppendRowOpLog(int32_t row_id, AbstractRowOpLog *row_oplog) {
+  // Serializes row_oplog and resets it. With a lossy codec or top-k, what
+  // the server will not see is left in row_oplog (see OpLogEncoder).
+  size_t AppendRowOpLogAndReset(int32_t row_id, AbstractRowOpLog *row_oplog) {
 
     int32_t server_id = GlobalContext::GetPartitionServerID(
-        row_id, my_comm_channel_idx_);
+        table_id_, row_id, my_comm_channel_idx_);
 
     auto map_iter = buffer_map_.find(server_id);
 
@@ -102,6 +134,24 @@ public:
     }
 
     SerializedOpLogBuffer *buffer = map_iter->second.back();
+    if (encoder_) {
+      const uint8_t *encoded;
+      size_t encoded_size = encoder_->EncodeAndReset(row_oplog, &encoded);
+      STATS_BG_ADD_PER_CLOCK_OPLOG_CODEC_SAVED(encoder_->get_raw_size(),
+                                               encoded_size);
+
+      size_t serialized_size = buffer->AppendSerializedRowOpLog(
+          row_id, encoded, encoded_size);
+      if (serialized_size == 0) {
+        SerializedOpLogBuffer *new_buffer = new SerializedOpLogBuffer(dense_serialize_);
+        serialized_size = new_buffer->AppendSerializedRowOpLog(
+            row_id, encoded, encoded_size);
+        CHECK_GT(serialized_size, 0) << "row id = " << row_id;
+        map_iter->second.push_back(new_buffer);
+      }
+      return serialized_size;
+    }
+
     size_t serialized_size = buffer->AppendRowOpLog(row_id, row_oplog);
     if (serialized_size == 0) {
       SerializedOpLogBuffer *new_buffer = new SerializedOpLogBuffer(dense_serialize_);
@@ -109,6 +159,7 @@ public:
       CHECK_GT(serialized_size, 0) << "row id = " << row_id;
       map_iter->second.push_back(new_buffer);
     }
+    row_oplog->Reset();
     return serialized_size;
   }
 
@@ -153,7 +204,9 @@ public:
 
 private:
   const bool dense_serialize_;
+  const int32_t table_id_;
   const int32_t my_comm_channel_idx_;
+  std::unique_ptr<OpLogEncoder> encoder_;
   std::unordered_map<int32_t, std::vector<SerializedOpLogBuffer*> >
   buffer_map_;
 };
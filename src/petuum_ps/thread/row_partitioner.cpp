@@ -0,0 +1,67 @@
+#include <petuum_ps/thread/row_partitioner.hpp>
+
+#include <glog/logging.h>
+
+namespace petuum {
+
+RowPartitioner::RowPartitioner(int32_t table_id, const TableInfo &table_info,
+                               int32_t num_clients,
+                               int32_t num_comm_channels_per_client):
+    type_(table_info.row_partitioner),
+    table_id_(table_id),
+    table_seed_(Mix(static_cast<uint64_t>(table_id) + 1) << 32),
+    num_comm_channels_per_client_(num_comm_channels_per_client),
+    num_partitions_(num_clients * num_comm_channels_per_client),
+    num_rows_(table_info.row_partitioner_num_rows) {
+  CHECK_GT(num_partitions_, 0);
+  switch (type_) {
+    case ModuloPartitioner:
+      break;
+    case HashPartitioner:
+      BuildHashSlots();
+      break;
+    case RangePartitioner:
+      CHECK_GT(num_rows_, 0) << "table " << table_id << " uses "
+                             << "RangePartitioner but row_partitioner_num_rows"
+                             << " is not set";
+      break;
+    default:
+      LOG(FATAL) << "Unknown row partitioner = " << type_;
+  }
+}
+
+uint64_t RowPartitioner::Mix(uint64_t x) {
+  // splitmix64 finalizer
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+  return x ^ (x >> 31);
+}
+
+void RowPartitioner::BuildHashSlots() {
+  // The ring depends on the partitions only, so every client builds the
+  // same one.
+  std::vector<std::pair<uint64_t, int32_t> > ring;
+  ring.reserve(num_partitions_ * kNumVirtualNodes);
+  for (int32_t partition = 0; partition < num_partitions_; ++partition) {
+    for (int32_t vnode = 0; vnode < kNumVirtualNodes; ++vnode) {
+      uint64_t point = Mix((static_cast<uint64_t>(partition) << 32) | vnode);
+      ring.push_back(std::make_pair(point, partition));
+    }
+  }
+  std::sort(ring.begin(), ring.end());
+
+  // A slot covers the hashes [slot << shift, (slot + 1) << shift) and
+  // belongs to the first point at or after its start, wrapping around.
+  const int32_t shift = 64 - kNumHashSlotBits;
+  hash_slots_.resize(size_t(1) << kNumHashSlotBits);
+  size_t ring_idx = 0;
+  for (size_t slot = 0; slot < hash_slots_.size(); ++slot) {
+    uint64_t slot_begin = static_cast<uint64_t>(slot) << shift;
+    while (ring_idx < ring.size() && ring[ring_idx].first < slot_begin)
+      ++ring_idx;
+    hash_slots_[slot] = (ring_idx < ring.size()) ? ring[ring_idx].second
+                        : ring[0].second;
+  }
+}
+
+}  // namespace petuum
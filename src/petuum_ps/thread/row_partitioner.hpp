@@ -0,0 +1,91 @@
+#pragma once
+
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+#include <boost/noncopyable.hpp>
+#include <glog/logging.h>
+
+#include <petuum_ps_common/include/configs.hpp>
+
+namespace petuum {
+
+// Assigns the rows of a table to server threads. Server threads are numbered
+// partition = client_id * num_comm_channels_per_client + comm_channel_idx,
+// and a row goes to the bg thread and server thread of its partition's comm
+// channel.
+//
+// 1) ModuloPartitioner: partition = row_id % num_partitions, which keeps the
+// historical layout (and the server's dense storage stride).
+// 2) HashPartitioner: consistent hashing of (table_id, row_id), with
+// kNumVirtualNodes points per partition on the ring. The ring is resolved
+// into a table of kNumHashSlots slots at construction so that a lookup is
+// one hash and one load. Spreads tables with few or clustered row ids,
+// which modulo puts on the same few servers.
+// 3) RangePartitioner: row ids [0, num_rows) are cut into num_partitions
+// contiguous ranges of (nearly) equal length; row ids past the end go to the
+// last range, and negative row ids are an error. Suits tables whose row ids
+// are dense; a server thread's rows are contiguous, so it can still use
+// dense storage.
+//
+// Const and thus safe to share among threads once constructed.
+class RowPartitioner : boost::noncopyable {
+public:
+  RowPartitioner(int32_t table_id, const TableInfo &table_info,
+                 int32_t num_clients, int32_t num_comm_channels_per_client);
+
+  int32_t GetPartition(int32_t row_id) const {
+    switch (type_) {
+      case HashPartitioner:
+        return hash_slots_[HashRow(row_id) >> (64 - kNumHashSlotBits)];
+      case RangePartitioner:
+        {
+          CHECK_GE(row_id, 0) << "table " << table_id_ << " uses "
+                              << "RangePartitioner, which takes row ids >= 0";
+          int64_t clamped = std::min(row_id, num_rows_ - 1);
+          return clamped * num_partitions_ / num_rows_;
+        }
+      default:
+        return row_id % num_partitions_;
+    }
+  }
+
+  int32_t GetCommChannelIndex(int32_t row_id) const {
+    return GetPartition(row_id) % num_comm_channels_per_client_;
+  }
+
+  int32_t GetClientID(int32_t row_id) const {
+    return GetPartition(row_id) / num_comm_channels_per_client_;
+  }
+
+  // Smallest row id RangePartitioner assigns to partition.
+  static int32_t GetRangeBegin(int32_t partition, int32_t num_partitions,
+                               int32_t num_rows) {
+    return (static_cast<int64_t>(partition) * num_rows + num_partitions - 1)
+        / num_partitions;
+  }
+
+private:
+  static const int32_t kNumVirtualNodes = 128;
+  static const int32_t kNumHashSlotBits = 16;
+
+  static uint64_t Mix(uint64_t x);
+
+  uint64_t HashRow(int32_t row_id) const {
+    return Mix(table_seed_ ^ static_cast<uint32_t>(row_id));
+  }
+
+  void BuildHashSlots();
+
+  const RowPartitionerType type_;
+  const int32_t table_id_;
+  const uint64_t table_seed_;
+  const int32_t num_comm_channels_per_client_;
+  const int32_t num_partitions_;
+  const int32_t num_rows_;
+
+  // HashPartitioner only: partition of each hash slot
+  std::vector<int32_t> hash_slots_;
+};
+
+}  // namespace petuum
@@ -10,6 +10,10 @@ void SSPAggrBgWorker::SetWaitMsg() {
 
 void SSPAggrBgWorker::PrepareBeforeInfiniteLoop() {
   msg_send_timer_.restart();
+  if (GlobalContext::get_adaptive_bg_send()) {
+    send_control_.reset(new AdaptiveSendControl(server_ids_));
+    send_control_timer_.restart();
+  }
 }
 
 void SSPAggrBgWorker::FinalizeTableStats() {
@@ -24,6 +28,58 @@ long SSPAggrBgWorker::ResetBgIdleMilli() {
   return GlobalContext::get_bg_idle_milli();
 }
 
+double SSPAggrBgWorker::EstimateTransMillisec(size_t num_bytes) const {
+  if (send_control_)
+    return send_control_->EstimateTransMillisec(num_bytes);
+  return TransTimeEstimate::EstimateTransMillisec(num_bytes);
+}
+
+size_t SSPAggrBgWorker::GetOpLogPushUpperBoundBytes() const {
+  if (send_control_)
+    return send_control_->GetPushUpperBoundBytes();
+  return GlobalContext::get_oplog_push_upper_bound_kb()*k1_Ki;
+}
+
+void SSPAggrBgWorker::TrackOpLogMsgsSent() {
+  if (!send_control_)
+    return;
+  double now_sec = send_control_timer_.elapsed();
+  for (const auto &server_id : server_ids_) {
+    auto oplog_msg_iter = server_oplog_msg_map_.find(server_id);
+    size_t num_bytes = 0;
+    if (oplog_msg_iter != server_oplog_msg_map_.end()
+        && oplog_msg_iter->second != 0)
+      num_bytes = oplog_msg_iter->second->get_size();
+    send_control_->OpLogSent(server_id, version_, num_bytes, now_sec);
+  }
+}
+
+void SSPAggrBgWorker::HandleServerPushRow(int32_t sender_id, void *msg_mem) {
+  if (send_control_) {
+    ServerPushRowMsg server_push_row_msg(msg_mem);
+    // Pushed when the server clock advanced, which may have been long after
+    // our oplogs arrived; not a network sample.
+    send_control_->OpLogAcked(
+        sender_id,
+        server_push_row_msg.get_version(GlobalContext::get_client_id()),
+        send_control_timer_.elapsed(), false);
+  }
+  SSPPushBgWorker::HandleServerPushRow(sender_id, msg_mem);
+}
+
+void SSPAggrBgWorker::HandleServerOpLogAck(int32_t sender_id,
+                                           uint32_t version) {
+  SSPPushBgWorker::HandleServerOpLogAck(sender_id, version);
+  if (!send_control_)
+    return;
+  send_control_->OpLogAcked(sender_id, version,
+                            send_control_timer_.elapsed(), true);
+  STATS_BG_SEND_CONTROL_UPDATE(send_control_->GetBandwidthMbps(),
+                               send_control_->GetMinRttMilli(),
+                               send_control_->GetSmoothedRttMilli(),
+                               send_control_->GetPushUpperBoundBytes());
+}
+
 void SSPAggrBgWorker::ReadTableOpLogsIntoOpLogMeta(int32_t table_id,
                                                    ClientTable *table) {
   // Get OpLog index
@@ -106,8 +162,7 @@ size_t SSPAggrBgWorker::ReadTableOpLogMetaUpToClockNoReplay(
       AbstractRowOpLog* row_oplog = oplog_accessor.get_row_oplog();
       if (row_oplog != 0) {
         size_t serialized_oplog_size
-            = row_oplog_serializer->AppendRowOpLog(row_id, row_oplog);
-        row_oplog->Reset();
+            = row_oplog_serializer->AppendRowOpLogAndReset(row_id, row_oplog);
 
         MetaRowOpLog *meta_row_oplog = dynamic_cast<MetaRowOpLog*>(row_oplog);
         meta_row_oplog->InvalidateMeta();
@@ -146,8 +201,7 @@ size_t SSPAggrBgWorker::ReadTableOpLogMetaUpToClockNoReplay(
           bg_table_oplog, GetSerializedRowOpLogSize);
       accum_table_oplog_bytes += serialized_oplog_size;
 
-      if (accum_table_oplog_bytes
-          >= GlobalContext::get_oplog_push_upper_bound_kb()*k1_Ki)
+      if (accum_table_oplog_bytes >= GetOpLogPushUpperBoundBytes())
         break;
     }
 
@@ -178,8 +232,7 @@ size_t SSPAggrBgWorker::ReadTableOpLogMetaUpToCapacityNoReplay(
       AbstractRowOpLog* row_oplog = oplog_accessor.get_row_oplog();
       if (row_oplog != 0) {
         size_t serialized_oplog_size
-            = row_oplog_serializer->AppendRowOpLog(row_id, row_oplog);
-        row_oplog->Reset();
+            = row_oplog_serializer->AppendRowOpLogAndReset(row_id, row_oplog);
 
         MetaRowOpLog *meta_row_oplog = dynamic_cast<MetaRowOpLog*>(row_oplog);
         meta_row_oplog->InvalidateMeta();
@@ -187,8 +240,7 @@ size_t SSPAggrBgWorker::ReadTableOpLogMetaUpToCapacityNoReplay(
 
         accum_table_oplog_bytes += serialized_oplog_size;
 
-        if (accum_table_oplog_bytes
-            >= GlobalContext::get_oplog_push_upper_bound_kb()*k1_Ki)
+        if (accum_table_oplog_bytes >= GetOpLogPushUpperBoundBytes())
           break;
       }
       row_id = table_oplog_meta->GetAndClearNextInOrder();
@@ -247,7 +299,10 @@ void SSPAggrBgWorker::PrepareOpLogsNormalNoReplay(
   if (serializer_iter == row_oplog_serializer_map_.end()) {
     RowOpLogSerializer *row_oplog_serializer
         = new RowOpLogSerializer(table->oplog_dense_serialized(),
-                                 my_comm_channel_idx_);
+                                 table_id, my_comm_channel_idx_,
+                                 table->get_oplog_codec(),
+                                 table->get_oplog_topk_ratio(),
+                                 table->get_sample_row()->get_update_size());
     row_oplog_serializer_map_.insert(std::make_pair(table_id, row_oplog_serializer));
     serializer_iter = row_oplog_serializer_map_.find(table_id);
   }
@@ -327,11 +382,13 @@ long SSPAggrBgWorker::HandleClockMsg(bool clock_advanced) {
   BgOpLog *bg_oplog = PrepareOpLogsToSend(clock_to_push);
 
   CreateOpLogMsgs(bg_oplog);
+  TrackOpLogMsgsSent();
+  STATS_BG_SEND_OPLOG_BEGIN();
   size_t sent_size = SendOpLogMsgs(true);
+  STATS_BG_SEND_OPLOG_END();
   TrackBgOpLog(bg_oplog);
 
-  oplog_send_milli_sec_
-      = TransTimeEstimate::EstimateTransMillisec(sent_size);
+  oplog_send_milli_sec_ = EstimateTransMillisec(sent_size);
 
   msg_send_timer_.restart();
 
@@ -415,7 +472,10 @@ void SSPAggrBgWorker::PrepareBgIdleOpLogsNormalNoReplay(int32_t table_id,
   if (serializer_iter == row_oplog_serializer_map_.end()) {
     RowOpLogSerializer *row_oplog_serializer
         = new RowOpLogSerializer(table->oplog_dense_serialized(),
-                                 my_comm_channel_idx_);
+                                 table_id, my_comm_channel_idx_,
+                                 table->get_oplog_codec(),
+                                 table->get_oplog_topk_ratio(),
+                                 table->get_sample_row()->get_update_size());
     row_oplog_serializer_map_.insert(std::make_pair(table_id, row_oplog_serializer));
     serializer_iter = row_oplog_serializer_map_.find(table_id);
   }
@@ -482,11 +542,13 @@ long SSPAggrBgWorker::BgIdleWork() {
   BgOpLog *bg_oplog = PrepareBgIdleOpLogs();
 
   CreateOpLogMsgs(bg_oplog);
+  TrackOpLogMsgsSent();
+  STATS_BG_SEND_OPLOG_BEGIN();
   size_t sent_size = SendOpLogMsgs(false);
+  STATS_BG_SEND_OPLOG_END();
   TrackBgOpLog(bg_oplog);
 
-  oplog_send_milli_sec_
-      = TransTimeEstimate::EstimateTransMillisec(sent_size);
+  oplog_send_milli_sec_ = EstimateTransMillisec(sent_size);
 
   msg_send_timer_.restart();
 
@@ -5,7 +5,9 @@
 #include <petuum_ps/thread/ssp_push_bg_worker.hpp>
 #include <petuum_ps/thread/oplog_meta.hpp>
 #include <petuum_ps/thread/bg_oplog_partition.hpp>
+#include <petuum_ps/thread/adaptive_send_control.hpp>
 #include <petuum_ps_common/util/high_resolution_timer.hpp>
+#include <memory>
 
 namespace petuum {
 
@@ -25,7 +27,8 @@ public:
                       system_clock_mtx,
                       system_clock_cv,
                       bg_server_clock),
-      min_table_staleness_(INT_MAX) { }
+      min_table_staleness_(INT_MAX),
+      oplog_send_milli_sec_(0) { }
 
   ~SSPAggrBgWorker() { }
 
@@ -36,6 +39,15 @@ protected:
   virtual long ResetBgIdleMilli();
   virtual long BgIdleWork();
   virtual long HandleClockMsg(bool clock_advanced);
+  virtual void HandleServerPushRow(int32_t sender_id, void *msg_mem);
+  virtual void HandleServerOpLogAck(int32_t sender_id, uint32_t version);
+
+  // Send pacing and idle push size, adaptive or from the config.
+  double EstimateTransMillisec(size_t num_bytes) const;
+  size_t GetOpLogPushUpperBoundBytes() const;
+  // Tells send_control_ about the oplog msgs CreateOpLogMsgs() created,
+  // before SendOpLogMsgs() sends and frees them.
+  void TrackOpLogMsgsSent();
 
   void ReadTableOpLogsIntoOpLogMeta(int32_t table_id,
                                     ClientTable *table);
@@ -95,6 +107,10 @@ protected:
   OpLogMeta oplog_meta_;
   HighResolutionTimer msg_send_timer_;
   double oplog_send_milli_sec_;
+
+  // Only with GlobalContext::get_adaptive_bg_send().
+  std::unique_ptr<AdaptiveSendControl> send_control_;
+  HighResolutionTimer send_control_timer_;
 };
 
 }
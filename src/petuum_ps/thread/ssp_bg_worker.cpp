@@ -174,7 +174,10 @@ void SSPBgWorker::PrepareOpLogsNormalNoReplay(
   if (serializer_iter == row_oplog_serializer_map_.end()) {
     RowOpLogSerializer *row_oplog_serializer
         = new RowOpLogSerializer(table->oplog_dense_serialized(),
-                                 my_comm_channel_idx_);
+                                 table_id, my_comm_channel_idx_,
+                                 table->get_oplog_codec(),
+                                 table->get_oplog_topk_ratio(),
+                                 table->get_sample_row()->get_update_size());
     row_oplog_serializer_map_.insert(std::make_pair(table_id, row_oplog_serializer));
     serializer_iter = row_oplog_serializer_map_.find(table_id);
   }
@@ -197,8 +200,7 @@ void SSPBgWorker::PrepareOpLogsNormalNoReplay(
 
     if (found && (row_oplog == 0)) continue;
 
-    row_oplog_serializer->AppendRowOpLog(row_id, row_oplog);
-    row_oplog->Reset();
+    row_oplog_serializer->AppendRowOpLogAndReset(row_id, row_oplog);
   }
 
   for (const auto &server_id : server_ids_) {
@@ -216,7 +218,10 @@ void SSPBgWorker::PrepareOpLogsAppendOnlyNoReplay(
   if (serializer_iter == row_oplog_serializer_map_.end()) {
     RowOpLogSerializer *row_oplog_serializer
         = new RowOpLogSerializer(table->oplog_dense_serialized(),
-                                 my_comm_channel_idx_);
+                                 table_id, my_comm_channel_idx_,
+                                 table->get_oplog_codec(),
+                                 table->get_oplog_topk_ratio(),
+                                 table->get_sample_row()->get_update_size());
     row_oplog_serializer_map_.insert(std::make_pair(table_id, row_oplog_serializer));
     serializer_iter = row_oplog_serializer_map_.find(table_id);
   }
@@ -231,8 +236,7 @@ void SSPBgWorker::PrepareOpLogsAppendOnlyNoReplay(
     AbstractRowOpLog *row_oplog
         = append_only_row_oplog_buffer->InitReadOpLog(&row_id);
     while (row_oplog != 0) {
-      row_oplog_serializer->AppendRowOpLog(row_id, row_oplog);
-      row_oplog->Reset();
+      row_oplog_serializer->AppendRowOpLogAndReset(row_id, row_oplog);
 
       row_oplog = append_only_row_oplog_buffer->NextReadOpLog(&row_id);
     }
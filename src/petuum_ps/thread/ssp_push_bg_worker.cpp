@@ -11,7 +11,8 @@ void SSPPushBgWorker::CreateRowRequestOpLogMgr() {
 
 void SSPPushBgWorker::HandleServerPushRow(int32_t sender_id, void *msg_mem) {
   ServerPushRowMsg server_push_row_msg(msg_mem);
-  uint32_t version = server_push_row_msg.get_version();
+  uint32_t version = server_push_row_msg.get_version(
+      GlobalContext::get_client_id());
   row_request_oplog_mgr_->ServerAcknowledgeVersion(sender_id, version);
 
   bool is_clock = server_push_row_msg.get_is_clock();
@@ -7,6 +7,7 @@
 #include <petuum_ps_common/client/client_row.hpp>
 
 #include <libcuckoo/cuckoohash_map.hh>
+#include <vector>
 
 namespace petuum {
 
@@ -33,6 +34,8 @@ public:
   virtual void FlushThreadCache() = 0;
 
   virtual ClientRow *Get(int32_t row_id, RowAccessor *row_accessor) = 0;
+  virtual void GetBatch(const std::vector<int32_t> &row_ids,
+                        RowAccessor *row_accessors) = 0;
   virtual void Inc(int32_t row_id, int32_t column_id, const void *update) = 0;
   virtual void BatchInc(int32_t row_id, const int32_t* column_ids,
                         const void* updates,
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <petuum_ps_common/include/abstract_row.hpp>
+#include <petuum_ps_common/client/client_row.hpp>
+
+#include <cstdint>
+#include <atomic>
+
+namespace petuum {
+
+// ClientRow of a LocalOOC table. A row is clean if it equals its copy in the
+// OOCRowStore, or if it has no copy and is empty; only dirty rows are
+// written back on eviction.
+class OOCClientRow : public ClientRow {
+public:
+  // OOCClientRow takes ownership of row_data. Rows are always reference
+  // counted, as they are evicted to disk.
+  explicit OOCClientRow(AbstractRow* row_data):
+      ClientRow(0, row_data, true),
+      dirty_(false) { }
+
+  // Called before updating the row and while holding a reference to it, so
+  // that eviction, which waits for the reference count to drop to 0, sees
+  // the flag.
+  void MarkDirty() {
+    if (!dirty_.load(std::memory_order_relaxed))
+      dirty_.store(true);
+  }
+
+  bool IsDirty() const {
+    return dirty_.load();
+  }
+
+private:
+  std::atomic<bool> dirty_;
+};
+
+}  // namespace petuum
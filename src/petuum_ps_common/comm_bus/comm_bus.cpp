@@ -1,6 +1,7 @@
 // author: jinliang
 
 #include <stdlib.h>
+#include <string.h>
 #include <glog/logging.h>
 #include <sstream>
 #include <string>
@@ -39,6 +40,10 @@ CommBus::CommBus(int32_t e_st, int32_t e_end, int32_t num_clients,
   e_st_ = e_st;
   e_end_ = e_end;
 
+  mailboxes_.reset(new std::atomic<InProcMailbox*>[e_end - e_st + 1]);
+  for (int32_t i = 0; i < e_end - e_st + 1; ++i)
+    mailboxes_[i].store(0, std::memory_order_relaxed);
+
   try {
     zmq_ctx_ = new zmq::context_t(num_zmq_thrs);
   } catch(zmq::error_t &e) {
@@ -62,6 +67,8 @@ CommBus::CommBus(int32_t e_st, int32_t e_end, int32_t num_clients,
 
 CommBus::~CommBus() {
   delete zmq_ctx_;
+  for (int32_t i = 0; i < e_end_ - e_st_ + 1; ++i)
+    delete mailboxes_[i].load(std::memory_order_relaxed);
 }
 
 void CommBus::SetUpRouterSocket(zmq::socket_t *sock, int32_t id,
@@ -99,7 +106,21 @@ void CommBus::ThreadRegister(const Config &config) {
   thr_info_->num_bytes_interproc_recv_buff_ =
     config.num_bytes_interproc_recv_buff_;
 
-  if (config.ltype_ & kInProc) {
+  if (config.inproc_transport_ == kRingTransport) {
+    CHECK(IsLocalEntity(config.entity_id_));
+    std::atomic<InProcMailbox*> &mailbox
+        = mailboxes_[config.entity_id_ - e_st_];
+    if (mailbox.load(std::memory_order_acquire) == 0) {
+      mailbox.store(new InProcMailbox(e_end_ - e_st_ + 1),
+                    std::memory_order_release);
+    }
+    thr_info_->mailbox_ = mailbox.load(std::memory_order_relaxed);
+  }
+
+  // Ring threads create their inproc socket in ConnectTo() if they talk to
+  // zmq threads.
+  if ((config.ltype_ & kInProc)
+      && config.inproc_transport_ != kRingTransport) {
     try {
       thr_info_->inproc_sock_.reset(new zmq::socket_t(*zmq_ctx_, ZMQ_ROUTER));
     } catch(...) {
@@ -146,6 +167,17 @@ void CommBus::ThreadDeregister() {
 void CommBus::ConnectTo(int32_t entity_id, void *connect_msg, size_t size) {
   CHECK(IsLocalEntity(entity_id)) << "Not local entity " << entity_id;
 
+  InProcMailbox *mailbox = GetMailbox(entity_id);
+  if (mailbox != NULL) {
+    // A zmq thread would be replied to through a socket it is not connected
+    // to.
+    CHECK(thr_info_->mailbox_ != NULL) << "Entity " << thr_info_->entity_id_
+                                       << " connects to ring thread "
+                                       << entity_id << " over zmq";
+    SendRing(mailbox, entity_id, connect_msg, size);
+    return;
+  }
+
   zmq::socket_t *sock = thr_info_->inproc_sock_.get();
   if (sock == NULL) {
     try {
@@ -191,6 +223,10 @@ void CommBus::ConnectTo(int32_t entity_id, const std::string &network_addr,
 }
 
 size_t CommBus::Send(int32_t entity_id, const void *data, size_t len) {
+  InProcMailbox *mailbox = GetMailbox(entity_id);
+  if (mailbox != NULL)
+    return SendRing(mailbox, entity_id, data, len);
+
   zmq::socket_t *sock;
 
   if (IsLocalEntity(entity_id)) {
@@ -206,6 +242,10 @@ size_t CommBus::Send(int32_t entity_id, const void *data, size_t len) {
 }
 
 size_t CommBus::SendInProc(int32_t entity_id, const void *data, size_t len) {
+  InProcMailbox *mailbox = GetMailbox(entity_id);
+  if (mailbox != NULL)
+    return SendRing(mailbox, entity_id, data, len);
+
   zmq::socket_t *sock = thr_info_->inproc_sock_.get();
 
   int32_t recv_id = ZMQUtil::EntityID2ZmqID(entity_id);
@@ -224,6 +264,10 @@ size_t CommBus::SendInterProc(int32_t entity_id, const void *data, size_t len) {
 }
 
 size_t CommBus::Send(int32_t entity_id, zmq::message_t &msg) {
+  InProcMailbox *mailbox = GetMailbox(entity_id);
+  if (mailbox != NULL)
+    return SendRing(mailbox, entity_id, msg);
+
   zmq::socket_t *sock;
 
   if (IsLocalEntity(entity_id)) {
@@ -239,6 +283,10 @@ size_t CommBus::Send(int32_t entity_id, zmq::message_t &msg) {
 }
 
 size_t CommBus::SendInProc(int32_t entity_id, zmq::message_t &msg) {
+  InProcMailbox *mailbox = GetMailbox(entity_id);
+  if (mailbox != NULL)
+    return SendRing(mailbox, entity_id, msg);
+
   zmq::socket_t *sock = thr_info_->inproc_sock_.get();
 
   int32_t recv_id = ZMQUtil::EntityID2ZmqID(entity_id);
@@ -247,8 +295,25 @@ size_t CommBus::SendInProc(int32_t entity_id, zmq::message_t &msg) {
   return nbytes;
 }
 
+size_t CommBus::SendInterProc(int32_t entity_id, zmq::message_t &msg) {
+  zmq::socket_t *sock = thr_info_->interproc_sock_.get();
+
+  int32_t recv_id = ZMQUtil::EntityID2ZmqID(entity_id);
+  size_t nbytes = ZMQUtil::ZMQSend(sock, recv_id, msg, 0);
+
+  return nbytes;
+}
+
 
 void CommBus::Recv(int32_t *entity_id, zmq::message_t *msg) {
+  if (thr_info_->mailbox_ != NULL) {
+    if (thr_info_->interproc_sock_.get() == NULL)
+      thr_info_->mailbox_->Recv(entity_id, msg, -1);
+    else
+      RecvRingOrInterProc(entity_id, msg, -1);
+    return;
+  }
+
   if (thr_info_->pollitems_.get() == NULL) {
     thr_info_->pollitems_.reset(new zmq::pollitem_t[2]);
     thr_info_->pollitems_[0].socket = *(thr_info_->inproc_sock_);
@@ -271,6 +336,13 @@ void CommBus::Recv(int32_t *entity_id, zmq::message_t *msg) {
 }
 
 bool CommBus::RecvAsync(int32_t *entity_id, zmq::message_t *msg) {
+  if (thr_info_->mailbox_ != NULL) {
+    if (thr_info_->mailbox_->TryRecv(entity_id, msg))
+      return true;
+    return (thr_info_->interproc_sock_.get() != NULL)
+        && RecvInterProcAsync(entity_id, msg);
+  }
+
   if (thr_info_->pollitems_.get() == NULL) {
     thr_info_->pollitems_.reset(new zmq::pollitem_t[2]);
     thr_info_->pollitems_[0].socket = *(thr_info_->inproc_sock_);
@@ -297,6 +369,12 @@ bool CommBus::RecvAsync(int32_t *entity_id, zmq::message_t *msg) {
 
 bool CommBus::RecvTimeOut(int32_t *entity_id, zmq::message_t *msg,
     long timeout_milli) {
+  if (thr_info_->mailbox_ != NULL) {
+    if (thr_info_->interproc_sock_.get() == NULL)
+      return thr_info_->mailbox_->Recv(entity_id, msg, timeout_milli);
+    return RecvRingOrInterProc(entity_id, msg, timeout_milli);
+  }
+
   if (thr_info_->pollitems_.get() == NULL) {
     thr_info_->pollitems_.reset(new zmq::pollitem_t[2]);
     thr_info_->pollitems_[0].socket = *(thr_info_->inproc_sock_);
@@ -322,12 +400,20 @@ bool CommBus::RecvTimeOut(int32_t *entity_id, zmq::message_t *msg,
 }
 
 void CommBus::RecvInProc(int32_t *entity_id, zmq::message_t *msg) {
+  if (thr_info_->mailbox_ != NULL) {
+    thr_info_->mailbox_->Recv(entity_id, msg, -1);
+    return;
+  }
+
   int32_t sender_id;
   ZMQUtil::ZMQRecv(thr_info_->inproc_sock_.get(), &sender_id, msg);
   *entity_id = ZMQUtil::ZmqID2EntityID(sender_id);
 }
 
 bool CommBus::RecvInProcAsync(int32_t *entity_id, zmq::message_t *msg) {
+  if (thr_info_->mailbox_ != NULL)
+    return thr_info_->mailbox_->TryRecv(entity_id, msg);
+
   int32_t sender_id;
   bool recved = ZMQUtil::ZMQRecvAsync(thr_info_->inproc_sock_.get(),
       &sender_id, msg);
@@ -340,6 +426,9 @@ bool CommBus::RecvInProcAsync(int32_t *entity_id, zmq::message_t *msg) {
 
 bool CommBus::RecvInProcTimeOut(int32_t *entity_id, zmq::message_t *msg,
     long timeout_milli) {
+  if (thr_info_->mailbox_ != NULL)
+    return thr_info_->mailbox_->Recv(entity_id, msg, timeout_milli);
+
   if (thr_info_->inproc_pollitem_.get() == NULL) {
     thr_info_->inproc_pollitem_.reset(new zmq::pollitem_t);
     thr_info_->inproc_pollitem_->socket = *(thr_info_->inproc_sock_);
@@ -399,4 +488,65 @@ bool CommBus::RecvInterProcTimeOut(int32_t *entity_id, zmq::message_t *msg,
   return true;
 }
 
+InProcMailbox *CommBus::GetMailbox(int32_t entity_id) {
+  if (!IsLocalEntity(entity_id))
+    return NULL;
+  return mailboxes_[entity_id - e_st_].load(std::memory_order_acquire);
+}
+
+size_t CommBus::SendRing(InProcMailbox *mailbox, int32_t entity_id,
+                         zmq::message_t &msg) {
+  SPSCMsgQueue *&queue = thr_info_->ring_queues_[entity_id];
+  if (queue == NULL)
+    queue = mailbox->GetQueue(thr_info_->entity_id_);
+
+  size_t nbytes = msg.size();
+  queue->Push(&msg);
+  mailbox->Notify();
+  return nbytes;
+}
+
+size_t CommBus::SendRing(InProcMailbox *mailbox, int32_t entity_id,
+                         const void *data, size_t len) {
+  zmq::message_t msg(len);
+  memcpy(msg.data(), data, len);
+  return SendRing(mailbox, entity_id, msg);
+}
+
+bool CommBus::RecvRingOrInterProc(int32_t *entity_id, zmq::message_t *msg,
+                                  long timeout_milli) {
+  InProcMailbox *mailbox = thr_info_->mailbox_;
+  if (thr_info_->ring_pollitems_.get() == NULL) {
+    thr_info_->ring_pollitems_.reset(new zmq::pollitem_t[2]);
+    thr_info_->ring_pollitems_[0].socket = *(thr_info_->interproc_sock_);
+    thr_info_->ring_pollitems_[0].events = ZMQ_POLLIN;
+    thr_info_->ring_pollitems_[1].socket = NULL;
+    thr_info_->ring_pollitems_[1].fd = mailbox->get_event_fd();
+    thr_info_->ring_pollitems_[1].events = ZMQ_POLLIN;
+  }
+
+  do {
+    if (mailbox->TryRecv(entity_id, msg))
+      return true;
+
+    mailbox->BeginFdWait();
+    if (mailbox->TryRecv(entity_id, msg)) {
+      mailbox->EndFdWait();
+      return true;
+    }
+    zmq::poll(thr_info_->ring_pollitems_.get(), 2, timeout_milli);
+    mailbox->EndFdWait();
+
+    if (mailbox->TryRecv(entity_id, msg))
+      return true;
+    if (thr_info_->ring_pollitems_[0].revents) {
+      RecvInterProc(entity_id, msg);
+      return true;
+    }
+    // A wakeup left over from an earlier message; callers treat a timeout
+    // as spurious anyway.
+  } while (timeout_milli < 0);
+  return false;
+}
+
 }   // namespace petuum
@@ -3,9 +3,12 @@
 #pragma once
 
 #include <petuum_ps_common/comm_bus/zmq_util.hpp>
+#include <petuum_ps_common/comm_bus/inproc_mailbox.hpp>
 #include <zmq.hpp>
+#include <atomic>
 #include <string>
 #include <utility>
+#include <unordered_map>
 #include <boost/thread/tss.hpp>
 #include <boost/scoped_ptr.hpp>
 #include <boost/scoped_array.hpp>
@@ -25,6 +28,11 @@ namespace petuum {
  * Each thread is an entity and should only register (ThreadRegister) once.
  * A thread is local if it is in the same CommBus object as myself, otherwise it
  * is remote.
+ * A thread registered with inproc_transport_ = kRingTransport receives its
+ * in-process messages through an InProcMailbox (lock-free SPSC queues and a
+ * futex) instead of a zmq inproc socket. Any local thread may send to it; a
+ * ring thread may only connect to other ring threads, or to zmq threads that
+ * it sends to through its own (lazily created) inproc socket.
  */
 
 class CommBus : boost::noncopyable {
@@ -33,6 +41,10 @@ public:
   static const int kInProc = 1;
   static const int kInterProc = 2;
 
+  // In-process transport of a thread.
+  static const int kZmqTransport = 0;
+  static const int kRingTransport = 1;
+
   struct Config : boost::noncopyable {
   public:
     // My thread id.
@@ -50,13 +62,17 @@ public:
     int num_bytes_interproc_send_buff_;
     int num_bytes_interproc_recv_buff_;
 
+    // How in-process messages reach me: kZmqTransport or kRingTransport.
+    int inproc_transport_;
+
     Config():
       entity_id_(0),
       ltype_(kNone),
       num_bytes_inproc_send_buff_(0),
       num_bytes_inproc_recv_buff_(0),
       num_bytes_interproc_send_buff_(0),
-      num_bytes_interproc_recv_buff_(0) { }
+      num_bytes_interproc_recv_buff_(0),
+      inproc_transport_(kZmqTransport) { }
 
     Config(int32_t entity_id, int ltype, std::string network_addr):
       entity_id_(entity_id),
@@ -65,7 +81,8 @@ public:
       num_bytes_inproc_send_buff_(0),
       num_bytes_inproc_recv_buff_(0),
       num_bytes_interproc_send_buff_(0),
-      num_bytes_interproc_recv_buff_(0) { }
+      num_bytes_interproc_recv_buff_(0),
+      inproc_transport_(kZmqTransport) { }
   };
 
   struct ThreadCommInfo : boost::noncopyable {
@@ -85,7 +102,15 @@ public:
     int num_bytes_interproc_send_buff_;
     int num_bytes_interproc_recv_buff_;
 
-    ThreadCommInfo() { }
+    // Set if I registered with kRingTransport; owned by CommBus.
+    InProcMailbox *mailbox_;
+    // Interproc socket and mailbox_'s event fd, for waiting on both.
+    boost::scoped_array<zmq::pollitem_t> ring_pollitems_;
+    // My queue in each ring thread's mailbox I have sent to.
+    std::unordered_map<int32_t, SPSCMsgQueue*> ring_queues_;
+
+    ThreadCommInfo():
+      mailbox_(0) { }
   };
 
   bool IsLocalEntity(int32_t entity_id);
@@ -121,6 +146,7 @@ public:
   // msg is nollified
   size_t Send(int32_t entity_id, zmq::message_t &msg);
   size_t SendInProc(int32_t entity_id, zmq::message_t &msg);
+  size_t SendInterProc(int32_t entity_id, zmq::message_t &msg);
 
   void Recv(int32_t *entity_id, zmq::message_t *msg);
   bool RecvAsync(int32_t *entity_id, zmq::message_t *msg);
@@ -162,12 +188,27 @@ private:
 
   static void SetUpRouterSocket(zmq::socket_t *sock, int32_t id,
     int num_bytes_send_buff, int num_bytes_recv_buff);
+
+  // Mailbox of entity_id if it is a local ring thread, NULL otherwise.
+  InProcMailbox *GetMailbox(int32_t entity_id);
+  size_t SendRing(InProcMailbox *mailbox, int32_t entity_id,
+                  zmq::message_t &msg);
+  size_t SendRing(InProcMailbox *mailbox, int32_t entity_id,
+                  const void *data, size_t len);
+  // For ring threads with an interproc socket; waits forever if
+  // timeout_milli is negative.
+  bool RecvRingOrInterProc(int32_t *entity_id, zmq::message_t *msg,
+                           long timeout_milli);
+
   static const std::string kInProcPrefix;
   static const std::string kInterProcPrefix;
   zmq::context_t *zmq_ctx_;
   // denote the range of entity IDs that are local, inclusive
   int32_t e_st_;
   int32_t e_end_;
+  // Indexed by entity_id - e_st_; set when a ring thread registers and kept
+  // until destruction, as other threads hold queues in it.
+  boost::scoped_array<std::atomic<InProcMailbox*> > mailboxes_;
   boost::thread_specific_ptr<ThreadCommInfo> thr_info_;
 };
 }   // namespace petuum
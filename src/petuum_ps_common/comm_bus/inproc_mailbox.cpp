@@ -0,0 +1,216 @@
+#include <petuum_ps_common/comm_bus/inproc_mailbox.hpp>
+
+#include <glog/logging.h>
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+namespace petuum {
+
+namespace {
+
+void FutexWait(std::atomic<uint32_t> *addr, uint32_t val, long timeout_milli) {
+  timespec timeout;
+  timespec *timeout_ptr = 0;
+  if (timeout_milli >= 0) {
+    timeout.tv_sec = timeout_milli / 1000;
+    timeout.tv_nsec = (timeout_milli % 1000) * 1000000;
+    timeout_ptr = &timeout;
+  }
+  int ret = syscall(SYS_futex, reinterpret_cast<uint32_t*>(addr),
+                    FUTEX_WAIT_PRIVATE, val, timeout_ptr, 0, 0);
+  CHECK(ret == 0 || errno == EAGAIN || errno == EINTR || errno == ETIMEDOUT)
+      << "futex wait failed: " << strerror(errno);
+}
+
+void FutexWake(std::atomic<uint32_t> *addr) {
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(addr), FUTEX_WAKE_PRIVATE,
+          1, 0, 0, 0);
+}
+
+int64_t NowMilli() {
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return int64_t(now.tv_sec) * 1000 + now.tv_nsec / 1000000;
+}
+
+}  // anonymous namespace
+
+SPSCMsgQueue::Segment::Segment(size_t capacity):
+    mask(capacity - 1),
+    slots(new zmq::message_t[capacity]),
+    next(0),
+    head(0),
+    tail(0) {
+  CHECK_EQ(capacity & mask, 0) << "capacity must be a power of 2";
+}
+
+SPSCMsgQueue::SPSCMsgQueue(int32_t sender_id, size_t init_capacity):
+    sender_id_(sender_id),
+    producer_seg_(new Segment(init_capacity)),
+    consumer_seg_(producer_seg_) { }
+
+SPSCMsgQueue::~SPSCMsgQueue() {
+  Segment *seg = consumer_seg_;
+  while (seg != 0) {
+    Segment *next = seg->next.load(std::memory_order_acquire);
+    delete seg;
+    seg = next;
+  }
+}
+
+void SPSCMsgQueue::Push(zmq::message_t *msg) {
+  Segment *seg = producer_seg_;
+  size_t tail = seg->tail.load(std::memory_order_relaxed);
+  if (tail - seg->head.load(std::memory_order_acquire) > seg->mask) {
+    Segment *new_seg = new Segment((seg->mask + 1) * 2);
+    seg->next.store(new_seg, std::memory_order_release);
+    producer_seg_ = seg = new_seg;
+    tail = 0;
+  }
+  seg->slots[tail & seg->mask].move(msg);
+  seg->tail.store(tail + 1, std::memory_order_release);
+}
+
+bool SPSCMsgQueue::Pop(zmq::message_t *msg) {
+  while (true) {
+    Segment *seg = consumer_seg_;
+    size_t head = seg->head.load(std::memory_order_relaxed);
+    if (head != seg->tail.load(std::memory_order_acquire)) {
+      msg->move(&(seg->slots[head & seg->mask]));
+      seg->head.store(head + 1, std::memory_order_release);
+      return true;
+    }
+
+    Segment *next = seg->next.load(std::memory_order_acquire);
+    if (next == 0)
+      return false;
+    // The producer no longer pushes to seg, but may have pushed more before
+    // linking next.
+    if (head != seg->tail.load(std::memory_order_acquire))
+      continue;
+    consumer_seg_ = next;
+    delete seg;
+  }
+}
+
+InProcMailbox::InProcMailbox(int32_t max_num_senders):
+    max_num_senders_(max_num_senders),
+    seq_(0),
+    waiting_(kNotWaiting),
+    event_fd_(-1),
+    queues_(new std::atomic<SPSCMsgQueue*>[max_num_senders]),
+    num_queues_(0),
+    next_queue_(0) {
+  for (int32_t i = 0; i < max_num_senders; ++i)
+    queues_[i].store(0, std::memory_order_relaxed);
+}
+
+InProcMailbox::~InProcMailbox() {
+  int32_t num_queues = num_queues_.load(std::memory_order_acquire);
+  for (int32_t i = 0; i < num_queues; ++i)
+    delete queues_[i].load(std::memory_order_relaxed);
+  if (event_fd_ >= 0)
+    close(event_fd_);
+}
+
+SPSCMsgQueue *InProcMailbox::GetQueue(int32_t sender_id) {
+  std::lock_guard<std::mutex> lock(queues_mtx_);
+  auto idx_iter = queue_idx_.find(sender_id);
+  if (idx_iter != queue_idx_.end())
+    return queues_[idx_iter->second].load(std::memory_order_relaxed);
+
+  int32_t idx = num_queues_.load(std::memory_order_relaxed);
+  CHECK_LT(idx, max_num_senders_) << "too many senders";
+  SPSCMsgQueue *queue = new SPSCMsgQueue(sender_id, kInitQueueCapacity);
+  queues_[idx].store(queue, std::memory_order_release);
+  num_queues_.store(idx + 1, std::memory_order_release);
+  queue_idx_[sender_id] = idx;
+  return queue;
+}
+
+void InProcMailbox::Notify() {
+  // Pairs with the fence in Recv() and BeginFdWait(): either the owner sees
+  // the message before sleeping, or we see it waiting.
+  seq_.fetch_add(1, std::memory_order_seq_cst);
+  int32_t waiting = waiting_.load(std::memory_order_seq_cst);
+  if (waiting == kFutexWaiting) {
+    FutexWake(&seq_);
+  } else if (waiting == kFdWaiting) {
+    uint64_t one = 1;
+    ssize_t ret = write(event_fd_, &one, sizeof(one));
+    CHECK(ret == sizeof(one) || errno == EAGAIN)
+        << "eventfd write failed: " << strerror(errno);
+  }
+}
+
+bool InProcMailbox::TryRecv(int32_t *sender_id, zmq::message_t *msg) {
+  int32_t num_queues = num_queues_.load(std::memory_order_acquire);
+  for (int32_t i = 0; i < num_queues; ++i) {
+    int32_t idx = (next_queue_ + i) % num_queues;
+    SPSCMsgQueue *queue = queues_[idx].load(std::memory_order_acquire);
+    if (queue->Pop(msg)) {
+      *sender_id = queue->get_sender_id();
+      next_queue_ = idx + 1;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool InProcMailbox::Recv(int32_t *sender_id, zmq::message_t *msg,
+                         long timeout_milli) {
+  for (int32_t i = 0; i < kNumSpins; ++i) {
+    if (TryRecv(sender_id, msg))
+      return true;
+  }
+
+  int64_t deadline = (timeout_milli >= 0) ? NowMilli() + timeout_milli : -1;
+  while (true) {
+    uint32_t seq = seq_.load(std::memory_order_seq_cst);
+    waiting_.store(kFutexWaiting, std::memory_order_seq_cst);
+    if (TryRecv(sender_id, msg)) {
+      waiting_.store(kNotWaiting, std::memory_order_relaxed);
+      return true;
+    }
+
+    long wait_milli = -1;
+    if (deadline >= 0) {
+      wait_milli = deadline - NowMilli();
+      if (wait_milli < 0) {
+        waiting_.store(kNotWaiting, std::memory_order_relaxed);
+        return false;
+      }
+    }
+    FutexWait(&seq_, seq, wait_milli);
+    waiting_.store(kNotWaiting, std::memory_order_relaxed);
+
+    if (TryRecv(sender_id, msg))
+      return true;
+  }
+}
+
+int InProcMailbox::get_event_fd() {
+  if (event_fd_ < 0) {
+    event_fd_ = eventfd(0, EFD_NONBLOCK);
+    CHECK_GE(event_fd_, 0) << "eventfd failed: " << strerror(errno);
+  }
+  return event_fd_;
+}
+
+void InProcMailbox::BeginFdWait() {
+  get_event_fd();
+  waiting_.store(kFdWaiting, std::memory_order_seq_cst);
+}
+
+void InProcMailbox::EndFdWait() {
+  waiting_.store(kNotWaiting, std::memory_order_relaxed);
+  uint64_t count;
+  while (read(event_fd_, &count, sizeof(count)) > 0) { }
+}
+
+}  // namespace petuum
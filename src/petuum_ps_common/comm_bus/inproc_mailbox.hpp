@@ -0,0 +1,115 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <mutex>
+#include <map>
+#include <zmq.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_array.hpp>
+
+namespace petuum {
+
+// Unbounded single-producer single-consumer FIFO of zmq messages. It is a
+// chain of ring segments: a producer that finds its segment full links a new
+// one twice as large, and the consumer frees a segment once it has drained it
+// and found the next one. Messages are moved in and out (zmq_msg_move), so
+// their data is never copied.
+class SPSCMsgQueue : boost::noncopyable {
+public:
+  SPSCMsgQueue(int32_t sender_id, size_t init_capacity);
+  ~SPSCMsgQueue();
+
+  // Producer only. msg is nullified.
+  void Push(zmq::message_t *msg);
+
+  // Consumer only. Returns false if the queue is empty.
+  bool Pop(zmq::message_t *msg);
+
+  int32_t get_sender_id() const {
+    return sender_id_;
+  }
+
+private:
+  struct Segment {
+    explicit Segment(size_t capacity);
+
+    const size_t mask;
+    boost::scoped_array<zmq::message_t> slots;
+    // Set by the producer once it has moved on to the next segment.
+    std::atomic<Segment*> next;
+    // head and tail are on separate cache lines as only the consumer writes
+    // head and only the producer writes tail.
+    char pad0[64];
+    std::atomic<size_t> head;
+    char pad1[64];
+    std::atomic<size_t> tail;
+    char pad2[64];
+  };
+
+  const int32_t sender_id_;
+  Segment *producer_seg_;
+  Segment *consumer_seg_;
+};
+
+// In-process messages for a thread registered with CommBus::kRingTransport:
+// one SPSCMsgQueue per local sending thread, which the owner drains round
+// robin. A sender wakes the owner only if it is asleep, through a futex, or
+// through an eventfd while the owner also waits on zmq sockets in
+// zmq::poll().
+class InProcMailbox : boost::noncopyable {
+public:
+  explicit InProcMailbox(int32_t max_num_senders);
+  ~InProcMailbox();
+
+  // The queue sender_id's messages go to; created on first use. Only one
+  // thread may push to it at a time.
+  SPSCMsgQueue *GetQueue(int32_t sender_id);
+
+  // Called by a sender after pushing to its queue.
+  void Notify();
+
+  // The remaining functions are called by the owner only.
+
+  bool TryRecv(int32_t *sender_id, zmq::message_t *msg);
+
+  // Waits up to timeout_milli, or forever if timeout_milli is negative.
+  bool Recv(int32_t *sender_id, zmq::message_t *msg, long timeout_milli);
+
+  // A file descriptor that becomes readable when a message arrives between
+  // BeginFdWait() and EndFdWait(), for zmq::poll().
+  int get_event_fd();
+
+  void BeginFdWait();
+  void EndFdWait();
+
+private:
+  static const int32_t kNotWaiting = 0;
+  static const int32_t kFutexWaiting = 1;
+  static const int32_t kFdWaiting = 2;
+
+  // Spins before going to sleep; a reply from a bg thread is often only a
+  // few microseconds away.
+  static const int32_t kNumSpins = 200;
+
+  static const size_t kInitQueueCapacity = 256;
+
+  const int32_t max_num_senders_;
+
+  // Bumped on every Notify(), the futex word.
+  std::atomic<uint32_t> seq_;
+  std::atomic<int32_t> waiting_;
+  int event_fd_;
+
+  std::mutex queues_mtx_;
+  // sender id -> index in queues_
+  std::map<int32_t, int32_t> queue_idx_;
+  boost::scoped_array<std::atomic<SPSCMsgQueue*> > queues_;
+  std::atomic<int32_t> num_queues_;
+
+  // owner only, where TryRecv() resumes
+  int32_t next_queue_;
+};
+
+}  // namespace petuum
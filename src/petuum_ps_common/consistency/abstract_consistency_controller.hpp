@@ -37,6 +37,13 @@ public:
   // fresh in SSP. The result is returned in row_accessor.
   virtual ClientRow *Get(int32_t row_id, RowAccessor* row_accessor) = 0;
 
+  // Get() on each of row_ids, fetching the rows that are missing or too
+  // stale together rather than one by one. If row_accessors is not NULL, it
+  // points to row_ids.size() accessors that receive the rows in order;
+  // otherwise the rows are only brought into the process storage.
+  virtual void GetBatch(const std::vector<int32_t> &row_ids,
+                        RowAccessor *row_accessors) = 0;
+
   // Increment (update) an entry. Does not take ownership of input argument
   // delta, which should be of template type UPDATE in Table. This may trigger
   // synchronization (e.g., in value-bound) and is blocked until consistency
@@ -2,6 +2,7 @@
 
 #include <boost/thread.hpp>
 #include <vector>
+#include <stdint.h>
 #include <boost/shared_array.hpp>
 
 namespace petuum {
@@ -20,6 +21,13 @@ public:
 
   virtual size_t get_update_size() const = 0;
 
+  // True if each update is a float. Lossy oplog codecs and top-k
+  // sparsification rewrite updates as floats (see oplog_codec.hpp), so
+  // tables of other rows must not use them.
+  virtual bool update_is_float() const {
+    return false;
+  }
+
   // Upper bound of the number of bytes that serialized row shall occupy.
   // Find some balance between tightness and time complexity.
   virtual size_t SerializedSize() const = 0;
@@ -102,6 +110,20 @@ public:
   virtual void SubtractUpdates(int32_t column_id, void *update1,
     const void* update2) const = 0;
 
+  // AddUpdates() on num_updates contiguous updates for columns starting at
+  // index_st. Rows whose updates are plain arithmetic types should override
+  // this with a vectorized loop.
+  virtual void AddDenseUpdates(int32_t index_st, void *updates1,
+    const void *updates2, int32_t num_updates) const {
+    uint8_t *updates1_uint8 = reinterpret_cast<uint8_t*>(updates1);
+    const uint8_t *updates2_uint8 = reinterpret_cast<const uint8_t*>(updates2);
+    size_t update_size = get_update_size();
+    for (int32_t i = 0; i < num_updates; ++i) {
+      AddUpdates(index_st + i, updates1_uint8 + update_size*i,
+                 updates2_uint8 + update_size*i);
+    }
+  }
+
   // Get importance of this update as if it is applied on to the given value.
   virtual double GetImportance(int32_t column_id, const void *update,
                                const void *value) const = 0;
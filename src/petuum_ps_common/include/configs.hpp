@@ -49,15 +49,43 @@ enum AppendOnlyOpLogType {
   DenseBatchInc = 2
 };
 
+// Wire encoding of the row oplogs a bg worker sends to servers, see
+// petuum_ps_common/oplog/oplog_codec.hpp. FP16Codec and Int8Codec are lossy
+// and treat updates as float.
+enum OpLogCodec {
+  NoCodec = 0,
+  // Column ids as delta coded varints, values unchanged.
+  VarintCodec = 1,
+  // Varint column ids, values as IEEE half precision floats.
+  FP16Codec = 2,
+  // Varint column ids, values as int8 scaled by the row's largest magnitude.
+  Int8Codec = 3
+};
+
 enum ProcessStorageType {
   BoundedDense = 0,
   BoundedSparse = 1
 };
 
+// How a table's rows are assigned to server threads, see
+// petuum_ps/thread/row_partitioner.hpp.
+enum RowPartitionerType {
+  // Row id modulo the number of server threads.
+  ModuloPartitioner = 0,
+  // Consistent hashing of (table id, row id).
+  HashPartitioner = 1,
+  // Contiguous row id ranges of equal length, requires
+  // TableInfo::row_partitioner_num_rows.
+  RangePartitioner = 2
+};
+
 struct TableGroupConfig {
 
   TableGroupConfig():
       stats_path(""),
+      stats_live_interval_milli(0),
+      stats_live_max_kb(64 * 1024),
+      trace_buffer_events(64 * 1024),
       num_comm_channels_per_client(1),
       num_tables(1),
       num_total_clients(1),
@@ -66,16 +94,37 @@ struct TableGroupConfig {
       aggressive_cpu(false),
       snapshot_clock(-1),
       resume_clock(-1),
+      snapshot_incremental(false),
       update_sort_policy(Random),
       bg_idle_milli(2),
       bandwidth_mbps(40),
       oplog_push_upper_bound_kb(100),
       oplog_push_staleness_tolerance(2),
       thread_oplog_batch_size(100*1000*1000),
-      server_row_candidate_factor(5) { }
+      server_row_candidate_factor(5),
+      num_server_apply_threads(1),
+      oplog_aggr_group_size(1),
+      inproc_ring_transport(false),
+      adaptive_bg_send(false),
+      bg_bandwidth_share(0.8) { }
 
   std::string stats_path;
 
+  // With PETUUM_STATS, if positive, a timer thread appends a snapshot of
+  // every thread's counters and latency histograms to
+  // <stats_path>.<client_id>.live this often while the process runs. The
+  // file is rolled over to <...>.live.1 once it exceeds stats_live_max_kb.
+  long stats_live_interval_milli;
+  size_t stats_live_max_kb;
+
+  // With PETUUM_STATS, if not empty, app, bg and server threads record
+  // timed spans (compute, Clock(), row request waits, oplog sends, server
+  // oplog apply and push, ...) and the process writes them to
+  // <trace_path>.<client_id>.json in Chrome trace format at shutdown. Each
+  // thread keeps its last trace_buffer_events spans.
+  std::string trace_path;
+  size_t trace_buffer_events;
+
   // ================= Global Parameters ===================
   // Global parameters have to be the same across all processes.
 
@@ -121,6 +170,15 @@ struct TableGroupConfig {
   std::string snapshot_dir;
   std::string resume_dir;
 
+  // If true, every snapshot but a server's first only contains the rows
+  // that changed since the previous one. Resuming reads the chain of delta
+  // snapshots back to the last full one, so snapshot_dir must keep all of
+  // them.
+  bool snapshot_incremental;
+
+  // LocalOOC only. Table table_id is kept in the file
+  // <ooc_path_prefix>.table<table_id> while the process runs, with up to
+  // ClientTableConfig::process_cache_capacity of its rows in memory.
   std::string ooc_path_prefix;
 
   UpdateSortPolicy update_sort_policy;
@@ -146,6 +204,38 @@ struct TableGroupConfig {
   long server_idle_milli;
 
   long server_row_candidate_factor;
+
+  // Number of threads each server thread uses to apply an oplog message,
+  // including the server thread itself. Rows are sharded among them by row
+  // id. 1 applies oplogs serially on the server thread.
+  int32_t num_server_apply_threads;
+
+  // Number of clients (consecutive client ids) whose bg threads combine their
+  // oplogs before sending them to servers. The bg thread of comm channel i
+  // on the first client of a group aggregates for channel i of the whole
+  // group. 1 sends oplogs straight to servers.
+  int32_t oplog_aggr_group_size;
+
+  // Directory for the scratch files that rows evicted from process storage
+  // spill to (see ClientTableConfig::evicted_row_spill_capacity). Should be
+  // on a local SSD.
+  std::string evicted_row_spill_dir;
+
+  // If true, app threads and bg threads exchange in-process messages
+  // (row requests and replies, oplog and clock messages) through lock-free
+  // queues and futex wakeups instead of zmq inproc sockets. Servers keep
+  // using zmq.
+  bool inproc_ring_transport;
+
+  // SSPAggr only. If true, bg threads measure the bandwidth and round trip
+  // time to each server from oplog acknowledgements, and pace their oplog
+  // pushes and size their batches by them instead of by bandwidth_mbps and
+  // oplog_push_upper_bound_kb (which are then just the starting point).
+  bool adaptive_bg_send;
+
+  // Fraction (0, 1] of the measured bandwidth that adaptive_bg_send lets a
+  // bg thread use.
+  double bg_bandwidth_share;
 };
 
 // TableInfo is shared between client and server.
@@ -156,7 +246,12 @@ struct TableInfo {
       row_capacity(0),
       oplog_dense_serialized(false),
       row_oplog_type(1),
-      dense_row_oplog_capacity(0) { }
+      dense_row_oplog_capacity(0),
+      server_dense_storage(false),
+      oplog_codec(NoCodec),
+      oplog_topk_ratio(0.0),
+      row_partitioner(ModuloPartitioner),
+      row_partitioner_num_rows(0) { }
 
   // table_staleness is used for SSP and ClockVAP.
   int32_t table_staleness;
@@ -175,6 +270,35 @@ struct TableInfo {
   int32_t row_oplog_type;
 
   size_t dense_row_oplog_capacity;
+
+  // Store the table's rows on the server in an array indexed by row id
+  // rather than a hash table. Meant for tables whose row ids are contiguous
+  // starting from 0; memory is proportional to the largest row id.
+  bool server_dense_storage;
+
+  // Encoding of oplogs on the wire. Anything but NoCodec requires
+  // ClientTableConfig::no_oplog_replay. FP16Codec, Int8Codec and top-k
+  // require a row type whose updates are floats; CreateTable() fails
+  // otherwise.
+  OpLogCodec oplog_codec;
+
+  // If in (0, 1) and oplog_codec is set, only send this fraction of each row
+  // oplog's nonzero updates, those of largest magnitude. Updates are treated
+  // as float. Like the quantization error of lossy codecs, what is not sent
+  // stays in the oplog and goes out with the row's next update.
+  double oplog_topk_ratio;
+
+  // Tables with a few large, heavily updated rows may balance better with
+  // HashPartitioner or RangePartitioner. server_dense_storage is ignored
+  // with HashPartitioner.
+  RowPartitionerType row_partitioner;
+
+  // Row ids are expected in [0, row_partitioner_num_rows) with
+  // RangePartitioner; larger ones go to the last server thread, negative
+  // ones are a fatal error. Optional
+  // with other partitioners, where it only serves to warn about tables
+  // with fewer rows than server threads.
+  int32_t row_partitioner_num_rows;
 };
 
 // ClientTableConfig is used by client only.
@@ -189,7 +313,9 @@ struct ClientTableConfig {
       per_thread_append_only_buff_pool_size(3),
       bg_apply_append_oplog_freq(1),
       process_storage_type(BoundedSparse),
-      no_oplog_replay(false) { }
+      no_oplog_replay(false),
+      evicted_row_mem_capacity(0),
+      evicted_row_spill_capacity(0) { }
 
   TableInfo table_info;
 
@@ -216,6 +342,17 @@ struct ClientTableConfig {
   ProcessStorageType process_storage_type;
 
   bool no_oplog_replay;
+
+  // In bytes. Rows evicted from a BoundedSparse process storage are kept
+  // compressed in memory up to evicted_row_mem_capacity, and then in a file
+  // under TableGroupConfig::evicted_row_spill_dir up to
+  // evicted_row_spill_capacity, so that a Get() on them within the
+  // staleness bound does not go to the server. Only used under SSP, where a
+  // row's clock tells whether such a copy is fresh enough. 0 for both turns
+  // this off.
+  size_t evicted_row_mem_capacity;
+
+  size_t evicted_row_spill_capacity;
 };
 
 }  // namespace petuum
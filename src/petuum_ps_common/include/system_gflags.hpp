@@ -7,6 +7,14 @@
 #include <petuum_ps_common/util/utils.hpp>
 
 DEFINE_string(stats_path, "", "stats file path prefix");
+DEFINE_int32(stats_live_interval_milli, 0,
+             "interval of live stats snapshots, 0 to disable");
+DEFINE_uint64(stats_live_max_kb, 64 * 1024,
+              "size at which the live stats file is rolled over");
+DEFINE_string(trace_path, "", "Chrome trace file path prefix, empty to "
+              "disable tracing");
+DEFINE_uint64(trace_buffer_events, 64 * 1024,
+              "no. of most recent spans each thread keeps for the trace");
 
 // Topology Configs
 DEFINE_int32(num_clients, 1, "total number of clients");
@@ -17,7 +25,7 @@ DEFINE_int32(client_id, 0, "This client's ID");
 DEFINE_string(hostfile, "", "path to Petuum PS server configuration file");
 
 // Execution Configs
-DEFINE_string(consistency_model, "SSPPush", "SSPAggr/SSPPush/SSP");
+DEFINE_string(consistency_model, "SSPPush", "SSPAggr/SSPPush/SSP/LocalOOC");
 
 // SSPAggr Configs -- client side
 DEFINE_uint64(bandwidth_mbps, 40, "per-thread bandwidth limit, in mbps");
@@ -27,31 +35,62 @@ DEFINE_uint64(oplog_push_upper_bound_kb, 100,
              "oplog push upper bound in Kilobytes per comm thread.");
 DEFINE_int32(oplog_push_staleness_tolerance, 2,
              "oplog push staleness tolerance");
+DEFINE_bool(adaptive_bg_send, false, "Pace oplog pushes and size oplog "
+            "batches by the bandwidth and RTT measured from server acks");
+DEFINE_double(bg_bandwidth_share, 0.8, "Fraction of the measured bandwidth "
+              "bg threads may use with adaptive_bg_send");
 DEFINE_uint64(thread_oplog_batch_size, 100*1000*1000, "thread oplog batch size");
 
+// OpLog Aggregation Configs
+DEFINE_int32(oplog_aggr_group_size, 1,
+             "no. of clients whose oplogs are combined before reaching servers");
+
 // SSPAggr Configs -- server side
 DEFINE_uint64(server_row_candidate_factor, 5, "server row candidate factor");
 DEFINE_int32(server_push_row_threshold, 100, "Server push row threshold");
 DEFINE_int32(server_idle_milli, 10, "server idle time out in millisec");
 DEFINE_string(update_sort_policy, "Random", "Update sort policy");
 
+// Server Configs
+DEFINE_int32(num_server_apply_threads, 1,
+             "no. of threads per server thread applying oplogs");
+
+// Process Storage Configs
+DEFINE_string(evicted_row_spill_dir, "",
+              "directory rows evicted from process storage spill to");
+
+// LocalOOC Configs
+DEFINE_string(ooc_path_prefix, "", "path prefix of LocalOOC table files");
+
+// Comm Configs
+DEFINE_bool(inproc_ring_transport, false,
+            "app and bg threads talk through lock-free queues, not zmq");
+
 // Snapshot Configs
 DEFINE_int32(snapshot_clock, -1, "snapshot clock");
 DEFINE_int32(resume_clock, -1, "resume clock");
 DEFINE_string(snapshot_dir, "", "snap shot directory");
 DEFINE_string(resume_dir, "", "resume directory");
+DEFINE_bool(snapshot_incremental, false,
+            "snapshots after the first only contain changed rows");
 
 namespace petuum {
 void InitTableGroupConfig(TableGroupConfig *config, int32_t *client_id,
                           int32_t num_tables) {
   config->stats_path = FLAGS_stats_path;
+  config->stats_live_interval_milli = FLAGS_stats_live_interval_milli;
+  config->stats_live_max_kb = FLAGS_stats_live_max_kb;
+  config->trace_path = FLAGS_trace_path;
+  config->trace_buffer_events = FLAGS_trace_buffer_events;
   config->num_comm_channels_per_client = FLAGS_num_comm_channels_per_client;
   config->num_tables = num_tables;
   config->num_total_clients = FLAGS_num_clients;
   config->num_local_app_threads = FLAGS_init_thread_access_table ?
                                   FLAGS_num_table_threads : FLAGS_num_table_threads + 1;
 
-  GetHostInfos(FLAGS_hostfile, &(config->host_map));
+  // LocalOOC has no servers.
+  if (FLAGS_consistency_model != "LocalOOC")
+    GetHostInfos(FLAGS_hostfile, &(config->host_map));
 
   config->client_id = FLAGS_client_id;
 
@@ -61,6 +100,8 @@ void InitTableGroupConfig(TableGroupConfig *config, int32_t *client_id,
     config->consistency_model = petuum::SSP;
   } else if (FLAGS_consistency_model == "SSPAggr") {
     config->consistency_model = petuum::SSPAggr;
+  } else if (FLAGS_consistency_model == "LocalOOC") {
+    config->consistency_model = petuum::LocalOOC;
   } else {
     LOG(FATAL) << "Unsupported ssp mode " << FLAGS_consistency_model;
   }
@@ -73,6 +114,7 @@ void InitTableGroupConfig(TableGroupConfig *config, int32_t *client_id,
   config->resume_clock = FLAGS_resume_clock;
   config->snapshot_dir = FLAGS_snapshot_dir;
   config->resume_dir = FLAGS_resume_dir;
+  config->snapshot_incremental = FLAGS_snapshot_incremental;
 
   if (FLAGS_update_sort_policy == "Random") {
     config->update_sort_policy = Random;
@@ -92,6 +134,13 @@ void InitTableGroupConfig(TableGroupConfig *config, int32_t *client_id,
   config->server_push_row_threshold = FLAGS_server_push_row_threshold;
   config->server_idle_milli = FLAGS_server_idle_milli;
   config->server_row_candidate_factor = FLAGS_server_row_candidate_factor;
+  config->num_server_apply_threads = FLAGS_num_server_apply_threads;
+  config->oplog_aggr_group_size = FLAGS_oplog_aggr_group_size;
+  config->evicted_row_spill_dir = FLAGS_evicted_row_spill_dir;
+  config->ooc_path_prefix = FLAGS_ooc_path_prefix;
+  config->inproc_ring_transport = FLAGS_inproc_ring_transport;
+  config->adaptive_bg_send = FLAGS_adaptive_bg_send;
+  config->bg_bandwidth_share = FLAGS_bg_bandwidth_share;
 
   *client_id = FLAGS_client_id;
 }
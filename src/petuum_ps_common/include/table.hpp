@@ -162,6 +162,15 @@ public:
     system_table_->Get(row_id, row_accessor);
   }
 
+  // Brings row_ids into the process cache with one request per server for
+  // those missing or too stale, instead of one per row as Get() would. If
+  // row_accessors is given, it points to row_ids.size() accessors which
+  // then hold the rows, as from Get(row_ids[i], &row_accessors[i]).
+  void GetBatch(const std::vector<int32_t> &row_ids,
+                RowAccessor *row_accessors = 0) {
+    system_table_->GetBatch(row_ids, row_accessors);
+  }
+
   template<typename ROW>
   const ROW &Get(int32_t row_id, RowAccessor *row_accessor = 0) {
     return *(dynamic_cast<ROW*>(
@@ -11,6 +11,16 @@ DEFINE_int32(table_staleness, 0, "table staleness");
 DEFINE_int32(row_type, 0, "table row type");
 DEFINE_int32(row_oplog_type, petuum::RowOpLogType::kDenseRowOpLog, "row oplog type");
 DEFINE_bool(oplog_dense_serialized, true, "dense serialized oplog");
+DEFINE_bool(server_dense_storage, false,
+            "store rows on server in an array indexed by row id");
+DEFINE_string(oplog_codec, "None", "oplog wire codec: None, Varint, FP16 or Int8");
+DEFINE_double(oplog_topk_ratio, 0.0,
+              "fraction of each row oplog's updates to send, 0 sends all");
+DEFINE_string(row_partitioner, "Modulo",
+              "row to server assignment: Modulo, Hash or Range");
+DEFINE_int32(row_partitioner_num_rows, 0,
+             "number of rows split into ranges by the Range partitioner "
+             "(optional with other partitioners)");
 
 DEFINE_string(oplog_type, "Sparse", "use append only oplog?");
 DEFINE_string(append_only_oplog_type, "Inc", "append only oplog type?");
@@ -18,6 +28,10 @@ DEFINE_uint64(append_only_buffer_capacity, 1024*1024, "buffer capacity in bytes"
 DEFINE_uint64(append_only_buffer_pool_size, 3, "append_ only buffer pool size");
 DEFINE_int32(bg_apply_append_oplog_freq, 4, "bg apply append oplog freq");
 DEFINE_string(process_storage_type, "BoundedSparse", "proess storage type");
+DEFINE_uint64(evicted_row_mem_capacity, 0,
+              "bytes of compressed evicted rows kept in memory");
+DEFINE_uint64(evicted_row_spill_capacity, 0,
+              "bytes of evicted rows spilled to evicted_row_spill_dir");
 
 namespace petuum {
 
@@ -34,6 +48,32 @@ void InitTableConfig(ClientTableConfig *config) {
 
   config->table_info.oplog_dense_serialized = FLAGS_oplog_dense_serialized;
   config->table_info.row_oplog_type = FLAGS_row_oplog_type;
+  config->table_info.server_dense_storage = FLAGS_server_dense_storage;
+
+  if (FLAGS_oplog_codec == "None") {
+    config->table_info.oplog_codec = NoCodec;
+  } else if (FLAGS_oplog_codec == "Varint") {
+    config->table_info.oplog_codec = VarintCodec;
+  } else if (FLAGS_oplog_codec == "FP16") {
+    config->table_info.oplog_codec = FP16Codec;
+  } else if (FLAGS_oplog_codec == "Int8") {
+    config->table_info.oplog_codec = Int8Codec;
+  } else {
+    LOG(FATAL) << "Unknown oplog codec = " << FLAGS_oplog_codec;
+  }
+  config->table_info.oplog_topk_ratio = FLAGS_oplog_topk_ratio;
+
+  if (FLAGS_row_partitioner == "Modulo") {
+    config->table_info.row_partitioner = ModuloPartitioner;
+  } else if (FLAGS_row_partitioner == "Hash") {
+    config->table_info.row_partitioner = HashPartitioner;
+  } else if (FLAGS_row_partitioner == "Range") {
+    config->table_info.row_partitioner = RangePartitioner;
+  } else {
+    LOG(FATAL) << "Unknown row partitioner = " << FLAGS_row_partitioner;
+  }
+  config->table_info.row_partitioner_num_rows
+      = FLAGS_row_partitioner_num_rows;
 
   if (FLAGS_oplog_type == "Sparse") {
     config->oplog_type = Sparse;
@@ -65,6 +105,8 @@ void InitTableConfig(ClientTableConfig *config) {
   } else {
     LOG(FATAL) << "Unknown process storage type " << FLAGS_process_storage_type;
   }
+  config->evicted_row_mem_capacity = FLAGS_evicted_row_mem_capacity;
+  config->evicted_row_spill_capacity = FLAGS_evicted_row_spill_capacity;
 }
 
 }
@@ -53,7 +53,7 @@ public:
 
   void* Next(int32_t *column_id) {
     uint8_t *update = reinterpret_cast<uint8_t*>(Find(iter_col_id_));
-    while (CheckZeroUpdate_(update) && iter_col_id_ < row_size_) {
+    while (iter_col_id_ < row_size_ && CheckZeroUpdate_(update)) {
       update += update_size_;
       ++iter_col_id_;
     }
@@ -73,7 +73,7 @@ public:
   const void* NextConst(int32_t *column_id) const {
     const uint8_t *update = reinterpret_cast<const uint8_t*>(
         FindConst(iter_col_id_));
-    while (CheckZeroUpdate_(update) && iter_col_id_ < row_size_) {
+    while (iter_col_id_ < row_size_ && CheckZeroUpdate_(update)) {
       update += update_size_;
       ++iter_col_id_;
     }
@@ -0,0 +1,361 @@
+#include <petuum_ps_common/oplog/oplog_codec.hpp>
+#include <petuum_ps_common/include/abstract_row.hpp>
+#include <petuum_ps_common/util/class_register.hpp>
+#include <glog/logging.h>
+#include <algorithm>
+#include <cmath>
+#include <string.h>
+
+namespace petuum {
+
+namespace {
+
+const size_t kMaxVarintSize = 10;
+
+size_t PutVarint(uint64_t value, uint8_t *mem) {
+  size_t size = 0;
+  while (value >= 0x80) {
+    mem[size++] = static_cast<uint8_t>(value) | 0x80;
+    value >>= 7;
+  }
+  mem[size++] = static_cast<uint8_t>(value);
+  return size;
+}
+
+uint64_t GetVarint(const uint8_t **mem) {
+  uint64_t value = 0;
+  int shift = 0;
+  const uint8_t *p = *mem;
+  while (*p & 0x80) {
+    value |= static_cast<uint64_t>(*p & 0x7f) << shift;
+    shift += 7;
+    ++p;
+  }
+  value |= static_cast<uint64_t>(*p) << shift;
+  *mem = p + 1;
+  return value;
+}
+
+uint64_t ZigZag(int64_t value) {
+  return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+int64_t UnZigZag(uint64_t value) {
+  return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+// Round to nearest even, saturating to infinity.
+uint16_t FloatToHalf(float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  uint16_t sign = (bits >> 16) & 0x8000;
+  uint32_t abs = bits & 0x7fffffff;
+
+  if (abs >= 0x7f800000)  // inf or nan
+    return sign | 0x7c00 | (abs > 0x7f800000 ? 0x200 : 0);
+  if (abs >= 0x477ff000)  // rounds to or beyond 65520
+    return sign | 0x7c00;
+  if (abs <= 0x33000000)  // at most half of the smallest subnormal half
+    return sign;
+
+  uint32_t mantissa;
+  uint32_t shift;
+  uint32_t half;
+  if (abs < 0x38800000) {
+    // subnormal half
+    mantissa = (abs & 0x7fffff) | 0x800000;
+    shift = 126 - (abs >> 23);
+    half = mantissa >> shift;
+  } else {
+    mantissa = abs;
+    shift = 13;
+    half = (abs - 0x38000000) >> 13;
+  }
+  uint32_t rem = mantissa & ((1U << shift) - 1);
+  uint32_t halfway = 1U << (shift - 1);
+  if (rem > halfway || (rem == halfway && (half & 1)))
+    ++half;
+  return sign | static_cast<uint16_t>(half);
+}
+
+float HalfToFloat(uint16_t half) {
+  uint32_t sign = static_cast<uint32_t>(half & 0x8000) << 16;
+  uint32_t exponent = (half >> 10) & 0x1f;
+  uint32_t mantissa = half & 0x3ff;
+  uint32_t bits;
+  if (exponent == 0) {
+    float value = std::ldexp(static_cast<float>(mantissa), -24);
+    return sign ? -value : value;
+  } else if (exponent == 31) {
+    bits = sign | 0x7f800000 | (mantissa << 13);
+  } else {
+    bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+  }
+  float value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+// Lossy codecs and top-k reconstruct updates as floats.
+bool OpLogCodecNeedsFloat(OpLogCodec codec, double topk_ratio) {
+  if (codec == NoCodec)
+    return false;
+  return codec != VarintCodec || (topk_ratio > 0 && topk_ratio < 1);
+}
+
+}  // anonymous namespace
+
+bool OpLogCodecSupported(const TableInfo &table_info) {
+  if (!OpLogCodecNeedsFloat(table_info.oplog_codec,
+                            table_info.oplog_topk_ratio))
+    return true;
+  std::unique_ptr<AbstractRow> sample_row(
+      ClassRegistry<AbstractRow>::GetRegistry().CreateObject(
+          table_info.row_type));
+  return sample_row->update_is_float();
+}
+
+OpLogEncoder::OpLogEncoder(OpLogCodec codec, double topk_ratio,
+                           bool dense_serialize, size_t update_size):
+    codec_(codec),
+    topk_ratio_(topk_ratio),
+    dense_serialize_(dense_serialize),
+    update_size_(update_size),
+    raw_size_(0) {
+  CHECK_NE(codec_, NoCodec);
+  CHECK_GE(topk_ratio_, 0.0);
+  if (OpLogCodecNeedsFloat(codec_, topk_ratio_)) {
+    CHECK_EQ(update_size_, sizeof(float))
+        << "lossy oplog codecs and top-k require float updates";
+  }
+}
+
+size_t OpLogEncoder::EncodeAndReset(AbstractRowOpLog *row_oplog,
+                                    const uint8_t **encoded) {
+  if (dense_serialize_) {
+    raw_size_ = row_oplog->GetDenseSerializedSize();
+  } else {
+    row_oplog->ClearZerosAndGetNoneZeroSize();
+    raw_size_ = row_oplog->GetSparseSerializedSize();
+  }
+  if (raw_buff_.size() < raw_size_)
+    raw_buff_.resize(raw_size_);
+
+  const int32_t *column_ids = 0;
+  int32_t num_updates;
+  size_t parsed_size;
+  const uint8_t *updates;
+  if (dense_serialize_) {
+    row_oplog->SerializeDense(raw_buff_.data());
+    updates = reinterpret_cast<const uint8_t*>(
+        row_oplog->ParseDenseSerializedOpLog(
+            raw_buff_.data(), &num_updates, &parsed_size));
+  } else {
+    row_oplog->SerializeSparse(raw_buff_.data());
+    updates = reinterpret_cast<const uint8_t*>(
+        row_oplog->ParseSparseSerializedOpLog(
+            raw_buff_.data(), &column_ids, &num_updates, &parsed_size));
+  }
+  row_oplog->Reset();
+
+  const float *values = reinterpret_cast<const float*>(updates);
+  bool topk = (topk_ratio_ > 0 && topk_ratio_ < 1);
+  selected_.clear();
+  if (topk) {
+    for (int32_t i = 0; i < num_updates; ++i) {
+      if (values[i] != 0)
+        selected_.push_back(i);
+    }
+    size_t k = static_cast<size_t>(std::ceil(topk_ratio_ * selected_.size()));
+    if (k < selected_.size()) {
+      std::nth_element(selected_.begin(), selected_.begin() + k,
+                       selected_.end(),
+                       [values] (int32_t a, int32_t b) {
+                         return std::fabs(values[a]) > std::fabs(values[b]);
+                       });
+      selected_.resize(k);
+      std::sort(selected_.begin(), selected_.end());
+    }
+  } else {
+    for (int32_t i = 0; i < num_updates; ++i)
+      selected_.push_back(i);
+  }
+
+  size_t num_selected = selected_.size();
+  size_t max_size = 2*kMaxVarintSize + sizeof(float)
+                    + num_selected*(kMaxVarintSize + update_size_);
+  if (encoded_buff_.size() < max_size)
+    encoded_buff_.resize(max_size);
+
+  uint8_t *mem = encoded_buff_.data();
+  mem += PutVarint(dense_serialize_ ? num_updates : num_selected, mem);
+  mem += PutVarint(num_selected, mem);
+
+  if (!dense_serialize_ || num_selected < static_cast<size_t>(num_updates)) {
+    int64_t prev_column_id = 0;
+    for (int32_t idx : selected_) {
+      int64_t column_id = dense_serialize_ ? idx : column_ids[idx];
+      mem += PutVarint(ZigZag(column_id - prev_column_id), mem);
+      prev_column_id = column_id;
+    }
+  }
+
+  if (codec_ == VarintCodec) {
+    for (int32_t idx : selected_) {
+      memcpy(mem, updates + idx*update_size_, update_size_);
+      mem += update_size_;
+    }
+    if (!topk) {
+      *encoded = encoded_buff_.data();
+      return mem - encoded_buff_.data();
+    }
+    decoded_values_.resize(num_selected);
+    for (size_t i = 0; i < num_selected; ++i)
+      decoded_values_[i] = values[selected_[i]];
+  } else {
+    selected_values_.resize(num_selected);
+    for (size_t i = 0; i < num_selected; ++i)
+      selected_values_[i] = values[selected_[i]];
+    mem += EncodeValues(selected_values_.data(), mem);
+  }
+
+  // Error feedback: whatever the server will not see stays in the oplog.
+  residuals_.assign(values, values + num_updates);
+  for (size_t i = 0; i < num_selected; ++i)
+    residuals_[selected_[i]] -= decoded_values_[i];
+  for (int32_t i = 0; i < num_updates; ++i) {
+    if (residuals_[i] == 0)
+      continue;
+    int32_t column_id = dense_serialize_ ? i : column_ids[i];
+    *(reinterpret_cast<float*>(row_oplog->FindCreate(column_id)))
+        += residuals_[i];
+  }
+
+  *encoded = encoded_buff_.data();
+  return mem - encoded_buff_.data();
+}
+
+// Also fills decoded_values_ with what the server will decode.
+size_t OpLogEncoder::EncodeValues(const float *values, uint8_t *mem) {
+  size_t num_values = selected_.size();
+  decoded_values_.resize(num_values);
+  uint8_t *mem_start = mem;
+
+  if (codec_ == FP16Codec) {
+    for (size_t i = 0; i < num_values; ++i) {
+      uint16_t half = FloatToHalf(values[i]);
+      memcpy(mem, &half, sizeof(half));
+      mem += sizeof(half);
+      decoded_values_[i] = HalfToFloat(half);
+    }
+  } else {
+    CHECK_EQ(codec_, Int8Codec);
+    float max_abs = 0;
+    for (size_t i = 0; i < num_values; ++i)
+      max_abs = std::max(max_abs, std::fabs(values[i]));
+    float scale = max_abs / 127;
+    memcpy(mem, &scale, sizeof(scale));
+    mem += sizeof(scale);
+    for (size_t i = 0; i < num_values; ++i) {
+      int32_t quantized = 0;
+      if (scale > 0) {
+        quantized = static_cast<int32_t>(std::lrint(values[i] / scale));
+        quantized = std::max(-127, std::min(127, quantized));
+      }
+      *(reinterpret_cast<int8_t*>(mem)) = static_cast<int8_t>(quantized);
+      mem += sizeof(int8_t);
+      decoded_values_[i] = quantized * scale;
+    }
+  }
+  return mem - mem_start;
+}
+
+uint8_t *OpLogDecodeArena::Alloc(size_t size) {
+  size = (size + 7) & ~static_cast<size_t>(7);
+  if (size > kBlockSize / 4) {
+    blocks_.emplace_back(new uint8_t[size]);
+    return blocks_.back().get();
+  }
+  if (blocks_.empty() || block_offset_ + size > block_size_) {
+    blocks_.emplace_back(new uint8_t[kBlockSize]);
+    block_ = blocks_.back().get();
+    block_offset_ = 0;
+    block_size_ = kBlockSize;
+  }
+  uint8_t *mem = block_ + block_offset_;
+  block_offset_ += size;
+  return mem;
+}
+
+const void *DecodeRowOpLog(OpLogCodec codec, bool dense_serialize,
+                           size_t update_size, const void *mem,
+                           OpLogDecodeArena *arena,
+                           int32_t const **column_ids, int32_t *num_updates,
+                           size_t *encoded_size) {
+  const uint8_t *mem_start = reinterpret_cast<const uint8_t*>(mem);
+  const uint8_t *mem_uint8 = mem_start;
+  size_t num_decoded = GetVarint(&mem_uint8);
+  size_t num_encoded = GetVarint(&mem_uint8);
+  bool has_column_ids = !dense_serialize || num_encoded < num_decoded;
+
+  int32_t *decoded_column_ids = 0;
+  if (has_column_ids) {
+    decoded_column_ids = reinterpret_cast<int32_t*>(
+        arena->Alloc(num_encoded*sizeof(int32_t)));
+    int64_t column_id = 0;
+    for (size_t i = 0; i < num_encoded; ++i) {
+      column_id += UnZigZag(GetVarint(&mem_uint8));
+      decoded_column_ids[i] = static_cast<int32_t>(column_id);
+    }
+  }
+
+  uint8_t *updates = arena->Alloc(num_decoded*update_size);
+  bool scatter = dense_serialize && has_column_ids;
+  if (scatter)
+    memset(updates, 0, num_decoded*update_size);
+
+  float scale = 0;
+  if (codec == Int8Codec) {
+    memcpy(&scale, mem_uint8, sizeof(scale));
+    mem_uint8 += sizeof(scale);
+  }
+
+  for (size_t i = 0; i < num_encoded; ++i) {
+    uint8_t *update = updates + i*update_size;
+    if (scatter) {
+      CHECK_LT(static_cast<size_t>(decoded_column_ids[i]), num_decoded);
+      update = updates + decoded_column_ids[i]*update_size;
+    }
+
+    float value;
+    switch (codec) {
+      case VarintCodec:
+        memcpy(update, mem_uint8, update_size);
+        mem_uint8 += update_size;
+        continue;
+      case FP16Codec:
+        {
+          uint16_t half;
+          memcpy(&half, mem_uint8, sizeof(half));
+          mem_uint8 += sizeof(half);
+          value = HalfToFloat(half);
+        }
+        break;
+      case Int8Codec:
+        value = *(reinterpret_cast<const int8_t*>(mem_uint8)) * scale;
+        mem_uint8 += sizeof(int8_t);
+        break;
+      default:
+        LOG(FATAL) << "Unknown oplog codec " << codec;
+    }
+    memcpy(update, &value, sizeof(value));
+  }
+
+  if (!dense_serialize)
+    *column_ids = decoded_column_ids;
+  *num_updates = static_cast<int32_t>(num_decoded);
+  *encoded_size = mem_uint8 - mem_start;
+  return updates;
+}
+
+}  // namespace petuum
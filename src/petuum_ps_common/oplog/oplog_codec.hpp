@@ -0,0 +1,102 @@
+#pragma once
+
+#include <stdint.h>
+#include <memory>
+#include <vector>
+#include <boost/noncopyable.hpp>
+
+#include <petuum_ps_common/include/configs.hpp>
+#include <petuum_ps_common/oplog/abstract_row_oplog.hpp>
+
+namespace petuum {
+
+// Encoding of a row oplog on the wire for tables whose
+// TableInfo::oplog_codec is not NoCodec. It replaces the output of
+// AbstractRowOpLog::SerializeSparse() / SerializeDense():
+//
+// 1) varint: number of updates the row oplog decodes to; for dense
+// serialized tables this is the width of the row oplog
+// 2) varint: number of updates on the wire
+// 3) column ids of the updates on the wire, each as the zigzag varint of its
+// difference to the previous one; omitted for dense serialized tables when
+// every update is on the wire
+// 4) values: update_size raw bytes each (VarintCodec), IEEE half precision
+// (FP16Codec) or a float scale followed by one int8 each (Int8Codec)
+//
+// The server decodes a row oplog back into the format the table's
+// ApplyRowBatchInc_ expects, so nothing downstream of SerializedOpLogReader
+// changes. Updates left out by top-k sparsification decode to zero in dense
+// serialized tables.
+class OpLogEncoder : boost::noncopyable {
+public:
+  OpLogEncoder(OpLogCodec codec, double topk_ratio, bool dense_serialize,
+               size_t update_size);
+
+  // Serializes and encodes row_oplog, then resets it. For lossy codecs and
+  // top-k, the difference between what was in row_oplog and what the server
+  // will decode is added back to row_oplog so that it goes out with the
+  // row's next update (error feedback). The caller must hold the row
+  // oplog's lock. Returns the encoded size; the encoded bytes are valid
+  // until the next call.
+  size_t EncodeAndReset(AbstractRowOpLog *row_oplog, const uint8_t **encoded);
+
+  // Size the last row oplog would have had with NoCodec.
+  size_t get_raw_size() const {
+    return raw_size_;
+  }
+
+private:
+  size_t EncodeValues(const float *values, uint8_t *mem);
+
+  const OpLogCodec codec_;
+  const double topk_ratio_;
+  const bool dense_serialize_;
+  const size_t update_size_;
+
+  size_t raw_size_;
+  std::vector<uint8_t> raw_buff_;
+  std::vector<uint8_t> encoded_buff_;
+  // Indices (into the serialized row oplog) of the updates on the wire.
+  std::vector<int32_t> selected_;
+  std::vector<float> selected_values_;
+  std::vector<float> decoded_values_;
+  std::vector<float> residuals_;
+};
+
+// Memory for decoded row oplogs. SerializedOpLogReader hands out pointers to
+// decoded updates that must stay valid until the whole message is applied
+// (see OpLogApplyPool), so memory is only released with the arena.
+class OpLogDecodeArena : boost::noncopyable {
+public:
+  OpLogDecodeArena():
+      block_(0),
+      block_offset_(0),
+      block_size_(0) { }
+
+  uint8_t *Alloc(size_t size);
+
+private:
+  static const size_t kBlockSize = 64*1024;
+
+  std::vector<std::unique_ptr<uint8_t[]> > blocks_;
+  uint8_t *block_;
+  size_t block_offset_;
+  size_t block_size_;
+};
+
+// True if table_info's oplog codec and top-k ratio can be used with its
+// row type: lossy codecs and top-k need float updates
+// (AbstractRow::update_is_float()), VarintCodec and NoCodec take any.
+// The row type must be registered.
+bool OpLogCodecSupported(const TableInfo &table_info);
+
+// Decodes an encoded row oplog at mem into arena. Returns the updates and
+// sets column_ids (left untouched for dense serialized tables), num_updates
+// and the number of bytes consumed from mem.
+const void *DecodeRowOpLog(OpLogCodec codec, bool dense_serialize,
+                           size_t update_size, const void *mem,
+                           OpLogDecodeArena *arena,
+                           int32_t const **column_ids, int32_t *num_updates,
+                           size_t *encoded_size);
+
+}  // namespace petuum
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <boost/noncopyable.hpp>
+
+#include <petuum_ps_common/client/client_row.hpp>
+#include <petuum_ps_common/storage/abstract_process_storage.hpp>
+
+namespace petuum {
+
+// Where a BoundedSparseProcessStorage puts the rows it evicts, and looks for
+// the rows it misses. All functions are called with the row's lock in the
+// process storage held, so operations on the same row_id never overlap.
+class AbstractEvictedRowStore : boost::noncopyable {
+public:
+  AbstractEvictedRowStore() { }
+
+  virtual ~AbstractEvictedRowStore() { }
+
+  // client_row is being evicted; it is deleted once Put() returns.
+  virtual void Put(int32_t row_id, ClientRow *client_row) = 0;
+
+  // Returns the serialized bytes of row_id in row_bytes and its clock, for
+  // the process storage to bring the row back. Returns the tier the copy was
+  // found in, kRowTierNone if there is none.
+  virtual RowTier Take(int32_t row_id, int32_t *clock,
+                       std::vector<uint8_t> *row_bytes) = 0;
+
+  // Whether there is a copy of row_id.
+  virtual bool Has(int32_t row_id) = 0;
+
+  // row_id is about to be inserted into the process storage afresh. Returns
+  // false if the store's copy is to be kept instead, which fails the
+  // insertion.
+  virtual bool Supersede(int32_t row_id) = 0;
+};
+
+}  // namespace petuum
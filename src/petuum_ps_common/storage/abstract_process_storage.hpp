@@ -9,6 +9,16 @@
 
 namespace petuum {
 
+// Where a process storage lookup found a row: the process storage itself,
+// or the compressed in-memory or spilled copy of an evicted row
+// (EvictedRowStore).
+enum RowTier {
+  kRowTierCache = 0,
+  kRowTierMem = 1,
+  kRowTierSpill = 2,
+  kRowTierNone = 3
+};
+
 class AbstractProcessStorage : boost::noncopyable {
 public:
   // capacity is the upper bound of the number of rows this ProcessStorage
@@ -24,6 +34,25 @@ public:
   // Otherwise, row_accessor is not used and can actually be a NULL pointer.
   virtual ClientRow *Find(int32_t row_id, RowAccessor* row_accessor) = 0;
 
+  // Same as above, and sets tier to where the row was found.
+  virtual ClientRow *Find(int32_t row_id, RowAccessor* row_accessor,
+                          RowTier *tier) {
+    ClientRow *client_row = Find(row_id, row_accessor);
+    *tier = (client_row != 0) ? kRowTierCache : kRowTierNone;
+    return client_row;
+  }
+
+  // Same as Find(row_id, row_accessor), but only looks at the rows in
+  // the storage itself: a row in an evicted row store is neither
+  // returned nor brought back. For callers that are about to overwrite
+  // the row (e.g. with a server reply) or only update it, where restoring
+  // the copy would cost a decompression or a disk read and possibly evict
+  // another row.
+  virtual ClientRow *FindResident(int32_t row_id,
+                                  RowAccessor* row_accessor) {
+    return Find(row_id, row_accessor);
+  }
+
   virtual bool Find(int32_t row_id) = 0;
 
   // Insert a row, and take ownership of client_row.
@@ -2,16 +2,37 @@
 // Date: 2014.01.23
 
 #include <utility>
+#include <vector>
+#include <thread>
+#include <chrono>
 #include <petuum_ps_common/storage/bounded_sparse_process_storage.hpp>
 #include <petuum_ps_common/include/constants.hpp>
 
 namespace petuum {
 
+namespace {
+
+// How long an insertion waits before looking for an evictable row again
+// once every row is referenced. RowAccessors release their rows without
+// telling the storage, so the wait is timed.
+const int64_t kEvictRetryMicros = 100;
+
+}  // anonymous namespace
+
 BoundedSparseProcessStorage::BoundedSparseProcessStorage(size_t capacity, size_t lock_pool_size) :
   capacity_(capacity), num_rows_(0),
   storage_map_(capacity * kCuckooExpansionFactor),
   clock_lru_(capacity, lock_pool_size), locks_(lock_pool_size) { }
 
+BoundedSparseProcessStorage::BoundedSparseProcessStorage(
+    size_t capacity, size_t lock_pool_size,
+    AbstractEvictedRowStore *evicted_rows,
+    RestoreClientRowFunc RestoreClientRow) :
+  capacity_(capacity), num_rows_(0),
+  storage_map_(capacity * kCuckooExpansionFactor),
+  clock_lru_(capacity, lock_pool_size), locks_(lock_pool_size),
+  evicted_rows_(evicted_rows), RestoreClientRow_(RestoreClientRow) { }
+
 BoundedSparseProcessStorage::~BoundedSparseProcessStorage() {
   // Iterate through storage_map_ and delete client rows.
   for (auto it = storage_map_.begin(); !it.is_end(); ++it) {
@@ -21,22 +42,41 @@ BoundedSparseProcessStorage::~BoundedSparseProcessStorage() {
 }
 
 ClientRow *BoundedSparseProcessStorage::Find(int32_t row_id, RowAccessor* row_accessor) {
+  RowTier tier;
+  return Find(row_id, row_accessor, &tier);
+}
+
+ClientRow *BoundedSparseProcessStorage::Find(int32_t row_id,
+                                             RowAccessor* row_accessor,
+                                             RowTier *tier) {
+  ClientRow *client_row = FindResident(row_id, row_accessor);
+  if (client_row != 0) {
+    *tier = kRowTierCache;
+    return client_row;
+  }
+  *tier = kRowTierNone;
+  if (evicted_rows_ == 0 || !evicted_rows_->Has(row_id))
+    return 0;
+  return Restore(row_id, row_accessor, tier);
+}
+
+ClientRow *BoundedSparseProcessStorage::FindResident(
+    int32_t row_id, RowAccessor* row_accessor) {
   CHECK_NOTNULL(row_accessor);
   std::pair<ClientRow*, int32_t> row_info;
   // Lock to avoid eviction before incrementing ref count of client_row_ptr.
   Unlocker<> unlocker;
   locks_.Lock(row_id, &unlocker);
   bool found = storage_map_.find(row_id, row_info);
-  if (found) {
-    CHECK_NOTNULL(row_info.first);
-    ClientRow* client_row_ptr = row_info.first;
-    // SetClientRow() increments the ref count and needs to be protected by
-    // lock.
-    row_accessor->SetClientRow(client_row_ptr);
-    clock_lru_.Reference(row_info.second);
-    return client_row_ptr;
-  }
-  return 0;
+  if (!found)
+    return 0;
+  CHECK_NOTNULL(row_info.first);
+  ClientRow* client_row_ptr = row_info.first;
+  // SetClientRow() increments the ref count and needs to be protected by
+  // lock.
+  row_accessor->SetClientRow(client_row_ptr);
+  clock_lru_.Reference(row_info.second);
+  return client_row_ptr;
 }
 
 bool BoundedSparseProcessStorage::Find(int32_t row_id) {
@@ -50,13 +90,19 @@ bool BoundedSparseProcessStorage::Find(int32_t row_id) {
 bool BoundedSparseProcessStorage::Insert(int32_t row_id, ClientRow* client_row) {
   // row_id does not exist in storage. Check space and evict if necessary.
   if (capacity_ < (++num_rows_)) {
-    std::pair<int32_t, ClientRow*> evicted = EvictOneRow();
-    delete evicted.second;
+    EvictOneRow();
   }
   { // This time we can insert for sure.
     Unlocker<> unlocker;
     locks_.Lock(row_id, &unlocker);
     if (Find(row_id)) {
+      --num_rows_;
+      return false;
+    }
+    // client_row supersedes the evicted copy, unless the store says
+    // otherwise.
+    if (evicted_rows_ != 0 && !evicted_rows_->Supersede(row_id)) {
+      --num_rows_;
       return false;
     }
     // Now we can insert row_id without worrying exceeding capacity.
@@ -70,13 +116,25 @@ bool BoundedSparseProcessStorage::Insert(int32_t row_id, ClientRow* client_row)
 
 // ==================== Private Methods ======================
 
-std::pair<int32_t, ClientRow*> BoundedSparseProcessStorage::EvictOneRow() {
+void BoundedSparseProcessStorage::EvictOneRow() {
   --num_rows_;
+  size_t num_referenced = 0;
   while (true) {
-    int32_t evict_candidate = clock_lru_.FindOneToEvict();
-    // Lock to prevent concurrent insert on evict_candidate.
+    int32_t evict_slot;
+    int32_t evict_candidate = clock_lru_.FindOneToEvict(&evict_slot);
+    if (evict_candidate < 0) {
+      std::this_thread::sleep_for(
+          std::chrono::microseconds(kEvictRetryMicros));
+      continue;
+    }
+    // Lock to prevent concurrent insert on evict_candidate. Insert() and
+    // Restore() lock a slot while holding a row lock, so we must not block
+    // on a row lock while holding a slot lock; move on instead.
     Unlocker<> unlocker;
-    locks_.Lock(evict_candidate, &unlocker);
+    if (!locks_.TryLock(evict_candidate, &unlocker)) {
+      clock_lru_.NoEvict(evict_slot);
+      continue;
+    }
     std::pair<ClientRow*, int32_t> row_info;
     CHECK(storage_map_.find(evict_candidate, row_info))
         << "row " << evict_candidate << "cannot possibly be evicted while "
@@ -84,16 +142,65 @@ std::pair<int32_t, ClientRow*> BoundedSparseProcessStorage::EvictOneRow() {
     ClientRow* candidate_client_row_ptr = row_info.first;
 
     if (candidate_client_row_ptr->HasZeroRef()) {
+      // The copy goes in before the row leaves the storage, so that a
+      // concurrent Find() on evict_candidate, which waits on the lock we
+      // hold, finds one or the other.
+      if (evicted_rows_ != 0) {
+        evicted_rows_->Put(evict_candidate, candidate_client_row_ptr);
+      }
       // erase() and Evict() can be called in either order
       storage_map_.erase(evict_candidate);
       clock_lru_.Evict(row_info.second);
-      return std::pair<int32_t, ClientRow*>(evict_candidate,
-                                            candidate_client_row_ptr);
+      delete candidate_client_row_ptr;
+      return;
     } else {
       // Can't evict with non-zero ref count.
       clock_lru_.NoEvict(row_info.second);
+      // Every row is referenced; wait for a RowAccessor to go away.
+      if (++num_referenced >= capacity_) {
+        std::this_thread::sleep_for(
+            std::chrono::microseconds(kEvictRetryMicros));
+        num_referenced = 0;
+      }
     }
   }
 }
 
+ClientRow *BoundedSparseProcessStorage::Restore(int32_t row_id,
+                                                RowAccessor* row_accessor,
+                                                RowTier *tier) {
+  // Make room first; eviction must not happen while holding row_id's lock.
+  if (capacity_ < (++num_rows_)) {
+    EvictOneRow();
+  }
+
+  Unlocker<> unlocker;
+  locks_.Lock(row_id, &unlocker);
+  std::pair<ClientRow*, int32_t> row_info;
+  // Another thread may have restored or inserted row_id meanwhile.
+  if (storage_map_.find(row_id, row_info)) {
+    --num_rows_;
+    row_accessor->SetClientRow(row_info.first);
+    clock_lru_.Reference(row_info.second);
+    *tier = kRowTierCache;
+    return row_info.first;
+  }
+
+  int32_t clock = 0;
+  std::vector<uint8_t> row_bytes;
+  *tier = evicted_rows_->Take(row_id, &clock, &row_bytes);
+  if (*tier == kRowTierNone) {
+    --num_rows_;
+    return 0;
+  }
+
+  ClientRow *client_row = RestoreClientRow_(clock, row_bytes.data(),
+                                            row_bytes.size());
+  row_info.first = client_row;
+  row_info.second = clock_lru_.Insert(row_id);
+  CHECK(storage_map_.insert(row_id, row_info));
+  row_accessor->SetClientRow(client_row);
+  return client_row;
+}
+
 }  // namespace petuum
@@ -7,10 +7,13 @@
 #include <petuum_ps_common/util/striped_lock.hpp>
 #include <petuum_ps_common/storage/clock_lru.hpp>
 #include <petuum_ps_common/storage/abstract_process_storage.hpp>
+#include <petuum_ps_common/storage/abstract_evicted_row_store.hpp>
 #include <libcuckoo/cuckoohash_map.hh>
 #include <atomic>
 #include <utility>
 #include <cstdint>
+#include <memory>
+#include <functional>
 
 namespace petuum {
 
@@ -21,20 +24,42 @@ namespace petuum {
 
 // LRU-based eviction is performed to ensure the size of the storage to
 // not exceed the pre-specified capacity. Eviction can only happen to
-// rows that no RowAccessor refers to.
+// rows that no RowAccessor refers to. When every row is referenced, an
+// insertion blocks until some RowAccessor lets go of its row.
+//
+// With an evicted row store, evicted rows are kept there and a lookup that
+// misses the storage brings the row back from it. With an EvictedRowStore
+// the caller checks the row's clock as for any other row, so a copy that is
+// still fresh enough saves a round trip to the server. With an OOCRowStore
+// (LocalOOC) the store holds the table itself.
 
 class BoundedSparseProcessStorage : public AbstractProcessStorage {
 public:
+  // Creates a ClientRow at clock from a row serialized by
+  // AbstractRow::Serialize().
+  typedef std::function<ClientRow*(int32_t clock, const void *data,
+                                   size_t size)> RestoreClientRowFunc;
+
   // capacity is the upper bound of the number of rows this ProcessStorage
   // can store.
   BoundedSparseProcessStorage(size_t capacity, size_t lock_pool_size);
 
+  // Takes ownership of evicted_rows.
+  BoundedSparseProcessStorage(size_t capacity, size_t lock_pool_size,
+                              AbstractEvictedRowStore *evicted_rows,
+                              RestoreClientRowFunc RestoreClientRow);
+
   ~BoundedSparseProcessStorage();
 
   // Find row row_id. Return true if found, otherwise false.
   ClientRow *Find(int32_t row_id, RowAccessor* row_accessor);
 
-  // Check if a row exists, does not count as one access
+  ClientRow *Find(int32_t row_id, RowAccessor* row_accessor, RowTier *tier);
+
+  ClientRow *FindResident(int32_t row_id, RowAccessor* row_accessor);
+
+  // Check if a row exists, does not count as one access. Rows in the
+  // evicted row store do not count.
   bool Find(int32_t row_id);
 
   // The following cases may cause eviction to occur when it
@@ -51,8 +76,13 @@ public:
   bool Insert(int32_t row_id, ClientRow* client_row);
 
 private:
-  // Evict one inactive row using CLOCK replacement algorithm.
-  std::pair<int32_t, ClientRow*> EvictOneRow();
+  // Evict one inactive row using CLOCK replacement algorithm, moving it to
+  // evicted_rows_ if there is one.
+  void EvictOneRow();
+
+  // Brings row_id back from evicted_rows_; returns 0 if it is not there.
+  ClientRow *Restore(int32_t row_id, RowAccessor* row_accessor,
+                     RowTier *tier);
 
   // Number of rows allowed in this storage.
   size_t capacity_;
@@ -67,6 +97,9 @@ private:
 
   // Lock pool.
   StripedLock<int32_t> locks_;
+
+  std::unique_ptr<AbstractEvictedRowStore> evicted_rows_;
+  RestoreClientRowFunc RestoreClientRow_;
 };
 
 
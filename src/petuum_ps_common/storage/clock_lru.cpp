@@ -6,6 +6,7 @@ const int32_t ClockLRU::MAX_NUM_ROUNDS = 20;
 
 ClockLRU::ClockLRU(int capacity, size_t lock_pool_size) :
   capacity_(capacity), evict_hand_(0), insert_hand_(0),
+  empty_slots_(capacity),
   locks_(lock_pool_size),
   stale_(new std::atomic_flag[capacity]),
   row_ids_(capacity) {
@@ -16,7 +17,7 @@ ClockLRU::ClockLRU(int capacity, size_t lock_pool_size) :
     }
   }
 
-int32_t ClockLRU::FindOneToEvict() {
+int32_t ClockLRU::FindOneToEvict(int32_t *evict_slot) {
   for (int i = 0; i < MAX_NUM_ROUNDS * capacity_; ++i) {
     // Check slot pointed by evict_hand_ and increment it so other thread will
     // not check this slot immediately.
@@ -50,16 +51,18 @@ int32_t ClockLRU::FindOneToEvict() {
     // Found it! Release the lock from unlocker to keep the lock on. slot will
     // be unlocked in Evict() or NoEvict().
     unlocker.Release();
+    *evict_slot = slot;
     return row_ids_[slot];
   }
-  LOG(FATAL) << "Cannot find a slot to evict after the clock hand goes "
-    << MAX_NUM_ROUNDS << " rounds.";
+  // Every slot is either recently used, being inserted to or erased, or
+  // empty. The caller tries again later.
+  return -1;
 }
 
 void ClockLRU::Evict(int32_t slot) {
   // We assume we are holding lock on the slot.
   row_ids_[slot] = -1;
-  empty_slots_.push(slot);
+  empty_slots_.Push(slot);
   locks_.Unlock(slot);
 }
 
@@ -84,7 +87,7 @@ int32_t ClockLRU::FindEmptySlot(
   CHECK_NOTNULL(unlocker);
   // Check empty_slots_.
   int32_t slot = -1;
-  if (empty_slots_.pop(&slot) > 0) {
+  if (empty_slots_.Pop(&slot)) {
     // empty_slots_ has something.
     // This lock should eventually suceed.
     Unlocker<SpinMutex> tmp_unlocker;
@@ -11,7 +11,7 @@
 
 #include <petuum_ps_common/util/striped_lock.hpp>
 #include <petuum_ps_common/util/lock.hpp>
-#include <petuum_ps_common/util/mt_queue.hpp>
+#include <petuum_ps_common/util/mpmc_queue.hpp>
 
 namespace petuum {
 
@@ -27,9 +27,10 @@ public:
   // Find an (infrequently used) row_id, but do not kick it out yet. Return
   // the row_id which is locked to prevent erase or insert (but not
   // refreshing) before user comes back to evict it or unlock it (the row has
-  // positive reference count and can't be evicted). FindOneToEvict will
-  // either return or fail after searching for MAX_NUM_ROUNDS times.
-  int32_t FindOneToEvict();
+  // positive reference count and can't be evicted). FindOneToEvict
+  // returns -1 if it finds nothing after searching for MAX_NUM_ROUNDS times,
+  // in which case nothing is locked. The locked slot is returned in slot.
+  int32_t FindOneToEvict(int32_t *slot);
 
   // User must call Evict or NoEvict after FindOneToEvict to unlock the slot.
   // Note that Reference() called on row_id during Evict() could fail (no-op).
@@ -72,9 +73,9 @@ private:    // private members
   // empty_slots_ will assist finding empty slot.
   std::atomic<int32_t> insert_hand_;
 
-  // Evict() will put the freed slot # to empty_slots_, which is protected by
-  // empty_slots_lock_.
-  MTQueue<int32_t> empty_slots_;
+  // Evict() will put the freed slot # to empty_slots_. A slot is in it at
+  // most once, so capacity_ cells never fill up.
+  MPMCQueue<int32_t> empty_slots_;
 
   // A thread locks a slot when performing insertion and erasure.
   //
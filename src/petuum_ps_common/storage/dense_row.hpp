@@ -11,6 +11,7 @@
 #include <cmath>
 
 #include <petuum_ps_common/util/lock.hpp>
+#include <petuum_ps_common/util/simd_kernels.hpp>
 #include <petuum_ps_common/storage/numeric_container_row.hpp>
 #include <ml/feature/dense_feature.hpp>
 
@@ -18,6 +19,12 @@ namespace petuum {
 
 // V is an arithmetic type. V is the data type and also the update type.
 // V needs to be POD.
+//
+// When compiled with PETUUM_OPTIMISTIC_ROW_READ, the row is guarded by a
+// SeqLock instead of a plain mutex: writers (bg thread applying server
+// replies, app threads Inc-ing) still serialize among themselves, but
+// operator[], CopyToVector() and CopyToDenseFeature() read optimistically
+// and never block on a writer.
 template<typename V>
 class DenseRow : public NumericContainerRow<V>, boost::noncopyable {
 public:
@@ -83,7 +90,13 @@ public:
 
   static_assert(std::is_pod<V>::value, "V must be POD");
 private:
-  mutable std::mutex mtx_;
+#ifdef PETUUM_OPTIMISTIC_ROW_READ
+  typedef SeqLock RowMutex;
+#else
+  typedef std::mutex RowMutex;
+#endif
+
+  mutable RowMutex mtx_;
   std::vector<V> data_;
   int32_t capacity_;
 };
@@ -106,7 +119,7 @@ void DenseRow<V>::Init(int32_t capacity) {
 
 template<typename V>
 AbstractRow *DenseRow<V>::Clone() const {
-  std::unique_lock<std::mutex> lock(mtx_);
+  std::unique_lock<RowMutex> lock(mtx_);
   DenseRow<V> *new_row = new DenseRow<V>();
   new_row->Init(capacity_);
   memcpy(new_row->data_.data(), data_.data(), capacity_*sizeof(V));
@@ -154,14 +167,14 @@ void DenseRow<V>::ReleaseWriteLock() {
 
 template<typename V>
 void DenseRow<V>::ApplyInc(int32_t column_id, const void *update) {
-  std::unique_lock<std::mutex> lock(mtx_);
+  std::unique_lock<RowMutex> lock(mtx_);
   ApplyIncUnsafe(column_id, update);
 }
 
 template<typename V>
 void DenseRow<V>::ApplyBatchInc(const int32_t *column_ids,
     const void* update_batch, int32_t num_updates) {
-  std::unique_lock<std::mutex> lock(mtx_);
+  std::unique_lock<RowMutex> lock(mtx_);
   ApplyBatchIncUnsafe(column_ids, update_batch, num_updates);
 }
 
@@ -174,22 +187,19 @@ template<typename V>
 void DenseRow<V>::ApplyBatchIncUnsafe(const int32_t *column_ids,
   const void *update_batch, int32_t num_updates) {
   const V *update_array = reinterpret_cast<const V*>(update_batch);
-  int i;
-  for (i = 0; i < num_updates; ++i) {
-    data_[column_ids[i]] += update_array[i];
-  }
+  ScatterAdd(data_.data(), column_ids, update_array, num_updates);
 }
 
 template<typename V>
 double DenseRow<V>::ApplyIncGetImportance(int32_t column_id, const void *update) {
-  std::unique_lock<std::mutex> lock(mtx_);
+  std::unique_lock<RowMutex> lock(mtx_);
   return ApplyIncUnsafeGetImportance(column_id, update);
 }
 
 template<typename V>
 double DenseRow<V>::ApplyBatchIncGetImportance(const int32_t *column_ids,
     const void* update_batch, int32_t num_updates) {
-  std::unique_lock<std::mutex> lock(mtx_);
+  std::unique_lock<RowMutex> lock(mtx_);
   return ApplyBatchIncUnsafeGetImportance(column_ids, update_batch,
                                           num_updates);
 }
@@ -208,52 +218,29 @@ template<typename V>
 double DenseRow<V>::ApplyBatchIncUnsafeGetImportance(const int32_t *column_ids,
   const void *update_batch, int32_t num_updates) {
   const V *update_array = reinterpret_cast<const V*>(update_batch);
-  int i;
-  double accum_importance = 0;
-  for (i = 0; i < num_updates; ++i) {
-    double importance
-        = (double(data_[column_ids[i]]) == 0) ? double(update_array[i])
-        : double(update_array[i]) / double(data_[column_ids[i]]);
-    data_[column_ids[i]] += update_array[i];
-
-    accum_importance += std::abs(importance);
-  }
-  return accum_importance;
+  return ScatterAddGetImportance(data_.data(), column_ids, update_array,
+                                 num_updates);
 }
 
 template<typename V>
 double DenseRow<V>::ApplyDenseBatchIncUnsafeGetImportance(
     const void* update_batch, int32_t index_st, int32_t num_updates) {
   const V *update_array = reinterpret_cast<const V*>(update_batch);
-  int i;
-  double accum_importance = 0;
-  for (i = 0; i < num_updates; ++i) {
-    int col_id = i + index_st;
-    double importance
-        = (double(data_[col_id]) == 0) ? double(update_array[i])
-        : double(update_array[i]) / double(data_[col_id]);
-    data_[col_id] += update_array[i];
-
-    accum_importance += std::abs(importance);
-  }
-  return accum_importance;
+  return DenseAddGetImportance(data_.data() + index_st, update_array,
+                               num_updates);
 }
 
 template<typename V>
 void DenseRow<V>::ApplyDenseBatchIncUnsafe(
     const void* update_batch, int32_t index_st, int32_t num_updates) {
   const V *update_array = reinterpret_cast<const V*>(update_batch);
-  int i;
-  for (i = 0; i < num_updates; ++i) {
-    int col_id = i + index_st;
-    data_[col_id] += update_array[i];
-  }
+  DenseAdd(data_.data() + index_st, update_array, num_updates);
 }
 
 template<typename V>
 double DenseRow<V>::ApplyDenseBatchIncGetImportance(
     const void* update_batch, int32_t index_st, int32_t num_updates) {
-  std::unique_lock<std::mutex> lock(mtx_);
+  std::unique_lock<RowMutex> lock(mtx_);
 
   return ApplyDenseBatchIncUnsafeGetImportance(
       update_batch, index_st, num_updates);
@@ -262,14 +249,23 @@ double DenseRow<V>::ApplyDenseBatchIncGetImportance(
 template<typename V>
 void DenseRow<V>::ApplyDenseBatchInc(
     const void* update_batch, int32_t index_st, int32_t num_updates) {
-  std::unique_lock<std::mutex> lock(mtx_);
+  std::unique_lock<RowMutex> lock(mtx_);
   return ApplyDenseBatchIncUnsafe(update_batch, index_st, num_updates);
 }
 
 template<typename V>
 V DenseRow<V>::operator [](int32_t column_id) const {
-  std::unique_lock<std::mutex> lock(mtx_);
+#ifdef PETUUM_OPTIMISTIC_ROW_READ
+  V v;
+  uint32_t version;
+  do {
+    version = mtx_.ReadBegin();
+    v = data_[column_id];
+  } while (mtx_.ReadRetry(version));
+#else
+  std::unique_lock<RowMutex> lock(mtx_);
   V v = data_[column_id];
+#endif
   return v;
 }
 
@@ -280,16 +276,33 @@ int32_t DenseRow<V>::get_capacity(){
 
 template<typename V>
 void DenseRow<V>::CopyToVector(std::vector<V> *to) const {
-  std::unique_lock<std::mutex> lock(mtx_);
+#ifdef PETUUM_OPTIMISTIC_ROW_READ
+  // data_ is only resized by Init() and Deserialize(), which are never
+  // concurrent with reads.
+  to->resize(data_.size());
+  uint32_t version;
+  do {
+    version = mtx_.ReadBegin();
+    memcpy(to->data(), data_.data(), data_.size()*sizeof(V));
+  } while (mtx_.ReadRetry(version));
+#else
+  std::unique_lock<RowMutex> lock(mtx_);
   //CHECK_EQ(to->size(), data_.size());
   to->resize(data_.size());
   std::copy(data_.begin(), data_.end(), to->begin());
+#endif
 }
 
 template<typename V>
 void DenseRow<V>::CopyToDenseFeature(ml::DenseFeature<V>* to) const {
-  std::unique_lock<std::mutex> lock(mtx_);
+#ifdef PETUUM_OPTIMISTIC_ROW_READ
+  std::vector<V> snapshot;
+  CopyToVector(&snapshot);
+  to->Init(snapshot);
+#else
+  std::unique_lock<RowMutex> lock(mtx_);
   to->Init(data_);
+#endif
 }
 
 }
@@ -0,0 +1,254 @@
+#include <petuum_ps_common/storage/evicted_row_store.hpp>
+
+#include <glog/logging.h>
+#include <snappy.h>
+#include <iterator>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+namespace petuum {
+
+EvictedRowStore::EvictedRowStore(size_t mem_capacity,
+                                 const std::string &spill_dir,
+                                 size_t spill_capacity):
+    mem_capacity_(mem_capacity),
+    spill_capacity_(spill_dir.empty() ? 0 : spill_capacity),
+    mem_size_(0),
+    spill_fd_(-1),
+    spill_end_(0) {
+  if (spill_capacity_ == 0)
+    return;
+
+  std::string filename = spill_dir + "/petuum_row_spill.XXXXXX";
+  std::vector<char> filename_buff(filename.begin(), filename.end());
+  filename_buff.push_back('\0');
+  spill_fd_ = mkstemp(filename_buff.data());
+  CHECK_GE(spill_fd_, 0) << "failed to create spill file "
+                         << filename << ": " << strerror(errno);
+  // The file is only scratch space, so it goes away with the process.
+  CHECK_EQ(unlink(filename_buff.data()), 0)
+      << "failed to unlink " << filename_buff.data() << ": "
+      << strerror(errno);
+}
+
+EvictedRowStore::~EvictedRowStore() {
+  if (spill_fd_ >= 0)
+    close(spill_fd_);
+}
+
+void EvictedRowStore::Put(int32_t row_id, ClientRow *client_row) {
+  const AbstractRow &row_data = *client_row->GetRowDataPtr();
+  std::vector<uint8_t> row_bytes(row_data.SerializedSize());
+  size_t row_size = row_data.Serialize(row_bytes.data());
+
+  std::unique_ptr<uint8_t[]> compressed(
+      new uint8_t[snappy::MaxCompressedLength(row_size)]);
+  size_t compressed_size = 0;
+  snappy::RawCompress(reinterpret_cast<const char*>(row_bytes.data()),
+                      row_size, reinterpret_cast<char*>(compressed.get()),
+                      &compressed_size);
+
+  Entry entry;
+  entry.clock = client_row->GetClock();
+  entry.offset = -1;
+  // Rows that do not compress are kept as they are.
+  entry.compressed = (compressed_size < row_size);
+  entry.size = entry.compressed ? compressed_size : row_size;
+  entry.mem.reset(new uint8_t[entry.size]);
+  memcpy(entry.mem.get(),
+         entry.compressed ? compressed.get() : row_bytes.data(), entry.size);
+
+  std::lock_guard<std::mutex> lock(mtx_);
+  auto entry_iter = entries_.find(row_id);
+  if (entry_iter != entries_.end())
+    EraseEntry(entry_iter);
+
+  if (entry.size > mem_capacity_) {
+    int64_t offset = WriteSpill(entry.mem.get(), entry.size);
+    if (offset < 0)
+      return;
+    entry.mem.reset();
+    entry.offset = offset;
+    entries_.insert(std::make_pair(row_id, std::move(entry)));
+    return;
+  }
+
+  while (mem_size_ + entry.size > mem_capacity_)
+    DemoteOldest();
+
+  mem_size_ += entry.size;
+  entry.fifo_iter = mem_fifo_.insert(mem_fifo_.end(), row_id);
+  entries_.insert(std::make_pair(row_id, std::move(entry)));
+}
+
+RowTier EvictedRowStore::Take(int32_t row_id, int32_t *clock,
+                              std::vector<uint8_t> *row_bytes) {
+  std::lock_guard<std::mutex> lock(mtx_);
+  auto entry_iter = entries_.find(row_id);
+  if (entry_iter == entries_.end())
+    return kRowTierNone;
+
+  Entry &entry = entry_iter->second;
+  RowTier tier = kRowTierMem;
+  const uint8_t *data = entry.mem.get();
+  if (entry.offset >= 0) {
+    tier = kRowTierSpill;
+    read_buff_.resize(entry.size);
+    ReadSpill(entry.offset, read_buff_.data(), entry.size);
+    data = read_buff_.data();
+  }
+
+  *clock = entry.clock;
+  if (entry.compressed) {
+    size_t row_size = 0;
+    CHECK(snappy::GetUncompressedLength(
+        reinterpret_cast<const char*>(data), entry.size, &row_size));
+    row_bytes->resize(row_size);
+    CHECK(snappy::RawUncompress(
+        reinterpret_cast<const char*>(data), entry.size,
+        reinterpret_cast<char*>(row_bytes->data())))
+        << "corrupted copy of row " << row_id;
+  } else {
+    row_bytes->assign(data, data + entry.size);
+  }
+
+  EraseEntry(entry_iter);
+  return tier;
+}
+
+bool EvictedRowStore::Has(int32_t row_id) {
+  std::lock_guard<std::mutex> lock(mtx_);
+  return entries_.count(row_id) > 0;
+}
+
+void EvictedRowStore::Erase(int32_t row_id) {
+  std::lock_guard<std::mutex> lock(mtx_);
+  auto entry_iter = entries_.find(row_id);
+  if (entry_iter != entries_.end())
+    EraseEntry(entry_iter);
+}
+
+bool EvictedRowStore::Supersede(int32_t row_id) {
+  Erase(row_id);
+  return true;
+}
+
+// ==================== Private Methods ======================
+
+void EvictedRowStore::EraseEntry(EntryMap::iterator entry_iter) {
+  Entry &entry = entry_iter->second;
+  if (entry.offset >= 0) {
+    FreeSpill(entry.offset, entry.size);
+  } else {
+    mem_size_ -= entry.size;
+    mem_fifo_.erase(entry.fifo_iter);
+  }
+  entries_.erase(entry_iter);
+}
+
+void EvictedRowStore::DemoteOldest() {
+  CHECK(!mem_fifo_.empty());
+  auto entry_iter = entries_.find(mem_fifo_.front());
+  CHECK(entry_iter != entries_.end());
+  Entry &entry = entry_iter->second;
+
+  int64_t offset = WriteSpill(entry.mem.get(), entry.size);
+  if (offset < 0) {
+    EraseEntry(entry_iter);
+    return;
+  }
+  mem_size_ -= entry.size;
+  mem_fifo_.pop_front();
+  entry.mem.reset();
+  entry.offset = offset;
+}
+
+int64_t EvictedRowStore::WriteSpill(const uint8_t *data, size_t size) {
+  if (spill_fd_ < 0)
+    return -1;
+
+  int64_t offset;
+  // Best fit among the freed extents; the rest of the extent stays free.
+  auto extent_iter = free_extents_.lower_bound(size);
+  if (extent_iter != free_extents_.end()) {
+    offset = extent_iter->second;
+    size_t extent_size = extent_iter->first;
+    RemoveFreeExtent(free_offsets_.find(offset));
+    if (extent_size > size)
+      AddFreeExtent(offset + size, extent_size - size);
+  } else if (spill_end_ + size <= spill_capacity_) {
+    offset = spill_end_;
+    spill_end_ += size;
+  } else {
+    return -1;
+  }
+
+  size_t written = 0;
+  while (written < size) {
+    ssize_t ret = pwrite(spill_fd_, data + written, size - written,
+                         offset + written);
+    if (ret < 0 && errno == EINTR)
+      continue;
+    CHECK_GT(ret, 0) << "failed to write spill file: " << strerror(errno);
+    written += ret;
+  }
+  return offset;
+}
+
+void EvictedRowStore::ReadSpill(int64_t offset, uint8_t *data, size_t size) {
+  size_t read_size = 0;
+  while (read_size < size) {
+    ssize_t ret = pread(spill_fd_, data + read_size, size - read_size,
+                        offset + read_size);
+    if (ret < 0 && errno == EINTR)
+      continue;
+    CHECK_GT(ret, 0) << "failed to read spill file: " << strerror(errno);
+    read_size += ret;
+  }
+}
+
+void EvictedRowStore::FreeSpill(int64_t offset, size_t size) {
+  auto next_iter = free_offsets_.lower_bound(offset);
+  if (next_iter != free_offsets_.end()
+      && next_iter->first == offset + static_cast<int64_t>(size)) {
+    size += next_iter->second;
+    RemoveFreeExtent(next_iter++);
+  }
+  if (next_iter != free_offsets_.begin()) {
+    auto prev_iter = std::prev(next_iter);
+    if (prev_iter->first + static_cast<int64_t>(prev_iter->second)
+        == offset) {
+      offset = prev_iter->first;
+      size += prev_iter->second;
+      RemoveFreeExtent(prev_iter);
+    }
+  }
+  // Free space at the end of the file is given back to the end.
+  if (static_cast<size_t>(offset) + size == spill_end_) {
+    spill_end_ = offset;
+    return;
+  }
+  AddFreeExtent(offset, size);
+}
+
+void EvictedRowStore::AddFreeExtent(int64_t offset, size_t size) {
+  free_extents_.insert(std::make_pair(size, offset));
+  free_offsets_.insert(std::make_pair(offset, size));
+}
+
+void EvictedRowStore::RemoveFreeExtent(
+    std::map<int64_t, size_t>::iterator offset_iter) {
+  auto range = free_extents_.equal_range(offset_iter->second);
+  for (auto extent_iter = range.first; extent_iter != range.second;
+       ++extent_iter) {
+    if (extent_iter->second == offset_iter->first) {
+      free_extents_.erase(extent_iter);
+      break;
+    }
+  }
+  free_offsets_.erase(offset_iter);
+}
+
+}  // namespace petuum
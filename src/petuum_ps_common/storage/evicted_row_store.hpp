@@ -0,0 +1,107 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <list>
+#include <map>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <boost/noncopyable.hpp>
+
+#include <petuum_ps_common/include/abstract_row.hpp>
+#include <petuum_ps_common/storage/abstract_evicted_row_store.hpp>
+
+namespace petuum {
+
+// Second cache tier under a process storage. Rows evicted from the process
+// storage are serialized, snappy compressed, and kept in memory up to
+// mem_capacity bytes. When memory is full, the oldest copies are moved to a
+// scratch file under spill_dir (if given) up to spill_capacity bytes, and
+// dropped after that. A copy is handed back at most once (Take()), as the
+// row then lives in the process storage again.
+//
+// Fully thread-safe. Callers serialize operations on the same row_id through
+// the process storage's row locks.
+class EvictedRowStore : public AbstractEvictedRowStore {
+public:
+  EvictedRowStore(size_t mem_capacity, const std::string &spill_dir,
+                  size_t spill_capacity);
+
+  ~EvictedRowStore();
+
+  // Keeps a copy of client_row's data, which was fresh as of its clock,
+  // replacing any older copy of row_id.
+  void Put(int32_t row_id, ClientRow *client_row);
+
+  // Removes the copy of row_id and returns its serialized bytes in row_bytes
+  // and its clock. Returns the tier the copy was found in, kRowTierNone if
+  // there is none.
+  RowTier Take(int32_t row_id, int32_t *clock,
+               std::vector<uint8_t> *row_bytes);
+
+  // Whether there is a copy of row_id.
+  bool Has(int32_t row_id);
+
+  // Drops the copy of row_id if there is one.
+  void Erase(int32_t row_id);
+
+  // Drops the copy of row_id; the newly inserted row is fresher.
+  bool Supersede(int32_t row_id);
+
+private:
+  struct Entry {
+    int32_t clock;
+    bool compressed;
+    size_t size;
+    // Set for copies in memory.
+    std::unique_ptr<uint8_t[]> mem;
+    std::list<int32_t>::iterator fifo_iter;
+    // Offset in the spill file for copies on disk; -1 otherwise.
+    int64_t offset;
+  };
+
+  typedef std::unordered_map<int32_t, Entry> EntryMap;
+
+  // Frees the space held by entry_iter and erases it.
+  void EraseEntry(EntryMap::iterator entry_iter);
+
+  // Moves the oldest copy in memory to the spill file, or drops it if the
+  // spill file is off or full.
+  void DemoteOldest();
+
+  // Returns the offset data is written to, or -1 if the spill file cannot
+  // take size more bytes.
+  int64_t WriteSpill(const uint8_t *data, size_t size);
+
+  void ReadSpill(int64_t offset, uint8_t *data, size_t size);
+
+  // Returns size bytes at offset to the free space of the spill file,
+  // merged with the free extents next to it.
+  void FreeSpill(int64_t offset, size_t size);
+
+  void AddFreeExtent(int64_t offset, size_t size);
+
+  void RemoveFreeExtent(std::map<int64_t, size_t>::iterator offset_iter);
+
+  const size_t mem_capacity_;
+  const size_t spill_capacity_;
+
+  std::mutex mtx_;
+  EntryMap entries_;
+  // Row ids of copies in memory, oldest first.
+  std::list<int32_t> mem_fifo_;
+  size_t mem_size_;
+
+  int spill_fd_;
+  size_t spill_end_;
+  // Space freed in the spill file, no two extents adjacent: size -> offsets
+  // for best fit, and offset -> size for merging.
+  std::multimap<size_t, int64_t> free_extents_;
+  std::map<int64_t, size_t> free_offsets_;
+
+  std::vector<uint8_t> read_buff_;
+};
+
+}  // namespace petuum
@@ -1,5 +1,7 @@
 #pragma once
+#include <type_traits>
 #include <petuum_ps_common/include/abstract_row.hpp>
+#include <petuum_ps_common/util/simd_kernels.hpp>
 #include <glog/logging.h>
 
 namespace petuum {
@@ -7,11 +9,22 @@ namespace petuum {
 template<typename V>
 class NumericContainerRow : public AbstractRow {
 
+virtual bool update_is_float() const {
+  return std::is_same<V, float>::value;
+}
+
 virtual void AddUpdates(int32_t column_id, void *update1,
                 const void *update2) const {
   *(reinterpret_cast<V*>(update1)) += *(reinterpret_cast<const V*>(update2));
 }
 
+virtual void AddDenseUpdates(int32_t index_st __attribute__ ((unused)),
+                             void *updates1, const void *updates2,
+                             int32_t num_updates) const {
+  DenseAdd(reinterpret_cast<V*>(updates1),
+           reinterpret_cast<const V*>(updates2), num_updates);
+}
+
 virtual void SubtractUpdates(int32_t column_id, void *update1,
                      const void *update2) const {
   *(reinterpret_cast<V*>(update1)) -= *(reinterpret_cast<const V*>(update2));
@@ -40,12 +53,7 @@ virtual double GetAccumImportance(
     const int32_t *column_ids __attribute__ ((unused)),
     const void *update_batch, int32_t num_updates) const {
   const V *update_array = reinterpret_cast<const V*>(update_batch);
-  double accum_importance = 0;
-  for (int i = 0; i < num_updates; ++i) {
-    double importance = double(update_array[i]);
-    accum_importance += std::abs(importance);
-  }
-  return accum_importance;
+  return AbsSum(update_array, num_updates);
 }
 
 virtual double GetDenseAccumImportance(
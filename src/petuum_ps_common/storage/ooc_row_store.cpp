@@ -0,0 +1,192 @@
+#include <petuum_ps_common/storage/ooc_row_store.hpp>
+#include <petuum_ps_common/client/ooc_client_row.hpp>
+
+#include <glog/logging.h>
+#include <algorithm>
+#include <utility>
+#include <fcntl.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+namespace petuum {
+
+namespace {
+
+// Copies closer than this in the file are read ahead together.
+const int64_t kPrefetchMergeGap = 64 * 1024;
+
+}  // anonymous namespace
+
+OOCRowStore::OOCRowStore(const std::string &filename):
+    filename_(filename),
+    file_end_(0) {
+  fd_ = open(filename_.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  CHECK_GE(fd_, 0) << "failed to create " << filename_ << ": "
+                   << strerror(errno);
+}
+
+OOCRowStore::~OOCRowStore() {
+  close(fd_);
+  if (unlink(filename_.c_str()) != 0) {
+    LOG(WARNING) << "failed to remove " << filename_ << ": "
+                 << strerror(errno);
+  }
+}
+
+void OOCRowStore::Put(int32_t row_id, ClientRow *client_row) {
+  if (!static_cast<OOCClientRow*>(client_row)->IsDirty())
+    return;
+
+  const AbstractRow &row_data = *client_row->GetRowDataPtr();
+  std::vector<uint8_t> row_bytes(row_data.SerializedSize());
+  size_t row_size = row_data.Serialize(row_bytes.data());
+
+  Extent extent;
+  bool moved = false;
+  Extent old_extent;
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    auto extent_iter = extents_.find(row_id);
+    if (row_size == 0) {
+      // Same as a row that was never written.
+      if (extent_iter != extents_.end()) {
+        free_extents_.insert(std::make_pair(extent_iter->second.capacity,
+                                            extent_iter->second.offset));
+        extents_.erase(extent_iter);
+      }
+      return;
+    }
+
+    if (extent_iter != extents_.end()
+        && row_size <= extent_iter->second.capacity) {
+      extent = extent_iter->second;
+    } else {
+      if (extent_iter != extents_.end()) {
+        moved = true;
+        old_extent = extent_iter->second;
+      }
+      extent.offset = Allocate(row_size);
+      extent.capacity = row_size;
+    }
+    extent.size = row_size;
+  }
+
+  // The old copy stays valid until the index points to the new one.
+  Write(extent.offset, row_bytes.data(), row_size);
+
+  std::lock_guard<std::mutex> lock(mtx_);
+  extents_[row_id] = extent;
+  if (moved) {
+    free_extents_.insert(std::make_pair(old_extent.capacity,
+                                        old_extent.offset));
+  }
+}
+
+RowTier OOCRowStore::Take(int32_t row_id, int32_t *clock,
+                          std::vector<uint8_t> *row_bytes) {
+  Extent extent;
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    auto extent_iter = extents_.find(row_id);
+    if (extent_iter == extents_.end())
+      return kRowTierNone;
+    extent = extent_iter->second;
+  }
+
+  *clock = 0;
+  row_bytes->resize(extent.size);
+  Read(extent.offset, row_bytes->data(), extent.size);
+  return kRowTierSpill;
+}
+
+bool OOCRowStore::Has(int32_t row_id) {
+  std::lock_guard<std::mutex> lock(mtx_);
+  return extents_.count(row_id) > 0;
+}
+
+bool OOCRowStore::Supersede(int32_t row_id) {
+  return !Has(row_id);
+}
+
+void OOCRowStore::Prefetch(const std::vector<int32_t> &row_ids) {
+  std::vector<std::pair<int64_t, int64_t> > ranges;
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    for (int32_t row_id : row_ids) {
+      auto extent_iter = extents_.find(row_id);
+      if (extent_iter == extents_.end())
+        continue;
+      const Extent &extent = extent_iter->second;
+      ranges.push_back(std::make_pair(extent.offset,
+                                      extent.offset + extent.size));
+    }
+  }
+  if (ranges.empty())
+    return;
+
+  std::sort(ranges.begin(), ranges.end());
+  int64_t begin = ranges[0].first;
+  int64_t end = ranges[0].second;
+  for (size_t i = 1; i <= ranges.size(); ++i) {
+    if (i < ranges.size() && ranges[i].first <= end + kPrefetchMergeGap) {
+      end = std::max(end, ranges[i].second);
+      continue;
+    }
+    // Only a hint; failure is harmless.
+    posix_fadvise(fd_, begin, end - begin, POSIX_FADV_WILLNEED);
+    if (i < ranges.size()) {
+      begin = ranges[i].first;
+      end = ranges[i].second;
+    }
+  }
+}
+
+// ==================== Private Methods ======================
+
+int64_t OOCRowStore::Allocate(size_t capacity) {
+  // Best fit among the freed extents; the rest of the extent stays free.
+  auto extent_iter = free_extents_.lower_bound(capacity);
+  if (extent_iter == free_extents_.end()) {
+    int64_t offset = file_end_;
+    file_end_ += capacity;
+    return offset;
+  }
+
+  int64_t offset = extent_iter->second;
+  size_t extent_size = extent_iter->first;
+  free_extents_.erase(extent_iter);
+  if (extent_size > capacity) {
+    free_extents_.insert(std::make_pair(extent_size - capacity,
+                                        offset + capacity));
+  }
+  return offset;
+}
+
+void OOCRowStore::Write(int64_t offset, const uint8_t *data, size_t size) {
+  size_t written = 0;
+  while (written < size) {
+    ssize_t ret = pwrite(fd_, data + written, size - written,
+                         offset + written);
+    if (ret < 0 && errno == EINTR)
+      continue;
+    CHECK_GT(ret, 0) << "failed to write " << filename_ << ": "
+                     << strerror(errno);
+    written += ret;
+  }
+}
+
+void OOCRowStore::Read(int64_t offset, uint8_t *data, size_t size) {
+  size_t read_size = 0;
+  while (read_size < size) {
+    ssize_t ret = pread(fd_, data + read_size, size - read_size,
+                        offset + read_size);
+    if (ret < 0 && errno == EINTR)
+      continue;
+    CHECK_GT(ret, 0) << "failed to read " << filename_ << ": "
+                     << strerror(errno);
+    read_size += ret;
+  }
+}
+
+}  // namespace petuum
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <mutex>
+
+#include <petuum_ps_common/storage/abstract_evicted_row_store.hpp>
+
+namespace petuum {
+
+// Disk store of a LocalOOC table, under the table's BoundedSparseProcessStorage
+// (the hot row cache). Rows evicted from the cache are written back to a
+// file if they are dirty (OOCClientRow), and read back when missed. A row
+// that was never written is empty, so the process storage creates it
+// instead.
+//
+// Rows are stored serialized, one extent each, and rewritten in place if they
+// still fit; otherwise they move to the best fitting freed extent or to the
+// end of the file. The extent index is in memory. Disk IO happens outside of
+// the store's lock, so threads reading and writing different rows do not
+// wait on each other.
+class OOCRowStore : public AbstractEvictedRowStore {
+public:
+  // Creates filename, truncating it. The file is removed at destruction, as
+  // it only holds the table for the lifetime of the process.
+  explicit OOCRowStore(const std::string &filename);
+
+  ~OOCRowStore();
+
+  // Writes client_row, an OOCClientRow, back if it is dirty.
+  void Put(int32_t row_id, ClientRow *client_row);
+
+  // Reads the copy of row_id, which stays in the file. clock is 0.
+  RowTier Take(int32_t row_id, int32_t *clock,
+               std::vector<uint8_t> *row_bytes);
+
+  bool Has(int32_t row_id);
+
+  // A row with a copy in the file is never created afresh.
+  bool Supersede(int32_t row_id);
+
+  // Asks the OS to read ahead the copies of row_ids, e.g. those that a
+  // batched get is about to miss. Returns right away.
+  void Prefetch(const std::vector<int32_t> &row_ids);
+
+private:
+  struct Extent {
+    int64_t offset;
+    // Serialized row.
+    size_t size;
+    // Space reserved, >= size.
+    size_t capacity;
+  };
+
+  typedef std::unordered_map<int32_t, Extent> ExtentMap;
+
+  // Returns the offset of capacity bytes of free space.
+  int64_t Allocate(size_t capacity);
+
+  void Write(int64_t offset, const uint8_t *data, size_t size);
+
+  void Read(int64_t offset, uint8_t *data, size_t size);
+
+  const std::string filename_;
+  int fd_;
+
+  std::mutex mtx_;
+  ExtentMap extents_;
+  int64_t file_end_;
+  // Space freed in the file: size -> offsets.
+  std::multimap<size_t, int64_t> free_extents_;
+};
+
+}  // namespace petuum
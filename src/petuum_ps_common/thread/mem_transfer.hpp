@@ -2,14 +2,20 @@
 #include <petuum_ps_common/thread/msg_base.hpp>
 #include <petuum_ps_common/util/mem_block.hpp>
 #include <petuum_ps_common/comm_bus/comm_bus.hpp>
+#include <vector>
+#include <atomic>
 
 namespace petuum {
 class MemTransfer {
 public:
-  // Transfer memory of msg (of type MemBlock) ownership to thread recv_id, who is
-  // responsible for destroying the received MemBlock via DestroyTransferredMem().
-  // Return true if the memory is transferred without copying otherwise return false.
-  // MemBlock is released from msg regardless wether or not the memory is copied.
+  // Transfer memory of msg (of type MemBlock) ownership to thread recv_id.
+  // If recv_id is local, the receiver is responsible for destroying the
+  // received MemBlock via DestroyTransferredMem() and true is returned.
+  // Otherwise the MemBlock is handed to zmq as the message body
+  // (zmq_msg_init_data), so the network send does not copy it either; zmq
+  // frees it via ZmqFreeTransferredMem() once it is on the wire, and false is
+  // returned.
+  // MemBlock is released from msg in both cases, so msg must not be reused.
   static bool TransferMem(CommBus *comm_bus, int32_t recv_id, ArbitrarySizedMsg *msg) {
     if (comm_bus->IsLocalEntity(recv_id)) {
       MemTransferMsg mem_transfer_msg;
@@ -19,18 +25,63 @@ public:
       CHECK_EQ(sent_size, mem_transfer_msg.get_size());
       return true;
     } else {
-      size_t sent_size = comm_bus->SendInterProc(recv_id, msg->get_mem(),
-        msg->get_size());
-      CHECK_EQ(sent_size, msg->get_size());
+      size_t msg_size = msg->get_size();
+      zmq::message_t zmq_msg(msg->ReleaseMem(), msg_size,
+                             ZmqFreeTransferredMem, 0);
+      size_t sent_size = comm_bus->SendInterProc(recv_id, zmq_msg);
+      CHECK_EQ(sent_size, msg_size);
       return false;
     }
   }
 
+  // Sends the memory of msg to each of recv_ids without copying it: every
+  // receiver gets a zmq message whose body is that same memory
+  // (zmq_msg_init_data), which is freed once the last of them is done with
+  // it. Unlike TransferMem(), local receivers get the message itself rather
+  // than a MemTransferMsg, and none of them may modify it.
+  // MemBlock is released from msg, so msg must not be reused.
+  static void TransferMemShared(CommBus *comm_bus,
+                                const std::vector<int32_t> &recv_ids,
+                                ArbitrarySizedMsg *msg) {
+    size_t msg_size = msg->get_size();
+    void *mem = msg->ReleaseMem();
+    if (recv_ids.empty()) {
+      MemBlock::MemFree(reinterpret_cast<uint8_t*>(mem));
+      return;
+    }
+
+    std::atomic<size_t> *ref_count
+        = new std::atomic<size_t>(recv_ids.size());
+    for (int32_t recv_id : recv_ids) {
+      zmq::message_t zmq_msg(mem, msg_size, ZmqFreeSharedMem, ref_count);
+      size_t sent_size = comm_bus->Send(recv_id, zmq_msg);
+      CHECK_EQ(sent_size, msg_size);
+    }
+  }
+
   static void DestroyTransferredMem(void *mem){
     MemBlock::MemFree(reinterpret_cast<uint8_t*>(mem));
   }
 
 private:
+  // Release hook of zmq messages created by TransferMem(); called by zmq
+  // (possibly from its io thread) when it no longer needs the data.
+  static void ZmqFreeTransferredMem(void *data,
+                                    void *hint __attribute__ ((unused)) ) {
+    MemBlock::MemFree(reinterpret_cast<uint8_t*>(data));
+  }
+
+  // Release hook of zmq messages created by TransferMemShared(); hint is the
+  // number of those messages not yet released.
+  static void ZmqFreeSharedMem(void *data, void *hint) {
+    std::atomic<size_t> *ref_count
+        = reinterpret_cast<std::atomic<size_t>*>(hint);
+    if (--(*ref_count) == 0) {
+      MemBlock::MemFree(reinterpret_cast<uint8_t*>(data));
+      delete ref_count;
+    }
+  }
+
   // Use msg's content to construct a MemTransferMsg to transfer memory
   // ownership between threads. That means if msg's mem should not be destroyed
   // by the sender. Therefore, InitMemTransferMsg lets msgg release its control
@@ -33,6 +33,10 @@ enum MsgType {
   kServerPushRow = 18,
   kServerOpLogAck = 19,
   kBgHandleAppendOpLog = 20,
+  kClientAggrOpLog = 21,
+  kAggrSendOpLog = 22,
+  kBulkRowRequest = 23,
+  kServerBulkRowRequestReply = 24,
   kMemTransfer = 50
 };
 
@@ -0,0 +1,62 @@
+#include <petuum_ps_common/util/latency_histogram.hpp>
+
+#include <cmath>
+
+namespace petuum {
+
+const int32_t LatencyHistogram::kSubBucketBits;
+const int32_t LatencyHistogram::kMaxValueBits;
+const int32_t LatencyHistogram::kNumBuckets;
+
+LatencyHistogram::LatencyHistogram():
+    sum_ns_(0) {
+  for (int32_t i = 0; i < kNumBuckets; ++i)
+    counts_[i].store(0, std::memory_order_relaxed);
+}
+
+void LatencyHistogram::GetSnapshot(Snapshot *snapshot) const {
+  snapshot->counts.resize(kNumBuckets);
+  for (int32_t i = 0; i < kNumBuckets; ++i)
+    snapshot->counts[i] = counts_[i].load(std::memory_order_relaxed);
+  snapshot->sum_ns = sum_ns_.load(std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::BucketUpperBound(int32_t index) {
+  if (index < (1 << kSubBucketBits))
+    return index;
+  int32_t shift = (index >> kSubBucketBits) - 1;
+  uint64_t sub_bucket = (index & ((1 << kSubBucketBits) - 1))
+                        + (1ul << kSubBucketBits);
+  return ((sub_bucket + 1) << shift) - 1;
+}
+
+uint64_t LatencyHistogram::Snapshot::Count() const {
+  uint64_t count = 0;
+  for (uint64_t c : counts)
+    count += c;
+  return count;
+}
+
+uint64_t LatencyHistogram::Snapshot::Quantile(double q) const {
+  uint64_t count = Count();
+  if (count == 0)
+    return 0;
+  uint64_t rank = static_cast<uint64_t>(std::ceil(q * count));
+  if (rank == 0)
+    rank = 1;
+  uint64_t seen = 0;
+  for (int32_t i = 0; i < kNumBuckets; ++i) {
+    seen += counts[i];
+    if (seen >= rank)
+      return BucketUpperBound(i);
+  }
+  return BucketUpperBound(kNumBuckets - 1);
+}
+
+void LatencyHistogram::Snapshot::Subtract(const Snapshot &earlier) {
+  for (int32_t i = 0; i < kNumBuckets; ++i)
+    counts[i] -= earlier.counts[i];
+  sum_ns -= earlier.sum_ns;
+}
+
+}  // namespace petuum
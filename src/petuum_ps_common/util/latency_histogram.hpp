@@ -0,0 +1,81 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <vector>
+
+namespace petuum {
+
+// Log-bucketed latency histogram in nanoseconds, in the manner of
+// HdrHistogram: values below 2^kSubBucketBits have a bucket each, and every
+// power of 2 above is split into 2^kSubBucketBits linear sub-buckets, so a
+// bucket is never wider than 1/16 of its lower bound. Values above
+// 2^kMaxValueBits ns (about 73 minutes) land in the last bucket.
+//
+// Record() is only called by the thread owning the histogram and costs a few
+// relaxed loads and stores. Any thread may take a Snapshot() concurrently; it
+// may miss the values being recorded meanwhile, but never sees a torn count.
+class LatencyHistogram {
+public:
+  static const int32_t kSubBucketBits = 4;
+  static const int32_t kMaxValueBits = 42;
+  static const int32_t kNumBuckets
+  = (kMaxValueBits - kSubBucketBits + 2) << kSubBucketBits;
+
+  // Counts copied out of a LatencyHistogram; also what an interval's
+  // histogram is computed in (see Subtract()).
+  struct Snapshot {
+    std::vector<uint64_t> counts;
+    uint64_t sum_ns;
+
+    Snapshot():
+        counts(kNumBuckets, 0),
+        sum_ns(0) { }
+
+    uint64_t Count() const;
+
+    // Upper bound of the bucket holding the q-quantile (0 < q <= 1), 0 if
+    // empty.
+    uint64_t Quantile(double q) const;
+
+    // Removes an earlier snapshot of the same histogram, leaving what was
+    // recorded in between.
+    void Subtract(const Snapshot &earlier);
+  };
+
+  LatencyHistogram();
+
+  void Record(uint64_t ns) {
+    std::atomic<uint64_t> &count = counts_[BucketIndex(ns)];
+    count.store(count.load(std::memory_order_relaxed) + 1,
+                std::memory_order_relaxed);
+    sum_ns_.store(sum_ns_.load(std::memory_order_relaxed) + ns,
+                  std::memory_order_relaxed);
+  }
+
+  void RecordSec(double sec) {
+    Record(sec > 0 ? static_cast<uint64_t>(sec * 1e9) : 0);
+  }
+
+  void GetSnapshot(Snapshot *snapshot) const;
+
+  static int32_t BucketIndex(uint64_t ns) {
+    if (ns < (1ul << kSubBucketBits))
+      return static_cast<int32_t>(ns);
+    int32_t msb = 63 - __builtin_clzl(ns);
+    if (msb > kMaxValueBits)
+      return kNumBuckets - 1;
+    int32_t shift = msb - kSubBucketBits;
+    return ((shift + 1) << kSubBucketBits)
+        + static_cast<int32_t>((ns >> shift) - (1ul << kSubBucketBits));
+  }
+
+  // Largest value that falls in bucket index.
+  static uint64_t BucketUpperBound(int32_t index);
+
+private:
+  std::atomic<uint64_t> counts_[kNumBuckets];
+  std::atomic<uint64_t> sum_ns_;
+};
+
+}  // namespace petuum
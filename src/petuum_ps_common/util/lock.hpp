@@ -6,6 +6,7 @@
 #include <petuum_ps_common/util/lockable.hpp>
 #include <pthread.h>
 #include <atomic>
+#include <cstdint>
 #include <mutex>
 #include <boost/utility.hpp>
 
@@ -103,6 +104,71 @@ private:
 } __attribute__((aligned(64)));
 
 
+// Sequence lock: writers are serialized by a mutex and bump a version
+// counter before and after modifying the protected data, so the version is
+// odd while a write is in progress. Readers never block; they snapshot the
+// version, copy the data out and retry if a writer intervened.
+//
+// Usage:
+// {
+//    std::unique_lock<SeqLock> lock(seq_lock);
+//    // Modify protected data
+// }
+// {
+//    uint32_t version;
+//    do {
+//      version = seq_lock.ReadBegin();
+//      // Copy protected data out; do not act on it inside the loop
+//    } while (seq_lock.ReadRetry(version));
+// }
+class SeqLock : public Lockable {
+public:
+  SeqLock():
+      version_(0) { }
+
+  inline void lock() {
+    mtx_.lock();
+    version_.store(version_.load(std::memory_order_relaxed) + 1,
+                   std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+  }
+
+  inline void unlock() {
+    version_.store(version_.load(std::memory_order_relaxed) + 1,
+                   std::memory_order_release);
+    mtx_.unlock();
+  }
+
+  inline bool try_lock() {
+    if (!mtx_.try_lock())
+      return false;
+    version_.store(version_.load(std::memory_order_relaxed) + 1,
+                   std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    return true;
+  }
+
+  // Spins while a write is in progress and returns the (even) version.
+  inline uint32_t ReadBegin() const {
+    uint32_t version = version_.load(std::memory_order_acquire);
+    while (version & 1) {
+      version = version_.load(std::memory_order_acquire);
+    }
+    return version;
+  }
+
+  // True if the data read since ReadBegin() may be torn.
+  inline bool ReadRetry(uint32_t version) const {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return version_.load(std::memory_order_relaxed) != version;
+  }
+
+private:
+  std::mutex mtx_;
+  std::atomic<uint32_t> version_;
+};
+
+
 // It takes an acquired lock and unlock it in destructor.
 template<typename MUTEX = std::mutex>
 class Unlocker : boost::noncopyable {
@@ -3,10 +3,12 @@
 
 #pragma once
 
-#include <cassert>
-#include <cstring>
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <mutex>
+#include <thread>
 
 #include <memory>
 #include <boost/noncopyable.hpp>
@@ -14,48 +16,141 @@
 namespace petuum {
 
 // MPMCQueue is a multi-producer-multi-consumer bounded buffer.
-
+//
+// Lock-free (Dmitry Vyukov's bounded MPMC queue): each cell carries a
+// sequence number that tells producers and consumers whether it is theirs
+// for the current lap, so Push() and Pop() are one CAS on the tail or head
+// in the common case. capacity is rounded up to a power of 2.
+//
+// Push() on a full queue spins for a while and then parks on a condition
+// variable until a Pop() makes room; the mutex is only touched when a
+// producer is parked.
 template<typename T>
 class MPMCQueue : boost::noncopyable {
 public:
   MPMCQueue(size_t capacity)
-  : capacity_(capacity),
-    size_(0),
-    buffer_(new T[capacity]) {
-    begin_ = buffer_.get();
-    end_ = begin_;
+  : mask_(RoundUpPow2(capacity) - 1),
+    cells_(new Cell[mask_ + 1]),
+    head_(0),
+    tail_(0),
+    num_parked_(0) {
+    for (size_t i = 0; i <= mask_; ++i)
+      cells_[i].seq.store(i, std::memory_order_relaxed);
   }
 
   ~MPMCQueue() { }
 
+  // Approximate when there are concurrent Push() or Pop().
   size_t get_size() const {
-    return size_;
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    size_t head = head_.load(std::memory_order_relaxed);
+    return (tail > head) ? tail - head : 0;
+  }
+
+  // Returns false if the queue is full.
+  bool TryPush(const T& value) {
+    Cell *cell;
+    size_t pos = tail_.load(std::memory_order_relaxed);
+    while (true) {
+      cell = &cells_[pos & mask_];
+      size_t seq = cell->seq.load(std::memory_order_acquire);
+      intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+      if (diff == 0) {
+        if (tail_.compare_exchange_weak(pos, pos + 1,
+                                        std::memory_order_relaxed))
+          break;
+      } else if (diff < 0) {
+        // The cell still holds the value from the previous lap.
+        return false;
+      } else {
+        pos = tail_.load(std::memory_order_relaxed);
+      }
+    }
+    cell->value = value;
+    cell->seq.store(pos + 1, std::memory_order_release);
+    return true;
   }
 
+  // Blocks while the queue is full.
   void Push(const T& value) {
+    for (int32_t i = 0; i < kNumSpins; ++i) {
+      if (TryPush(value))
+        return;
+      if (i >= kNumSpins / 2)
+        std::this_thread::yield();
+    }
+
     std::unique_lock<std::mutex> lock(mtx_);
-    while (size_ == capacity_) cv_.wait(lock);
-    memcpy(end_, &value, sizeof(T));
-    end_++;
-    size_++;
-    if (end_ == buffer_.get() + capacity_) end_ = buffer_.get();
+    num_parked_.fetch_add(1, std::memory_order_seq_cst);
+    while (!TryPush(value)) {
+      // The timeout covers a Pop() that checked num_parked_ before we
+      // incremented it.
+      cv_.wait_for(lock, std::chrono::milliseconds(1));
+    }
+    num_parked_.fetch_sub(1, std::memory_order_relaxed);
   }
 
+  // Returns false if the queue is empty.
   bool Pop(T* value) {
-    std::unique_lock<std::mutex> lock(mtx_);
-    if (size_ == 0) return false;
-    if (size_ == capacity_) cv_.notify_all();
-    *value = *begin_;
-    begin_++;
-    size_--;
-    if (begin_ == buffer_.get() + capacity_) begin_ = buffer_.get();
+    Cell *cell;
+    size_t pos = head_.load(std::memory_order_relaxed);
+    while (true) {
+      cell = &cells_[pos & mask_];
+      size_t seq = cell->seq.load(std::memory_order_acquire);
+      intptr_t diff = static_cast<intptr_t>(seq)
+                      - static_cast<intptr_t>(pos + 1);
+      if (diff == 0) {
+        if (head_.compare_exchange_weak(pos, pos + 1,
+                                        std::memory_order_relaxed))
+          break;
+      } else if (diff < 0) {
+        // Only empty if no Push() has claimed the cell yet; otherwise wait
+        // for it to publish, so that a value pushed before Pop() is never
+        // missed (ClockLRU relies on that).
+        if (tail_.load(std::memory_order_acquire) == pos)
+          return false;
+        std::this_thread::yield();
+        pos = head_.load(std::memory_order_relaxed);
+      } else {
+        pos = head_.load(std::memory_order_relaxed);
+      }
+    }
+    *value = cell->value;
+    cell->seq.store(pos + mask_ + 1, std::memory_order_release);
+
+    if (num_parked_.load(std::memory_order_seq_cst) > 0) {
+      std::lock_guard<std::mutex> lock(mtx_);
+      cv_.notify_all();
+    }
     return true;
   }
 
 private:
-  size_t capacity_, size_;
-  std::unique_ptr<T[]> buffer_;
-  T *begin_, *end_;
+  static const int32_t kNumSpins = 128;
+
+  struct Cell {
+    std::atomic<size_t> seq;
+    T value;
+  };
+
+  static size_t RoundUpPow2(size_t n) {
+    size_t pow2 = 1;
+    while (pow2 < n) pow2 <<= 1;
+    return pow2;
+  }
+
+  const size_t mask_;
+  std::unique_ptr<Cell[]> cells_;
+
+  // head_ and tail_ are on separate cache lines from each other and from
+  // the read-mostly members above.
+  char pad0_[64];
+  std::atomic<size_t> head_;
+  char pad1_[64];
+  std::atomic<size_t> tail_;
+  char pad2_[64];
+
+  std::atomic<int32_t> num_parked_;
   std::mutex mtx_;
   std::condition_variable cv_;
 };
@@ -0,0 +1,457 @@
+#include <petuum_ps_common/util/simd_kernels.hpp>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define PETUUM_SIMD_X86
+#include <immintrin.h>
+#endif
+
+namespace petuum {
+
+namespace {
+
+enum SIMDLevel {
+  kScalar = 0,
+  kSSE2 = 1,
+  kAVX2 = 2
+};
+
+SIMDLevel DetectSIMDLevel() {
+#ifdef PETUUM_SIMD_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+    return kAVX2;
+  if (__builtin_cpu_supports("sse2"))
+    return kSSE2;
+#endif
+  return kScalar;
+}
+
+SIMDLevel GetSIMDLevel() {
+  static const SIMDLevel level = DetectSIMDLevel();
+  return level;
+}
+
+template<typename V>
+struct KernelTable {
+  void (*DenseAdd)(V *dst, const V *src, int32_t num);
+  double (*DenseAddGetImportance)(V *dst, const V *src, int32_t num);
+  double (*ScatterAddGetImportance)(V *dst, const int32_t *idx, const V *src,
+                                    int32_t num);
+  double (*AbsSum)(const V *src, int32_t num);
+};
+
+template<typename V>
+KernelTable<V> MakeScalarKernelTable() {
+  KernelTable<V> table;
+  table.DenseAdd = &ScalarKernels<V>::DenseAdd;
+  table.DenseAddGetImportance = &ScalarKernels<V>::DenseAddGetImportance;
+  table.ScatterAddGetImportance = &ScalarKernels<V>::ScatterAddGetImportance;
+  table.AbsSum = &ScalarKernels<V>::AbsSum;
+  return table;
+}
+
+#ifdef PETUUM_SIMD_X86
+
+#define PETUUM_TARGET_SSE2 __attribute__((target("sse2")))
+#define PETUUM_TARGET_AVX2 __attribute__((target("avx2")))
+
+// ======================== SSE2 ========================
+// Importance is computed on pairs of double lanes; elements are processed
+// four at a time.
+
+template<typename V>
+struct SSE2Ops;
+
+template<>
+struct SSE2Ops<float> {
+  PETUUM_TARGET_SSE2 static inline void Load4(
+      const float *p, __m128d *lo, __m128d *hi) {
+    __m128 v = _mm_loadu_ps(p);
+    *lo = _mm_cvtps_pd(v);
+    *hi = _mm_cvtps_pd(_mm_movehl_ps(v, v));
+  }
+
+  PETUUM_TARGET_SSE2 static inline void Add4(float *dst, const float *src) {
+    _mm_storeu_ps(dst, _mm_add_ps(_mm_loadu_ps(dst), _mm_loadu_ps(src)));
+  }
+};
+
+template<>
+struct SSE2Ops<double> {
+  PETUUM_TARGET_SSE2 static inline void Load4(
+      const double *p, __m128d *lo, __m128d *hi) {
+    *lo = _mm_loadu_pd(p);
+    *hi = _mm_loadu_pd(p + 2);
+  }
+
+  PETUUM_TARGET_SSE2 static inline void Add4(double *dst, const double *src) {
+    _mm_storeu_pd(dst, _mm_add_pd(_mm_loadu_pd(dst), _mm_loadu_pd(src)));
+    _mm_storeu_pd(dst + 2, _mm_add_pd(_mm_loadu_pd(dst + 2),
+                                      _mm_loadu_pd(src + 2)));
+  }
+};
+
+template<>
+struct SSE2Ops<int32_t> {
+  PETUUM_TARGET_SSE2 static inline void Load4(
+      const int32_t *p, __m128d *lo, __m128d *hi) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    *lo = _mm_cvtepi32_pd(v);
+    *hi = _mm_cvtepi32_pd(_mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+  }
+
+  PETUUM_TARGET_SSE2 static inline void Add4(int32_t *dst,
+                                             const int32_t *src) {
+    __m128i *dst_v = reinterpret_cast<__m128i*>(dst);
+    _mm_storeu_si128(dst_v, _mm_add_epi32(
+        _mm_loadu_si128(dst_v),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src))));
+  }
+};
+
+// |u / (o == 0 ? 1 : o)|
+PETUUM_TARGET_SSE2 inline __m128d RelativeMagnitudeSSE2(__m128d u,
+                                                        __m128d o) {
+  __m128d zero_mask = _mm_cmpeq_pd(o, _mm_setzero_pd());
+  __m128d denom = _mm_or_pd(_mm_and_pd(zero_mask, _mm_set1_pd(1.0)),
+                            _mm_andnot_pd(zero_mask, o));
+  return _mm_andnot_pd(_mm_set1_pd(-0.0), _mm_div_pd(u, denom));
+}
+
+PETUUM_TARGET_SSE2 inline double HorizontalSumSSE2(__m128d v) {
+  double lanes[2];
+  _mm_storeu_pd(lanes, v);
+  return lanes[0] + lanes[1];
+}
+
+template<typename V>
+PETUUM_TARGET_SSE2 void DenseAddSSE2(V *dst, const V *src, int32_t num) {
+  int32_t i = 0;
+  for (; i + 4 <= num; i += 4) {
+    SSE2Ops<V>::Add4(dst + i, src + i);
+  }
+  ScalarKernels<V>::DenseAdd(dst + i, src + i, num - i);
+}
+
+template<typename V>
+PETUUM_TARGET_SSE2 double DenseAddGetImportanceSSE2(
+    V *dst, const V *src, int32_t num) {
+  __m128d accum = _mm_setzero_pd();
+  int32_t i = 0;
+  for (; i + 4 <= num; i += 4) {
+    __m128d o_lo, o_hi, u_lo, u_hi;
+    SSE2Ops<V>::Load4(dst + i, &o_lo, &o_hi);
+    SSE2Ops<V>::Load4(src + i, &u_lo, &u_hi);
+    accum = _mm_add_pd(accum, RelativeMagnitudeSSE2(u_lo, o_lo));
+    accum = _mm_add_pd(accum, RelativeMagnitudeSSE2(u_hi, o_hi));
+    SSE2Ops<V>::Add4(dst + i, src + i);
+  }
+  return HorizontalSumSSE2(accum)
+      + ScalarKernels<V>::DenseAddGetImportance(dst + i, src + i, num - i);
+}
+
+template<typename V>
+PETUUM_TARGET_SSE2 double AbsSumSSE2(const V *src, int32_t num) {
+  const __m128d sign_mask = _mm_set1_pd(-0.0);
+  __m128d accum = _mm_setzero_pd();
+  int32_t i = 0;
+  for (; i + 4 <= num; i += 4) {
+    __m128d u_lo, u_hi;
+    SSE2Ops<V>::Load4(src + i, &u_lo, &u_hi);
+    accum = _mm_add_pd(accum, _mm_andnot_pd(sign_mask, u_lo));
+    accum = _mm_add_pd(accum, _mm_andnot_pd(sign_mask, u_hi));
+  }
+  return HorizontalSumSSE2(accum)
+      + ScalarKernels<V>::AbsSum(src + i, num - i);
+}
+
+// SSE2 has no gather; the scatter variant stays scalar.
+template<typename V>
+KernelTable<V> MakeSSE2KernelTable() {
+  KernelTable<V> table = MakeScalarKernelTable<V>();
+  table.DenseAdd = &DenseAddSSE2<V>;
+  table.DenseAddGetImportance = &DenseAddGetImportanceSSE2<V>;
+  table.AbsSum = &AbsSumSSE2<V>;
+  return table;
+}
+
+// ======================== AVX2 ========================
+// Importance is computed on four double lanes. Plain adds use the full
+// 256-bit width of V.
+
+template<typename V>
+struct AVX2Ops;
+
+template<>
+struct AVX2Ops<float> {
+  static const int32_t kAddWidth = 8;
+
+  PETUUM_TARGET_AVX2 static inline __m256d Load4(const float *p) {
+    return _mm256_cvtps_pd(_mm_loadu_ps(p));
+  }
+
+  PETUUM_TARGET_AVX2 static inline __m256d Gather4(const float *base,
+                                                   __m128i vidx) {
+    return _mm256_cvtps_pd(_mm_i32gather_ps(base, vidx, sizeof(float)));
+  }
+
+  PETUUM_TARGET_AVX2 static inline void Add4(float *dst, const float *src) {
+    _mm_storeu_ps(dst, _mm_add_ps(_mm_loadu_ps(dst), _mm_loadu_ps(src)));
+  }
+
+  PETUUM_TARGET_AVX2 static inline void AddWide(float *dst,
+                                                const float *src) {
+    _mm256_storeu_ps(dst, _mm256_add_ps(_mm256_loadu_ps(dst),
+                                        _mm256_loadu_ps(src)));
+  }
+};
+
+template<>
+struct AVX2Ops<double> {
+  static const int32_t kAddWidth = 4;
+
+  PETUUM_TARGET_AVX2 static inline __m256d Load4(const double *p) {
+    return _mm256_loadu_pd(p);
+  }
+
+  PETUUM_TARGET_AVX2 static inline __m256d Gather4(const double *base,
+                                                   __m128i vidx) {
+    // The masked form avoids gcc's -Wmaybe-uninitialized on the
+    // undefined pass-through operand of _mm256_i32gather_pd().
+    return _mm256_mask_i32gather_pd(
+        _mm256_setzero_pd(), base, vidx,
+        _mm256_castsi256_pd(_mm256_set1_epi64x(-1)), sizeof(double));
+  }
+
+  PETUUM_TARGET_AVX2 static inline void Add4(double *dst, const double *src) {
+    _mm256_storeu_pd(dst, _mm256_add_pd(_mm256_loadu_pd(dst),
+                                        _mm256_loadu_pd(src)));
+  }
+
+  PETUUM_TARGET_AVX2 static inline void AddWide(double *dst,
+                                                const double *src) {
+    Add4(dst, src);
+  }
+};
+
+template<>
+struct AVX2Ops<int32_t> {
+  static const int32_t kAddWidth = 8;
+
+  PETUUM_TARGET_AVX2 static inline __m256d Load4(const int32_t *p) {
+    return _mm256_cvtepi32_pd(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+  }
+
+  PETUUM_TARGET_AVX2 static inline __m256d Gather4(const int32_t *base,
+                                                   __m128i vidx) {
+    return _mm256_cvtepi32_pd(_mm_i32gather_epi32(
+        reinterpret_cast<const int*>(base), vidx, sizeof(int32_t)));
+  }
+
+  PETUUM_TARGET_AVX2 static inline void Add4(int32_t *dst,
+                                             const int32_t *src) {
+    __m128i *dst_v = reinterpret_cast<__m128i*>(dst);
+    _mm_storeu_si128(dst_v, _mm_add_epi32(
+        _mm_loadu_si128(dst_v),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src))));
+  }
+
+  PETUUM_TARGET_AVX2 static inline void AddWide(int32_t *dst,
+                                                const int32_t *src) {
+    __m256i *dst_v = reinterpret_cast<__m256i*>(dst);
+    _mm256_storeu_si256(dst_v, _mm256_add_epi32(
+        _mm256_loadu_si256(dst_v),
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src))));
+  }
+};
+
+// |u / (o == 0 ? 1 : o)|
+PETUUM_TARGET_AVX2 inline __m256d RelativeMagnitudeAVX2(__m256d u,
+                                                        __m256d o) {
+  __m256d zero_mask = _mm256_cmp_pd(o, _mm256_setzero_pd(), _CMP_EQ_OQ);
+  __m256d denom = _mm256_blendv_pd(o, _mm256_set1_pd(1.0), zero_mask);
+  return _mm256_andnot_pd(_mm256_set1_pd(-0.0), _mm256_div_pd(u, denom));
+}
+
+PETUUM_TARGET_AVX2 inline double HorizontalSumAVX2(__m256d v) {
+  double lanes[4];
+  _mm256_storeu_pd(lanes, v);
+  return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+}
+
+template<typename V>
+PETUUM_TARGET_AVX2 void DenseAddAVX2(V *dst, const V *src, int32_t num) {
+  const int32_t width = AVX2Ops<V>::kAddWidth;
+  int32_t i = 0;
+  for (; i + width <= num; i += width) {
+    AVX2Ops<V>::AddWide(dst + i, src + i);
+  }
+  ScalarKernels<V>::DenseAdd(dst + i, src + i, num - i);
+}
+
+template<typename V>
+PETUUM_TARGET_AVX2 double DenseAddGetImportanceAVX2(
+    V *dst, const V *src, int32_t num) {
+  __m256d accum = _mm256_setzero_pd();
+  int32_t i = 0;
+  for (; i + 4 <= num; i += 4) {
+    __m256d o = AVX2Ops<V>::Load4(dst + i);
+    __m256d u = AVX2Ops<V>::Load4(src + i);
+    accum = _mm256_add_pd(accum, RelativeMagnitudeAVX2(u, o));
+    AVX2Ops<V>::Add4(dst + i, src + i);
+  }
+  return HorizontalSumAVX2(accum)
+      + ScalarKernels<V>::DenseAddGetImportance(dst + i, src + i, num - i);
+}
+
+// Importance of the whole batch is taken against the gathered pre-batch
+// values; the adds are then applied in order so that repeated indices
+// accumulate.
+template<typename V>
+PETUUM_TARGET_AVX2 double ScatterAddGetImportanceAVX2(
+    V *dst, const int32_t *idx, const V *src, int32_t num) {
+  __m256d accum = _mm256_setzero_pd();
+  int32_t i = 0;
+  for (; i + 4 <= num; i += 4) {
+    __m128i vidx = _mm_loadu_si128(reinterpret_cast<const __m128i*>(idx + i));
+    __m256d o = AVX2Ops<V>::Gather4(dst, vidx);
+    __m256d u = AVX2Ops<V>::Load4(src + i);
+    accum = _mm256_add_pd(accum, RelativeMagnitudeAVX2(u, o));
+  }
+  double accum_importance = HorizontalSumAVX2(accum);
+  for (; i < num; ++i) {
+    double importance = (double(dst[idx[i]]) == 0) ? double(src[i])
+                        : double(src[i]) / double(dst[idx[i]]);
+    accum_importance += std::abs(importance);
+  }
+  ScalarKernels<V>::ScatterAdd(dst, idx, src, num);
+  return accum_importance;
+}
+
+template<typename V>
+PETUUM_TARGET_AVX2 double AbsSumAVX2(const V *src, int32_t num) {
+  const __m256d sign_mask = _mm256_set1_pd(-0.0);
+  __m256d accum = _mm256_setzero_pd();
+  int32_t i = 0;
+  for (; i + 4 <= num; i += 4) {
+    accum = _mm256_add_pd(
+        accum, _mm256_andnot_pd(sign_mask, AVX2Ops<V>::Load4(src + i)));
+  }
+  return HorizontalSumAVX2(accum)
+      + ScalarKernels<V>::AbsSum(src + i, num - i);
+}
+
+template<typename V>
+KernelTable<V> MakeAVX2KernelTable() {
+  KernelTable<V> table;
+  table.DenseAdd = &DenseAddAVX2<V>;
+  table.DenseAddGetImportance = &DenseAddGetImportanceAVX2<V>;
+  table.ScatterAddGetImportance = &ScatterAddGetImportanceAVX2<V>;
+  table.AbsSum = &AbsSumAVX2<V>;
+  return table;
+}
+
+#endif  // PETUUM_SIMD_X86
+
+template<typename V>
+KernelTable<V> MakeKernelTable() {
+  switch (GetSIMDLevel()) {
+#ifdef PETUUM_SIMD_X86
+    case kAVX2:
+      return MakeAVX2KernelTable<V>();
+    case kSSE2:
+      return MakeSSE2KernelTable<V>();
+#endif
+    default:
+      return MakeScalarKernelTable<V>();
+  }
+}
+
+template<typename V>
+const KernelTable<V> &GetKernelTable() {
+  static const KernelTable<V> table = MakeKernelTable<V>();
+  return table;
+}
+
+}  // anonymous namespace
+
+template<>
+void DenseAdd<float>(float *dst, const float *src, int32_t num) {
+  GetKernelTable<float>().DenseAdd(dst, src, num);
+}
+
+template<>
+void DenseAdd<double>(double *dst, const double *src, int32_t num) {
+  GetKernelTable<double>().DenseAdd(dst, src, num);
+}
+
+template<>
+void DenseAdd<int32_t>(int32_t *dst, const int32_t *src, int32_t num) {
+  GetKernelTable<int32_t>().DenseAdd(dst, src, num);
+}
+
+template<>
+double DenseAddGetImportance<float>(float *dst, const float *src,
+                                    int32_t num) {
+  return GetKernelTable<float>().DenseAddGetImportance(dst, src, num);
+}
+
+template<>
+double DenseAddGetImportance<double>(double *dst, const double *src,
+                                     int32_t num) {
+  return GetKernelTable<double>().DenseAddGetImportance(dst, src, num);
+}
+
+template<>
+double DenseAddGetImportance<int32_t>(int32_t *dst, const int32_t *src,
+                                      int32_t num) {
+  return GetKernelTable<int32_t>().DenseAddGetImportance(dst, src, num);
+}
+
+template<>
+double ScatterAddGetImportance<float>(float *dst, const int32_t *idx,
+                                      const float *src, int32_t num) {
+  return GetKernelTable<float>().ScatterAddGetImportance(dst, idx, src, num);
+}
+
+template<>
+double ScatterAddGetImportance<double>(double *dst, const int32_t *idx,
+                                       const double *src, int32_t num) {
+  return GetKernelTable<double>().ScatterAddGetImportance(dst, idx, src, num);
+}
+
+template<>
+double ScatterAddGetImportance<int32_t>(int32_t *dst, const int32_t *idx,
+                                        const int32_t *src, int32_t num) {
+  return GetKernelTable<int32_t>().ScatterAddGetImportance(
+      dst, idx, src, num);
+}
+
+template<>
+double AbsSum<float>(const float *src, int32_t num) {
+  return GetKernelTable<float>().AbsSum(src, num);
+}
+
+template<>
+double AbsSum<double>(const double *src, int32_t num) {
+  return GetKernelTable<double>().AbsSum(src, num);
+}
+
+template<>
+double AbsSum<int32_t>(const int32_t *src, int32_t num) {
+  return GetKernelTable<int32_t>().AbsSum(src, num);
+}
+
+const char *GetSIMDKernelISA() {
+  switch (GetSIMDLevel()) {
+    case kAVX2:
+      return "avx2";
+    case kSSE2:
+      return "sse2";
+    default:
+      return "scalar";
+  }
+}
+
+}  // namespace petuum
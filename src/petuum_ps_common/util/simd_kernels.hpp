@@ -0,0 +1,135 @@
+#pragma once
+
+#include <stdint.h>
+#include <cmath>
+
+namespace petuum {
+
+// Arithmetic kernels behind DenseRow's Apply*BatchInc* family, i.e. the
+// server oplog apply path and the client row update path.
+//
+// The generic templates are plain loops. float, double and int32_t are
+// specialized in simd_kernels.cpp with SSE2 and AVX2 versions; which one runs
+// is decided once per process from the CPU the binary runs on, so the library
+// itself does not need to be compiled with -mavx2.
+//
+// "Importance" follows DenseRow::ApplyIncUnsafeGetImportance(): the magnitude
+// of the update relative to the value it is applied to, or the magnitude of
+// the update itself if that value is 0. It is accumulated in double
+// precision, possibly in a different order than the plain loop.
+
+// Plain loops; the fallback for every V and the tail handler of the vector
+// versions.
+template<typename V>
+struct ScalarKernels {
+  static void DenseAdd(V *dst, const V *src, int32_t num) {
+    for (int32_t i = 0; i < num; ++i) {
+      dst[i] += src[i];
+    }
+  }
+
+  static void ScatterAdd(V *dst, const int32_t *idx, const V *src,
+                         int32_t num) {
+    for (int32_t i = 0; i < num; ++i) {
+      dst[idx[i]] += src[i];
+    }
+  }
+
+  static double DenseAddGetImportance(V *dst, const V *src, int32_t num) {
+    double accum_importance = 0;
+    for (int32_t i = 0; i < num; ++i) {
+      double importance = (double(dst[i]) == 0) ? double(src[i])
+                          : double(src[i]) / double(dst[i]);
+      dst[i] += src[i];
+      accum_importance += std::abs(importance);
+    }
+    return accum_importance;
+  }
+
+  static double ScatterAddGetImportance(V *dst, const int32_t *idx,
+                                        const V *src, int32_t num) {
+    double accum_importance = 0;
+    for (int32_t i = 0; i < num; ++i) {
+      double importance = (double(dst[idx[i]]) == 0) ? double(src[i])
+                          : double(src[i]) / double(dst[idx[i]]);
+      dst[idx[i]] += src[i];
+      accum_importance += std::abs(importance);
+    }
+    return accum_importance;
+  }
+
+  static double AbsSum(const V *src, int32_t num) {
+    double accum = 0;
+    for (int32_t i = 0; i < num; ++i) {
+      accum += std::abs(double(src[i]));
+    }
+    return accum;
+  }
+};
+
+// dst[i] += src[i], for i in [0, num).
+template<typename V>
+void DenseAdd(V *dst, const V *src, int32_t num) {
+  ScalarKernels<V>::DenseAdd(dst, src, num);
+}
+
+// dst[idx[i]] += src[i], for i in [0, num). Repeated indices accumulate.
+//
+// There is no vector version: x86 has no scatter below AVX-512 and a
+// gather-add-scatter would drop updates to repeated indices.
+template<typename V>
+void ScatterAdd(V *dst, const int32_t *idx, const V *src, int32_t num) {
+  ScalarKernels<V>::ScatterAdd(dst, idx, src, num);
+}
+
+// DenseAdd() and return the accumulated importance of src w.r.t. dst.
+template<typename V>
+double DenseAddGetImportance(V *dst, const V *src, int32_t num) {
+  return ScalarKernels<V>::DenseAddGetImportance(dst, src, num);
+}
+
+// ScatterAdd() and return the accumulated importance of src w.r.t. dst.
+// The vector versions gather all old values before applying the batch, so
+// for a repeated index the importance is computed against the value before
+// the batch rather than before that particular update. The row values are
+// the same either way.
+template<typename V>
+double ScatterAddGetImportance(V *dst, const int32_t *idx, const V *src,
+                               int32_t num) {
+  return ScalarKernels<V>::ScatterAddGetImportance(dst, idx, src, num);
+}
+
+// Sum of |src[i]|, in double precision.
+template<typename V>
+double AbsSum(const V *src, int32_t num) {
+  return ScalarKernels<V>::AbsSum(src, num);
+}
+
+template<> void DenseAdd<float>(float *dst, const float *src, int32_t num);
+template<> void DenseAdd<double>(double *dst, const double *src, int32_t num);
+template<> void DenseAdd<int32_t>(int32_t *dst, const int32_t *src,
+                                  int32_t num);
+
+template<> double DenseAddGetImportance<float>(
+    float *dst, const float *src, int32_t num);
+template<> double DenseAddGetImportance<double>(
+    double *dst, const double *src, int32_t num);
+template<> double DenseAddGetImportance<int32_t>(
+    int32_t *dst, const int32_t *src, int32_t num);
+
+template<> double ScatterAddGetImportance<float>(
+    float *dst, const int32_t *idx, const float *src, int32_t num);
+template<> double ScatterAddGetImportance<double>(
+    double *dst, const int32_t *idx, const double *src, int32_t num);
+template<> double ScatterAddGetImportance<int32_t>(
+    int32_t *dst, const int32_t *idx, const int32_t *src, int32_t num);
+
+template<> double AbsSum<float>(const float *src, int32_t num);
+template<> double AbsSum<double>(const double *src, int32_t num);
+template<> double AbsSum<int32_t>(const int32_t *src, int32_t num);
+
+// Name of the instruction set the specializations above dispatch to
+// ("avx2", "sse2" or "scalar"), for logging.
+const char *GetSIMDKernelISA();
+
+}  // namespace petuum
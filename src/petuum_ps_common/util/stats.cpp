@@ -2,11 +2,29 @@
 
 #include <petuum_ps_common/util/stats.hpp>
 #include <petuum_ps_common/include/constants.hpp>
+#include <petuum_ps_common/storage/abstract_process_storage.hpp>
 #include <glog/logging.h>
 #include <sstream>
 #include <fstream>
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
 
 namespace petuum {
+
+namespace {
+
+// e.g. "bg.1" for the second bg thread registered.
+std::string GetThreadName(const LiveThreadMetrics &live) {
+  static const char *thread_type_names[] = {"app", "bg", "server",
+                                            "name_node"};
+  std::stringstream thread_name;
+  thread_name << thread_type_names[live.thread_type] << "." << live.index;
+  return thread_name.str();
+}
+
+}  // anonymous namespace
+
 TableGroupConfig Stats::table_group_config_;
 std::string Stats::stats_path_;
 boost::thread_specific_ptr<ThreadType> Stats::thread_type_;
@@ -15,7 +33,55 @@ boost::thread_specific_ptr<BgThreadStats> Stats::bg_thread_stats_;
 boost::thread_specific_ptr<ServerThreadStats> Stats::server_thread_stats_;
 boost::thread_specific_ptr<NameNodeThreadStats> Stats::name_node_thread_stats_;
 
+const char *LiveThreadMetrics::kCounterNames[kNumCounters] = {
+  "num_get",
+  "num_ssp_get_hit",
+  "num_ssp_get_miss",
+  "num_inc",
+  "num_batch_inc",
+  "num_table_clock",
+  "bg_clock",
+  "bg_oplog_sent_bytes",
+  "bg_server_push_row_recv_bytes",
+  "server_clock",
+  "server_oplog_recv_bytes",
+  "server_push_row_sent_bytes"
+};
+
+const char *LiveThreadMetrics::kHistogramNames[kNumHistograms] = {
+  "ssp_get_hit",
+  "ssp_get_miss",
+  "ssp_get_server_fetch",
+  "bg_oplog_serialize",
+  "server_apply_oplog"
+};
+
+LiveThreadMetrics::LiveThreadMetrics(ThreadType thread_type, int32_t index):
+    thread_type(thread_type),
+    index(index),
+    deregistered(false),
+    exported_after_deregister(false) {
+  for (int32_t i = 0; i < kNumCounters; ++i) {
+    counters[i].store(0, std::memory_order_relaxed);
+    exported_counters[i] = 0;
+  }
+}
+
 std::mutex Stats::stats_mtx_;
+
+std::atomic<bool> Stats::live_export_(false);
+std::mutex Stats::live_mtx_;
+std::vector<std::unique_ptr<LiveThreadMetrics> > Stats::live_threads_;
+NanoTimer Stats::live_export_timer_;
+std::atomic<bool> Stats::live_export_stop_(false);
+HighResolutionTimer Stats::live_export_uptime_;
+double Stats::live_export_last_sec_ = 0;
+std::string Stats::live_export_path_;
+std::ofstream Stats::live_export_out_;
+
+std::string Stats::trace_path_;
+std::mutex Stats::trace_mtx_;
+std::vector<std::unique_ptr<TraceBuffer> > Stats::trace_buffers_;
 std::vector<double> Stats::app_thread_life_sec_;
 std::vector<double> Stats::app_load_data_sec_;
 std::vector<double> Stats::app_init_sec_;
@@ -57,6 +123,9 @@ double Stats::bg_accum_server_push_row_recv_mb_ = 0;
 std::vector<double> Stats::bg_per_clock_oplog_sent_mb_;
 std::vector<double> Stats::bg_per_clock_server_push_row_recv_mb_;
 
+double Stats::bg_accum_oplog_codec_saved_mb_ = 0;
+std::vector<double> Stats::bg_per_clock_oplog_codec_saved_mb_;
+
 std::vector<size_t> Stats::bg_accum_server_push_oplog_row_applied_;
 std::vector<size_t> Stats::bg_accum_server_push_update_applied_;
 std::vector<size_t> Stats::bg_accum_server_push_version_diff_;
@@ -74,6 +143,9 @@ std::vector<size_t> Stats::bg_accum_num_idle_send_;
 std::vector<size_t> Stats::bg_accum_num_push_row_msg_recv_;
 std::vector<double> Stats::bg_accum_idle_send_sec_;
 std::vector<size_t> Stats::bg_accum_idle_send_bytes_;
+std::vector<size_t> Stats::bg_accum_oplog_aggr_recv_bytes_;
+std::vector<size_t> Stats::bg_accum_oplog_aggr_sent_bytes_;
+std::map<int32_t, size_t> Stats::bg_accum_server_oplog_sent_bytes_;
 
 std::vector<double> Stats::bg_accum_handle_append_oplog_sec_;
 std::vector<size_t> Stats::bg_num_append_oplog_buff_handled_;
@@ -81,8 +153,15 @@ std::vector<size_t> Stats::bg_num_append_oplog_buff_handled_;
 std::vector<size_t> Stats::bg_num_row_oplog_created_;
 std::vector<size_t> Stats::bg_num_row_oplog_recycled_;
 
+std::vector<size_t> Stats::bg_num_send_control_updates_;
+std::vector<double> Stats::bg_send_control_bandwidth_mbps_;
+std::vector<double> Stats::bg_send_control_min_rtt_milli_;
+std::vector<double> Stats::bg_send_control_srtt_milli_;
+std::vector<size_t> Stats::bg_send_control_push_upper_bound_bytes_;
+
 double Stats::server_accum_apply_oplog_sec_ = 0.0;
 double Stats::server_accum_push_row_sec_ = 0.0;
+std::vector<double> Stats::server_accum_apply_oplog_shard_sec_;
 
 double Stats::server_accum_oplog_recv_mb_ = 0.0;
 double Stats::server_accum_push_row_mb_ = 0.0;
@@ -101,6 +180,26 @@ void Stats::Init(const TableGroupConfig &table_group_config) {
   stats_path_ss << "." << table_group_config.client_id;
 
   stats_path_ = stats_path_ss.str();
+
+  if (!table_group_config.trace_path.empty()) {
+    std::stringstream trace_path_ss;
+    trace_path_ss << table_group_config.trace_path << "."
+                  << table_group_config.client_id << ".json";
+    trace_path_ = trace_path_ss.str();
+  }
+
+  if (table_group_config.stats_live_interval_milli > 0) {
+    live_export_path_ = stats_path_ + ".live";
+    live_export_out_.open(live_export_path_.c_str(),
+                          std::ofstream::out | std::ofstream::trunc);
+    CHECK(live_export_out_) << "failed to open " << live_export_path_;
+    live_export_ = true;
+    live_export_stop_ = false;
+    live_export_uptime_.restart();
+    live_export_last_sec_ = 0;
+    CHECK_EQ(0, live_export_timer_.Start(kLiveExportTickMilli * 1000000,
+                                         LiveExportTimerHandler, 0));
+  }
 }
 
 void Stats::RegisterThread(ThreadType thread_type) {
@@ -110,12 +209,19 @@ void Stats::RegisterThread(ThreadType thread_type) {
   switch (thread_type) {
     case kAppThread:
       app_thread_stats_.reset(new AppThreadStats);
+      app_thread_stats_->live = RegisterLiveThread(thread_type);
+      app_thread_stats_->trace = RegisterTraceBuffer(*app_thread_stats_->live);
       break;
     case kBgThread:
       bg_thread_stats_.reset(new BgThreadStats);
+      bg_thread_stats_->live = RegisterLiveThread(thread_type);
+      bg_thread_stats_->trace = RegisterTraceBuffer(*bg_thread_stats_->live);
       break;
     case kServerThread:
       server_thread_stats_.reset(new ServerThreadStats);
+      server_thread_stats_->live = RegisterLiveThread(thread_type);
+      server_thread_stats_->trace
+          = RegisterTraceBuffer(*server_thread_stats_->live);
       break;
     case kNameNodeThread:
       name_node_thread_stats_.reset(new NameNodeThreadStats);
@@ -143,7 +249,29 @@ void Stats::DeregisterThread() {
   }
 }
 
+LiveThreadMetrics *Stats::RegisterLiveThread(ThreadType thread_type) {
+  std::lock_guard<std::mutex> lock(live_mtx_);
+  int32_t index = 0;
+  for (const auto &live : live_threads_) {
+    if (live->thread_type == thread_type)
+      ++index;
+  }
+  live_threads_.emplace_back(new LiveThreadMetrics(thread_type, index));
+  return live_threads_.back().get();
+}
+
+TraceBuffer *Stats::RegisterTraceBuffer(const LiveThreadMetrics &live) {
+  if (trace_path_.empty())
+    return 0;
+  std::lock_guard<std::mutex> lock(trace_mtx_);
+  trace_buffers_.emplace_back(new TraceBuffer(
+      GetThreadName(live), trace_buffers_.size(),
+      table_group_config_.trace_buffer_events));
+  return trace_buffers_.back().get();
+}
+
 void Stats::DeregisterAppThread() {
+  app_thread_stats_->live->deregistered = true;
   std::lock_guard<std::mutex> lock(stats_mtx_);
   app_thread_life_sec_.push_back(
       app_thread_stats_->thread_life_timer.elapsed());
@@ -212,6 +340,17 @@ void Stats::DeregisterAppThread() {
     table_stats_[table_id].accum_sample_ssp_get_miss_sec
       += thread_table_stats.accum_sample_ssp_get_miss_sec;
 
+    table_stats_[table_id].num_ssp_get_cache_hit
+      += thread_table_stats.num_ssp_get_cache_hit;
+    table_stats_[table_id].num_ssp_get_mem_tier_hit
+      += thread_table_stats.num_ssp_get_mem_tier_hit;
+    table_stats_[table_id].num_ssp_get_spill_tier_hit
+      += thread_table_stats.num_ssp_get_spill_tier_hit;
+    table_stats_[table_id].num_ssp_get_stale
+      += thread_table_stats.num_ssp_get_stale;
+    table_stats_[table_id].num_ssp_get_not_found
+      += thread_table_stats.num_ssp_get_not_found;
+
     table_stats_[table_id].num_ssppush_get_comm_block
       += thread_table_stats.num_ssppush_get_comm_block;
 
@@ -279,6 +418,7 @@ void Stats::DeregisterAppThread() {
 }
 
 void Stats::DeregisterBgThread() {
+  bg_thread_stats_->live->deregistered = true;
   std::lock_guard<std::mutex> lock(stats_mtx_);
   BgThreadStats &stats = *bg_thread_stats_;
   bg_accum_clock_end_oplog_serialize_sec_
@@ -345,20 +485,48 @@ void Stats::DeregisterBgThread() {
       += stats.per_clock_server_push_row_recv_kb[i] / double(k1_Ki);
   }
 
+  bg_accum_oplog_codec_saved_mb_
+    += stats.accum_oplog_codec_saved_kb / double(k1_Ki);
+
+  vec_size = stats.per_clock_oplog_codec_saved_kb.size();
+
+  if (bg_per_clock_oplog_codec_saved_mb_.size() < vec_size) {
+    bg_per_clock_oplog_codec_saved_mb_.resize(vec_size, 0.0);
+  }
+
+  for (int i = 0; i < vec_size; ++i) {
+    bg_per_clock_oplog_codec_saved_mb_[i]
+      += stats.per_clock_oplog_codec_saved_kb[i] / double(k1_Ki);
+  }
+
   bg_accum_num_idle_invoke_.push_back(stats.accum_num_idle_invoke);
   bg_accum_num_idle_send_.push_back(stats.accum_num_idle_send);
   bg_accum_num_push_row_msg_recv_.push_back(stats.accum_num_push_row_msg_recv);
   bg_accum_idle_send_sec_.push_back(stats.accum_idle_send_sec);
   bg_accum_idle_send_bytes_.push_back(stats.accum_idle_send_bytes);
+  bg_accum_oplog_aggr_recv_bytes_.push_back(stats.accum_oplog_aggr_recv_bytes);
+  bg_accum_oplog_aggr_sent_bytes_.push_back(stats.accum_oplog_aggr_sent_bytes);
+  for (const auto &server_bytes : stats.accum_server_oplog_sent_bytes) {
+    bg_accum_server_oplog_sent_bytes_[server_bytes.first]
+        += server_bytes.second;
+  }
 
   bg_accum_handle_append_oplog_sec_.push_back(stats.accum_handle_append_oplog_sec);
   bg_num_append_oplog_buff_handled_.push_back(stats.num_append_oplog_buff_handled);
 
   bg_num_row_oplog_created_.push_back(stats.num_row_oplog_created);
   bg_num_row_oplog_recycled_.push_back(stats.num_row_oplog_recycled);
+
+  bg_num_send_control_updates_.push_back(stats.num_send_control_updates);
+  bg_send_control_bandwidth_mbps_.push_back(stats.send_control_bandwidth_mbps);
+  bg_send_control_min_rtt_milli_.push_back(stats.send_control_min_rtt_milli);
+  bg_send_control_srtt_milli_.push_back(stats.send_control_srtt_milli);
+  bg_send_control_push_upper_bound_bytes_.push_back(
+      stats.send_control_push_upper_bound_bytes);
 }
 
 void Stats::DeregisterServerThread() {
+  server_thread_stats_->live->deregistered = true;
   std::lock_guard<std::mutex> lock(stats_mtx_);
   ServerThreadStats &stats = *server_thread_stats_;
   server_accum_apply_oplog_sec_
@@ -367,6 +535,16 @@ void Stats::DeregisterServerThread() {
   server_accum_push_row_sec_
     += stats.accum_push_row_sec;
 
+  size_t num_shards = stats.accum_apply_oplog_shard_sec.size();
+  if (server_accum_apply_oplog_shard_sec_.size() < num_shards) {
+    server_accum_apply_oplog_shard_sec_.resize(num_shards, 0.0);
+  }
+
+  for (int i = 0; i < num_shards; ++i) {
+    server_accum_apply_oplog_shard_sec_[i]
+      += stats.accum_apply_oplog_shard_sec[i];
+  }
+
   server_accum_oplog_recv_mb_
     += stats.accum_oplog_recv_kb / double(k1_Ki);
 
@@ -428,11 +606,15 @@ void Stats::AppBootstrapEnd() {
 
 void Stats::AppAccumCompBegin() {
   app_thread_stats_->comp_timer.restart();
+  if (app_thread_stats_->trace != 0)
+    app_thread_stats_->trace->Begin(kTraceAppComp);
 }
 
 void Stats::AppAccumCompEnd() {
   AppThreadStats &stats = *app_thread_stats_;
   stats.accum_comp_sec += stats.comp_timer.elapsed();
+  if (stats.trace != 0)
+    stats.trace->End(kTraceAppComp);
 }
 
 void Stats::AppAccumObjCompBegin() {
@@ -446,18 +628,27 @@ void Stats::AppAccumObjCompEnd() {
 
 void Stats::AppAccumTgClockBegin() {
   app_thread_stats_->tg_clock_timer.restart();
+  if (app_thread_stats_->trace != 0)
+    app_thread_stats_->trace->Begin(kTraceAppClock);
 }
 
 void Stats::AppAccumTgClockEnd() {
   AppThreadStats &stats = *app_thread_stats_;
   stats.accum_tg_clock_sec += stats.tg_clock_timer.elapsed();
+  if (stats.trace != 0) {
+    stats.trace->End(kTraceAppClock);
+    stats.trace->Clock();
+  }
 }
 
 void Stats::AppSampleSSPGetBegin(int32_t table_id) {
   AppThreadStats &stats = *app_thread_stats_;
 
-  if ((stats.table_stats[table_id].num_get < kFirstNGetToSkip)
-      || (stats.table_stats[table_id].num_get % kGetSampleFreq))
+  uint64_t num_get = stats.table_stats[table_id].num_get;
+  bool live_sample = live_export_.load(std::memory_order_relaxed)
+    && (num_get % kLiveGetSampleFreq == 0);
+  if (!live_sample && ((num_get < kFirstNGetToSkip)
+                       || (num_get % kGetSampleFreq)))
     return;
 
   stats.table_stats[table_id].get_timer.restart();
@@ -474,6 +665,19 @@ void Stats::AppSampleSSPGetEnd(int32_t table_id, bool hit) {
   else
     ++stats.table_stats[table_id].num_ssp_get_miss;
 
+  stats.live->Inc(LiveThreadMetrics::kNumGet);
+  if (hit) {
+    stats.live->Inc(LiveThreadMetrics::kNumSSPGetHit);
+  } else {
+    stats.live->Inc(LiveThreadMetrics::kNumSSPGetMiss);
+  }
+  if (live_export_.load(std::memory_order_relaxed)
+      && (org_num_get % kLiveGetSampleFreq == 0)) {
+    stats.live->histograms[hit ? LiveThreadMetrics::kSSPGetHit
+                           : LiveThreadMetrics::kSSPGetMiss].RecordSec(
+        stats.table_stats[table_id].get_timer.elapsed());
+  }
+
   if ((org_num_get - 1) < kFirstNGetToSkip
       || ((org_num_get - 1) % kGetSampleFreq)) {
     return;
@@ -490,8 +694,26 @@ void Stats::AppSampleSSPGetEnd(int32_t table_id, bool hit) {
   }
 }
 
+void Stats::AppAccumSSPGetTier(int32_t table_id, int32_t tier, bool fresh) {
+  AppThreadPerTableStats &stats = app_thread_stats_->table_stats[table_id];
+
+  if (tier == kRowTierNone) {
+    ++stats.num_ssp_get_not_found;
+  } else if (!fresh) {
+    ++stats.num_ssp_get_stale;
+  } else if (tier == kRowTierCache) {
+    ++stats.num_ssp_get_cache_hit;
+  } else if (tier == kRowTierMem) {
+    ++stats.num_ssp_get_mem_tier_hit;
+  } else {
+    ++stats.num_ssp_get_spill_tier_hit;
+  }
+}
+
 void Stats::AppAccumSSPPushGetCommBlockBegin(int32_t table_id) {
   app_thread_stats_->table_stats[table_id].ssppush_get_comm_block_timer.restart();
+  if (app_thread_stats_->trace != 0)
+    app_thread_stats_->trace->Begin(kTraceAppServerPushWait);
 }
 
 void Stats::AppAccumSSPPushGetCommBlockEnd(int32_t table_id) {
@@ -500,16 +722,25 @@ void Stats::AppAccumSSPPushGetCommBlockEnd(int32_t table_id) {
     += stats.table_stats[table_id].ssppush_get_comm_block_timer.elapsed();
 
   ++(stats.table_stats[table_id].num_ssppush_get_comm_block);
+  if (stats.trace != 0)
+    stats.trace->End(kTraceAppServerPushWait, table_id);
 }
 
 void Stats::AppAccumSSPGetServerFetchBegin(int32_t table_id) {
   app_thread_stats_->table_stats[table_id].ssp_get_server_fetch_timer.restart();
+  if (app_thread_stats_->trace != 0)
+    app_thread_stats_->trace->Begin(kTraceAppServerFetch);
 }
 
 void Stats::AppAccumSSPGetServerFetchEnd(int32_t table_id) {
   AppThreadStats &stats = *app_thread_stats_;
-  stats.table_stats[table_id].accum_ssp_get_server_fetch_sec
-    += stats.table_stats[table_id].ssp_get_server_fetch_timer.elapsed();
+  double elapsed
+    = stats.table_stats[table_id].ssp_get_server_fetch_timer.elapsed();
+  stats.table_stats[table_id].accum_ssp_get_server_fetch_sec += elapsed;
+  stats.live->histograms[LiveThreadMetrics::kSSPGetServerFetch].RecordSec(
+      elapsed);
+  if (stats.trace != 0)
+    stats.trace->End(kTraceAppServerFetch, table_id);
 }
 
 void Stats::AppSampleIncBegin(int32_t table_id) {
@@ -526,6 +757,7 @@ void Stats::AppSampleIncEnd(int32_t table_id) {
 
   uint64_t org_num_inc = stats.table_stats[table_id].num_inc;
   ++stats.table_stats[table_id].num_inc;
+  stats.live->Inc(LiveThreadMetrics::kNumInc);
   if (org_num_inc % kIncSampleFreq)
     return;
 
@@ -548,6 +780,7 @@ void Stats::AppSampleBatchIncEnd(int32_t table_id) {
 
   uint64_t org_num_batch_inc = stats.table_stats[table_id].num_batch_inc;
   ++stats.table_stats[table_id].num_batch_inc;
+  stats.live->Inc(LiveThreadMetrics::kNumBatchInc);
   if (org_num_batch_inc % kBatchIncSampleFreq)
     return;
 
@@ -617,6 +850,7 @@ void Stats::AppSampleTableClockEnd(int32_t table_id) {
 
   uint64_t org_num_clock = stats.table_stats[table_id].num_clock;
   ++stats.table_stats[table_id].num_clock;
+  stats.live->Inc(LiveThreadMetrics::kNumTableClock);
 
   if (org_num_clock % kClockSampleFreq)
     return;
@@ -693,15 +927,24 @@ void Stats::AppAccumAppendOnlyFlushOpLogEnd() {
 
 void Stats::BgAccumOpLogSerializeBegin() {
   bg_thread_stats_->oplog_serialize_timer.restart();
+  if (bg_thread_stats_->trace != 0)
+    bg_thread_stats_->trace->Begin(kTraceBgOpLogSerialize);
 }
 
 void Stats::BgAccumOpLogSerializeEnd() {
   BgThreadStats& stats = *bg_thread_stats_;
-  stats.accum_total_oplog_serialize_sec += stats.oplog_serialize_timer.elapsed();
+  double elapsed = stats.oplog_serialize_timer.elapsed();
+  stats.accum_total_oplog_serialize_sec += elapsed;
+  stats.live->histograms[LiveThreadMetrics::kBgOpLogSerialize].RecordSec(
+      elapsed);
+  if (stats.trace != 0)
+    stats.trace->End(kTraceBgOpLogSerialize);
 }
 
 void Stats::BgAccumClockEndOpLogSerializeBegin() {
   bg_thread_stats_->oplog_serialize_timer.restart();
+  if (bg_thread_stats_->trace != 0)
+    bg_thread_stats_->trace->Begin(kTraceBgOpLogSerialize);
 }
 
 void Stats::BgAccumClockEndOpLogSerializeEnd() {
@@ -711,10 +954,26 @@ void Stats::BgAccumClockEndOpLogSerializeEnd() {
 
   stats.accum_total_oplog_serialize_sec += elapsed;
   stats.accum_clock_end_oplog_serialize_sec += elapsed;
+  stats.live->histograms[LiveThreadMetrics::kBgOpLogSerialize].RecordSec(
+      elapsed);
+  if (stats.trace != 0)
+    stats.trace->End(kTraceBgOpLogSerialize);
+}
+
+void Stats::BgSendOpLogBegin() {
+  if (bg_thread_stats_->trace != 0)
+    bg_thread_stats_->trace->Begin(kTraceBgSendOpLog);
+}
+
+void Stats::BgSendOpLogEnd() {
+  if (bg_thread_stats_->trace != 0)
+    bg_thread_stats_->trace->End(kTraceBgSendOpLog);
 }
 
 void Stats::BgAccumServerPushRowApplyBegin() {
   bg_thread_stats_->server_push_row_apply_timer.restart();
+  if (bg_thread_stats_->trace != 0)
+    bg_thread_stats_->trace->Begin(kTraceBgServerPushRowApply);
 }
 
 void Stats::BgAccumServerPushRowApplyEnd() {
@@ -722,6 +981,8 @@ void Stats::BgAccumServerPushRowApplyEnd() {
 
   stats.accum_server_push_row_apply_sec
     += stats.server_push_row_apply_timer.elapsed();
+  if (stats.trace != 0)
+    stats.trace->End(kTraceBgServerPushRowApply);
 }
 
 void Stats::BgSampleProcessCacheInsertBegin() {
@@ -772,8 +1033,12 @@ void Stats::BgSampleServerPushDeserializeEnd() {
 
 void Stats::BgClock() {
   ++(bg_thread_stats_->clock_num);
+  bg_thread_stats_->live->Inc(LiveThreadMetrics::kBgClock);
+  if (bg_thread_stats_->trace != 0)
+    bg_thread_stats_->trace->Clock();
   bg_thread_stats_->per_clock_oplog_sent_kb.push_back(0.0);
   bg_thread_stats_->per_clock_server_push_row_recv_kb.push_back(0.0);
+  bg_thread_stats_->per_clock_oplog_codec_saved_kb.push_back(0.0);
 }
 
 void Stats::BgAddPerClockOpLogSize(size_t oplog_size) {
@@ -785,6 +1050,18 @@ void Stats::BgAddPerClockOpLogSize(size_t oplog_size) {
   stats.per_clock_oplog_sent_kb[stats.clock_num]
     += oplog_size_kb;
   stats.accum_oplog_sent_kb += oplog_size_kb;
+  stats.live->Inc(LiveThreadMetrics::kBgOpLogSentBytes, oplog_size);
+}
+
+void Stats::BgAddPerClockOpLogCodecSaved(size_t raw_size,
+                                         size_t encoded_size) {
+  double saved_kb
+    = (double(raw_size) - double(encoded_size)) / double(k1_Ki);
+
+  BgThreadStats &stats = *bg_thread_stats_;
+
+  stats.per_clock_oplog_codec_saved_kb[stats.clock_num] += saved_kb;
+  stats.accum_oplog_codec_saved_kb += saved_kb;
 }
 
 void Stats::BgAddPerClockServerPushRowSize(size_t server_push_row_size) {
@@ -796,6 +1073,8 @@ void Stats::BgAddPerClockServerPushRowSize(size_t server_push_row_size) {
   stats.per_clock_server_push_row_recv_kb[stats.clock_num]
     += server_push_row_size_kb;
   stats.accum_server_push_row_recv_kb += server_push_row_size_kb;
+  stats.live->Inc(LiveThreadMetrics::kBgServerPushRowRecvBytes,
+                  server_push_row_size);
 }
 
 void Stats::BgIdleInvokeIncOne() {
@@ -824,6 +1103,26 @@ void Stats::BgAccumIdleOpLogSentBytes(size_t num_bytes) {
   bg_thread_stats_->accum_idle_send_bytes += num_bytes;
 }
 
+void Stats::BgAccumOpLogAggrBytes(size_t recv_bytes, size_t sent_bytes) {
+  bg_thread_stats_->accum_oplog_aggr_recv_bytes += recv_bytes;
+  bg_thread_stats_->accum_oplog_aggr_sent_bytes += sent_bytes;
+}
+
+void Stats::BgAccumServerOpLogSentBytes(int32_t server_id, size_t num_bytes) {
+  bg_thread_stats_->accum_server_oplog_sent_bytes[server_id] += num_bytes;
+}
+
+void Stats::BgSendControlUpdate(double bandwidth_mbps, double min_rtt_milli,
+                                double srtt_milli,
+                                size_t push_upper_bound_bytes) {
+  BgThreadStats &stats = *bg_thread_stats_;
+  ++(stats.num_send_control_updates);
+  stats.send_control_bandwidth_mbps = bandwidth_mbps;
+  stats.send_control_min_rtt_milli = min_rtt_milli;
+  stats.send_control_srtt_milli = srtt_milli;
+  stats.send_control_push_upper_bound_bytes = push_upper_bound_bytes;
+}
+
 void Stats::BgAccumHandleAppendOpLogBegin() {
   bg_thread_stats_->handle_append_oplog_timer.restart();
 }
@@ -856,17 +1155,34 @@ void Stats::BgAccumServerPushVersionDiffAdd(size_t diff) {
 
 void Stats::ServerAccumApplyOpLogBegin() {
   server_thread_stats_->apply_oplog_timer.restart();
+  if (server_thread_stats_->trace != 0)
+    server_thread_stats_->trace->Begin(kTraceServerApplyOpLog);
 }
 
 void Stats::ServerAccumApplyOpLogEnd() {
   ServerThreadStats &stats = *server_thread_stats_;
 
-  stats.accum_apply_oplog_sec
-    += stats.apply_oplog_timer.elapsed();
+  double elapsed = stats.apply_oplog_timer.elapsed();
+  stats.accum_apply_oplog_sec += elapsed;
+  stats.live->histograms[LiveThreadMetrics::kServerApplyOpLog].RecordSec(
+      elapsed);
+  if (stats.trace != 0)
+    stats.trace->End(kTraceServerApplyOpLog);
+}
+
+void Stats::ServerAccumApplyOpLogShardSec(int32_t shard, double sec) {
+  ServerThreadStats &stats = *server_thread_stats_;
+
+  if (stats.accum_apply_oplog_shard_sec.size() <= shard) {
+    stats.accum_apply_oplog_shard_sec.resize(shard + 1, 0.0);
+  }
+  stats.accum_apply_oplog_shard_sec[shard] += sec;
 }
 
 void Stats::ServerAccumPushRowBegin() {
   server_thread_stats_->push_row_timer.restart();
+  if (server_thread_stats_->trace != 0)
+    server_thread_stats_->trace->Begin(kTraceServerPushRow);
 }
 
 void Stats::ServerAccumPushRowEnd() {
@@ -874,10 +1190,27 @@ void Stats::ServerAccumPushRowEnd() {
 
   stats.accum_push_row_sec
     += stats.push_row_timer.elapsed();
+  if (stats.trace != 0)
+    stats.trace->End(kTraceServerPushRow);
+}
+
+void Stats::ServerClockUntilBegin() {
+  if (server_thread_stats_->trace != 0)
+    server_thread_stats_->trace->Begin(kTraceServerClockUntil);
+}
+
+void Stats::ServerClockUntilEnd(int32_t bg_id) {
+  if (server_thread_stats_->trace != 0)
+    server_thread_stats_->trace->End(kTraceServerClockUntil, bg_id);
 }
 
 void Stats::ServerClock() {
   ++server_thread_stats_->clock_num;
+  server_thread_stats_->live->Inc(LiveThreadMetrics::kServerClock);
+  if (server_thread_stats_->trace != 0) {
+    server_thread_stats_->trace->Clock();
+    server_thread_stats_->trace->Instant(kTraceServerMinClock);
+  }
   server_thread_stats_->per_clock_oplog_recv_kb.push_back(0.0);
   server_thread_stats_->per_clock_push_row_kb.push_back(0.0);
 }
@@ -891,6 +1224,7 @@ void Stats::ServerAddPerClockOpLogSize(size_t oplog_size) {
   stats.per_clock_oplog_recv_kb[stats.clock_num]
     += oplog_size_kb;
   stats.accum_oplog_recv_kb += oplog_size_kb;
+  stats.live->Inc(LiveThreadMetrics::kServerOpLogRecvBytes, oplog_size);
 }
 
 void Stats::ServerAddPerClockPushRowSize(size_t push_row_size) {
@@ -902,6 +1236,7 @@ void Stats::ServerAddPerClockPushRowSize(size_t push_row_size) {
   stats.per_clock_push_row_kb[stats.clock_num]
     += push_row_size_kb;
   stats.accum_push_row_kb += push_row_size_kb;
+  stats.live->Inc(LiveThreadMetrics::kServerPushRowSentBytes, push_row_size);
 }
 
 void Stats::ServerOpLogMsgRecvIncOne() {
@@ -925,7 +1260,150 @@ void Stats::YamlPrintSequence(YAML::Emitter *yaml_out,
   *yaml_out << YAML::EndSeq;
 }
 
+int32_t Stats::LiveExportTimerHandler(void *argu, int32_t rem) {
+  if (live_export_stop_.load())
+    return 0;
+
+  double interval_sec
+    = double(table_group_config_.stats_live_interval_milli) / 1000.;
+  if (live_export_uptime_.elapsed() - live_export_last_sec_ >= interval_sec)
+    ExportLiveSnapshot();
+  return kLiveExportTickMilli * 1000000;
+}
+
+void Stats::StopLiveExport() {
+  if (!live_export_.load())
+    return;
+  live_export_stop_ = true;
+  live_export_timer_.Stop();
+  // Whatever happened since the last one.
+  ExportLiveSnapshot();
+  live_export_out_.close();
+  live_export_ = false;
+}
+
+void Stats::ExportLiveSnapshot() {
+  double uptime_sec = live_export_uptime_.elapsed();
+  double interval_sec = uptime_sec - live_export_last_sec_;
+  live_export_last_sec_ = uptime_sec;
+
+  YAML::Emitter yaml_out;
+  yaml_out << YAML::BeginMap
+    << YAML::Key << "unix_time"
+    << YAML::Value << int64_t(time(0))
+    << YAML::Key << "uptime_sec"
+    << YAML::Value << uptime_sec
+    << YAML::Key << "interval_sec"
+    << YAML::Value << interval_sec
+    << YAML::Key << "threads"
+    << YAML::Value << YAML::BeginSeq;
+
+  LatencyHistogram::Snapshot total, interval;
+  {
+    std::lock_guard<std::mutex> lock(live_mtx_);
+    for (const auto &live_ptr : live_threads_) {
+      LiveThreadMetrics &live = *live_ptr;
+      // A deregistered thread is reported one last time.
+      bool deregistered = live.deregistered.load();
+      if (live.exported_after_deregister)
+        continue;
+      live.exported_after_deregister = deregistered;
+
+      yaml_out << YAML::BeginMap
+        << YAML::Key << "thread"
+        << YAML::Value << GetThreadName(live)
+        << YAML::Key << "deregistered"
+        << YAML::Value << deregistered;
+
+      // Counters the thread never touched are left out.
+      yaml_out << YAML::Key << "counters"
+        << YAML::Value << YAML::BeginMap;
+      for (int32_t i = 0; i < LiveThreadMetrics::kNumCounters; ++i) {
+        uint64_t count = live.counters[i].load(std::memory_order_relaxed);
+        if (count == 0)
+          continue;
+        double per_sec = (interval_sec > 0) ?
+            double(count - live.exported_counters[i]) / interval_sec : 0;
+        live.exported_counters[i] = count;
+        yaml_out << YAML::Key << LiveThreadMetrics::kCounterNames[i]
+          << YAML::Value << YAML::Flow << YAML::BeginMap
+          << YAML::Key << "total" << YAML::Value << count
+          << YAML::Key << "per_sec" << YAML::Value << per_sec
+          << YAML::EndMap;
+      }
+      yaml_out << YAML::EndMap;
+
+      // Latencies recorded since the last snapshot.
+      yaml_out << YAML::Key << "latency_ns"
+        << YAML::Value << YAML::BeginMap;
+      for (int32_t i = 0; i < LiveThreadMetrics::kNumHistograms; ++i) {
+        live.histograms[i].GetSnapshot(&total);
+        interval = total;
+        interval.Subtract(live.exported_histograms[i]);
+        std::swap(live.exported_histograms[i], total);
+
+        uint64_t count = interval.Count();
+        if (count == 0)
+          continue;
+        yaml_out << YAML::Key << LiveThreadMetrics::kHistogramNames[i]
+          << YAML::Value << YAML::Flow << YAML::BeginMap
+          << YAML::Key << "count" << YAML::Value << count
+          << YAML::Key << "mean" << YAML::Value << interval.sum_ns / count
+          << YAML::Key << "p50" << YAML::Value << interval.Quantile(0.5)
+          << YAML::Key << "p90" << YAML::Value << interval.Quantile(0.9)
+          << YAML::Key << "p99" << YAML::Value << interval.Quantile(0.99)
+          << YAML::Key << "p999" << YAML::Value << interval.Quantile(0.999)
+          << YAML::Key << "max" << YAML::Value << interval.Quantile(1.0)
+          << YAML::EndMap;
+      }
+      yaml_out << YAML::EndMap
+        << YAML::EndMap;
+    }
+  }
+  yaml_out << YAML::EndSeq
+    << YAML::EndMap;
+
+  if (live_export_out_.tellp() >= std::streamoff(
+          table_group_config_.stats_live_max_kb * k1_Ki)) {
+    live_export_out_.close();
+    std::string rolled_path = live_export_path_ + ".1";
+    if (std::rename(live_export_path_.c_str(), rolled_path.c_str()) != 0) {
+      LOG(WARNING) << "failed to roll " << live_export_path_ << " over to "
+                   << rolled_path;
+    }
+    live_export_out_.open(live_export_path_.c_str(),
+                          std::ofstream::out | std::ofstream::trunc);
+  }
+  live_export_out_ << "---\n" << yaml_out.c_str() << std::endl;
+}
+
+void Stats::WriteTrace() {
+  if (trace_path_.empty())
+    return;
+  std::ofstream trace_out(trace_path_.c_str(), std::ofstream::out |
+                          std::ofstream::trunc);
+  if (!trace_out) {
+    LOG(ERROR) << "failed to open " << trace_path_;
+    return;
+  }
+
+  trace_out << "{\"traceEvents\":[\n";
+  trace_out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":"
+            << table_group_config_.client_id
+            << ",\"args\":{\"name\":\"client "
+            << table_group_config_.client_id << "\"}}";
+  bool first = false;
+  std::lock_guard<std::mutex> lock(trace_mtx_);
+  for (const auto &trace : trace_buffers_) {
+    trace->WriteJson(table_group_config_.client_id, &trace_out, &first);
+  }
+  trace_out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+}
+
 void Stats::PrintStats() {
+  StopLiveExport();
+  WriteTrace();
+
   YAML::Emitter yaml_out;
   std::lock_guard<std::mutex> lock(stats_mtx_);
 
@@ -1118,6 +1596,16 @@ void Stats::PrintStats() {
       << YAML::Key << "accum_sample_ssp_get_miss_sec"
       << YAML::Value
       << table_stats_iter->second.accum_sample_ssp_get_miss_sec
+      << YAML::Key << "num_ssp_get_cache_hit"
+      << YAML::Value << table_stats_iter->second.num_ssp_get_cache_hit
+      << YAML::Key << "num_ssp_get_mem_tier_hit"
+      << YAML::Value << table_stats_iter->second.num_ssp_get_mem_tier_hit
+      << YAML::Key << "num_ssp_get_spill_tier_hit"
+      << YAML::Value << table_stats_iter->second.num_ssp_get_spill_tier_hit
+      << YAML::Key << "num_ssp_get_stale"
+      << YAML::Value << table_stats_iter->second.num_ssp_get_stale
+      << YAML::Key << "num_ssp_get_not_found"
+      << YAML::Value << table_stats_iter->second.num_ssp_get_not_found
       << YAML::Key << "num_ssppush_get_comm_block"
       << YAML::Value << table_stats_iter->second.num_ssppush_get_comm_block
       << YAML::Key << "accum_sspppush_get_comm_block_sec"
@@ -1170,6 +1658,13 @@ void Stats::PrintStats() {
     << YAML::Value;
   YamlPrintSequence(&yaml_out, bg_per_clock_server_push_row_recv_mb_);
 
+  yaml_out << YAML::Key << "bg_accum_oplog_codec_saved_mb"
+    << YAML::Value << bg_accum_oplog_codec_saved_mb_;
+
+  yaml_out << YAML::Key << "bg_per_clock_oplog_codec_saved_mb"
+    << YAML::Value;
+  YamlPrintSequence(&yaml_out, bg_per_clock_oplog_codec_saved_mb_);
+
   yaml_out << YAML::Key << "bg_accum_server_push_oplog_row_applied"
     << YAML::Value;
 
@@ -1225,6 +1720,40 @@ void Stats::PrintStats() {
     << YAML::Value;
   YamlPrintSequence(&yaml_out, bg_accum_idle_send_bytes_);
 
+  yaml_out << YAML::Key << "bg_accum_oplog_aggr_recv_bytes"
+    << YAML::Value;
+  YamlPrintSequence(&yaml_out, bg_accum_oplog_aggr_recv_bytes_);
+
+  yaml_out << YAML::Key << "bg_accum_oplog_aggr_sent_bytes"
+    << YAML::Value;
+  YamlPrintSequence(&yaml_out, bg_accum_oplog_aggr_sent_bytes_);
+
+  {
+    std::vector<int32_t> server_ids;
+    std::vector<size_t> server_bytes;
+    size_t max_bytes = 0, sum_bytes = 0;
+    for (const auto &server_bytes_pair : bg_accum_server_oplog_sent_bytes_) {
+      server_ids.push_back(server_bytes_pair.first);
+      server_bytes.push_back(server_bytes_pair.second);
+      max_bytes = std::max(max_bytes, server_bytes_pair.second);
+      sum_bytes += server_bytes_pair.second;
+    }
+    // max over mean; 1 when every server gets the same load
+    double imbalance = (sum_bytes == 0) ? 0.0
+        : double(max_bytes) * server_ids.size() / double(sum_bytes);
+
+    yaml_out << YAML::Key << "bg_oplog_server_ids"
+             << YAML::Value;
+    YamlPrintSequence(&yaml_out, server_ids);
+
+    yaml_out << YAML::Key << "bg_accum_server_oplog_sent_bytes"
+             << YAML::Value;
+    YamlPrintSequence(&yaml_out, server_bytes);
+
+    yaml_out << YAML::Key << "bg_server_oplog_imbalance"
+             << YAML::Value << imbalance;
+  }
+
   yaml_out << YAML::Key << "bg_accum_handle_append_oplog_sec"
            << YAML::Value;
   YamlPrintSequence(&yaml_out, bg_accum_handle_append_oplog_sec_);
@@ -1241,6 +1770,26 @@ void Stats::PrintStats() {
            << YAML::Value;
   YamlPrintSequence(&yaml_out, bg_num_row_oplog_recycled_);
 
+  yaml_out << YAML::Key << "bg_num_send_control_updates"
+           << YAML::Value;
+  YamlPrintSequence(&yaml_out, bg_num_send_control_updates_);
+
+  yaml_out << YAML::Key << "bg_send_control_bandwidth_mbps"
+           << YAML::Value;
+  YamlPrintSequence(&yaml_out, bg_send_control_bandwidth_mbps_);
+
+  yaml_out << YAML::Key << "bg_send_control_min_rtt_milli"
+           << YAML::Value;
+  YamlPrintSequence(&yaml_out, bg_send_control_min_rtt_milli_);
+
+  yaml_out << YAML::Key << "bg_send_control_srtt_milli"
+           << YAML::Value;
+  YamlPrintSequence(&yaml_out, bg_send_control_srtt_milli_);
+
+  yaml_out << YAML::Key << "bg_send_control_push_upper_bound_bytes"
+           << YAML::Value;
+  YamlPrintSequence(&yaml_out, bg_send_control_push_upper_bound_bytes_);
+
   yaml_out << YAML::EndMap;
 
   yaml_out << YAML::BeginMap
@@ -1254,6 +1803,10 @@ void Stats::PrintStats() {
     << YAML::Key << "server_accum_push_row_mb"
     << YAML::Value << server_accum_push_row_mb_;
 
+  yaml_out << YAML::Key << "server_accum_apply_oplog_shard_sec"
+    << YAML::Value;
+  YamlPrintSequence(&yaml_out, server_accum_apply_oplog_shard_sec_);
+
   yaml_out << YAML::Key << "server_per_clock_oplog_recv_mb"
     << YAML::Value;
   YamlPrintSequence(&yaml_out, server_per_clock_oplog_recv_mb_);
@@ -2,14 +2,21 @@
 #pragma once
 
 #include <petuum_ps_common/util/high_resolution_timer.hpp>
+#include <petuum_ps_common/util/latency_histogram.hpp>
+#include <petuum_ps_common/util/timer_thr.hpp>
+#include <petuum_ps_common/util/trace_buffer.hpp>
 #include <petuum_ps_common/include/configs.hpp>
 #include <boost/thread/tss.hpp>
 #include <boost/unordered_map.hpp>
 #include <vector>
+#include <map>
 #include <stdint.h>
 #include <stddef.h>
 #include <string>
 #include <mutex>
+#include <memory>
+#include <atomic>
+#include <fstream>
 #include <yaml-cpp/yaml.h>
 
 #ifdef PETUUM_STATS
@@ -65,6 +72,9 @@
 #define STATS_APP_SAMPLE_SSP_GET_END(table_id, hit) \
   Stats::AppSampleSSPGetEnd(table_id, hit)
 
+#define STATS_APP_ACCUM_SSP_GET_TIER(table_id, tier, fresh) \
+  Stats::AppAccumSSPGetTier(table_id, tier, fresh)
+
 #define STATS_APP_ACCUM_SSPPUSH_GET_COMM_BLOCK_BEGIN(table_id) \
   Stats::AppAccumSSPPushGetCommBlockBegin(table_id)
 
@@ -164,6 +174,12 @@
 #define STATS_BG_ACCUM_CLOCK_END_OPLOG_SERIALIZE_END() \
   Stats::BgAccumClockEndOpLogSerializeEnd()
 
+#define STATS_BG_SEND_OPLOG_BEGIN() \
+  Stats::BgSendOpLogBegin()
+
+#define STATS_BG_SEND_OPLOG_END() \
+  Stats::BgSendOpLogEnd()
+
 #define STATS_BG_ACCUM_SERVER_PUSH_ROW_APPLY_BEGIN() \
   Stats::BgAccumServerPushRowApplyBegin()
 
@@ -176,6 +192,9 @@
 #define STATS_BG_ADD_PER_CLOCK_OPLOG_SIZE(oplog_size) \
   Stats::BgAddPerClockOpLogSize(oplog_size)
 
+#define STATS_BG_ADD_PER_CLOCK_OPLOG_CODEC_SAVED(raw_size, encoded_size) \
+  Stats::BgAddPerClockOpLogCodecSaved(raw_size, encoded_size)
+
 #define STATS_BG_ADD_PER_CLOCK_SERVER_PUSH_ROW_SIZE(server_push_row_size) \
   Stats::BgAddPerClockServerPushRowSize(server_push_row_size)
 
@@ -197,6 +216,17 @@
 #define STATS_BG_ACCUM_IDLE_OPLOG_SENT_BYTES(num_bytes) \
   Stats::BgAccumIdleOpLogSentBytes(num_bytes)
 
+#define STATS_BG_ACCUM_OPLOG_AGGR_BYTES(recv_bytes, sent_bytes) \
+  Stats::BgAccumOpLogAggrBytes(recv_bytes, sent_bytes)
+
+#define STATS_BG_ACCUM_SERVER_OPLOG_SENT_BYTES(server_id, num_bytes) \
+  Stats::BgAccumServerOpLogSentBytes(server_id, num_bytes)
+
+#define STATS_BG_SEND_CONTROL_UPDATE(bandwidth_mbps, min_rtt_milli, \
+                                     srtt_milli, push_upper_bound_bytes) \
+  Stats::BgSendControlUpdate(bandwidth_mbps, min_rtt_milli, srtt_milli, \
+                             push_upper_bound_bytes)
+
 #define STATS_BG_ACCUM_SERVER_PUSH_OPLOG_ROW_APPLIED_ADD_ONE() \
   Stats::BgAccumServerPushOpLogRowAppliedAddOne()
 
@@ -242,6 +272,15 @@
 #define STATS_SERVER_ACCUM_APPLY_OPLOG_END() \
   Stats::ServerAccumApplyOpLogEnd()
 
+#define STATS_SERVER_ACCUM_APPLY_OPLOG_SHARD_SEC(shard, sec) \
+  Stats::ServerAccumApplyOpLogShardSec(shard, sec)
+
+#define STATS_SERVER_CLOCK_UNTIL_BEGIN() \
+  Stats::ServerClockUntilBegin()
+
+#define STATS_SERVER_CLOCK_UNTIL_END(bg_id) \
+  Stats::ServerClockUntilEnd(bg_id)
+
 #define STATS_SERVER_CLOCK() \
   Stats::ServerClock()
 
@@ -278,6 +317,7 @@
 #define STATS_APP_ACCUM_TG_CLOCK_END() ((void) 0)
 #define STATS_APP_SAMPLE_SSP_GET_BEGIN(table_id) ((void) 0)
 #define STATS_APP_SAMPLE_SSP_GET_END(table_id, hit) ((void) 0)
+#define STATS_APP_ACCUM_SSP_GET_TIER(table_id, tier, fresh) ((void) 0)
 
 #define STATS_APP_ACCUM_SSPPUSH_GET_COMM_BLOCK_BEGIN(table_id) \
   ((void) 0)
@@ -321,10 +361,15 @@
 #define STATS_BG_ACCUM_OPLOG_SERIALIZE_END() ((void) 0)
 #define STATS_BG_ACCUM_CLOCK_END_OPLOG_SERIALIZE_BEGIN() ((void) 0)
 #define STATS_BG_ACCUM_CLOCK_END_OPLOG_SERIALIZE_END() ((void) 0)
+#define STATS_BG_SEND_OPLOG_BEGIN() ((void) 0)
+#define STATS_BG_SEND_OPLOG_END() ((void) 0)
 #define STATS_BG_ACCUM_SERVER_PUSH_ROW_APPLY_BEGIN() ((void) 0)
 #define STATS_BG_ACCUM_SERVER_PUSH_ROW_APPLY_END() ((void) 0)
 #define STATS_BG_CLOCK() ((void) 0)
 #define STATS_BG_ADD_PER_CLOCK_OPLOG_SIZE(oplog_size) ((void) 0)
+
+#define STATS_BG_ADD_PER_CLOCK_OPLOG_CODEC_SAVED(raw_size, encoded_size) \
+  ((void) 0)
 #define STATS_BG_ADD_PER_CLOCK_SERVER_PUSH_ROW_SIZE(server_push_row_size) \
   ((void) 0)
 
@@ -349,6 +394,11 @@
 #define STATS_BG_ACCUM_IDLE_SEND_BEGIN() ((void) 0)
 #define STATS_BG_ACCUM_IDLE_SEND_END() ((void) 0)
 #define STATS_BG_ACCUM_IDLE_OPLOG_SENT_BYTES(num_bytes) ((void) 0)
+#define STATS_BG_ACCUM_OPLOG_AGGR_BYTES(recv_bytes, sent_bytes) ((void) 0)
+#define STATS_BG_ACCUM_SERVER_OPLOG_SENT_BYTES(server_id, num_bytes) ((void) 0)
+#define STATS_BG_SEND_CONTROL_UPDATE(bandwidth_mbps, min_rtt_milli, \
+                                     srtt_milli, push_upper_bound_bytes) \
+  ((void) 0)
 
 #define STATS_BG_ACCUM_HANDLE_APPEND_OPLOG_BEGIN() ((void) 0)
 #define STATS_BG_ACCUM_HANDLE_APPEND_OPLOG_END() ((void) 0)
@@ -359,6 +409,9 @@
 #define STATS_SERVER_ACCUM_PUSH_ROW_END() ((void) 0)
 #define STATS_SERVER_ACCUM_APPLY_OPLOG_BEGIN() ((void) 0)
 #define STATS_SERVER_ACCUM_APPLY_OPLOG_END() ((void) 0)
+#define STATS_SERVER_ACCUM_APPLY_OPLOG_SHARD_SEC(shard, sec) ((void) 0)
+#define STATS_SERVER_CLOCK_UNTIL_BEGIN() ((void) 0)
+#define STATS_SERVER_CLOCK_UNTIL_END(bg_id) ((void) 0)
 #define STATS_SERVER_CLOCK() ((void) 0)
 #define STATS_SERVER_ADD_PER_CLOCK_OPLOG_SIZE(oplog_size) ((void) 0)
 #define STATS_SERVER_ADD_PER_CLOCK_PUSH_ROW_SIZE(push_row_size) ((void) 0)
@@ -377,6 +430,65 @@ enum ThreadType {
   kNameNodeThread = 3
 };
 
+// Counters and latency histograms of one thread that the live exporter
+// (TableGroupConfig::stats_live_interval_milli) reads while the thread runs.
+// Only the owning thread updates them, with relaxed atomics, which cost the
+// same as plain increments.
+struct LiveThreadMetrics {
+  enum Counter {
+    // App threads, summed over tables.
+    kNumGet = 0,
+    kNumSSPGetHit = 1,
+    kNumSSPGetMiss = 2,
+    kNumInc = 3,
+    kNumBatchInc = 4,
+    kNumTableClock = 5,
+    // Bg threads.
+    kBgClock = 6,
+    kBgOpLogSentBytes = 7,
+    kBgServerPushRowRecvBytes = 8,
+    // Server threads.
+    kServerClock = 9,
+    kServerOpLogRecvBytes = 10,
+    kServerPushRowSentBytes = 11,
+    kNumCounters = 12
+  };
+
+  enum Histogram {
+    // Sampled, see Stats::kLiveGetSampleFreq.
+    kSSPGetHit = 0,
+    kSSPGetMiss = 1,
+    kSSPGetServerFetch = 2,
+    kBgOpLogSerialize = 3,
+    kServerApplyOpLog = 4,
+    kNumHistograms = 5
+  };
+
+  static const char *kCounterNames[kNumCounters];
+  static const char *kHistogramNames[kNumHistograms];
+
+  // Index among the threads of thread_type, in order of registration.
+  LiveThreadMetrics(ThreadType thread_type, int32_t index);
+
+  void Inc(Counter counter, uint64_t delta = 1) {
+    counters[counter].store(
+        counters[counter].load(std::memory_order_relaxed) + delta,
+        std::memory_order_relaxed);
+  }
+
+  const ThreadType thread_type;
+  const int32_t index;
+  std::atomic<uint64_t> counters[kNumCounters];
+  LatencyHistogram histograms[kNumHistograms];
+  std::atomic<bool> deregistered;
+
+  // Owned by the exporter: the values at the previous snapshot, so that it
+  // can report what happened in between.
+  uint64_t exported_counters[kNumCounters];
+  LatencyHistogram::Snapshot exported_histograms[kNumHistograms];
+  bool exported_after_deregister;
+};
+
 struct AppThreadPerTableStats {
   // System timers:
   HighResolutionTimer get_timer; // ct = client table
@@ -401,6 +513,15 @@ struct AppThreadPerTableStats {
   double accum_sample_ssp_get_hit_sec;
   double accum_sample_ssp_get_miss_sec;
 
+  // Where SSP Gets found the row: fresh enough in process storage, in the
+  // in-memory or spill tier of evicted rows, found but too stale, or not
+  // found at all.
+  uint64_t num_ssp_get_cache_hit;
+  uint64_t num_ssp_get_mem_tier_hit;
+  uint64_t num_ssp_get_spill_tier_hit;
+  uint64_t num_ssp_get_stale;
+  uint64_t num_ssp_get_not_found;
+
   // Number of Gets that are blocked waiting on receiving
   // server pushed messages.
   uint64_t num_ssppush_get_comm_block;
@@ -435,6 +556,11 @@ struct AppThreadPerTableStats {
       num_ssp_get_miss_sampled(0),
       accum_sample_ssp_get_hit_sec(0),
       accum_sample_ssp_get_miss_sec(0),
+      num_ssp_get_cache_hit(0),
+      num_ssp_get_mem_tier_hit(0),
+      num_ssp_get_spill_tier_hit(0),
+      num_ssp_get_stale(0),
+      num_ssp_get_not_found(0),
       num_ssppush_get_comm_block(0),
       accum_ssppush_get_comm_block_sec(0.0),
       accum_ssp_get_server_fetch_sec(0.0),
@@ -496,6 +622,10 @@ struct AppThreadStats {
   double accum_append_only_oplog_flush_sec;
   size_t append_only_flush_oplog_count;
 
+  // Owned by Stats. trace is 0 unless tracing.
+  LiveThreadMetrics *live;
+  TraceBuffer *trace;
+
   AppThreadStats():
       load_data_sec(0),
       init_sec(0),
@@ -511,7 +641,9 @@ struct AppThreadStats {
       app_defined_accum_sec(0),
       app_defined_accum_val(0),
       accum_append_only_oplog_flush_sec(0) ,
-      append_only_flush_oplog_count(0) { }
+      append_only_flush_oplog_count(0),
+      live(0),
+      trace(0) { }
 };
 
 struct BgThreadStats {
@@ -544,6 +676,9 @@ struct BgThreadStats {
   std::vector<double> per_clock_oplog_sent_kb;
   std::vector<double> per_clock_server_push_row_recv_kb;
 
+  double accum_oplog_codec_saved_kb;
+  std::vector<double> per_clock_oplog_codec_saved_kb;
+
   uint32_t clock_num;
 
   size_t accum_num_idle_invoke;
@@ -553,6 +688,13 @@ struct BgThreadStats {
 
   size_t accum_idle_send_bytes;
 
+  // oplog aggregator bg threads only
+  size_t accum_oplog_aggr_recv_bytes;
+  size_t accum_oplog_aggr_sent_bytes;
+
+  // server id -> oplog bytes sent to it, before aggregation
+  std::map<int32_t, size_t> accum_server_oplog_sent_bytes;
+
   HighResolutionTimer idle_send_timer;
 
   HighResolutionTimer handle_append_oplog_timer;
@@ -562,6 +704,17 @@ struct BgThreadStats {
   size_t num_row_oplog_created;
   size_t num_row_oplog_recycled;
 
+  // adaptive_bg_send controller state after its last update
+  size_t num_send_control_updates;
+  double send_control_bandwidth_mbps;
+  double send_control_min_rtt_milli;
+  double send_control_srtt_milli;
+  size_t send_control_push_upper_bound_bytes;
+
+  // Owned by Stats. trace is 0 unless tracing.
+  LiveThreadMetrics *live;
+  TraceBuffer *trace;
+
   BgThreadStats():
     accum_clock_end_oplog_serialize_sec(0.0),
     accum_total_oplog_serialize_sec(0.0),
@@ -579,15 +732,26 @@ struct BgThreadStats {
     num_server_push_deserialize_sampled(0),
     per_clock_oplog_sent_kb(1, 0.0),
     per_clock_server_push_row_recv_kb(1, 0.0),
+    accum_oplog_codec_saved_kb(0.0),
+    per_clock_oplog_codec_saved_kb(1, 0.0),
     clock_num(0),
     accum_num_idle_invoke(0),
     accum_num_idle_send(0),
     accum_num_push_row_msg_recv(0),
     accum_idle_send_sec(0),
     accum_idle_send_bytes(0),
+    accum_oplog_aggr_recv_bytes(0),
+    accum_oplog_aggr_sent_bytes(0),
     accum_handle_append_oplog_sec(0),
     num_row_oplog_created(0),
-    num_row_oplog_recycled(0) { }
+    num_row_oplog_recycled(0),
+    num_send_control_updates(0),
+    send_control_bandwidth_mbps(0),
+    send_control_min_rtt_milli(0),
+    send_control_srtt_milli(0),
+    send_control_push_upper_bound_bytes(0),
+    live(0),
+    trace(0) { }
 };
 
 struct ServerThreadStats {
@@ -597,6 +761,9 @@ struct ServerThreadStats {
   double accum_apply_oplog_sec;
   double accum_push_row_sec;
 
+  // indexed by apply shard, see OpLogApplyPool
+  std::vector<double> accum_apply_oplog_shard_sec;
+
   double accum_oplog_recv_kb;
   double accum_push_row_kb;
 
@@ -608,6 +775,10 @@ struct ServerThreadStats {
   size_t accum_num_oplog_msg_recv;
   size_t accum_num_push_row_msg_send;
 
+  // Owned by Stats. trace is 0 unless tracing.
+  LiveThreadMetrics *live;
+  TraceBuffer *trace;
+
   ServerThreadStats():
     accum_apply_oplog_sec(0.0),
     accum_push_row_sec(0.0),
@@ -617,7 +788,9 @@ struct ServerThreadStats {
     per_clock_push_row_kb(1, 0.0),
     clock_num(0),
     accum_num_oplog_msg_recv(0),
-    accum_num_push_row_msg_send(0) { }
+    accum_num_push_row_msg_send(0),
+    live(0),
+    trace(0) { }
 };
 
 struct NameNodeThreadStats {
@@ -652,6 +825,8 @@ public:
 
   static void AppSampleSSPGetBegin(int32_t table_id);
   static void AppSampleSSPGetEnd(int32_t table_id, bool hit);
+  // tier is a RowTier.
+  static void AppAccumSSPGetTier(int32_t table_id, int32_t tier, bool fresh);
 
   static void AppAccumSSPPushGetCommBlockBegin(int32_t table_id);
   static void AppAccumSSPPushGetCommBlockEnd(int32_t table_id);
@@ -704,6 +879,10 @@ public:
   static void BgAccumClockEndOpLogSerializeBegin();
   static void BgAccumClockEndOpLogSerializeEnd();
 
+  // Only traced.
+  static void BgSendOpLogBegin();
+  static void BgSendOpLogEnd();
+
   static void BgAccumServerPushRowApplyBegin();
   static void BgAccumServerPushRowApplyEnd();
 
@@ -719,6 +898,10 @@ public:
 
   static void BgClock();
   static void BgAddPerClockOpLogSize(size_t oplog_size);
+  // Bytes an oplog codec saved on one row oplog; negative if the encoding
+  // came out larger.
+  static void BgAddPerClockOpLogCodecSaved(size_t raw_size,
+                                           size_t encoded_size);
   static void BgAddPerClockServerPushRowSize(size_t server_push_row_size);
 
   static void BgIdleInvokeIncOne();
@@ -727,6 +910,11 @@ public:
   static void BgAccumIdleSendBegin();
   static void BgAccumIdleSendEnd();
   static void BgAccumIdleOpLogSentBytes(size_t num_bytes);
+  static void BgAccumOpLogAggrBytes(size_t recv_bytes, size_t sent_bytes);
+  static void BgAccumServerOpLogSentBytes(int32_t server_id, size_t num_bytes);
+  static void BgSendControlUpdate(double bandwidth_mbps, double min_rtt_milli,
+                                  double srtt_milli,
+                                  size_t push_upper_bound_bytes);
 
   static void BgAccumHandleAppendOpLogBegin();
   static void BgAccumHandleAppendOpLogEnd();
@@ -739,6 +927,11 @@ public:
 
   static void ServerAccumApplyOpLogBegin();
   static void ServerAccumApplyOpLogEnd();
+  static void ServerAccumApplyOpLogShardSec(int32_t shard, double sec);
+
+  // Only traced.
+  static void ServerClockUntilBegin();
+  static void ServerClockUntilEnd(int32_t bg_id);
 
   static void ServerClock();
   static void ServerAddPerClockOpLogSize(size_t oplog_size);
@@ -755,6 +948,18 @@ private:
   static void DeregisterBgThread();
   static void DeregisterServerThread();
 
+  static LiveThreadMetrics *RegisterLiveThread(ThreadType thread_type);
+  // Returns 0 unless tracing.
+  static TraceBuffer *RegisterTraceBuffer(const LiveThreadMetrics &live);
+  static void WriteTrace();
+
+  // NanoTimer handler of the live exporter.
+  static int32_t LiveExportTimerHandler(void *argu, int32_t rem);
+  static void StopLiveExport();
+  // Appends a snapshot to the live stats file. Not thread safe; called by
+  // the timer thread, or once it is stopped.
+  static void ExportLiveSnapshot();
+
   template<typename T>
   static void YamlPrintSequence(YAML::Emitter *yaml_out,
                                 const std::vector<T> &sequence);
@@ -773,6 +978,13 @@ private:
   static const int32_t kProcessCacheInsertSampleFreq = 1000;
   static const int32_t kServerPushDeserializeSampleFreq = 1000;
 
+  // SSP Gets timed for the live latency histograms. Much more often than
+  // kGetSampleFreq so that tails show up; a timer read costs about as much
+  // as a cache hit.
+  static const int32_t kLiveGetSampleFreq = 64;
+  // The live exporter checks for shutdown this often.
+  static const int32_t kLiveExportTickMilli = 100;
+
   // assuming I have received all server pushed message after this number
   // of Get()s.
   static const int32_t kFirstNGetToSkip = 10;
@@ -788,6 +1000,27 @@ private:
 
   static std::mutex stats_mtx_;
 
+  // Live export
+  // Read by app threads on every sampled Get, set and cleared by the thread
+  // that starts and stops the export.
+  static std::atomic<bool> live_export_;
+  static std::mutex live_mtx_;
+  // Guarded by live_mtx_. Kept after threads deregister, as the exporter
+  // may still be reading them.
+  static std::vector<std::unique_ptr<LiveThreadMetrics> > live_threads_;
+  static NanoTimer live_export_timer_;
+  static std::atomic<bool> live_export_stop_;
+  static HighResolutionTimer live_export_uptime_;
+  static double live_export_last_sec_;
+  static std::string live_export_path_;
+  static std::ofstream live_export_out_;
+
+  // Tracing
+  static std::string trace_path_;
+  static std::mutex trace_mtx_;
+  // Guarded by trace_mtx_, indexed by tid.
+  static std::vector<std::unique_ptr<TraceBuffer> > trace_buffers_;
+
   // App thread stats
   static std::vector<double> app_thread_life_sec_;
   static std::vector<double> app_load_data_sec_;
@@ -836,6 +1069,9 @@ private:
   static std::vector<double> bg_per_clock_oplog_sent_mb_;
   static std::vector<double> bg_per_clock_server_push_row_recv_mb_;
 
+  static double bg_accum_oplog_codec_saved_mb_;
+  static std::vector<double> bg_per_clock_oplog_codec_saved_mb_;
+
   static std::vector<size_t> bg_accum_server_push_oplog_row_applied_;
   static std::vector<size_t> bg_accum_server_push_update_applied_;
   static std::vector<size_t> bg_accum_server_push_version_diff_;
@@ -853,6 +1089,10 @@ private:
   static std::vector<size_t> bg_accum_num_push_row_msg_recv_;
   static std::vector<double> bg_accum_idle_send_sec_;
   static std::vector<size_t> bg_accum_idle_send_bytes_;
+  static std::vector<size_t> bg_accum_oplog_aggr_recv_bytes_;
+  static std::vector<size_t> bg_accum_oplog_aggr_sent_bytes_;
+  // summed over bg threads, shows how evenly rows are partitioned
+  static std::map<int32_t, size_t> bg_accum_server_oplog_sent_bytes_;
 
   static std::vector<double> bg_accum_handle_append_oplog_sec_;
   static std::vector<size_t> bg_num_append_oplog_buff_handled_;
@@ -860,8 +1100,16 @@ private:
   static std::vector<size_t> bg_num_row_oplog_created_;
   static std::vector<size_t> bg_num_row_oplog_recycled_;
 
+  static std::vector<size_t> bg_num_send_control_updates_;
+  static std::vector<double> bg_send_control_bandwidth_mbps_;
+  static std::vector<double> bg_send_control_min_rtt_milli_;
+  static std::vector<double> bg_send_control_srtt_milli_;
+  static std::vector<size_t> bg_send_control_push_upper_bound_bytes_;
+
   // Server thread stats
   static double server_accum_apply_oplog_sec_;
+  // summed over server threads
+  static std::vector<double> server_accum_apply_oplog_shard_sec_;
 
   static double server_accum_push_row_sec_;
 
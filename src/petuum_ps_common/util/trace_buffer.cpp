@@ -0,0 +1,91 @@
+#include <petuum_ps_common/util/trace_buffer.hpp>
+
+#include <cstdio>
+
+namespace petuum {
+
+namespace {
+
+const char *kTraceSpanNames[kNumTraceSpans] = {
+  "app_comp",
+  "clock",
+  "request_row_wait",
+  "server_push_wait",
+  "oplog_serialize",
+  "send_oplog_msgs",
+  "server_push_row_apply",
+  "apply_oplog",
+  "clock_until",
+  "server_push_row",
+  "min_clock_advanced"
+};
+
+// Name of the span's argument, 0 if it has none.
+const char *kTraceSpanArgNames[kNumTraceSpans] = {
+  0,
+  0,
+  "table_id",
+  "table_id",
+  0,
+  0,
+  0,
+  0,
+  "bg_id",
+  0,
+  0
+};
+
+// Chrome trace timestamps are in microseconds.
+void WriteMicros(int64_t ns, std::ostream *out) {
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%lld.%03d", (long long) (ns / 1000),
+           int(ns % 1000));
+  *out << buf;
+}
+
+}  // anonymous namespace
+
+TraceBuffer::TraceBuffer(const std::string &thread_name, int32_t tid,
+                         size_t capacity):
+    thread_name_(thread_name),
+    tid_(tid),
+    capacity_(capacity),
+    events_(new Event[capacity]),
+    num_events_(0),
+    clock_(0) {
+  for (int32_t i = 0; i < kNumTraceSpans; ++i)
+    begin_ns_[i] = 0;
+}
+
+void TraceBuffer::WriteJson(int32_t pid, std::ostream *out,
+                            bool *first) const {
+  if (!*first)
+    *out << ",\n";
+  *first = false;
+  *out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid
+       << ",\"tid\":" << tid_ << ",\"args\":{\"name\":\"" << thread_name_
+       << "\"}}";
+
+  uint64_t num_events = num_events_.load(std::memory_order_acquire);
+  uint64_t oldest = (num_events > capacity_) ? num_events - capacity_ : 0;
+  for (uint64_t i = oldest; i < num_events; ++i) {
+    const Event &event = events_[i % capacity_];
+    *out << ",\n{\"name\":\"" << kTraceSpanNames[event.span] << "\"";
+    if (event.dur_ns < 0) {
+      // Instant, scoped to the process.
+      *out << ",\"ph\":\"i\",\"s\":\"p\"";
+    } else {
+      *out << ",\"ph\":\"X\",\"dur\":";
+      WriteMicros(event.dur_ns, out);
+    }
+    *out << ",\"pid\":" << pid << ",\"tid\":" << tid_ << ",\"ts\":";
+    WriteMicros(event.begin_ns, out);
+    *out << ",\"args\":{\"clock\":" << event.clock;
+    if (kTraceSpanArgNames[event.span] != 0) {
+      *out << ",\"" << kTraceSpanArgNames[event.span] << "\":" << event.arg;
+    }
+    *out << "}}";
+  }
+}
+
+}  // namespace petuum
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <stdint.h>
+#include <time.h>
+#include <atomic>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <boost/noncopyable.hpp>
+
+namespace petuum {
+
+// Spans recorded by TraceBuffer. Each is timed between a pair of STATS_*
+// macros (see Stats), except the instants.
+enum TraceSpan {
+  kTraceAppComp = 0,
+  kTraceAppClock = 1,
+  // Blocking RequestRow wait in an SSP Get.
+  kTraceAppServerFetch = 2,
+  // SSPPush Get waiting for a server push.
+  kTraceAppServerPushWait = 3,
+  kTraceBgOpLogSerialize = 4,
+  kTraceBgSendOpLog = 5,
+  kTraceBgServerPushRowApply = 6,
+  kTraceServerApplyOpLog = 7,
+  kTraceServerClockUntil = 8,
+  kTraceServerPushRow = 9,
+  // Instant: the server's min clock advanced.
+  kTraceServerMinClock = 10,
+  kNumTraceSpans = 11
+};
+
+// Timeline of one thread for the Chrome trace (chrome://tracing, Perfetto)
+// written at shutdown when TableGroupConfig::trace_path is set. Spans are
+// kept in a ring buffer of fixed capacity; once full, the oldest are
+// overwritten. Spans are stamped with wall clock time, so that the files of
+// all clients line up if the hosts' clocks are synchronized, and with the
+// owning thread's clock (app: TableGroup::Clock() calls, bg: client clock,
+// server: min clock), so that a straggler shows up as the span every other
+// thread waits on at the same clock.
+//
+// Only the owning thread records; WriteJson() may run concurrently but
+// would then miss the spans being recorded.
+class TraceBuffer : boost::noncopyable {
+public:
+  // tid identifies the thread in the trace.
+  TraceBuffer(const std::string &thread_name, int32_t tid, size_t capacity);
+
+  void Begin(TraceSpan span) {
+    begin_ns_[span] = NowNanos();
+  }
+
+  // arg is shown with the span if it has an argument name (see
+  // kTraceSpanArgNames in trace_buffer.cpp).
+  void End(TraceSpan span, int32_t arg = 0) {
+    Append(span, begin_ns_[span], NowNanos() - begin_ns_[span], arg);
+  }
+
+  void Instant(TraceSpan span, int32_t arg = 0) {
+    Append(span, NowNanos(), -1, arg);
+  }
+
+  // The owning thread advanced its clock.
+  void Clock() {
+    ++clock_;
+  }
+
+  // Writes the thread's metadata and spans as comma separated Chrome trace
+  // events, each preceded by a comma unless *first is set, which it clears.
+  void WriteJson(int32_t pid, std::ostream *out, bool *first) const;
+
+  static int64_t NowNanos() {
+    timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return int64_t(now.tv_sec) * 1000000000 + now.tv_nsec;
+  }
+
+private:
+  struct Event {
+    int64_t begin_ns;
+    // -1 for an instant.
+    int64_t dur_ns;
+    int32_t span;
+    int32_t clock;
+    int32_t arg;
+  };
+
+  void Append(TraceSpan span, int64_t begin_ns, int64_t dur_ns, int32_t arg) {
+    uint64_t num_events = num_events_.load(std::memory_order_relaxed);
+    Event &event = events_[num_events % capacity_];
+    event.begin_ns = begin_ns;
+    event.dur_ns = dur_ns;
+    event.span = span;
+    event.clock = clock_;
+    event.arg = arg;
+    num_events_.store(num_events + 1, std::memory_order_release);
+  }
+
+  const std::string thread_name_;
+  const int32_t tid_;
+  const size_t capacity_;
+  std::unique_ptr<Event[]> events_;
+  std::atomic<uint64_t> num_events_;
+
+  int64_t begin_ns_[kNumTraceSpans];
+  int32_t clock_;
+};
+
+}  // namespace petuum
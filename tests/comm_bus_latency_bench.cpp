@@ -0,0 +1,111 @@
+// Description: Round trip latency between an app thread and a bg thread
+// over CommBus, the in-process part of a Get() that misses the process
+// cache (row request to the bg thread, reply once the row is in). Run
+// with both in-process transports: zmq inproc sockets and the ring
+// transport (CommBus::kRingTransport, --inproc_ring_transport).
+
+#include <petuum_ps_common/comm_bus/comm_bus.hpp>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <string.h>
+
+DEFINE_int32(num_round_trips, 100000, "# of measured round trips per "
+    "transport.");
+DEFINE_int32(num_warmup_round_trips, 1000, "# of round trips before "
+    "measuring.");
+DEFINE_int32(request_bytes, 16, "Request size; a RowRequestMsg is 16 "
+    "bytes.");
+DEFINE_int32(reply_bytes, 8, "Reply size; the row itself is put in the "
+    "process storage, the reply only wakes the app thread.");
+
+namespace {
+
+const int32_t kBgId = 100;
+const int32_t kAppId = 200;
+const int32_t kEntityEnd = 1000;
+
+void BgMain(petuum::CommBus *comm_bus, int transport) {
+  petuum::CommBus::Config config(kBgId, petuum::CommBus::kInProc, "");
+  config.inproc_transport_ = transport;
+  comm_bus->ThreadRegister(config);
+
+  std::vector<uint8_t> reply(FLAGS_reply_bytes, 1);
+  int32_t sender_id;
+  zmq::message_t msg;
+  // Connect message
+  comm_bus->RecvInProc(&sender_id, &msg);
+  CHECK_EQ(sender_id, kAppId);
+  while (true) {
+    comm_bus->RecvInProc(&sender_id, &msg);
+    // An empty message stops the thread.
+    if (msg.size() == 0)
+      break;
+    size_t sent_size = comm_bus->SendInProc(sender_id, reply.data(),
+                                            reply.size());
+    CHECK_EQ(sent_size, reply.size());
+  }
+  comm_bus->ThreadDeregister();
+}
+
+void Run(const char *name, int transport) {
+  petuum::CommBus comm_bus(0, kEntityEnd, 1);
+  std::thread bg(BgMain, &comm_bus, transport);
+  // The bg thread must register before the app thread connects.
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  petuum::CommBus::Config config(kAppId, petuum::CommBus::kNone, "");
+  config.inproc_transport_ = transport;
+  comm_bus.ThreadRegister(config);
+  int32_t connect_msg = 0;
+  comm_bus.ConnectTo(kBgId, &connect_msg, sizeof(connect_msg));
+
+  std::vector<uint8_t> request(FLAGS_request_bytes, 1);
+  std::vector<double> latencies;
+  latencies.reserve(FLAGS_num_round_trips);
+  int32_t sender_id;
+  zmq::message_t msg;
+  for (int32_t i = 0; i < FLAGS_num_warmup_round_trips + FLAGS_num_round_trips;
+       ++i) {
+    auto begin = std::chrono::steady_clock::now();
+    size_t sent_size = comm_bus.SendInProc(kBgId, request.data(),
+                                           request.size());
+    CHECK_EQ(sent_size, request.size());
+    comm_bus.RecvInProc(&sender_id, &msg);
+    CHECK_EQ(sender_id, kBgId);
+    CHECK_EQ(msg.size(), static_cast<size_t>(FLAGS_reply_bytes));
+    if (i >= FLAGS_num_warmup_round_trips) {
+      latencies.push_back(std::chrono::duration<double, std::micro>(
+          std::chrono::steady_clock::now() - begin).count());
+    }
+  }
+  comm_bus.SendInProc(kBgId, request.data(), 0);
+  bg.join();
+  comm_bus.ThreadDeregister();
+
+  std::sort(latencies.begin(), latencies.end());
+  double sum = 0;
+  for (double latency : latencies)
+    sum += latency;
+  printf("%-5s round trip (us): mean = %.2f p50 = %.2f p99 = %.2f "
+         "max = %.2f\n", name, sum / latencies.size(),
+         latencies[latencies.size() / 2],
+         latencies[latencies.size() * 99 / 100], latencies.back());
+}
+
+}  // anonymous namespace
+
+int main(int argc, char *argv[]) {
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  CHECK_GT(FLAGS_num_round_trips, 0);
+
+  Run("zmq", petuum::CommBus::kZmqTransport);
+  Run("ring", petuum::CommBus::kRingTransport);
+  return 0;
+}
@@ -0,0 +1,94 @@
+// Description: DenseRow read throughput vs. number of reader threads, with
+// one writer applying dense batch updates to the same row the whole time
+// (the bg thread applying server replies / app threads Inc-ing). Built
+// twice by `make tests`: dense_row_read_bench guards the row with a mutex,
+// dense_row_read_bench_seqlock with PETUUM_OPTIMISTIC_ROW_READ.
+
+#include <petuum_ps_common/storage/dense_row.hpp>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+
+DEFINE_int32(row_capacity, 1000, "# of floats in the row.");
+DEFINE_int32(max_num_readers, 8, "Reader thread counts 1, 2, 4, ... up to "
+    "this are measured.");
+DEFINE_double(seconds, 2, "Seconds per measurement.");
+DEFINE_bool(bulk_read, false, "Readers call CopyToVector() instead of "
+    "operator[] per element.");
+DEFINE_bool(with_writer, true, "Run a concurrent writer.");
+
+namespace {
+
+// Returns # of elements read per second by all readers together.
+double Measure(petuum::DenseRow<float> *row, int32_t num_readers) {
+  std::atomic<bool> stop(false);
+  std::atomic<int32_t> num_started(0);
+  std::vector<int64_t> num_read(num_readers, 0);
+  std::vector<std::thread> threads;
+  for (int32_t t = 0; t < num_readers; ++t) {
+    threads.emplace_back([&, t]() {
+      std::vector<float> buff;
+      float sum = 0;
+      int64_t n = 0;
+      ++num_started;
+      while (!stop.load(std::memory_order_relaxed)) {
+        if (FLAGS_bulk_read) {
+          row->CopyToVector(&buff);
+          sum += buff[0];
+        } else {
+          for (int32_t i = 0; i < FLAGS_row_capacity; ++i)
+            sum += (*row)[i];
+        }
+        n += FLAGS_row_capacity;
+      }
+      num_read[t] = n;
+      CHECK(sum == sum);
+    });
+  }
+  std::thread writer;
+  if (FLAGS_with_writer) {
+    writer = std::thread([&]() {
+      std::vector<float> updates(FLAGS_row_capacity, 1);
+      while (!stop.load(std::memory_order_relaxed))
+        row->ApplyDenseBatchInc(updates.data(), 0, FLAGS_row_capacity);
+    });
+  }
+  while (num_started < num_readers) std::this_thread::yield();
+  auto begin = std::chrono::steady_clock::now();
+  std::this_thread::sleep_for(std::chrono::duration<double>(FLAGS_seconds));
+  stop = true;
+  for (auto &thread : threads) thread.join();
+  double elapsed = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - begin).count();
+  if (writer.joinable()) writer.join();
+  int64_t total = 0;
+  for (int64_t n : num_read) total += n;
+  return total / elapsed;
+}
+
+}  // anonymous namespace
+
+int main(int argc, char *argv[]) {
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+
+  petuum::DenseRow<float> row;
+  row.Init(FLAGS_row_capacity);
+#ifdef PETUUM_OPTIMISTIC_ROW_READ
+  printf("row lock: seqlock\n");
+#else
+  printf("row lock: mutex\n");
+#endif
+  for (int32_t num_readers = 1; num_readers <= FLAGS_max_num_readers;
+       num_readers *= 2) {
+    double rate = Measure(&row, num_readers);
+    printf("readers = %d reads/sec = %.3e per_reader = %.3e\n",
+           num_readers, rate, rate / num_readers);
+  }
+  return 0;
+}
@@ -0,0 +1,122 @@
+// Description: A server reply for a row whose only local copy is in the
+// evicted row store must not bring that copy back (which costs a
+// decompression and may evict another row) just to overwrite it. This
+// walks BoundedSparseProcessStorage through what the bg worker does:
+// evict -> evicted row store hit -> server reply
+// (AbstractBgWorker::ApplyRowRequestReply()).
+
+#include <petuum_ps_common/storage/bounded_sparse_process_storage.hpp>
+#include <petuum_ps_common/storage/evicted_row_store.hpp>
+#include <petuum_ps_common/storage/dense_row.hpp>
+#include <petuum_ps/client/ssp_client_row.hpp>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <cstdio>
+
+namespace {
+
+const int32_t kCapacity = 2;
+const int32_t kRowCapacity = 16;
+
+petuum::ClientRow *MakeClientRow(int32_t clock, float value) {
+  petuum::DenseRow<float> *row_data = new petuum::DenseRow<float>;
+  row_data->Init(kRowCapacity);
+  int32_t column_id = 0;
+  row_data->ApplyInc(column_id, &value);
+  return new petuum::SSPClientRow(clock, row_data, true);
+}
+
+petuum::ClientRow *RestoreClientRow(int32_t clock, const void *data,
+                                    size_t size) {
+  petuum::DenseRow<float> *row_data = new petuum::DenseRow<float>;
+  row_data->Deserialize(data, size);
+  return new petuum::SSPClientRow(clock, row_data, true);
+}
+
+float ValueOf(petuum::ClientRow *client_row) {
+  return (*static_cast<petuum::DenseRow<float>*>(
+      client_row->GetRowDataPtr()))[0];
+}
+
+}  // anonymous namespace
+
+int main(int argc, char *argv[]) {
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+
+  petuum::EvictedRowStore *evicted_rows
+      = new petuum::EvictedRowStore(1 << 20, "", 0);
+  petuum::BoundedSparseProcessStorage storage(kCapacity, 4, evicted_rows,
+                                              RestoreClientRow);
+
+  // Rows 0 .. kCapacity at clock 1; one of them is evicted.
+  for (int32_t row_id = 0; row_id <= kCapacity; ++row_id)
+    CHECK(storage.Insert(row_id, MakeClientRow(1, row_id + 1)));
+  int32_t evicted_row_id = -1;
+  for (int32_t row_id = 0; row_id <= kCapacity; ++row_id) {
+    if (!storage.Find(row_id)) {
+      CHECK_EQ(evicted_row_id, -1) << "more than one row evicted";
+      evicted_row_id = row_id;
+    }
+  }
+  CHECK_GE(evicted_row_id, 0) << "no row evicted";
+  CHECK(evicted_rows->Has(evicted_row_id));
+
+  // Resident rows are found as usual.
+  for (int32_t row_id = 0; row_id <= kCapacity; ++row_id) {
+    if (row_id == evicted_row_id)
+      continue;
+    petuum::RowAccessor row_accessor;
+    petuum::ClientRow *client_row
+        = storage.FindResident(row_id, &row_accessor);
+    CHECK(client_row != 0) << row_id;
+    CHECK_EQ(ValueOf(client_row), row_id + 1);
+  }
+
+  // The reply for the evicted row: FindResident() misses without touching
+  // the evicted row store or the other rows.
+  {
+    petuum::RowAccessor row_accessor;
+    CHECK(storage.FindResident(evicted_row_id, &row_accessor) == 0);
+  }
+  CHECK(evicted_rows->Has(evicted_row_id));
+  for (int32_t row_id = 0; row_id <= kCapacity; ++row_id)
+    CHECK_EQ(storage.Find(row_id), row_id != evicted_row_id) << row_id;
+
+  // Inserting the server's row (InsertNonexistentRow()) supersedes the
+  // evicted copy; one of the other rows makes room.
+  CHECK(storage.Insert(evicted_row_id, MakeClientRow(5, 42)));
+  CHECK(!evicted_rows->Has(evicted_row_id));
+  {
+    petuum::RowAccessor row_accessor;
+    petuum::RowTier tier;
+    petuum::ClientRow *client_row
+        = storage.Find(evicted_row_id, &row_accessor, &tier);
+    CHECK(client_row != 0);
+    CHECK_EQ(tier, petuum::kRowTierCache);
+    CHECK_EQ(client_row->GetClock(), 5);
+    CHECK_EQ(ValueOf(client_row), 42);
+  }
+
+  // Find() (app threads) still restores an evicted copy.
+  int32_t newly_evicted_row_id = -1;
+  for (int32_t row_id = 0; row_id <= kCapacity; ++row_id) {
+    if (!storage.Find(row_id))
+      newly_evicted_row_id = row_id;
+  }
+  CHECK_GE(newly_evicted_row_id, 0);
+  CHECK_NE(newly_evicted_row_id, evicted_row_id);
+  {
+    petuum::RowAccessor row_accessor;
+    petuum::RowTier tier;
+    petuum::ClientRow *client_row
+        = storage.Find(newly_evicted_row_id, &row_accessor, &tier);
+    CHECK(client_row != 0);
+    CHECK_EQ(tier, petuum::kRowTierMem);
+    CHECK_EQ(client_row->GetClock(), 1);
+    CHECK_EQ(ValueOf(client_row), newly_evicted_row_id + 1);
+  }
+
+  printf("evicted_row_reply_test passed\n");
+  return 0;
+}
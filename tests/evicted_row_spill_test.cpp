@@ -0,0 +1,85 @@
+// Description: Space freed in the spill file of an EvictedRowStore is
+// merged with the free space next to it, so that a copy larger than any one
+// of the freed copies still fits, and free space at the end of the file goes
+// back to the end. Copies are random bytes, which snappy leaves as they are,
+// and memory is off, so every copy goes to the spill file.
+
+#include <petuum_ps_common/storage/evicted_row_store.hpp>
+#include <petuum_ps_common/storage/dense_row.hpp>
+#include <petuum_ps/client/ssp_client_row.hpp>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace {
+
+// Columns of the smallest copy; the spill file holds three of them.
+const int32_t kNumColumns = 64;
+const size_t kCopySize = kNumColumns * sizeof(float);
+
+std::mt19937 gen(1);
+
+std::vector<uint8_t> RandomBytes(int32_t num_columns) {
+  std::vector<uint8_t> bytes(num_columns * sizeof(float));
+  for (auto &byte : bytes)
+    byte = static_cast<uint8_t>(gen());
+  return bytes;
+}
+
+// Puts a copy of num_columns random columns and returns its bytes.
+std::vector<uint8_t> PutRow(petuum::EvictedRowStore *evicted_rows,
+                            int32_t row_id, int32_t num_columns) {
+  std::vector<uint8_t> bytes = RandomBytes(num_columns);
+  petuum::DenseRow<float> *row_data = new petuum::DenseRow<float>;
+  CHECK(row_data->Deserialize(bytes.data(), bytes.size()));
+  petuum::SSPClientRow client_row(1, row_data, true);
+  evicted_rows->Put(row_id, &client_row);
+  return bytes;
+}
+
+void CheckTake(petuum::EvictedRowStore *evicted_rows, int32_t row_id,
+               const std::vector<uint8_t> &bytes) {
+  int32_t clock = 0;
+  std::vector<uint8_t> row_bytes;
+  CHECK_EQ(evicted_rows->Take(row_id, &clock, &row_bytes),
+           petuum::kRowTierSpill) << row_id;
+  CHECK_EQ(clock, 1);
+  CHECK(row_bytes == bytes) << row_id;
+}
+
+}  // anonymous namespace
+
+int main(int argc, char *argv[]) {
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+
+  petuum::EvictedRowStore evicted_rows(0, "/tmp", 3 * kCopySize);
+
+  // Fill the spill file with rows 0, 1 and 2; row 3 does not fit.
+  std::vector<std::vector<uint8_t> > bytes;
+  for (int32_t row_id = 0; row_id < 3; ++row_id)
+    bytes.push_back(PutRow(&evicted_rows, row_id, kNumColumns));
+  PutRow(&evicted_rows, 3, kNumColumns);
+  CHECK(!evicted_rows.Has(3));
+
+  // Rows 0 and 1 are adjacent; a copy twice their size fits once both are
+  // freed, in between row 2 and the start of the file.
+  CheckTake(&evicted_rows, 0, bytes[0]);
+  CheckTake(&evicted_rows, 1, bytes[1]);
+  std::vector<uint8_t> large_bytes = PutRow(&evicted_rows, 4,
+                                            2 * kNumColumns);
+  CHECK(evicted_rows.Has(4));
+
+  // Emptying the file frees all of it.
+  CheckTake(&evicted_rows, 2, bytes[2]);
+  CheckTake(&evicted_rows, 4, large_bytes);
+  std::vector<uint8_t> full_bytes = PutRow(&evicted_rows, 5,
+                                           3 * kNumColumns);
+  CHECK(evicted_rows.Has(5));
+  CheckTake(&evicted_rows, 5, full_bytes);
+
+  printf("evicted_row_spill_test passed\n");
+  return 0;
+}
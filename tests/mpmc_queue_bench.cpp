@@ -0,0 +1,121 @@
+// Description: MPMCQueue throughput under contention, against the
+// mutex-and-condition-variable bounded buffer it replaced (MutexQueue
+// below). Producers Push() their share of --num_items, consumers Pop()
+// until all are taken, yielding when the queue is empty; every item must
+// come out exactly once.
+
+#include <petuum_ps_common/util/mpmc_queue.hpp>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <string.h>
+
+DEFINE_int64(num_items, 4000000, "# of items pushed per measurement.");
+DEFINE_int32(capacity, 1024, "Queue capacity.");
+
+namespace {
+
+// The previous MPMCQueue.
+template<typename T>
+class MutexQueue : boost::noncopyable {
+public:
+  MutexQueue(size_t capacity)
+  : capacity_(capacity),
+    size_(0),
+    buffer_(new T[capacity]) {
+    begin_ = buffer_.get();
+    end_ = begin_;
+  }
+
+  void Push(const T& value) {
+    std::unique_lock<std::mutex> lock(mtx_);
+    while (size_ == capacity_) cv_.wait(lock);
+    memcpy(end_, &value, sizeof(T));
+    end_++;
+    size_++;
+    if (end_ == buffer_.get() + capacity_) end_ = buffer_.get();
+  }
+
+  bool Pop(T* value) {
+    std::unique_lock<std::mutex> lock(mtx_);
+    if (size_ == 0) return false;
+    if (size_ == capacity_) cv_.notify_all();
+    *value = *begin_;
+    begin_++;
+    size_--;
+    if (begin_ == buffer_.get() + capacity_) begin_ = buffer_.get();
+    return true;
+  }
+
+private:
+  size_t capacity_, size_;
+  std::unique_ptr<T[]> buffer_;
+  T *begin_, *end_;
+  std::mutex mtx_;
+  std::condition_variable cv_;
+};
+
+// Returns items per second.
+template<typename Queue>
+double Measure(int32_t num_producers, int32_t num_consumers) {
+  Queue queue(FLAGS_capacity);
+  std::atomic<int64_t> num_popped(0);
+  std::vector<int64_t> sums(num_consumers, 0);
+  std::vector<std::thread> threads;
+  int64_t num_per_producer = FLAGS_num_items / num_producers;
+  int64_t num_items = num_per_producer * num_producers;
+
+  auto begin = std::chrono::steady_clock::now();
+  for (int32_t p = 0; p < num_producers; ++p) {
+    threads.emplace_back([&, p]() {
+      for (int64_t i = 0; i < num_per_producer; ++i)
+        queue.Push(p * num_per_producer + i);
+    });
+  }
+  for (int32_t c = 0; c < num_consumers; ++c) {
+    threads.emplace_back([&, c]() {
+      int64_t value;
+      int64_t sum = 0;
+      while (num_popped.load(std::memory_order_relaxed) < num_items) {
+        if (queue.Pop(&value)) {
+          sum += value;
+          ++num_popped;
+        } else {
+          std::this_thread::yield();
+        }
+      }
+      sums[c] = sum;
+    });
+  }
+  for (auto &thread : threads) thread.join();
+  double elapsed = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - begin).count();
+
+  int64_t sum = 0;
+  for (int64_t s : sums) sum += s;
+  CHECK_EQ(num_popped.load(), num_items);
+  CHECK_EQ(sum, num_items * (num_items - 1) / 2);
+  return num_items / elapsed;
+}
+
+}  // anonymous namespace
+
+int main(int argc, char *argv[]) {
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+
+  const int32_t configs[][2] = {{1, 1}, {2, 2}, {4, 4}, {8, 4}, {8, 8}};
+  for (const auto &config : configs) {
+    double mutex_rate = Measure<MutexQueue<int64_t> >(config[0], config[1]);
+    double mpmc_rate = Measure<petuum::MPMCQueue<int64_t> >(config[0],
+                                                            config[1]);
+    printf("producers = %d consumers = %d items/sec: mutex = %.3e "
+           "mpmc = %.3e\n", config[0], config[1], mutex_rate, mpmc_rate);
+  }
+  return 0;
+}
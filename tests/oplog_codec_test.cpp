@@ -0,0 +1,110 @@
+// Description: Tables whose rows do not have float updates must be refused
+// lossy oplog codecs and top-k (TableGroup::CreateTable() fails), and
+// lossy encoding of float rows must round trip within the codec's error.
+
+#include <petuum_ps_common/oplog/oplog_codec.hpp>
+#include <petuum_ps_common/oplog/dense_row_oplog.hpp>
+#include <petuum_ps_common/storage/dense_row.hpp>
+#include <petuum_ps_common/storage/sparse_row.hpp>
+#include <petuum_ps_common/util/class_register.hpp>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <cmath>
+#include <cstdio>
+
+namespace {
+
+const int32_t kFloatDenseRow = 0;
+const int32_t kIntDenseRow = 1;
+const int32_t kIntSparseRow = 2;
+const int32_t kDoubleDenseRow = 3;
+
+petuum::TableInfo MakeTableInfo(int32_t row_type, petuum::OpLogCodec codec,
+                                double topk_ratio) {
+  petuum::TableInfo table_info;
+  table_info.row_type = row_type;
+  table_info.oplog_codec = codec;
+  table_info.oplog_topk_ratio = topk_ratio;
+  return table_info;
+}
+
+void TestCodecSupported() {
+  using petuum::OpLogCodecSupported;
+  const int32_t row_types[] = {kIntDenseRow, kIntSparseRow, kDoubleDenseRow};
+  for (int32_t row_type : row_types) {
+    CHECK(!OpLogCodecSupported(
+        MakeTableInfo(row_type, petuum::FP16Codec, 0))) << row_type;
+    CHECK(!OpLogCodecSupported(
+        MakeTableInfo(row_type, petuum::Int8Codec, 0))) << row_type;
+    CHECK(!OpLogCodecSupported(
+        MakeTableInfo(row_type, petuum::VarintCodec, 0.1))) << row_type;
+    CHECK(OpLogCodecSupported(
+        MakeTableInfo(row_type, petuum::VarintCodec, 0))) << row_type;
+    CHECK(OpLogCodecSupported(
+        MakeTableInfo(row_type, petuum::NoCodec, 0.1))) << row_type;
+  }
+  CHECK(OpLogCodecSupported(
+      MakeTableInfo(kFloatDenseRow, petuum::FP16Codec, 0)));
+  CHECK(OpLogCodecSupported(
+      MakeTableInfo(kFloatDenseRow, petuum::Int8Codec, 0.5)));
+  CHECK(OpLogCodecSupported(
+      MakeTableInfo(kFloatDenseRow, petuum::VarintCodec, 0.5)));
+}
+
+void InitFloat(int32_t column_id, void *update) {
+  *reinterpret_cast<float*>(update) = 0;
+}
+
+bool CheckZeroFloat(const void *update) {
+  return *reinterpret_cast<const float*>(update) == 0;
+}
+
+void TestFP16RoundTrip() {
+  const int32_t kCapacity = 64;
+  petuum::DenseRowOpLog row_oplog(InitFloat, CheckZeroFloat, sizeof(float),
+                                  kCapacity);
+  for (int32_t i = 0; i < kCapacity; ++i)
+    *reinterpret_cast<float*>(row_oplog.FindCreate(i)) = (i - 32) * 0.37;
+
+  petuum::OpLogEncoder encoder(petuum::FP16Codec, 0, true, sizeof(float));
+  const uint8_t *encoded;
+  size_t encoded_size = encoder.EncodeAndReset(&row_oplog, &encoded);
+
+  petuum::OpLogDecodeArena arena;
+  const int32_t *column_ids = 0;
+  int32_t num_updates = 0;
+  size_t decoded_size = 0;
+  const float *updates = reinterpret_cast<const float*>(
+      petuum::DecodeRowOpLog(petuum::FP16Codec, true, sizeof(float), encoded,
+                             &arena, &column_ids, &num_updates,
+                             &decoded_size));
+  CHECK_EQ(decoded_size, encoded_size);
+  CHECK_EQ(num_updates, kCapacity);
+  for (int32_t i = 0; i < kCapacity; ++i) {
+    float expected = (i - 32) * 0.37;
+    CHECK_LE(std::abs(updates[i] - expected), std::abs(expected) / 1024)
+        << i;
+  }
+}
+
+}  // anonymous namespace
+
+int main(int argc, char *argv[]) {
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  petuum::ClassRegistry<petuum::AbstractRow> &registry
+      = petuum::ClassRegistry<petuum::AbstractRow>::GetRegistry();
+  registry.AddCreator(kFloatDenseRow,
+      petuum::CreateObj<petuum::AbstractRow, petuum::DenseRow<float> >);
+  registry.AddCreator(kIntDenseRow,
+      petuum::CreateObj<petuum::AbstractRow, petuum::DenseRow<int32_t> >);
+  registry.AddCreator(kIntSparseRow,
+      petuum::CreateObj<petuum::AbstractRow, petuum::SparseRow<int32_t> >);
+  registry.AddCreator(kDoubleDenseRow,
+      petuum::CreateObj<petuum::AbstractRow, petuum::DenseRow<double> >);
+
+  TestCodecSupported();
+  TestFP16RoundTrip();
+  printf("oplog_codec_test passed\n");
+  return 0;
+}
@@ -0,0 +1,128 @@
+// Description: Server-side apply throughput on a table with many rows:
+// ServerRowMap (flat, hashed and dense layouts) vs. the
+// boost::unordered_map<int32_t, ServerRow> ServerTable used before. Each
+// pass applies one dense batch update per row, the work OpLogApplyPool
+// does for a client's oplog, with row ids visited in random or in
+// ascending order; a last pass iterates the table the way
+// TakeSnapShot() and AppendTableToBuffs() do.
+
+#include <petuum_ps/server/server_row_map.hpp>
+#include <petuum_ps_common/storage/dense_row.hpp>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <boost/unordered_map.hpp>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+
+DEFINE_int32(num_rows, 1000000, "# of rows in the table.");
+DEFINE_int32(row_capacity, 16, "# of floats per row.");
+DEFINE_int32(num_server_threads, 4, "Row ids are i * num_server_threads, "
+    "as seen by one of num_server_threads server threads.");
+DEFINE_int32(num_passes, 5, "# of passes over all rows per measurement.");
+
+namespace {
+
+typedef boost::unordered_map<int32_t, petuum::ServerRow> NodeMap;
+
+petuum::ServerRow MakeRow() {
+  petuum::DenseRow<float> *row = new petuum::DenseRow<float>;
+  row->Init(FLAGS_row_capacity);
+  return petuum::ServerRow(row);
+}
+
+double Seconds(std::chrono::steady_clock::time_point begin) {
+  return std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - begin).count();
+}
+
+petuum::ServerRow *Find(NodeMap *storage, int32_t row_id) {
+  auto iter = storage->find(row_id);
+  return iter == storage->end() ? 0 : &(iter->second);
+}
+
+petuum::ServerRow *Find(petuum::ServerRowMap *storage, int32_t row_id) {
+  return storage->Find(row_id);
+}
+
+void Insert(NodeMap *storage, int32_t row_id) {
+  storage->emplace(row_id, MakeRow());
+}
+
+void Insert(petuum::ServerRowMap *storage, int32_t row_id) {
+  storage->Insert(row_id, MakeRow());
+}
+
+// Returns rows updated per second.
+template<typename Storage>
+double Apply(Storage *storage, const std::vector<int32_t> &row_ids,
+             const std::vector<float> &updates) {
+  auto begin = std::chrono::steady_clock::now();
+  for (int32_t pass = 0; pass < FLAGS_num_passes; ++pass) {
+    for (int32_t row_id : row_ids) {
+      petuum::ServerRow *server_row = Find(storage, row_id);
+      CHECK(server_row != 0);
+      server_row->ApplyDenseBatchInc(updates.data(), FLAGS_row_capacity);
+    }
+  }
+  return double(row_ids.size()) * FLAGS_num_passes / Seconds(begin);
+}
+
+template<typename Storage>
+void Run(const char *name, Storage *storage,
+         const std::vector<int32_t> &row_ids) {
+  auto begin = std::chrono::steady_clock::now();
+  for (int32_t row_id : row_ids)
+    Insert(storage, row_id);
+  double insert_secs = Seconds(begin);
+
+  std::vector<float> updates(FLAGS_row_capacity, 1);
+  std::vector<int32_t> random_ids(row_ids);
+  std::shuffle(random_ids.begin(), random_ids.end(), std::mt19937(0));
+  double random_rate = Apply(storage, random_ids, updates);
+  double sorted_rate = Apply(storage, row_ids, updates);
+
+  begin = std::chrono::steady_clock::now();
+  size_t num_bytes = 0;
+  for (int32_t pass = 0; pass < FLAGS_num_passes; ++pass) {
+    for (auto iter = storage->begin(); iter != storage->end(); ++iter)
+      num_bytes += iter->second.SerializedSize();
+  }
+  double iterate_rate = double(row_ids.size()) * FLAGS_num_passes
+                        / Seconds(begin);
+  CHECK_EQ(num_bytes, size_t(FLAGS_num_passes) * row_ids.size()
+           * FLAGS_row_capacity * sizeof(float));
+
+  printf("%-16s insert = %6.3fs apply random = %.3e rows/s "
+         "apply in order = %.3e rows/s iterate = %.3e rows/s\n",
+         name, insert_secs, random_rate, sorted_rate, iterate_rate);
+}
+
+}  // anonymous namespace
+
+int main(int argc, char *argv[]) {
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+
+  std::vector<int32_t> row_ids(FLAGS_num_rows);
+  for (int32_t i = 0; i < FLAGS_num_rows; ++i)
+    row_ids[i] = i * FLAGS_num_server_threads;
+
+  {
+    NodeMap storage;
+    Run("unordered_map", &storage, row_ids);
+  }
+  {
+    petuum::ServerRowMap storage;
+    Run("flat hashed", &storage, row_ids);
+  }
+  {
+    petuum::ServerRowMap storage;
+    storage.SetDense(FLAGS_num_server_threads, 0);
+    Run("flat dense", &storage, row_ids);
+  }
+  return 0;
+}
@@ -0,0 +1,169 @@
+// Description: How much of the cost of reading training data
+// StreamingDataSource hides behind training, and the memory it saves over
+// loading the whole file. Writes a synthetic LibSVM file, then times one
+// epoch of: (1) reading only, (2) a stand-in for training (least
+// squares SGD on a sparse weight vector) on data already in memory, and
+// (3) streaming and training together, reporting how long NextBlock()
+// stalled. Last, the whole file is loaded with ReadDataLabelLibSVM for the
+// peak memory comparison.
+
+#include <ml/include/ml.hpp>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <sys/resource.h>
+#include <chrono>
+#include <fstream>
+#include <random>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+
+DEFINE_string(data_file, "/tmp/streaming_data_source_bench.libsvm",
+    "Synthetic LibSVM file to write and read.");
+DEFINE_int32(num_data, 200000, "# of examples.");
+DEFINE_int32(feature_dim, 100000, "Feature dimension.");
+DEFINE_int32(num_nonzeros, 50, "# of nonzero features per example.");
+DEFINE_int32(block_size, 1000, "# of examples per block.");
+DEFINE_int32(num_compute_passes, 20, "# of SGD passes over each block, "
+    "which sets how long training a block takes.");
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+double Seconds(Clock::time_point begin) {
+  return std::chrono::duration<double>(Clock::now() - begin).count();
+}
+
+// Peak resident set size in MB.
+double PeakRSSMB() {
+  struct rusage usage;
+  CHECK_EQ(getrusage(RUSAGE_SELF, &usage), 0);
+  return usage.ru_maxrss / 1024.;
+}
+
+void WriteData() {
+  std::ofstream out(FLAGS_data_file);
+  CHECK(out) << "Can't open " << FLAGS_data_file;
+  std::mt19937 rng(0);
+  std::uniform_int_distribution<int32_t> stride(
+      1, 2 * FLAGS_feature_dim / FLAGS_num_nonzeros - 1);
+  for (int32_t i = 0; i < FLAGS_num_data; ++i) {
+    out << (i % 2);
+    int32_t feature_id = 0;
+    for (int32_t j = 0; j < FLAGS_num_nonzeros; ++j) {
+      feature_id += stride(rng);
+      if (feature_id >= FLAGS_feature_dim)
+        break;
+      out << " " << feature_id << ":" << (j + 1) * 0.01;
+    }
+    out << "\n";
+  }
+  CHECK(out);
+}
+
+// Stand-in for training on a block: least squares SGD.
+float Train(const petuum::ml::DataBlock &block, std::vector<float> *weights) {
+  const float kLearningRate = 1e-4;
+  float sum = 0;
+  for (int32_t pass = 0; pass < FLAGS_num_compute_passes; ++pass) {
+    for (int32_t i = 0; i < block.GetNumData(); ++i) {
+      petuum::ml::SparseDatumView x = block.sparse_features.GetDatum(i);
+      float prediction = 0;
+      for (int32_t j = 0; j < x.GetNumEntries(); ++j)
+        prediction += (*weights)[x.GetFeatureId(j)] * x.GetFeatureVal(j);
+      float grad = prediction - block.labels[i];
+      for (int32_t j = 0; j < x.GetNumEntries(); ++j) {
+        (*weights)[x.GetFeatureId(j)]
+            -= kLearningRate * grad * x.GetFeatureVal(j);
+      }
+      sum += grad;
+    }
+  }
+  return sum;
+}
+
+petuum::ml::StreamingDataSourceConfig MakeConfig() {
+  petuum::ml::StreamingDataSourceConfig config;
+  config.filename = FLAGS_data_file;
+  config.format = petuum::ml::kLibSVMFormat;
+  config.feature_dim = FLAGS_feature_dim;
+  config.block_size = FLAGS_block_size;
+  config.data_idx_begin = 0;
+  config.data_idx_end = FLAGS_num_data;
+  return config;
+}
+
+}  // anonymous namespace
+
+int main(int argc, char *argv[]) {
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  CHECK_GT(FLAGS_num_nonzeros, 0);
+  CHECK_GT(2 * FLAGS_feature_dim / FLAGS_num_nonzeros, 1);
+
+  WriteData();
+  std::vector<float> weights(FLAGS_feature_dim, 0.5);
+  float checksum = 0;
+
+  // (1) Reading only.
+  double read_secs;
+  petuum::ml::DataBlock first_block;
+  {
+    petuum::ml::StreamingDataSource source(MakeConfig());
+    auto begin = Clock::now();
+    int64_t num_read = 0;
+    while (const petuum::ml::DataBlock *block = source.NextBlock()) {
+      if (num_read == 0)
+        first_block = *block;
+      num_read += block->GetNumData();
+    }
+    read_secs = Seconds(begin);
+    CHECK_EQ(num_read, FLAGS_num_data);
+  }
+
+  // (2) Training only, on one block in memory as many times as there are
+  // blocks.
+  auto begin = Clock::now();
+  int32_t num_blocks = (FLAGS_num_data + FLAGS_block_size - 1)
+                       / FLAGS_block_size;
+  for (int32_t i = 0; i < num_blocks; ++i)
+    checksum += Train(first_block, &weights);
+  double train_secs = Seconds(begin);
+
+  // (3) Streaming and training.
+  double stream_secs, stall_secs = 0;
+  {
+    petuum::ml::StreamingDataSource source(MakeConfig());
+    begin = Clock::now();
+    while (true) {
+      auto wait_begin = Clock::now();
+      const petuum::ml::DataBlock *block = source.NextBlock();
+      stall_secs += Seconds(wait_begin);
+      if (block == 0)
+        break;
+      checksum += Train(*block, &weights);
+    }
+    stream_secs = Seconds(begin);
+  }
+  double streaming_rss_mb = PeakRSSMB();
+
+  // Whole file in memory.
+  begin = Clock::now();
+  petuum::ml::SparseDataset features(FLAGS_feature_dim);
+  std::vector<int32_t> labels;
+  petuum::ml::ReadDataLabelLibSVM(FLAGS_data_file, FLAGS_feature_dim,
+      FLAGS_num_data, &features, &labels, false, false, false);
+  double load_secs = Seconds(begin);
+  CHECK_EQ(features.GetNumData(), FLAGS_num_data);
+  double load_rss_mb = PeakRSSMB();
+
+  printf("read only: %.2fs train only: %.2fs stream + train: %.2fs "
+         "(stalled in NextBlock(): %.2fs)\n",
+         read_secs, train_secs, stream_secs, stall_secs);
+  printf("peak RSS: streaming %.1f MB, after loading the whole file "
+         "(%.2fs) %.1f MB\n", streaming_rss_mb, load_secs, load_rss_mb);
+  printf("checksum %g\n", checksum);
+  remove(FLAGS_data_file.c_str());
+  return 0;
+}